@@ -0,0 +1,83 @@
+// delivery_mode_benchmark_test.dart
+//
+// End-to-end delivery latency: SendPort posting vs NativeCallable.listener.
+//
+// Registration delivers the current count immediately through the same
+// native path as a count change (DartPortManager::Deliver), so timing
+// register → first delivery measures the native → Dart hop of each mode.
+// The native-side fan-out cost and allocations per update are measured by
+// windows/benchmark/delivery_mode_benchmark.cpp.
+// Must run with: flutter test integration_test/
+
+import 'dart:async';
+import 'dart:ffi';
+import 'dart:isolate';
+
+import 'package:flutter/foundation.dart';
+import 'package:flutter_test/flutter_test.dart';
+import 'package:integration_test/integration_test.dart';
+
+import 'package:win_shmem_multi_window/window_manager_ffi.dart';
+
+const int _iterations = 200;
+
+/// Returns [p50, p99] of [samples] in microseconds.
+List<int> _percentiles(List<int> samples) {
+  final sorted = [...samples]..sort();
+  int at(double q) => sorted[((sorted.length - 1) * q).round()];
+  return [at(0.50), at(0.99)];
+}
+
+Future<int> _measurePortDelivery(WindowManagerFFI ffi) async {
+  final receivePort = ReceivePort();
+  final stopwatch = Stopwatch()..start();
+  final first = receivePort.first;
+  ffi.registerWindowCountPort(receivePort.sendPort);
+  await first;
+  stopwatch.stop();
+  ffi.unregisterWindowCountPort(receivePort.sendPort);
+  receivePort.close();
+  return stopwatch.elapsedMicroseconds;
+}
+
+Future<int> _measureListenerDelivery(WindowManagerFFI ffi) async {
+  final delivered = Completer<void>();
+  final callable = NativeCallable<WindowCountListenerNative>.listener(
+    (int count) {
+      if (!delivered.isCompleted) delivered.complete();
+    },
+  );
+  final stopwatch = Stopwatch()..start();
+  ffi.registerWindowCountListener(callable);
+  await delivered.future;
+  stopwatch.stop();
+  ffi.unregisterWindowCountListener(callable);
+  callable.close();
+  return stopwatch.elapsedMicroseconds;
+}
+
+void main() {
+  IntegrationTestWidgetsFlutterBinding.ensureInitialized();
+
+  test('delivery mode latency: port vs NativeCallable.listener', () async {
+    final ffi = WindowManagerFFI();
+    expect(ffi.initializeDartApi(), 0);
+
+    final port = <int>[];
+    final listener = <int>[];
+    for (var i = 0; i < _iterations; i++) {
+      port.add(await _measurePortDelivery(ffi));
+      listener.add(await _measureListenerDelivery(ffi));
+    }
+
+    final portStats = _percentiles(port);
+    final listenerStats = _percentiles(listener);
+    debugPrint('delivery_mode port      p50=${portStats[0]}us '
+        'p99=${portStats[1]}us');
+    debugPrint('delivery_mode listener  p50=${listenerStats[0]}us '
+        'p99=${listenerStats[1]}us');
+
+    expect(port.length, _iterations);
+    expect(listener.length, _iterations);
+  });
+}
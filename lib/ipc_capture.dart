@@ -0,0 +1,54 @@
+// ipc_capture.dart
+//
+// Dart access to native IPC traffic capture (windows/runner/ipc_capture.h).
+//
+// A capture writes every count change, listener start/stop/wake, Dart post
+// and subscriber change of all windows to a compact binary file until it is
+// stopped. Replay the file offline with the ipc_replay tool
+// (windows/test/ipc_replay.cpp) to reproduce and benchmark real traffic.
+
+import 'dart:convert';
+import 'dart:ffi';
+import 'dart:typed_data';
+
+// FFI function signatures
+typedef StartIpcCaptureNative = Bool Function(Pointer<Uint8>);
+typedef StartIpcCaptureDart = bool Function(Pointer<Uint8>);
+typedef StopIpcCaptureNative = Bool Function();
+typedef StopIpcCaptureDart = bool Function();
+
+/// Control of the native IPC traffic capture.
+///
+/// Example:
+///   IpcCapture.start(r'C:\temp\ipc_capture.bin');
+///   // ... reproduce the slow pattern ...
+///   IpcCapture.stop();
+abstract final class IpcCapture {
+  static final DynamicLibrary _nativeLib = DynamicLibrary.process();
+
+  // Leaf so the path can be passed as a TypedData address without
+  // package:ffi; starting only opens the file and a polling thread.
+  static final StartIpcCaptureDart _start = _nativeLib.lookupFunction<
+      StartIpcCaptureNative,
+      StartIpcCaptureDart>('StartIpcCapture', isLeaf: true);
+
+  static final StopIpcCaptureDart _stop = _nativeLib
+      .lookupFunction<StopIpcCaptureNative, StopIpcCaptureDart>(
+          'StopIpcCapture');
+
+  /// Start capturing the IPC traffic of all windows to [path].
+  ///
+  /// Returns false if a capture is already running in this window or the
+  /// file could not be created.
+  static bool start(String path) {
+    final bytes = utf8.encode(path);
+    final buffer = Uint8List(bytes.length + 1)..setAll(0, bytes);
+    return _start(buffer.address);
+  }
+
+  /// Stop the capture started by [start] and finish its file.
+  ///
+  /// Returns false if no capture was running or the file could not be
+  /// written.
+  static bool stop() => _stop();
+}
@@ -0,0 +1,41 @@
+// ipc_flight_recorder.dart
+//
+// Dart access to the native IPC flight recorder
+// (windows/runner/ipc_flight_recorder.h).
+//
+// Every window records its recent IPC events (count changes, listener
+// wakeups, Dart posts, subscriber changes) into one shared ring that
+// outlives the window that wrote them, so any surviving window can dump the
+// history of one that hung or crashed.
+
+import 'dart:convert';
+import 'dart:ffi';
+import 'dart:typed_data';
+
+// FFI function signatures
+typedef DumpIpcFlightRecorderNative = Bool Function(Pointer<Uint8>);
+typedef DumpIpcFlightRecorderDart = bool Function(Pointer<Uint8>);
+
+/// Access to the native IPC flight recorder.
+///
+/// Example:
+///   IpcFlightRecorder.dump(r'C:\temp\ipc_flight.txt');
+abstract final class IpcFlightRecorder {
+  static final DynamicLibrary _nativeLib = DynamicLibrary.process();
+
+  // Leaf so the path can be passed as a TypedData address without
+  // package:ffi; the dump is a short, on-demand diagnostics write.
+  static final DumpIpcFlightRecorderDart _dump = _nativeLib.lookupFunction<
+      DumpIpcFlightRecorderNative,
+      DumpIpcFlightRecorderDart>('DumpIpcFlightRecorder', isLeaf: true);
+
+  /// Write the recent IPC events of all windows to [path] as text, oldest
+  /// first.
+  ///
+  /// Returns false if the file could not be written.
+  static bool dump(String path) {
+    final bytes = utf8.encode(path);
+    final buffer = Uint8List(bytes.length + 1)..setAll(0, bytes);
+    return _dump(buffer.address);
+  }
+}
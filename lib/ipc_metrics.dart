@@ -0,0 +1,155 @@
+// ipc_metrics.dart
+//
+// Dart access to the native IPC metrics (windows/runner/ipc_metrics.h).
+//
+// Every window process records counters, gauges and latency histograms into
+// its own slot of a shared region; a snapshot sums all of them, so any
+// window sees the metrics of every open window.
+
+import 'dart:ffi';
+import 'dart:typed_data';
+
+// FFI function signatures
+typedef GetIpcMetricsSnapshotNative = Bool Function(Pointer<Int64>);
+typedef GetIpcMetricsSnapshotDart = bool Function(Pointer<Int64>);
+typedef DumpIpcMetricsNative = Void Function();
+typedef DumpIpcMetricsDart = void Function();
+
+/// Counter names, in native Counter order.
+const List<String> kIpcCounterNames = [
+  'notifications.sent',
+  'notifications.received',
+  'notifications.coalesced',
+  'dart.posts',
+  'dart.post_failures',
+  'dart.filtered',
+  'spin.hits',
+  'spin.nanoseconds',
+  'delivery.coalesce_merged',
+  'delivery.debounce_merged',
+  'delivery.frame_merged',
+  'topics.published',
+  'topics.wakeups',
+  'callbacks.queued',
+  'callbacks.collapsed',
+];
+
+/// Gauge names, in native Gauge order.
+const List<String> kIpcGaugeNames = [
+  'dart.subscribers',
+  'listeners.running',
+];
+
+/// Histogram names, in native Histogram order. Values are nanoseconds.
+const List<String> kIpcHistogramNames = [
+  'wake_latency_ns',
+  'callback_duration_ns',
+  'dart_post_duration_ns',
+  'spin_wake_latency_ns',
+];
+
+// Int64 layout of the native MetricsSnapshot struct.
+const int _kMaxCounters = 16;
+const int _kMaxGauges = 8;
+const int _kMaxHistograms = 4;
+const int _kHistogramFields = 8;
+const int _kCountersOffset = 4;
+const int _kGaugesOffset = _kCountersOffset + _kMaxCounters;
+const int _kHistogramsOffset = _kGaugesOffset + _kMaxGauges;
+const int _kSnapshotLength =
+    _kHistogramsOffset + _kMaxHistograms * _kHistogramFields;
+
+/// Aggregated histogram; percentiles are within 12.5% of the true value.
+class IpcHistogramSummary {
+  final int count;
+  final int sum;
+  final int max;
+  final int p50;
+  final int p90;
+  final int p99;
+  final int p999;
+
+  const IpcHistogramSummary(this.count, this.sum, this.max, this.p50,
+      this.p90, this.p99, this.p999);
+
+  double get mean => count == 0 ? 0 : sum / count;
+}
+
+/// Metrics of all open windows at one point in time.
+class IpcMetricsSnapshot {
+  /// Window processes currently recording.
+  final int processCount;
+  final int timestampTicks;
+  final int ticksPerSecond;
+  final Map<String, int> counters;
+  final Map<String, int> gauges;
+  final Map<String, IpcHistogramSummary> histograms;
+
+  const IpcMetricsSnapshot(this.processCount, this.timestampTicks,
+      this.ticksPerSecond, this.counters, this.gauges, this.histograms);
+
+  /// Per-second rate of [counter] since [earlier], e.g. listener wakeups
+  /// per second: `later.rate(earlier, 'notifications.received')`.
+  double rate(IpcMetricsSnapshot earlier, String counter) {
+    final ticks = timestampTicks - earlier.timestampTicks;
+    if (ticks <= 0 || ticksPerSecond <= 0) return 0;
+    final delta = (counters[counter] ?? 0) - (earlier.counters[counter] ?? 0);
+    return delta * ticksPerSecond / ticks;
+  }
+}
+
+/// Access to the native IPC metrics.
+///
+/// Example:
+///   final before = IpcMetrics.snapshot();
+///   ...
+///   final after = IpcMetrics.snapshot();
+///   print(after?.rate(before!, 'notifications.received'));
+///   IpcMetrics.dump();  // Writes all metrics to the native log
+abstract final class IpcMetrics {
+  static final DynamicLibrary _nativeLib = DynamicLibrary.process();
+
+  // Leaf so the snapshot can be written straight into a TypedData buffer.
+  static final GetIpcMetricsSnapshotDart _snapshot = _nativeLib.lookupFunction<
+      GetIpcMetricsSnapshotNative,
+      GetIpcMetricsSnapshotDart>('GetIpcMetricsSnapshot', isLeaf: true);
+
+  static final DumpIpcMetricsDart _dump = _nativeLib
+      .lookupFunction<DumpIpcMetricsNative, DumpIpcMetricsDart>(
+          'DumpIpcMetrics');
+
+  /// Aggregate the metrics of all windows.
+  ///
+  /// Returns null if the native metrics region is unavailable.
+  static IpcMetricsSnapshot? snapshot() {
+    final raw = Int64List(_kSnapshotLength);
+    if (!_snapshot(raw.address)) {
+      return null;
+    }
+    return IpcMetricsSnapshot(
+      raw[0],
+      raw[1],
+      raw[2],
+      {
+        for (var i = 0; i < kIpcCounterNames.length; i++)
+          kIpcCounterNames[i]: raw[_kCountersOffset + i],
+      },
+      {
+        for (var i = 0; i < kIpcGaugeNames.length; i++)
+          kIpcGaugeNames[i]: raw[_kGaugesOffset + i],
+      },
+      {
+        for (var i = 0; i < kIpcHistogramNames.length; i++)
+          kIpcHistogramNames[i]: _histogram(
+              raw, _kHistogramsOffset + i * _kHistogramFields),
+      },
+    );
+  }
+
+  /// Write the metrics of all windows to the native log.
+  static void dump() => _dump();
+
+  static IpcHistogramSummary _histogram(Int64List raw, int offset) =>
+      IpcHistogramSummary(raw[offset], raw[offset + 1], raw[offset + 2],
+          raw[offset + 3], raw[offset + 4], raw[offset + 5], raw[offset + 6]);
+}
@@ -0,0 +1,61 @@
+// ipc_trace.dart
+//
+// Dart end of the native end-to-end latency trace (windows/runner/ipc_trace.h).
+//
+// Native code records every stage of a window count update under one trace
+// ID. Ports registered with DartPortFilter.traceId receive that ID with the
+// count; calling [IpcTrace.markReceived] from the handler adds the final
+// "dart.receive" stage. [IpcTrace.export] writes the stages of all windows
+// as Chrome JSON for chrome://tracing or ui.perfetto.dev.
+
+import 'dart:convert';
+import 'dart:ffi';
+import 'dart:typed_data';
+
+// FFI function signatures
+typedef RecordIpcTraceDartReceiveNative = Void Function(Uint32);
+typedef RecordIpcTraceDartReceiveDart = void Function(int);
+typedef ExportIpcTraceNative = Bool Function(Pointer<Uint8>);
+typedef ExportIpcTraceDart = bool Function(Pointer<Uint8>);
+
+/// Access to the native IPC trace.
+///
+/// Example:
+///   receivePort.listen((message) {
+///     final update = message as int;
+///     IpcTrace.markReceived(update.traceId);
+///     setState(() => count = update.tracedValue);
+///   });
+///   ...
+///   IpcTrace.export(r'C:\temp\ipc_trace.json');
+abstract final class IpcTrace {
+  static final DynamicLibrary _nativeLib = DynamicLibrary.process();
+
+  static final RecordIpcTraceDartReceiveDart _markReceived =
+      _nativeLib.lookupFunction<RecordIpcTraceDartReceiveNative,
+          RecordIpcTraceDartReceiveDart>('RecordIpcTraceDartReceive',
+          isLeaf: true);
+
+  // Leaf so the path can be passed as a TypedData address without
+  // package:ffi. Writing the file blocks this isolate briefly, which is
+  // acceptable for an on-demand diagnostics export.
+  static final ExportIpcTraceDart _export = _nativeLib.lookupFunction<
+      ExportIpcTraceNative, ExportIpcTraceDart>('ExportIpcTrace', isLeaf: true);
+
+  /// Record that this isolate's handler received update [traceId].
+  ///
+  /// Call it first thing in the handler. Trace ID 0 is ignored.
+  static void markReceived(int traceId) {
+    if (traceId == 0) return;
+    _markReceived(traceId);
+  }
+
+  /// Write the recorded stages of all windows to [path] as Chrome JSON.
+  ///
+  /// Returns false if the file could not be written.
+  static bool export(String path) {
+    final bytes = utf8.encode(path);
+    final buffer = Uint8List(bytes.length + 1)..setAll(0, bytes);
+    return _export(buffer.address);
+  }
+}
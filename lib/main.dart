@@ -2,6 +2,7 @@ import 'dart:io';
 
 import 'package:flutter/material.dart';
 
+import 'native_command_channel.dart';
 import 'services/ffi_window_count_service.dart';
 import 'widgets/window_counter_widget.dart';
 import 'window_manager_ffi.dart';
@@ -74,15 +75,18 @@ class _WindowCounterScreenState extends State<WindowCounterScreen> {
 
   /// Closes the current window via Win32 WM_CLOSE message.
   ///
-  /// Uses FFI to send WM_CLOSE to the window, triggering proper cleanup:
-  /// WM_CLOSE → WM_DESTROY → OnDestroy() → DecrementWindowCount()
+  /// Posts a close command over the native command channel, triggering
+  /// proper cleanup: WM_CLOSE → WM_DESTROY → OnDestroy() →
+  /// DecrementWindowCount(). The window lookup runs on a native thread,
+  /// not on the UI isolate thread.
   ///
   /// This ensures window count is properly decremented, unlike exit(0)
   /// which would bypass the Win32 message loop.
-  void _closeCurrentWindow() {
+  Future<void> _closeCurrentWindow() async {
     debugPrint('Closing current window via WM_CLOSE...');
-    final ffi = WindowManagerFFI();
-    ffi.closeWindow();
+    final channel = await NativeCommandChannel.open(WindowManagerFFI());
+    await channel.requestWindowClose();
+    channel.close();
   }
 
   @override
@@ -0,0 +1,101 @@
+// native_command_channel.dart
+//
+// Asynchronous Dart → C++ command channel backed by a native port
+// (Dart_NewNativePort_DL in DartCommandPort).
+//
+// Commands are posted with SendPort.send() and answered on a ReceivePort,
+// so no native work runs on the UI isolate thread and many commands can be
+// in flight at once.
+
+import 'dart:async';
+import 'dart:isolate';
+
+import 'window_manager_ffi.dart';
+
+/// Command identifiers (mirrors DartCommand in dart_command_port.h).
+abstract final class NativeCommand {
+  static const int registerPort = 1;
+  static const int unregisterPort = 2;
+  static const int requestWindowClose = 3;
+}
+
+/// Sends commands to native code and completes futures on replies.
+///
+/// Message format:
+///   request: [command, requestId, replyPort, ...arguments]
+///   reply:   [requestId, result]
+///
+/// Example:
+///   final channel = await NativeCommandChannel.open(WindowManagerFFI());
+///   await channel.registerPort(receivePort.sendPort);
+///   await channel.requestWindowClose();
+class NativeCommandChannel {
+  final ReceivePort _replies;
+  final SendPort _commandPort;
+  final Map<int, Completer<bool>> _pending = {};
+  int _nextRequestId = 1;
+
+  NativeCommandChannel._(this._replies, this._commandPort, Stream replies) {
+    replies.listen(_handleReply);
+  }
+
+  /// Opens the channel. The first message on the reply port is the native
+  /// command SendPort; all later messages are replies.
+  static Future<NativeCommandChannel> open(WindowManagerFFI ffi) async {
+    final replies = ReceivePort();
+    final stream = replies.asBroadcastStream();
+    final firstMessage = stream.first;
+    if (!ffi.openDartCommandChannel(replies.sendPort)) {
+      replies.close();
+      throw StateError('OpenDartCommandChannel failed');
+    }
+    final commandPort = await firstMessage as SendPort;
+    return NativeCommandChannel._(replies, commandPort, stream);
+  }
+
+  /// Register [port] for window count updates with optional filters.
+  Future<bool> registerPort(
+    SendPort port, {
+    int topicMask = DartPortTopic.all,
+    int filterFlags = DartPortFilter.none,
+    int threshold = 0,
+  }) {
+    return _send(NativeCommand.registerPort,
+        [port, topicMask, filterFlags, threshold]);
+  }
+
+  /// Unregister a previously registered [port].
+  Future<bool> unregisterPort(SendPort port) {
+    return _send(NativeCommand.unregisterPort, [port]);
+  }
+
+  /// Request graceful window close (WM_CLOSE) without blocking the UI thread.
+  Future<bool> requestWindowClose() {
+    return _send(NativeCommand.requestWindowClose, const []);
+  }
+
+  /// Fails all pending commands and closes the reply port.
+  void close() {
+    for (final completer in _pending.values) {
+      completer.completeError(StateError('NativeCommandChannel closed'));
+    }
+    _pending.clear();
+    _replies.close();
+  }
+
+  Future<bool> _send(int command, List<Object> arguments) {
+    final requestId = _nextRequestId++;
+    final completer = Completer<bool>();
+    _pending[requestId] = completer;
+    _commandPort.send([command, requestId, _replies.sendPort, ...arguments]);
+    return completer.future;
+  }
+
+  void _handleReply(dynamic message) {
+    if (message is! List || message.length != 2) {
+      return;
+    }
+    final completer = _pending.remove(message[0] as int);
+    completer?.complete(message[1] as bool);
+  }
+}
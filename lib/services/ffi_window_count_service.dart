@@ -4,19 +4,43 @@
 // Connects to C++ layer via WindowManagerFFI.
 
 import 'dart:async';
+import 'dart:ffi';
 import 'dart:isolate';
 
 import 'package:flutter/foundation.dart';
 
+import '../ipc_trace.dart';
 import '../window_manager_ffi.dart';
 import 'window_count_service.dart';
 
+/// How window count updates travel from native code to this isolate.
+enum WindowCountDelivery {
+  /// Dart_PostCObject to a ReceivePort (default).
+  port,
+
+  /// Direct call of a NativeCallable.listener from the notification thread.
+  listener,
+}
+
 /// FFI-based implementation of WindowCountService.
 ///
 /// Connects to the C++ DartPortManager to receive window count updates.
 class FFIWindowCountService implements WindowCountService {
+  FFIWindowCountService({
+    this.delivery = WindowCountDelivery.port,
+    this.traced = false,
+  });
+
+  /// Delivery mode used by [initialize].
+  final WindowCountDelivery delivery;
+
+  /// Receive each update's ipc_trace ID and report its arrival to
+  /// [IpcTrace], completing the native end-to-end latency trace.
+  final bool traced;
+
   WindowManagerFFI? _ffi;
   ReceivePort? _receivePort;
+  NativeCallable<WindowCountListenerNative>? _listener;
   final StreamController<int> _controller = StreamController<int>.broadcast();
   int? _currentCount;
   bool _isInitialized = false;
@@ -43,18 +67,25 @@ class FFIWindowCountService implements WindowCountService {
         return false;
       }
 
-      _receivePort = ReceivePort();
+      final bool registered;
+      if (delivery == WindowCountDelivery.listener) {
+        _listener = NativeCallable<WindowCountListenerNative>.listener(
+          _handleCount,
+        );
+        registered = _ffi!.registerWindowCountListener(_listener!,
+            filterFlags: _filterFlags);
+      } else {
+        _receivePort = ReceivePort();
 
-      // Listen for updates from C++ layer
-      _receivePort!.listen((message) {
-        debugPrint('FFIWindowCountService: Received count: $message');
-        final count = message as int;
-        _currentCount = count;
-        _controller.add(count);
-      });
+        // Listen for updates from C++ layer
+        _receivePort!.listen((message) => _handleCount(message as int));
 
-      // Register port with C++ layer
-      final registered = _ffi!.registerWindowCountPort(_receivePort!.sendPort);
+        // Register port with C++ layer
+        registered = traced
+            ? _ffi!.registerWindowCountPortFiltered(_receivePort!.sendPort,
+                filterFlags: _filterFlags)
+            : _ffi!.registerWindowCountPort(_receivePort!.sendPort);
+      }
 
       if (registered) {
         debugPrint('FFIWindowCountService: Port registered');
@@ -70,8 +101,32 @@ class FFIWindowCountService implements WindowCountService {
     }
   }
 
+  int get _filterFlags => traced ? DartPortFilter.traceId : DartPortFilter.none;
+
+  void _handleCount(int message) {
+    final int count;
+    if (traced) {
+      IpcTrace.markReceived(message.traceId);
+      count = message.tracedValue;
+    } else {
+      count = message;
+    }
+    debugPrint('FFIWindowCountService: Received count: $count');
+    _currentCount = count;
+    _controller.add(count);
+  }
+
   @override
   void dispose() {
+    if (_ffi != null && _listener != null) {
+      try {
+        _ffi!.unregisterWindowCountListener(_listener!);
+      } catch (e) {
+        debugPrint('FFIWindowCountService: Error unregistering listener: $e');
+      }
+      _listener!.close();
+      _listener = null;
+    }
     if (_ffi != null && _receivePort != null) {
       try {
         _ffi!.unregisterWindowCountPort(_receivePort!.sendPort);
@@ -0,0 +1,149 @@
+// shared_buffer_pool.dart
+//
+// Zero-copy transfer of large payloads (images, documents, serialized
+// models) between windows through the native SharedBufferPool.
+//
+// Sending writes straight into shared memory through a Uint8List view of
+// the slot. Receiving yields a Uint8List that is itself a view of the slot
+// (Dart_CObject_kExternalTypedData); the slot returns to the pool when that
+// list is garbage collected. No temp files, no copies in native code.
+
+import 'dart:ffi';
+import 'dart:isolate';
+import 'dart:typed_data';
+
+// FFI function signatures
+typedef OpenSharedBufferPoolNative = Bool Function(Int64);
+typedef OpenSharedBufferPoolDart = bool Function(int);
+typedef CloseSharedBufferPoolNative = Void Function();
+typedef CloseSharedBufferPoolDart = void Function();
+typedef AcquireSharedBufferNative = Int64 Function();
+typedef AcquireSharedBufferDart = int Function();
+typedef GetSharedBufferDataNative = Pointer<Uint8> Function(Int64);
+typedef GetSharedBufferDataDart = Pointer<Uint8> Function(int);
+typedef GetSharedBufferCapacityNative = Uint32 Function();
+typedef GetSharedBufferCapacityDart = int Function();
+typedef PublishSharedBufferNative = Bool Function(Int64, Uint32, Uint32);
+typedef PublishSharedBufferDart = bool Function(int, int, int);
+typedef ReleaseSharedBufferNative = Bool Function(Int64);
+typedef ReleaseSharedBufferDart = bool Function(int);
+
+/// A payload received from another window.
+class SharedBuffer {
+  /// Pool handle, valid until [data] is garbage collected.
+  final int handle;
+
+  /// Process ID of the sending window.
+  final int senderPid;
+
+  /// View into shared memory. Do not keep it longer than needed: the pool
+  /// slot stays reserved while this list is reachable.
+  final Uint8List data;
+
+  const SharedBuffer(this.handle, this.senderPid, this.data);
+}
+
+/// A slot acquired for writing. Fill [data], then publish or abandon it.
+class SharedBufferWriter {
+  final SharedBufferPool _pool;
+
+  /// Pool handle of the reserved slot.
+  final int handle;
+
+  /// Writable view of the whole slot (capacity bytes).
+  final Uint8List data;
+
+  bool _done = false;
+
+  SharedBufferWriter._(this._pool, this.handle, this.data);
+
+  /// Hand the first [length] bytes to another window.
+  ///
+  /// [targetPid] 0 delivers to the first other window that claims it.
+  bool publish(int length, {int targetPid = 0}) {
+    if (_done) return false;
+    _done = true;
+    return _pool._publish(handle, length, targetPid);
+  }
+
+  /// Return the slot without sending anything.
+  void abandon() {
+    if (_done) return;
+    _done = true;
+    _pool._release(handle);
+  }
+}
+
+/// Dart side of the native SharedBufferPool.
+///
+/// Example:
+///   final pool = SharedBufferPool.open();
+///   pool.buffers.listen((buffer) => decodeImage(buffer.data));
+///
+///   final writer = pool.acquire()!;
+///   writer.data.setAll(0, pngBytes);
+///   writer.publish(pngBytes.length);
+class SharedBufferPool {
+  final ReceivePort _inbox;
+  final CloseSharedBufferPoolDart _close;
+  final AcquireSharedBufferDart _acquire;
+  final GetSharedBufferDataDart _getData;
+  final PublishSharedBufferDart _publish;
+  final ReleaseSharedBufferDart _release;
+
+  /// Capacity of every slot in bytes.
+  final int capacity;
+
+  SharedBufferPool._(this._inbox, this._close, this._acquire, this._getData,
+      this._publish, this._release, this.capacity);
+
+  /// Open the pool and start receiving buffers sent to this window.
+  ///
+  /// Requires WindowManagerFFI.initializeDartApi() to have been called.
+  static SharedBufferPool open() {
+    final DynamicLibrary nativeLib = DynamicLibrary.process();
+
+    final open = nativeLib.lookupFunction<OpenSharedBufferPoolNative,
+        OpenSharedBufferPoolDart>('OpenSharedBufferPool');
+    final close = nativeLib.lookupFunction<CloseSharedBufferPoolNative,
+        CloseSharedBufferPoolDart>('CloseSharedBufferPool');
+    final acquire = nativeLib.lookupFunction<AcquireSharedBufferNative,
+        AcquireSharedBufferDart>('AcquireSharedBuffer', isLeaf: true);
+    final getData = nativeLib.lookupFunction<GetSharedBufferDataNative,
+        GetSharedBufferDataDart>('GetSharedBufferData', isLeaf: true);
+    final getCapacity = nativeLib.lookupFunction<GetSharedBufferCapacityNative,
+        GetSharedBufferCapacityDart>('GetSharedBufferCapacity', isLeaf: true);
+    final publish = nativeLib.lookupFunction<PublishSharedBufferNative,
+        PublishSharedBufferDart>('PublishSharedBuffer');
+    final release = nativeLib.lookupFunction<ReleaseSharedBufferNative,
+        ReleaseSharedBufferDart>('ReleaseSharedBuffer', isLeaf: true);
+
+    final inbox = ReceivePort();
+    if (!open(inbox.sendPort.nativePort)) {
+      inbox.close();
+      throw StateError('OpenSharedBufferPool failed');
+    }
+    return SharedBufferPool._(
+        inbox, close, acquire, getData, publish, release, getCapacity());
+  }
+
+  /// Buffers published to this window, in arrival order.
+  Stream<SharedBuffer> get buffers => _inbox.map((message) {
+        final list = message as List;
+        return SharedBuffer(list[0] as int, list[1] as int, list[2] as Uint8List);
+      });
+
+  /// Reserve a slot for writing, or null if every slot is in use.
+  SharedBufferWriter? acquire() {
+    final handle = _acquire();
+    if (handle < 0) return null;
+    final data = _getData(handle).asTypedList(capacity);
+    return SharedBufferWriter._(this, handle, data);
+  }
+
+  /// Stop receiving. Buffers already delivered stay valid until collected.
+  void close() {
+    _close();  // Native side first: nothing is posted to a closed port
+    _inbox.close();
+  }
+}
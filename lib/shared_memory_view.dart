@@ -0,0 +1,172 @@
+// shared_memory_view.dart
+//
+// Zero-hop read access to the native SharedMemoryData segment.
+//
+// Instead of waiting for a port message, Dart maps the same 32 bytes the
+// C++ layer writes and reads fields directly (e.g. during build()). The
+// Struct below mirrors windows/runner/shared_memory_manager.h by hand;
+// field offsets are pinned there with static_assert, and open() refuses
+// to attach if the native layout version or size disagree.
+
+import 'dart:ffi';
+import 'dart:typed_data';
+
+/// Mirror of the C++ SharedMemoryData struct (layout version 2).
+///
+/// Keep in sync with kSharedMemoryLayoutVersion in shared_memory_manager.h.
+final class SharedMemoryData extends Struct {
+  @Int32()
+  external int windowCount;
+
+  @Uint32()
+  external int magic;
+
+  @Uint32()
+  external int layoutVersion;
+
+  @Int32()
+  external int lastWriterPid;
+
+  @Int32()
+  external int sequence;
+
+  @Uint32()
+  external int dataSize;
+
+  @Uint32()
+  external int traceId;
+
+  @Uint32()
+  external int reserved;
+}
+
+/// Mirror of the C++ SharedMemorySnapshot struct.
+final class SharedMemorySnapshot extends Struct {
+  @Int32()
+  external int windowCount;
+
+  @Uint32()
+  external int lastWriterPid;
+
+  @Int32()
+  external int sequence;
+
+  @Uint32()
+  external int traceId;
+}
+
+/// Layout version this Dart code was written against.
+const int kSharedMemoryLayoutVersion = 2;
+
+/// Magic marker written by the process that created the segment.
+const int kSharedMemoryMagic = 0xDEADBEEF;
+
+// FFI function signatures
+typedef GetSharedMemoryViewNative = Pointer<SharedMemoryData> Function();
+typedef GetSharedMemoryLayoutVersionNative = Uint32 Function();
+typedef GetSharedMemoryLayoutVersionDart = int Function();
+typedef ReadSharedMemorySnapshotNative = Bool Function(
+    Pointer<SharedMemorySnapshot>);
+typedef ReadSharedMemorySnapshotDart = bool Function(
+    Pointer<SharedMemorySnapshot>);
+
+/// Consistent copy of count, last writer, sequence and trace ID.
+class SharedMemoryState {
+  final int windowCount;
+  final int lastWriterPid;
+  final int sequence;
+
+  /// ipc_trace ID of the write (see windows/runner/ipc_trace.h).
+  final int traceId;
+
+  const SharedMemoryState(
+      this.windowCount, this.lastWriterPid, this.sequence, this.traceId);
+}
+
+/// Read-only view of the shared memory segment.
+///
+/// Single fields are naturally aligned 32-bit values, so reading one of
+/// them (windowCount) is a plain load with no FFI transition. Reads that
+/// must see several fields from the same write go through [snapshot],
+/// which runs the seqlock reader natively as a leaf call because Dart
+/// has no load fences to order the retry loop itself.
+///
+/// Usage:
+///   final view = SharedMemoryView.open();
+///   Text('Windows: ${view?.windowCount ?? 0}');
+class SharedMemoryView {
+  final Pointer<SharedMemoryData> _data;
+  final ReadSharedMemorySnapshotDart _readSnapshot;
+
+  /// Scratch buffer for snapshots. Its address is passed straight to the
+  /// leaf call, so taking a snapshot allocates nothing natively.
+  final Int32List _scratch = Int32List(4);
+
+  SharedMemoryView._(this._data, this._readSnapshot);
+
+  /// Attach to the segment mapped by the current process.
+  ///
+  /// Returns null if shared memory is not initialized, or if the native
+  /// layout does not match this Struct definition (stale Dart code against
+  /// a newer runner, or vice versa).
+  static SharedMemoryView? open() {
+    final DynamicLibrary nativeLib = DynamicLibrary.process();
+
+    final getView = nativeLib.lookupFunction<GetSharedMemoryViewNative,
+        GetSharedMemoryViewNative>('GetSharedMemoryView', isLeaf: true);
+    final getVersion = nativeLib.lookupFunction<
+        GetSharedMemoryLayoutVersionNative,
+        GetSharedMemoryLayoutVersionDart>('GetSharedMemoryLayoutVersion',
+        isLeaf: true);
+    final getSize = nativeLib.lookupFunction<
+        GetSharedMemoryLayoutVersionNative,
+        GetSharedMemoryLayoutVersionDart>('GetSharedMemoryDataSize',
+        isLeaf: true);
+    final readSnapshot = nativeLib.lookupFunction<
+        ReadSharedMemorySnapshotNative,
+        ReadSharedMemorySnapshotDart>('ReadSharedMemorySnapshot',
+        isLeaf: true);
+
+    if (getVersion() != kSharedMemoryLayoutVersion ||
+        getSize() != sizeOf<SharedMemoryData>()) {
+      return null;
+    }
+
+    final data = getView();
+    if (data == nullptr) {
+      return null;
+    }
+
+    // The segment's own header records the layout of whichever process
+    // created it, which may be a different build of the runner.
+    final header = data.ref;
+    if (header.magic != kSharedMemoryMagic ||
+        header.layoutVersion != kSharedMemoryLayoutVersion ||
+        header.dataSize != sizeOf<SharedMemoryData>()) {
+      return null;
+    }
+
+    return SharedMemoryView._(data, readSnapshot);
+  }
+
+  /// Current window count: a single 32-bit load from shared memory.
+  int get windowCount => _data.ref.windowCount;
+
+  /// Current seqlock sequence. Unchanged sequence means unchanged data,
+  /// so callers can cheaply skip work when nothing was written.
+  int get sequence => _data.ref.sequence;
+
+  /// Count, last writer, sequence and trace ID from the same write.
+  ///
+  /// Returns null only if a writer died mid-update and the native retry
+  /// budget ran out.
+  SharedMemoryState? snapshot() {
+    if (!_readSnapshot(_scratch.address.cast<SharedMemorySnapshot>())) {
+      return null;
+    }
+    // Fields in declaration order: count, last writer (unsigned), sequence,
+    // trace ID (unsigned)
+    return SharedMemoryState(_scratch[0], _scratch[1] & 0xFFFFFFFF,
+        _scratch[2], _scratch[3] & 0xFFFFFFFF);
+  }
+}
@@ -9,14 +9,76 @@ import 'dart:isolate';
 // FFI function signatures (C side)
 typedef InitDartApiDLNative = IntPtr Function(Pointer<Void>);
 typedef RegisterWindowCountPortNative = Bool Function(Int64);
+typedef RegisterWindowCountPortFilteredNative = Bool Function(
+    Int64, Uint32, Uint32, Int32);
 typedef UnregisterWindowCountPortNative = Bool Function(Int64);
 typedef RequestWindowCloseNative = Void Function();
+typedef OpenDartCommandChannelNative = Bool Function(Int64);
+typedef WindowCountListenerNative = Void Function(Int64);
+typedef RegisterWindowCountListenerNative = Bool Function(
+    Pointer<NativeFunction<WindowCountListenerNative>>, Uint32, Uint32, Int32);
+typedef UnregisterWindowCountListenerNative = Bool Function(
+    Pointer<NativeFunction<WindowCountListenerNative>>);
+typedef SetIpcDeliveryPolicyNative = Bool Function(Int32, Uint32);
 
 // FFI function signatures (Dart side)
 typedef InitDartApiDLDart = int Function(Pointer<Void>);
 typedef RegisterWindowCountPortDart = bool Function(int);
+typedef RegisterWindowCountPortFilteredDart = bool Function(
+    int, int, int, int);
 typedef UnregisterWindowCountPortDart = bool Function(int);
 typedef RequestWindowCloseDart = void Function();
+typedef OpenDartCommandChannelDart = bool Function(int);
+typedef RegisterWindowCountListenerDart = bool Function(
+    Pointer<NativeFunction<WindowCountListenerNative>>, int, int, int);
+typedef UnregisterWindowCountListenerDart = bool Function(
+    Pointer<NativeFunction<WindowCountListenerNative>>);
+typedef SetIpcDeliveryPolicyDart = bool Function(int, int);
+
+/// Notification topics a port can subscribe to (mirrors DartPortTopic).
+abstract final class DartPortTopic {
+  static const int windowCount = 1 << 0;
+  static const int all = 0xFFFFFFFF;
+}
+
+/// Native filters evaluated before posting (mirrors DartPortFilter).
+abstract final class DartPortFilter {
+  static const int none = 0;
+
+  /// Deliver only when the count crosses the threshold.
+  static const int crossesThreshold = 1 << 0;
+
+  /// Deliver only changes made by another window process.
+  static const int otherProcesses = 1 << 1;
+
+  /// Not a filter: deliver (traceId << 32) | count so the handler can
+  /// report arrival to IpcTrace. Decode with [TracedCount].
+  static const int traceId = 1 << 2;
+}
+
+/// When native code delivers changes (mirrors IpcDeliveryMode).
+abstract final class IpcDeliveryMode {
+  /// Every change as soon as the listener wakes (default).
+  static const int immediate = 0;
+
+  /// One delivery per window of `value` microseconds.
+  static const int coalesce = 1;
+
+  /// Leading and trailing edge, `value` microseconds of quiet.
+  static const int debounce = 2;
+
+  /// At most one delivery per frame of a `value` Hz clock.
+  static const int frameAligned = 3;
+}
+
+/// Decoding of updates delivered with [DartPortFilter.traceId].
+extension TracedCount on int {
+  /// The window count (low 32 bits).
+  int get tracedValue => toSigned(32);
+
+  /// The ipc_trace ID (high 32 bits), 0 for untraced updates.
+  int get traceId => (this >> 32) & 0xFFFFFFFF;
+}
 
 /// WindowManagerFFI provides access to C++ DartPortManager functions.
 ///
@@ -33,8 +95,14 @@ class WindowManagerFFI {
   // Late-initialized FFI functions
   late final InitDartApiDLDart _initDartApiDL;
   late final RegisterWindowCountPortDart _registerWindowCountPort;
+  late final RegisterWindowCountPortFilteredDart
+      _registerWindowCountPortFiltered;
   late final UnregisterWindowCountPortDart _unregisterWindowCountPort;
   late final RequestWindowCloseDart _requestWindowClose;
+  late final OpenDartCommandChannelDart _openDartCommandChannel;
+  late final RegisterWindowCountListenerDart _registerWindowCountListener;
+  late final UnregisterWindowCountListenerDart _unregisterWindowCountListener;
+  late final SetIpcDeliveryPolicyDart _setIpcDeliveryPolicy;
 
   WindowManagerFFI() {
     // Load the native library (process = current executable)
@@ -48,12 +116,32 @@ class WindowManagerFFI {
         RegisterWindowCountPortNative,
         RegisterWindowCountPortDart>('RegisterWindowCountPort');
 
+    _registerWindowCountPortFiltered = nativeLib.lookupFunction<
+        RegisterWindowCountPortFilteredNative,
+        RegisterWindowCountPortFilteredDart>('RegisterWindowCountPortFiltered');
+
     _unregisterWindowCountPort = nativeLib.lookupFunction<
         UnregisterWindowCountPortNative,
         UnregisterWindowCountPortDart>('UnregisterWindowCountPort');
 
     _requestWindowClose = nativeLib.lookupFunction<RequestWindowCloseNative,
         RequestWindowCloseDart>('RequestWindowClose');
+
+    _openDartCommandChannel = nativeLib.lookupFunction<
+        OpenDartCommandChannelNative,
+        OpenDartCommandChannelDart>('OpenDartCommandChannel');
+
+    _registerWindowCountListener = nativeLib.lookupFunction<
+        RegisterWindowCountListenerNative,
+        RegisterWindowCountListenerDart>('RegisterWindowCountListener');
+
+    _unregisterWindowCountListener = nativeLib.lookupFunction<
+        UnregisterWindowCountListenerNative,
+        UnregisterWindowCountListenerDart>('UnregisterWindowCountListener');
+
+    _setIpcDeliveryPolicy = nativeLib.lookupFunction<
+        SetIpcDeliveryPolicyNative,
+        SetIpcDeliveryPolicyDart>('SetIpcDeliveryPolicy');
   }
 
   /// Initialize Dart API DL.
@@ -92,6 +180,68 @@ class WindowManagerFFI {
     return _registerWindowCountPort(sendPort.nativePort);
   }
 
+  /// Register a SendPort that only receives matching updates.
+  ///
+  /// Topic mask and filters are evaluated in native code, so updates this
+  /// port is not interested in never cross into Dart.
+  ///
+  /// Example:
+  ///   // Only notify when the window count reaches or drops below 3
+  ///   ffi.registerWindowCountPortFiltered(
+  ///     receivePort.sendPort,
+  ///     filterFlags: DartPortFilter.crossesThreshold,
+  ///     threshold: 3,
+  ///   );
+  bool registerWindowCountPortFiltered(
+    SendPort sendPort, {
+    int topicMask = DartPortTopic.all,
+    int filterFlags = DartPortFilter.none,
+    int threshold = 0,
+  }) {
+    return _registerWindowCountPortFiltered(
+        sendPort.nativePort, topicMask, filterFlags, threshold);
+  }
+
+  /// Register a NativeCallable.listener for direct callback delivery.
+  ///
+  /// Native code calls the listener from its notification thread; the call
+  /// runs on this isolate's event loop without a ReceivePort in between.
+  /// Unregister before closing the callable.
+  ///
+  /// Example:
+  ///   final callable = NativeCallable<WindowCountListenerNative>.listener(
+  ///     (int count) => setState(() { windowCount = count; }),
+  ///   );
+  ///   ffi.registerWindowCountListener(callable);
+  bool registerWindowCountListener(
+    NativeCallable<WindowCountListenerNative> callable, {
+    int topicMask = DartPortTopic.all,
+    int filterFlags = DartPortFilter.none,
+    int threshold = 0,
+  }) {
+    return _registerWindowCountListener(
+        callable.nativeFunction, topicMask, filterFlags, threshold);
+  }
+
+  /// Unregister a NativeCallable.listener. Call before callable.close().
+  ///
+  /// Returns true if the listener was found and removed.
+  bool unregisterWindowCountListener(
+      NativeCallable<WindowCountListenerNative> callable) {
+    return _unregisterWindowCountListener(callable.nativeFunction);
+  }
+
+  /// Choose how this window process delivers count changes to every port
+  /// and listener, e.g. at most once per 60 Hz frame:
+  ///
+  ///   ffi.setDeliveryPolicy(IpcDeliveryMode.frameAligned, value: 60);
+  ///
+  /// Held deliveries always carry the latest count. Returns false for an
+  /// invalid mode or value.
+  bool setDeliveryPolicy(int mode, {int value = 0}) {
+    return _setIpcDeliveryPolicy(mode, value);
+  }
+
   /// Unregister a previously registered SendPort.
   ///
   /// Should be called when window is destroyed to prevent messages
@@ -119,4 +269,14 @@ class WindowManagerFFI {
   void closeWindow() {
     _requestWindowClose();
   }
+
+  /// Ask native code to post its command SendPort to [replyPort].
+  ///
+  /// This is the only synchronous call needed for the command channel;
+  /// see NativeCommandChannel for the asynchronous protocol.
+  ///
+  /// Returns true if the SendPort was posted.
+  bool openDartCommandChannel(SendPort replyPort) {
+    return _openDartCommandChannel(replyPort.nativePort);
+  }
 }
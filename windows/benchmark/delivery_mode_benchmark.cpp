@@ -0,0 +1,182 @@
+// delivery_mode_benchmark.cpp
+//
+// Google Benchmark comparing DartPortManager delivery modes:
+//   - Port mode: Dart_PostCObject_DL to a SendPort (mocked)
+//   - Listener mode: direct call of a NativeCallable.listener pointer
+//
+// Reports native time per update and heap allocations per update. The
+// plain mock Dart_PostCObject_DL does no copying, so port mode numbers are a
+// lower bound; the real VM additionally allocates and copies one message per
+// port. The SimulatedIsolates variant posts through the simulated VM
+// (test/simulated_dart_runtime.h) instead, which copies and queues every
+// message and handles it on an isolate thread, and adds end-to-end latency
+// and queue depth counters.
+// The Dart-side half of the path is measured by
+// integration_test/delivery_mode_benchmark_test.dart.
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// Include dart_api_dl.h which redirects to our mock in benchmark builds
+#include "dart_api_dl.h"
+
+#include "dart_port_manager.h"
+#include "simulated_dart_runtime.h"
+
+namespace {
+
+// Global allocation counter, incremented by the operator new overrides below.
+std::atomic<int64_t> g_allocations{0};
+
+std::atomic<int64_t> g_listener_calls{0};
+
+void CountingListener(int64_t value) {
+  benchmark::DoNotOptimize(value);
+  g_listener_calls.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Listener entry points differ only by address, so a table of distinct
+// functions lets one DartPortManager hold many listener subscribers.
+template <int N>
+void IndexedListener(int64_t value) {
+  CountingListener(value);
+}
+
+constexpr DartListenerCallback kListenerTable[] = {
+    &IndexedListener<0>,  &IndexedListener<1>,  &IndexedListener<2>,
+    &IndexedListener<3>,  &IndexedListener<4>,  &IndexedListener<5>,
+    &IndexedListener<6>,  &IndexedListener<7>,  &IndexedListener<8>,
+    &IndexedListener<9>,  &IndexedListener<10>, &IndexedListener<11>,
+    &IndexedListener<12>, &IndexedListener<13>, &IndexedListener<14>,
+    &IndexedListener<15>, &IndexedListener<16>, &IndexedListener<17>,
+    &IndexedListener<18>, &IndexedListener<19>, &IndexedListener<20>,
+    &IndexedListener<21>, &IndexedListener<22>, &IndexedListener<23>,
+    &IndexedListener<24>, &IndexedListener<25>, &IndexedListener<26>,
+    &IndexedListener<27>, &IndexedListener<28>, &IndexedListener<29>,
+    &IndexedListener<30>, &IndexedListener<31>,
+};
+
+// Runs NotifyWindowCountChanged on |manager| and reports
+// allocations per update alongside the timing.
+void RunFanOut(benchmark::State& state, DartPortManager& manager) {
+  LONG count = 0;
+  int64_t allocations_before = g_allocations.load();
+  for (auto _ : state) {
+    manager.NotifyWindowCountChanged(++count);
+  }
+  int64_t allocations = g_allocations.load() - allocations_before;
+  state.counters["allocs_per_update"] = benchmark::Counter(
+      static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+  state.counters["deliveries"] = benchmark::Counter(
+      static_cast<double>(state.iterations() * state.range(0)),
+      benchmark::Counter::kIsRate);
+}
+
+void BM_FanOut_PortMode(benchmark::State& state) {
+  mock_dart_api::Reset();
+  mock_dart_api::SetRecordCalls(false);
+  DartPortManager manager;
+  for (int64_t i = 0; i < state.range(0); i++) {
+    manager.RegisterPort(1000 + i, -1);
+  }
+  RunFanOut(state, manager);
+}
+
+void BM_FanOut_ListenerMode(benchmark::State& state) {
+  mock_dart_api::Reset();
+  DartPortManager manager;
+  for (int64_t i = 0; i < state.range(0); i++) {
+    manager.Register(DartSubscriber::ForListener(kListenerTable[i]), -1,
+                     DartPortSubscription());
+  }
+  RunFanOut(state, manager);
+}
+
+// Port mode through the simulated VM, with one isolate per port as with
+// one window per port. range(1) is the per-message cost in microseconds; a
+// cost above the posting interval shows up as queue depth and latency.
+void BM_FanOut_SimulatedIsolates(benchmark::State& state) {
+  mock_dart_api::Reset();
+  mock_dart_api::SetRecordCalls(false);
+  simulated_dart::SimulatedDartRuntime runtime;
+  runtime.Install();
+  simulated_dart::IsolateConfig config;
+  config.message_cost = std::chrono::microseconds(state.range(1));
+
+  DartPortManager manager;
+  std::vector<Dart_Port_DL> ports;
+  for (int64_t i = 0; i < state.range(0); i++) {
+    Dart_Port_DL port = runtime.NewPort(
+        runtime.CreateIsolate(config),
+        [](Dart_Port_DL, const simulated_dart::DartValue& message) {
+          benchmark::DoNotOptimize(message.as_int64);
+        });
+    manager.RegisterPort(port, -1);
+    ports.push_back(port);
+  }
+  RunFanOut(state, manager);
+  if (!runtime.WaitForIdle(std::chrono::seconds(60))) {
+    state.SkipWithError("Simulated isolates did not drain");
+    return;
+  }
+
+  uint64_t handled = 0;
+  std::chrono::nanoseconds total_latency(0);
+  std::chrono::nanoseconds max_latency(0);
+  size_t max_queue_depth = 0;
+  for (Dart_Port_DL port : ports) {
+    simulated_dart::PortStats stats = runtime.GetPortStats(port);
+    handled += stats.handled;
+    total_latency += stats.total_latency;
+    max_latency = std::max(max_latency, stats.max_latency);
+    max_queue_depth = std::max(max_queue_depth, stats.max_queue_depth);
+  }
+  state.counters["latency_us"] =
+      handled == 0 ? 0.0 : total_latency.count() / 1000.0 / handled;
+  state.counters["max_latency_us"] = max_latency.count() / 1000.0;
+  state.counters["max_queue_depth"] = static_cast<double>(max_queue_depth);
+}
+
+}  // namespace
+
+// Ports scale further than listeners, which are limited by kListenerTable.
+BENCHMARK(BM_FanOut_PortMode)->RangeMultiplier(2)->Range(1, 256);
+BENCHMARK(BM_FanOut_ListenerMode)->RangeMultiplier(2)->Range(1, 32);
+// Fixed iterations: with a message cost every update queues work that has
+// to drain before the counters are read.
+BENCHMARK(BM_FanOut_SimulatedIsolates)
+    ->ArgsProduct({{1, 4, 16}, {0, 20}})
+    ->Iterations(5000)
+    ->UseRealTime();
+
+// Count every heap allocation made while the benchmarks run.
+void* operator new(std::size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+int main(int argc, char* argv[]) {
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  // Recorded in JSON output so results of different notification
+  // backends can be told apart.
+  benchmark::AddCustomContext("ipc_backend", "win32_event");
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,259 @@
+#!/usr/bin/env python3
+"""Performance regression gate for the IPC benchmarks.
+
+Runs the gated benchmarks with repetitions, compares each metric with the
+samples stored in a baseline file, and fails if any metric regressed:
+
+  - wake_latency_p99_us    WindowCountListener SetEvent-to-wake p99, without
+                           the 10 ms reset delay, 1 listener (lower)
+  - increment_throughput   SharedMemoryManager changes/s, 1 thread (higher)
+  - fanout_ns_per_update   DartPortManager port fan-out to 16 ports (lower)
+
+A metric regresses when its median is worse than the baseline median by more
+than --margin AND a one-sided Mann-Whitney U test says the difference is
+unlikely to be noise (p < --alpha). The margin alone would fail on one noisy
+run; the test alone would fail on tiny but consistent differences.
+
+Registered with CTest by CMakeLists.txt. Without a baseline file the gate
+exits with 77, which CTest reports as skipped. Record one on the machine
+that runs the gate:
+
+  python perf_gate.py --bin-dir build/Release --baseline perf_baseline.json \\
+      --update-baseline
+
+Only the Python standard library is used.
+"""
+
+import argparse
+import itertools
+import json
+import math
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+
+SKIP_EXIT_CODE = 77
+BASELINE_VERSION = 2  # 2: wake latency no longer includes the reset delay
+
+# name: (binary, benchmark run name, field, better)
+METRICS = {
+    "wake_latency_p99_us": (
+        "window_count_listener_benchmark",
+        "BM_WakeLatency/1/iterations:1000/manual_time",
+        "event_wake_p99_us",
+        "lower",
+    ),
+    "increment_throughput": (
+        "shared_memory_benchmark",
+        "BM_IncrementDecrement/real_time/threads:1",
+        "updates",
+        "higher",
+    ),
+    "fanout_ns_per_update": (
+        "delivery_mode_benchmark",
+        "BM_FanOut_PortMode/16",
+        "real_time",
+        "lower",
+    ),
+}
+
+# Nanoseconds per Google Benchmark time unit.
+TIME_UNITS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+# Above this many splits the exact U distribution is approximated.
+MAX_EXACT_SPLITS = 200000
+
+
+def binary_path(bin_dir, name):
+    suffix = ".exe" if os.name == "nt" else ""
+    return os.path.join(bin_dir, name + suffix)
+
+
+def run_benchmark(bin_dir, binary, run_name, repetitions):
+    """Returns the iteration runs of one benchmark and the run context."""
+    # Results go to a file: the IPC code echoes log lines to stdout.
+    out_path = os.path.join(tempfile.gettempdir(),
+                            "perf_gate_%s_%d.json" % (binary, os.getpid()))
+    command = [
+        binary_path(bin_dir, binary),
+        "--benchmark_filter=^%s$" % run_name,
+        "--benchmark_repetitions=%d" % repetitions,
+        "--benchmark_out=%s" % out_path,
+        "--benchmark_out_format=json",
+    ]
+    result = subprocess.run(command, stdout=subprocess.DEVNULL,
+                            stderr=subprocess.PIPE, check=False)
+    if result.returncode != 0:
+        raise RuntimeError("%s failed (%d): %s" % (
+            binary, result.returncode, result.stderr.decode(errors="replace")))
+    try:
+        with open(out_path) as file:
+            document = json.load(file)
+    finally:
+        if os.path.exists(out_path):
+            os.remove(out_path)
+    runs = [b for b in document["benchmarks"]
+            if b.get("run_type", "iteration") == "iteration"
+            and b.get("run_name", b["name"]) == run_name]
+    if not runs:
+        raise RuntimeError("%s produced no %s runs" % (binary, run_name))
+    for run in runs:
+        if "error_occurred" in run and run["error_occurred"]:
+            raise RuntimeError("%s: %s" % (run_name, run["error_message"]))
+    return runs, document.get("context", {})
+
+
+def metric_value(run, field):
+    if field == "real_time":
+        return run["real_time"] * TIME_UNITS[run.get("time_unit", "ns")]
+    return float(run[field])
+
+
+def collect(bin_dir, repetitions):
+    """Runs every gated benchmark; returns {metric: samples} and context."""
+    samples = {}
+    context = {}
+    for name, (binary, run_name, field, _) in METRICS.items():
+        print("Running %s (%d repetitions)..." % (run_name, repetitions),
+              flush=True)
+        runs, context = run_benchmark(bin_dir, binary, run_name, repetitions)
+        samples[name] = [metric_value(run, field) for run in runs]
+    return samples, context
+
+
+def u_statistic(x, y):
+    """Mann-Whitney U of y over x: pairs with y > x, ties count half."""
+    u = 0.0
+    for a in x:
+        for b in y:
+            if b > a:
+                u += 1.0
+            elif b == a:
+                u += 0.5
+    return u
+
+
+def p_value_greater(x, y):
+    """One-sided p-value that y tends to be larger than x."""
+    observed = u_statistic(x, y)
+    n, m = len(x), len(y)
+    pooled = list(x) + list(y)
+    if math.comb(n + m, m) <= MAX_EXACT_SPLITS:
+        at_least = 0
+        total = 0
+        for picked in itertools.combinations(range(n + m), m):
+            chosen = set(picked)
+            new_y = [pooled[i] for i in picked]
+            new_x = [pooled[i] for i in range(n + m) if i not in chosen]
+            total += 1
+            if u_statistic(new_x, new_y) >= observed:
+                at_least += 1
+        return at_least / total
+    mean = n * m / 2.0
+    sd = math.sqrt(n * m * (n + m + 1) / 12.0)
+    z = (observed - 0.5 - mean) / sd
+    return 0.5 * math.erfc(z / math.sqrt(2))
+
+
+def compare(baseline, current, margin, alpha):
+    """Prints a comparison table; returns the names of regressed metrics."""
+    regressed = []
+    print()
+    print("%-22s %14s %14s %9s %8s  %s" % (
+        "METRIC", "BASELINE", "CURRENT", "CHANGE", "P", "RESULT"))
+    for name, (_, _, _, better) in METRICS.items():
+        if name not in baseline:
+            print("%-22s %14s %14.2f %9s %8s  %s" % (
+                name, "-", statistics.median(current[name]), "-", "-",
+                "no baseline"))
+            continue
+        base = baseline[name]
+        cur = current[name]
+        base_median = statistics.median(base)
+        cur_median = statistics.median(cur)
+        if better == "lower":
+            worse_by = (cur_median - base_median) / base_median
+            p = p_value_greater(base, cur)
+        else:
+            worse_by = (base_median - cur_median) / base_median
+            p = p_value_greater([-v for v in base], [-v for v in cur])
+        failed = worse_by > margin and p < alpha
+        if failed:
+            regressed.append(name)
+        print("%-22s %14.2f %14.2f %+8.1f%% %8.4f  %s" % (
+            name, base_median, cur_median,
+            100.0 * (cur_median - base_median) / base_median, p,
+            "REGRESSED" if failed else "ok"))
+    return regressed
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--bin-dir", required=True,
+                        help="Directory with the benchmark executables")
+    parser.add_argument("--baseline", required=True,
+                        help="Baseline JSON file")
+    parser.add_argument("--repetitions", type=int, default=5,
+                        help="Runs per benchmark (default 5)")
+    parser.add_argument("--margin", type=float, default=0.10,
+                        help="Allowed slowdown of the median (default 0.10)")
+    parser.add_argument("--alpha", type=float, default=0.05,
+                        help="Significance level (default 0.05)")
+    parser.add_argument("--update-baseline", action="store_true",
+                        help="Record the current results as the baseline")
+    args = parser.parse_args()
+    # The most extreme split of 2n samples has p = 1 / C(2n, n); below that
+    # no difference could ever be significant.
+    if 1.0 / math.comb(2 * args.repetitions, args.repetitions) >= args.alpha:
+        parser.error("--repetitions %d is too few to reach alpha %.2f"
+                     % (args.repetitions, args.alpha))
+
+    if not args.update_baseline and not os.path.exists(args.baseline):
+        print("No baseline at %s; record one with --update-baseline"
+              % args.baseline)
+        return SKIP_EXIT_CODE
+
+    try:
+        current, context = collect(args.bin_dir, args.repetitions)
+    except (OSError, RuntimeError, ValueError, KeyError) as error:
+        print("Benchmark run failed: %s" % error)
+        return 1
+
+    if args.update_baseline:
+        document = {
+            "version": BASELINE_VERSION,
+            "context": {key: context.get(key) for key in
+                        ("host_name", "num_cpus", "mhz_per_cpu",
+                         "ipc_backend", "library_build_type")},
+            "metrics": current,
+        }
+        with open(args.baseline, "w") as file:
+            json.dump(document, file, indent=2)
+            file.write("\n")
+        print("Baseline written to %s" % args.baseline)
+        return 0
+
+    with open(args.baseline) as file:
+        document = json.load(file)
+    if document.get("version") != BASELINE_VERSION:
+        print("Baseline %s has an unknown version" % args.baseline)
+        return 1
+    baseline_host = document.get("context", {}).get("host_name")
+    if baseline_host and baseline_host != context.get("host_name"):
+        print("Warning: baseline was recorded on %s, running on %s"
+              % (baseline_host, context.get("host_name")))
+
+    regressed = compare(document["metrics"], current, args.margin, args.alpha)
+    print()
+    if regressed:
+        print("Performance regression: %s" % ", ".join(regressed))
+        return 1
+    print("No regression beyond %.0f%% (alpha %.2f)"
+          % (100 * args.margin, args.alpha))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,213 @@
+// shared_memory_benchmark.cpp
+//
+// Google Benchmark for SharedMemoryManager (Layer 1):
+//   - IncrementWindowCount/DecrementWindowCount and GetWindowCount
+//     throughput with 1-16 threads in one process
+//   - Increment/decrement throughput with 1-8 processes hammering the same
+//     segment, the way real windows share it
+//
+// Every increment goes through the full production path: seqlock write,
+// trace and metrics recording, SetEvent and an INFO log call. Each run uses
+// a private IPC namespace (ipc_namespace.h) unless FLUTTER_IPC_NAMESPACE is
+// set, so open windows neither see nor disturb it.
+//
+// The multi-process benchmark re-launches this executable with
+// --child <pairs> <name>. Each child opens the segment, releases the
+// "<name>.Ready" semaphore and waits on the "<name>.Start" event, so process
+// creation stays out of the timed section.
+
+#include <benchmark/benchmark.h>
+#include <windows.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "ipc_namespace.h"
+#include "shared_memory_manager.h"
+
+namespace {
+
+constexpr char kChildFlag[] = "--child";
+
+// Increment/decrement pairs each child process performs per iteration.
+constexpr int kPairsPerChild = 20000;
+
+// How long the parent waits for a child to report ready.
+constexpr DWORD kChildReadyTimeoutMs = 10000;
+
+// Segment shared by all threads of the in-process benchmarks.
+SharedMemoryManager& SharedManager() {
+  static SharedMemoryManager* manager = [] {
+    SharedMemoryManager* created = new SharedMemoryManager();
+    created->Initialize();
+    return created;
+  }();
+  return *manager;
+}
+
+double Seconds(int64_t ticks) {
+  LARGE_INTEGER frequency;
+  QueryPerformanceFrequency(&frequency);
+  return static_cast<double>(ticks) / static_cast<double>(frequency.QuadPart);
+}
+
+int64_t Now() {
+  LARGE_INTEGER now;
+  QueryPerformanceCounter(&now);
+  return now.QuadPart;
+}
+
+// Child process body: report ready, wait for the start signal, then
+// hammer the segment.
+int RunChild(int argc, char* argv[]) {
+  if (argc < 4) {
+    return 2;
+  }
+  int pairs = std::atoi(argv[2]);
+  std::string name = argv[3];
+  HANDLE ready = OpenSemaphoreA(SEMAPHORE_MODIFY_STATE, FALSE,
+                                (name + ".Ready").c_str());
+  HANDLE start = OpenEventA(SYNCHRONIZE, FALSE, (name + ".Start").c_str());
+  SharedMemoryManager manager;
+  bool initialized = manager.Initialize();
+  if (ready != nullptr) {
+    ReleaseSemaphore(ready, 1, nullptr);  // Even on failure: never hang
+    CloseHandle(ready);
+  }
+  if (start == nullptr || !initialized) {
+    return 1;
+  }
+  WaitForSingleObject(start, INFINITE);
+  for (int i = 0; i < pairs; i++) {
+    manager.IncrementWindowCount();
+    manager.DecrementWindowCount();
+  }
+  CloseHandle(start);
+  return 0;
+}
+
+void BM_IncrementDecrement(benchmark::State& state) {
+  SharedMemoryManager& manager = SharedManager();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(manager.IncrementWindowCount());
+    benchmark::DoNotOptimize(manager.DecrementWindowCount());
+  }
+  state.counters["updates"] = benchmark::Counter(
+      static_cast<double>(state.iterations() * 2), benchmark::Counter::kIsRate);
+}
+
+void BM_GetWindowCount(benchmark::State& state) {
+  SharedMemoryManager& manager = SharedManager();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(manager.GetWindowCount());
+  }
+}
+
+void BM_ReadSnapshot(benchmark::State& state) {
+  SharedMemoryManager& manager = SharedManager();
+  SharedMemorySnapshot snapshot;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(manager.ReadSnapshot(&snapshot));
+  }
+}
+
+void BM_IncrementDecrement_Processes(benchmark::State& state) {
+  int processes = static_cast<int>(state.range(0));
+  char module_path[MAX_PATH];
+  if (GetModuleFileNameA(nullptr, module_path, MAX_PATH) == 0) {
+    state.SkipWithError("GetModuleFileNameA failed");
+    return;
+  }
+  std::string name = "Local\\SharedMemoryBenchmark." +
+                     std::to_string(GetCurrentProcessId());
+
+  for (auto _ : state) {
+    HANDLE ready = CreateSemaphoreA(nullptr, 0, processes,
+                                    (name + ".Ready").c_str());
+    HANDLE start =
+        CreateEventA(nullptr, TRUE, FALSE, (name + ".Start").c_str());
+    std::vector<HANDLE> children;
+    for (int i = 0; i < processes; i++) {
+      std::string command = std::string("\"") + module_path + "\" " +
+                            kChildFlag + " " +
+                            std::to_string(kPairsPerChild) + " " + name;
+      STARTUPINFOA startup = {};
+      startup.cb = sizeof(startup);
+      PROCESS_INFORMATION info = {};
+      if (!CreateProcessA(nullptr, &command[0], nullptr, nullptr, FALSE, 0,
+                          nullptr, nullptr, &startup, &info)) {
+        break;
+      }
+      CloseHandle(info.hThread);
+      children.push_back(info.hProcess);
+    }
+    bool all_ready = static_cast<int>(children.size()) == processes;
+    for (size_t i = 0; all_ready && i < children.size(); i++) {
+      all_ready = WaitForSingleObject(ready, kChildReadyTimeoutMs) ==
+                  WAIT_OBJECT_0;
+    }
+    if (!all_ready) {
+      SetEvent(start);  // Release the children that did start
+      for (HANDLE child : children) {
+        WaitForSingleObject(child, INFINITE);
+        CloseHandle(child);
+      }
+      CloseHandle(start);
+      CloseHandle(ready);
+      state.SkipWithError("Child processes failed to start");
+      return;
+    }
+
+    int64_t begin = Now();
+    SetEvent(start);
+    WaitForMultipleObjects(static_cast<DWORD>(children.size()),
+                           children.data(), TRUE, INFINITE);
+    state.SetIterationTime(Seconds(Now() - begin));
+
+    for (HANDLE child : children) {
+      CloseHandle(child);
+    }
+    CloseHandle(start);
+    CloseHandle(ready);
+  }
+  state.counters["updates"] = benchmark::Counter(
+      static_cast<double>(state.iterations() * processes * kPairsPerChild * 2),
+      benchmark::Counter::kIsRate);
+}
+
+}  // namespace
+
+BENCHMARK(BM_IncrementDecrement)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_GetWindowCount)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_ReadSnapshot)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_IncrementDecrement_Processes)
+    ->RangeMultiplier(2)
+    ->Range(1, 8)
+    ->UseManualTime()
+    ->Iterations(5)
+    ->Unit(benchmark::kMillisecond);
+
+int main(int argc, char* argv[]) {
+  if (argc > 1 && std::strcmp(argv[1], kChildFlag) == 0) {
+    return RunChild(argc, argv);
+  }
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  // Recorded in JSON output so results of different notification
+  // backends can be told apart.
+  benchmark::AddCustomContext("ipc_backend", "win32_event");
+  // A private IPC instance unless one is given, so running windows and
+  // parallel benchmark runs do not disturb the results. Child processes
+  // inherit it.
+  if (ipc_namespace::GetDefault().empty()) {
+    ipc_namespace::SetDefault(ipc_namespace::MakeUnique("Benchmark"));
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
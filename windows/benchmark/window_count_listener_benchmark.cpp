@@ -0,0 +1,177 @@
+// window_count_listener_benchmark.cpp
+//
+// Google Benchmark for WindowCountListener (Layer 2) wake latency: the time
+// from IncrementWindowCount() (SetEvent) until the callback of the last of
+// N listeners starts, reported as p50/p99/p99.9/max in microseconds.
+//
+// Each iteration is one count change, timed manually, so the reported
+// time per iteration is the mean latency and the percentile counters come
+// from the same samples. The listener deliberately sleeps 10 ms before
+// resetting the manual-reset event (see window_count_listener.cpp), and
+// that delay is part of what this measures. The event_wake_* counters
+// leave it out: they come from the listeners' own SetEvent-to-wake
+// histogram (ipc_metrics kMetricWakeLatency) over the same run.
+
+#include <benchmark/benchmark.h>
+#include <windows.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "ipc_metrics.h"
+#include "ipc_namespace.h"
+#include "shared_memory_manager.h"
+#include "window_count_listener.h"
+
+namespace {
+
+// How long an iteration waits for every listener before giving up.
+constexpr DWORD kWakeTimeoutMs = 1000;
+
+int64_t Now() {
+  LARGE_INTEGER now;
+  QueryPerformanceCounter(&now);
+  return now.QuadPart;
+}
+
+double TicksPerMicrosecond() {
+  LARGE_INTEGER frequency;
+  QueryPerformanceFrequency(&frequency);
+  return static_cast<double>(frequency.QuadPart) / 1e6;
+}
+
+// Nearest-rank percentile of sorted samples.
+int64_t Percentile(const std::vector<int64_t>& sorted, double fraction) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  size_t rank =
+      static_cast<size_t>(fraction * static_cast<double>(sorted.size()));
+  return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+// Signals |done| once all |expected| listeners ran their callback.
+struct WakeBarrier {
+  std::atomic<int> pending{0};
+  std::atomic<int64_t> last_callback_ticks{0};
+  HANDLE done = CreateEventA(nullptr, FALSE, FALSE, nullptr);
+
+  ~WakeBarrier() { CloseHandle(done); }
+
+  void Arm(int expected) { pending.store(expected); }
+
+  void OnCallback() {
+    int64_t ticks = Now();
+    if (pending.fetch_sub(1) == 1) {
+      last_callback_ticks.store(ticks);
+      SetEvent(done);
+    }
+  }
+};
+
+void BM_WakeLatency(benchmark::State& state) {
+  int listener_count = static_cast<int>(state.range(0));
+  SharedMemoryManager writer;
+  if (!writer.Initialize()) {
+    state.SkipWithError("SharedMemoryManager::Initialize failed");
+    return;
+  }
+
+  WakeBarrier barrier;
+  std::vector<std::unique_ptr<WindowCountListener>> listeners;
+  for (int i = 0; i < listener_count; i++) {
+    auto listener = std::make_unique<WindowCountListener>();
+    listener->SetCallback([&barrier](LONG) { barrier.OnCallback(); });
+    if (!listener->Start()) {
+      state.SkipWithError("WindowCountListener::Start failed");
+      return;
+    }
+    listeners.push_back(std::move(listener));
+  }
+
+  double ticks_per_us = TicksPerMicrosecond();
+  std::vector<int64_t> samples;
+  samples.reserve(static_cast<size_t>(state.max_iterations));
+  std::vector<int64_t> wake_before;
+  ipc_metrics::GetRegistry().SnapshotBuckets(ipc_metrics::kMetricWakeLatency,
+                                             &wake_before);
+
+  for (auto _ : state) {
+    barrier.Arm(listener_count);
+    int64_t start = Now();
+    writer.IncrementWindowCount();
+    if (WaitForSingleObject(barrier.done, kWakeTimeoutMs) != WAIT_OBJECT_0) {
+      state.SkipWithError("Listeners did not wake");
+      break;
+    }
+    int64_t latency = barrier.last_callback_ticks.load() - start;
+    samples.push_back(latency);
+    state.SetIterationTime(static_cast<double>(latency) / ticks_per_us / 1e6);
+
+    // Restore the count; its wakeup is absorbed outside the timed region.
+    barrier.Arm(listener_count);
+    writer.DecrementWindowCount();
+    WaitForSingleObject(barrier.done, kWakeTimeoutMs);
+  }
+
+  for (auto& listener : listeners) {
+    listener->Stop();
+  }
+
+  // Wakeups of this run only, decrements included
+  std::vector<int64_t> wake_buckets;
+  if (ipc_metrics::GetRegistry().SnapshotBuckets(
+          ipc_metrics::kMetricWakeLatency, &wake_buckets) &&
+      wake_before.size() == wake_buckets.size()) {
+    for (size_t b = 0; b < wake_buckets.size(); b++) {
+      wake_buckets[b] -= wake_before[b];
+    }
+    using ipc_metrics::MetricsRegistry;
+    state.counters["event_wake_p50_us"] =
+        MetricsRegistry::BucketPercentile(wake_buckets, 0.50) / 1e3;
+    state.counters["event_wake_p99_us"] =
+        MetricsRegistry::BucketPercentile(wake_buckets, 0.99) / 1e3;
+  }
+
+  std::sort(samples.begin(), samples.end());
+  auto micros = [&](int64_t ticks) {
+    return static_cast<double>(ticks) / ticks_per_us;
+  };
+  state.counters["p50_us"] = micros(Percentile(samples, 0.50));
+  state.counters["p99_us"] = micros(Percentile(samples, 0.99));
+  state.counters["p999_us"] = micros(Percentile(samples, 0.999));
+  state.counters["max_us"] = micros(samples.empty() ? 0 : samples.back());
+}
+
+}  // namespace
+
+// 1000 samples make p99.9 meaningful; each takes two listener wakeups.
+BENCHMARK(BM_WakeLatency)
+    ->Arg(1)
+    ->Arg(4)
+    ->Arg(16)
+    ->UseManualTime()
+    ->Iterations(1000)
+    ->Unit(benchmark::kMicrosecond);
+
+int main(int argc, char* argv[]) {
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  // Recorded in JSON output so results of different notification
+  // backends can be told apart.
+  benchmark::AddCustomContext("ipc_backend", "win32_event");
+  // A private IPC instance unless one is given, so running windows and
+  // parallel benchmark runs do not disturb the results. Child processes
+  // inherit it.
+  if (ipc_namespace::GetDefault().empty()) {
+    ipc_namespace::SetDefault(ipc_namespace::MakeUnique("Benchmark"));
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,247 @@
+// dart_command_port.cpp
+//
+// Implementation of DartCommandPort, the asynchronous Dart → C++ command
+// channel built on Dart_NewNativePort_DL.
+//
+// Message decoding is deliberately strict: any command with missing or
+// mistyped arguments is answered with result=false (when a reply port is
+// available) rather than guessed at, so a Dart-side bug surfaces as a
+// failed future instead of a silent no-op.
+
+#include "dart_command_port.h"
+
+#include <map>
+
+#include "dart_port_manager.h"
+#include "ipc_log.h"
+
+namespace {
+// Open command ports by native port ID, so the VM's handler reaches the
+// instance that owns the port. Held while a command runs, so Close() waits
+// for it and the instance outlives it.
+std::mutex g_open_ports_mutex;
+std::map<Dart_Port_DL, DartCommandPort*> g_open_ports;
+
+// Fixed header of every command list: [command, request_id, reply_port]
+constexpr intptr_t kCommandHeaderLength = 3;
+
+// Reads an integer element that Dart may encode as int32 or int64.
+bool ReadInt(const Dart_CObject* object, int64_t* out) {
+  if (object->type == Dart_CObject_kInt32) {
+    *out = object->value.as_int32;
+    return true;
+  }
+  if (object->type == Dart_CObject_kInt64) {
+    *out = object->value.as_int64;
+    return true;
+  }
+  return false;
+}
+
+// Reads a SendPort element and returns its native port ID.
+bool ReadSendPort(const Dart_CObject* object, Dart_Port_DL* out) {
+  if (object->type != Dart_CObject_kSendPort) {
+    return false;
+  }
+  *out = object->value.as_send_port.id;
+  return true;
+}
+}  // anonymous namespace
+
+DartCommandPort::DartCommandPort(DartPortManager& port_manager)
+    : port_manager_(port_manager), port_(ILLEGAL_PORT) {}
+
+DartCommandPort::~DartCommandPort() {
+  Close();
+}
+
+bool DartCommandPort::Open() {
+  std::lock_guard<std::mutex> lock(port_mutex_);
+
+  if (port_ != ILLEGAL_PORT) {
+    return true;  // Idempotent - already open
+  }
+
+  // handle_concurrently=false: the VM delivers one message at a time, which
+  // keeps commands ordered (e.g. register before unregister) while still
+  // running them off the UI isolate thread.
+  port_ = Dart_NewNativePort_DL("DartCommandPort", &DartCommandPort::HandleMessage,
+                                false);
+  if (port_ == ILLEGAL_PORT) {
+    IPC_LOG_ERROR("Dart_NewNativePort_DL failed for DartCommandPort");
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> ports_lock(g_open_ports_mutex);
+    g_open_ports[port_] = this;
+  }
+
+  IPC_LOG_INFO("DartCommandPort opened: {}", port_);
+  return true;
+}
+
+void DartCommandPort::Close() {
+  std::lock_guard<std::mutex> lock(port_mutex_);
+
+  if (port_ == ILLEGAL_PORT) {
+    return;  // Not open, nothing to close
+  }
+
+  {
+    std::lock_guard<std::mutex> ports_lock(g_open_ports_mutex);
+    g_open_ports.erase(port_);
+  }
+  Dart_CloseNativePort_DL(port_);
+  IPC_LOG_INFO("DartCommandPort closed: {}", port_);
+  port_ = ILLEGAL_PORT;
+}
+
+Dart_Port_DL DartCommandPort::port() const {
+  std::lock_guard<std::mutex> lock(port_mutex_);
+  return port_;
+}
+
+bool DartCommandPort::Dispatch(Dart_CObject* message) {
+  if (message == nullptr || message->type != Dart_CObject_kArray ||
+      message->value.as_array.length < kCommandHeaderLength) {
+    IPC_LOG_WARN("DartCommandPort: malformed command message");
+    return false;
+  }
+
+  Dart_CObject** values = message->value.as_array.values;
+  intptr_t length = message->value.as_array.length;
+
+  int64_t command = 0;
+  int64_t request_id = 0;
+  Dart_Port_DL reply_port = ILLEGAL_PORT;
+  if (!ReadInt(values[0], &command) || !ReadInt(values[1], &request_id) ||
+      !ReadSendPort(values[2], &reply_port)) {
+    IPC_LOG_WARN("DartCommandPort: malformed command header");
+    return false;
+  }
+
+  Dart_CObject** args = values + kCommandHeaderLength;
+  intptr_t arg_count = length - kCommandHeaderLength;
+  bool well_formed = true;
+  bool result = false;
+
+  switch (command) {
+    case kDartCommandRegisterPort: {
+      Dart_Port_DL port = ILLEGAL_PORT;
+      int64_t topic_mask = 0;
+      int64_t filter_flags = 0;
+      int64_t threshold = 0;
+      well_formed = arg_count == 4 && ReadSendPort(args[0], &port) &&
+                    ReadInt(args[1], &topic_mask) &&
+                    ReadInt(args[2], &filter_flags) &&
+                    ReadInt(args[3], &threshold);
+      if (well_formed) {
+        DartPortSubscription subscription;
+        subscription.topic_mask = static_cast<uint32_t>(topic_mask);
+        subscription.filter_flags = static_cast<uint32_t>(filter_flags);
+        subscription.threshold = static_cast<LONG>(threshold);
+        result = port_manager_.RegisterPort(port, GetCurrentWindowCount(),
+                                            subscription);
+      }
+      break;
+    }
+    case kDartCommandUnregisterPort: {
+      Dart_Port_DL port = ILLEGAL_PORT;
+      well_formed = arg_count == 1 && ReadSendPort(args[0], &port);
+      if (well_formed) {
+        result = port_manager_.UnregisterPort(port);
+      }
+      break;
+    }
+    case kDartCommandRequestWindowClose:
+      well_formed = arg_count == 0;
+      if (well_formed) {
+        RequestWindowClose();
+        result = true;
+      }
+      break;
+    default:
+      well_formed = false;
+      break;
+  }
+
+  if (!well_formed) {
+    IPC_LOG_WARN("DartCommandPort: bad command {} (request {})", command,
+                 request_id);
+  }
+
+  PostReply(reply_port, request_id, result);
+  return well_formed;
+}
+
+void DartCommandPort::HandleMessage(Dart_Port_DL dest_port,
+                                    Dart_CObject* message) {
+  // Runs on a Dart VM native thread, never on the UI isolate thread.
+  std::lock_guard<std::mutex> lock(g_open_ports_mutex);
+  auto it = g_open_ports.find(dest_port);
+  if (it == g_open_ports.end()) {
+    IPC_LOG_WARN("DartCommandPort: message for closed port {}", dest_port);
+    return;
+  }
+  it->second->Dispatch(message);
+}
+
+void DartCommandPort::PostReply(Dart_Port_DL reply_port, int64_t request_id,
+                                bool result) {
+  Dart_CObject id_object;
+  id_object.type = Dart_CObject_kInt64;
+  id_object.value.as_int64 = request_id;
+
+  Dart_CObject result_object;
+  result_object.type = Dart_CObject_kBool;
+  result_object.value.as_bool = result;
+
+  Dart_CObject* elements[] = {&id_object, &result_object};
+  Dart_CObject reply;
+  reply.type = Dart_CObject_kArray;
+  reply.value.as_array.length = 2;
+  reply.value.as_array.values = elements;
+
+  if (!Dart_PostCObject_DL(reply_port, &reply)) {
+    IPC_LOG_ERROR("DartCommandPort: failed to post reply for request {}",
+                  request_id);
+  }
+}
+
+// ============================================================================
+// FFI Exports - C functions callable from Dart via FFI
+// ============================================================================
+
+DartCommandPort& GetGlobalDartCommandPort() {
+  // Function-local static so the command port is constructed after the
+  // global DartPortManager it refers to.
+  static DartCommandPort command_port(GetGlobalDartPortManager());
+  return command_port;
+}
+
+extern "C" {
+
+/// Open the command channel and hand its SendPort to Dart.
+///
+/// Dart usage:
+///   final replies = ReceivePort();
+///   openDartCommandChannel(replies.sendPort.nativePort);
+///   final commandPort = await replies.first as SendPort;  // first message
+///   commandPort.send([1, requestId, replies.sendPort, port, mask, 0, 0]);
+///
+/// @param reply_port Dart_Port_DL that receives the command SendPort
+/// @return true if the SendPort was posted
+__declspec(dllexport) bool OpenDartCommandChannel(Dart_Port_DL reply_port) {
+  DartCommandPort& command_port = GetGlobalDartCommandPort();
+  if (!command_port.Open()) {
+    return false;
+  }
+
+  Dart_CObject message;
+  message.type = Dart_CObject_kSendPort;
+  message.value.as_send_port.id = command_port.port();
+  message.value.as_send_port.origin_id = ILLEGAL_PORT;
+  return Dart_PostCObject_DL(reply_port, &message);
+}
+
+}  // extern "C"
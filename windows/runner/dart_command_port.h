@@ -0,0 +1,124 @@
+// dart_command_port.h
+//
+// DartCommandPort: Asynchronous Dart → C++ command channel.
+//
+// Counterpart to DartPortManager (C++ → Dart). Instead of calling native
+// functions synchronously over FFI on the UI isolate thread, Dart posts
+// command messages to a native port created with Dart_NewNativePort_DL.
+// The Dart VM runs the handler on one of its native threads, so heavier
+// operations (window lookup, registry changes) never block a frame, and
+// Dart can pipeline many commands without waiting for each reply.
+//
+// Thread Safety: All public methods are thread-safe using std::mutex.
+
+#ifndef RUNNER_DART_COMMAND_PORT_H_
+#define RUNNER_DART_COMMAND_PORT_H_
+
+#include <dart_api_dl.h>
+#include <windows.h>
+
+#include <cstdint>
+#include <mutex>
+
+class DartPortManager;
+
+/// Command identifiers understood by DartCommandPort.
+///
+/// Every command message is a Dart List:
+///   [command, request_id, reply_port, ...arguments]
+/// and every reply is posted to reply_port as:
+///   [request_id, result]
+/// where result is a bool.
+enum DartCommand : int64_t {
+  /// Arguments: [port (SendPort), topic_mask, filter_flags, threshold]
+  kDartCommandRegisterPort = 1,
+  /// Arguments: [port (SendPort)]
+  kDartCommandUnregisterPort = 2,
+  /// Arguments: none
+  kDartCommandRequestWindowClose = 3,
+};
+
+/// Receives commands from Dart on a native port and replies asynchronously.
+///
+/// Architecture:
+///   Dart SendPort.send([cmd, id, replyPort, ...])
+///     → Dart VM native port handler thread
+///     → DartCommandPort::Dispatch()
+///     → DartPortManager / RequestWindowClose()
+///     → Dart_PostCObject_DL(replyPort, [id, result])
+///
+/// Usage:
+///   1. Dart creates a ReceivePort for replies
+///   2. Dart calls OpenDartCommandChannel(replyPort.nativePort) once via FFI
+///   3. Native posts the command port to replyPort as a SendPort
+///   4. Dart sends commands to that SendPort and completes futures on reply
+class DartCommandPort {
+ public:
+  /// @param port_manager Registry used for register/unregister commands
+  explicit DartCommandPort(DartPortManager& port_manager);
+
+  /// Closes the native port if still open.
+  ~DartCommandPort();
+
+  /// Creates the native port with Dart_NewNativePort_DL.
+  ///
+  /// The port is not handled concurrently, so commands execute in the
+  /// order Dart sent them.
+  ///
+  /// Safe to call multiple times (idempotent).
+  ///
+  /// @return true if the port is open
+  bool Open();
+
+  /// Closes the native port. Safe to call when not open (no-op).
+  void Close();
+
+  /// Returns the native port ID, or ILLEGAL_PORT if not open.
+  Dart_Port_DL port() const;
+
+  /// Decodes and executes one command message, then posts the reply.
+  ///
+  /// Called on the Dart VM's native handler thread. Exposed for tests.
+  ///
+  /// @param message Command list received from Dart
+  /// @return true if the message was a well-formed command
+  bool Dispatch(Dart_CObject* message);
+
+ private:
+  /// Native port handler registered with Dart_NewNativePort_DL. Dispatches
+  /// on the open DartCommandPort that owns dest_port.
+  static void HandleMessage(Dart_Port_DL dest_port, Dart_CObject* message);
+
+  /// Posts [request_id, result] to the reply port.
+  static void PostReply(Dart_Port_DL reply_port, int64_t request_id,
+                        bool result);
+
+  DartPortManager& port_manager_;
+
+  /// Native port ID, ILLEGAL_PORT when closed.
+  /// Protected by port_mutex_ for Open()/Close().
+  Dart_Port_DL port_;
+  mutable std::mutex port_mutex_;
+};
+
+// Get global DartCommandPort instance, bound to the global DartPortManager.
+DartCommandPort& GetGlobalDartCommandPort();
+
+// FFI Exports for Dart binding
+extern "C" {
+
+/// FFI export: Open the command channel and deliver its SendPort to Dart.
+///
+/// Called once from Dart via FFI:
+///   openChannel(replyPort.sendPort.nativePort);
+///
+/// The command port is posted to reply_port as a SendPort message; all
+/// further communication is asynchronous.
+///
+/// @param reply_port Dart_Port_DL that receives the command SendPort
+/// @return true if the SendPort was posted
+__declspec(dllexport) bool OpenDartCommandChannel(Dart_Port_DL reply_port);
+
+}  // extern "C"
+
+#endif  // RUNNER_DART_COMMAND_PORT_H_
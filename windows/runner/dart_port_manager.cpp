@@ -20,7 +20,50 @@
 #include "dart_port_manager.h"
 
 #include <algorithm>
-#include <iostream>
+#include <cstring>
+#include <iterator>
+
+#include "ipc_flight_recorder.h"
+#include "ipc_log.h"
+#include "ipc_metrics.h"
+#include "ipc_probes.h"
+#include "ipc_trace.h"
+
+namespace {
+
+// Bit index of a single-topic DartPortTopic value.
+uint32_t TopicIndex(uint32_t topic) {
+  uint32_t index = 0;
+  while (index < kDartPortTopicCount - 1 && (topic & (1u << index)) == 0) {
+    index++;
+  }
+  return index;
+}
+
+// EnumWindows callback: stops at the first top-level Flutter runner window
+// of this process and stores it in *param.
+BOOL CALLBACK FindOwnRunnerWindow(HWND hwnd, LPARAM param) {
+  DWORD pid = 0;
+  GetWindowThreadProcessId(hwnd, &pid);
+  if (pid != GetCurrentProcessId()) {
+    return TRUE;
+  }
+  char class_name[64];
+  if (GetClassNameA(hwnd, class_name, sizeof(class_name)) == 0 ||
+      strcmp(class_name, "FLUTTER_RUNNER_WIN32_WINDOW") != 0) {
+    return TRUE;
+  }
+  *reinterpret_cast<HWND*>(param) = hwnd;
+  return FALSE;
+}
+
+}  // anonymous namespace
+
+void DartPortManager::PortRegistration::ResetObserved(LONG initial_count) {
+  std::fill(std::begin(last_observed_values), std::end(last_observed_values),
+            -1);
+  last_observed_values[TopicIndex(kDartPortTopicWindowCount)] = initial_count;
+}
 
 DartPortManager::DartPortManager() {
   // Constructor initializes members to safe defaults.
@@ -32,99 +75,225 @@ DartPortManager::~DartPortManager() {
   // Destructor - ports are automatically cleaned up when vector is destroyed.
   // Dart_Port_DL is just int64_t, so no special cleanup required.
   // Dart isolates should unregister before destruction, but not critical.
+  ipc_metrics::AddGauge(ipc_metrics::kMetricDartSubscribers,
+                        -static_cast<int64_t>(ports_.size()));
 }
 
 bool DartPortManager::RegisterPort(Dart_Port_DL port, LONG initial_count) {
-  // Thread-safe port registration using RAII mutex guard.
-  // Called from Dart via FFI when window creates ReceivePort.
+  // Default subscription: every topic, no filters.
+  return RegisterPort(port, initial_count, DartPortSubscription());
+}
+
+bool DartPortManager::RegisterPort(Dart_Port_DL port, LONG initial_count,
+                                   const DartPortSubscription& subscription) {
+  return Register(DartSubscriber::ForPort(port), initial_count, subscription);
+}
+
+bool DartPortManager::UnregisterPort(Dart_Port_DL port) {
+  return Unregister(DartSubscriber::ForPort(port));
+}
+
+bool DartPortManager::Register(const DartSubscriber& subscriber,
+                               LONG initial_count,
+                               const DartPortSubscription& subscription) {
+  // Thread-safe registration using RAII mutex guard.
+  // Called from Dart via FFI when window creates ReceivePort or
+  // NativeCallable.listener.
   //
   // Flow: Dart creates ReceivePort → sendPort.nativePort →
   //       FFI call to RegisterWindowCountPort → this method
   std::lock_guard<std::mutex> lock(ports_mutex_);
 
-  ports_.push_back(port);
-  std::cout << "Dart port registered: " << port << std::endl;
+  // Re-registering a subscriber replaces its subscription instead of adding
+  // a duplicate entry that would receive every update twice.
+  auto it = std::find_if(ports_.begin(), ports_.end(),
+                         [&subscriber](const PortRegistration& registration) {
+                           return registration.subscriber == subscriber;
+                         });
+  if (it != ports_.end()) {
+    it->subscription = subscription;
+    it->ResetObserved(initial_count);
+    IPC_LOG_INFO("Dart subscriber re-registered: {}", subscriber.port);
+  } else {
+    PortRegistration registration{subscriber, subscription, {}};
+    registration.ResetObserved(initial_count);
+    ports_.push_back(registration);
+    ipc_metrics::AddGauge(ipc_metrics::kMetricDartSubscribers, 1);
+    IPC_PROBE_SUBSCRIBER_ADD(subscriber.port, ports_.size());
+    ipc_flight::Record(ipc_flight::kFlightSubscriberAdd,
+                       static_cast<int64_t>(ports_.size()), subscriber.port);
+    IPC_LOG_INFO("Dart subscriber registered: {}", subscriber.port);
+  }
 
-  // Send initial count to newly registered port if provided.
+  // Send initial count to newly registered subscriber if provided.
   // This ensures Dart receives the current state immediately.
   if (initial_count >= 0) {
-    Dart_CObject message;
-    message.type = Dart_CObject_kInt64;
-    message.value.as_int64 = static_cast<int64_t>(initial_count);
-
-    bool result = Dart_PostCObject_DL(port, &message);
-    if (result) {
-      std::cout << "Sent initial count (" << initial_count
-                << ") to newly registered port" << std::endl;
+    if (Deliver(subscriber, EncodeMessage(subscription, initial_count, 0))) {
+      IPC_LOG_DEBUG("Sent initial count ({}) to newly registered subscriber",
+                    initial_count);
     } else {
-      std::cerr << "Failed to send initial count to port" << std::endl;
+      IPC_LOG_ERROR("Failed to send initial count to port");
     }
   }
 
   return true;
 }
 
-bool DartPortManager::UnregisterPort(Dart_Port_DL port) {
-  // Thread-safe port removal using RAII mutex guard.
+bool DartPortManager::Unregister(const DartSubscriber& subscriber) {
+  // Thread-safe removal using RAII mutex guard.
   // Called from Dart via FFI when window is destroyed (dispose()).
   //
-  // Uses std::find + erase pattern for O(n) removal.
+  // Uses std::find_if + erase pattern for O(n) removal.
   // Acceptable since N is small (<10 windows typically).
   std::lock_guard<std::mutex> lock(ports_mutex_);
 
-  auto it = std::find(ports_.begin(), ports_.end(), port);
+  auto it = std::find_if(ports_.begin(), ports_.end(),
+                         [&subscriber](const PortRegistration& registration) {
+                           return registration.subscriber == subscriber;
+                         });
   if (it != ports_.end()) {
     ports_.erase(it);
-    std::cout << "Dart port unregistered: " << port << std::endl;
+    ipc_metrics::AddGauge(ipc_metrics::kMetricDartSubscribers, -1);
+    IPC_PROBE_SUBSCRIBER_REMOVE(subscriber.port, ports_.size());
+    ipc_flight::Record(ipc_flight::kFlightSubscriberRemove,
+                       static_cast<int64_t>(ports_.size()), subscriber.port);
+    IPC_LOG_INFO("Dart subscriber unregistered: {}", subscriber.port);
     return true;
   }
 
-  return false;  // Port not found (already removed or never registered)
+  return false;  // Not found (already removed or never registered)
 }
 
-void DartPortManager::NotifyWindowCountChanged(LONG new_count) {
-  // Broadcast window count update to all registered Dart isolates.
+void DartPortManager::NotifyWindowCountChanged(LONG new_count,
+                                               DWORD source_process_id,
+                                               uint32_t trace_id) {
+  Notify(kDartPortTopicWindowCount, new_count, source_process_id, trace_id);
+}
+
+void DartPortManager::Notify(uint32_t topic, LONG value,
+                             DWORD source_process_id, uint32_t trace_id) {
+  // Broadcast an update to all subscribed Dart isolates.
   // Called from WindowCountListener::ListenerThreadFunction when event signals.
   //
   // Thread Safety: Acquires mutex to protect ports_ during iteration.
   // Dart_PostCObject_DL is thread-safe and can be called from any thread.
   //
   // Performance: O(n) where n = number of registered ports (typically <10).
-  // Dart_PostCObject_DL is non-blocking, so minimal latency (<1ms per port).
+  // Filters run before Dart_PostCObject_DL, so updates a port is not
+  // interested in cost a few comparisons instead of a message per isolate.
   std::lock_guard<std::mutex> lock(ports_mutex_);
 
   if (ports_.empty()) {
     return;  // No Dart isolates registered, nothing to notify
   }
 
-  std::cout << "Notifying " << ports_.size() << " Dart port(s) of window count: "
-            << new_count << std::endl;
+  IPC_LOG_DEBUG("Notifying {} Dart subscriber(s) of topic {} value: {}",
+                ports_.size(), topic, value);
 
-  // Create Dart_CObject message structure.
-  // Dart_CObject is a C struct that represents Dart objects for FFI.
-  // Using kInt64 type to send LONG as 64-bit integer to Dart.
-  Dart_CObject message;
-  message.type = Dart_CObject_kInt64;
-  message.value.as_int64 = static_cast<int64_t>(new_count);
-
-  // Broadcast to all registered Dart ports using Dart_PostCObject_DL.
-  // Dart_PostCObject_DL posts message to Dart isolate's message queue.
-  // The Dart isolate's ReceivePort.listen() callback will receive it.
-  //
+  // Broadcast to all subscribed Dart isolates.
   // Error Handling: If posting fails (e.g., stale port), log error but
-  // continue broadcasting to other ports. Don't crash entire app.
-  for (Dart_Port_DL port : ports_) {
-    bool result = Dart_PostCObject_DL(port, &message);
-    if (result) {
-      std::cout << "Posted to Dart port: " << port << std::endl;
+  // continue broadcasting to other subscribers. Don't crash entire app.
+  for (PortRegistration& registration : ports_) {
+    if ((registration.subscription.topic_mask & topic) == 0) {
+      continue;  // Not subscribed to this topic
+    }
+
+    // Each topic crosses its threshold against its own previous value
+    LONG& last_observed = registration.last_observed_values[TopicIndex(topic)];
+    DartPortUpdate update{topic, value, last_observed, source_process_id,
+                          trace_id};
+    last_observed = value;
+
+    if (!ShouldDeliver(registration, update)) {
+      ipc_metrics::Increment(ipc_metrics::kMetricDartFiltered);
+      continue;  // Filtered out natively
+    }
+
+    ipc_trace::Span span(ipc_trace::kStageDartPost, trace_id);
+    int64_t post_start = ipc_trace::Now();
+    bool posted = Deliver(registration.subscriber,
+                          EncodeMessage(registration.subscription, value,
+                                        trace_id));
+    ipc_metrics::RecordDuration(ipc_metrics::kMetricDartPostDuration,
+                                post_start, ipc_trace::Now());
+    IPC_PROBE_DART_POST(registration.subscriber.port, topic, value, trace_id,
+                        posted);
+    ipc_flight::Record(posted ? ipc_flight::kFlightDartPost
+                              : ipc_flight::kFlightDartPostFailed,
+                       value, registration.subscriber.port, trace_id);
+    if (posted) {
+      ipc_metrics::Increment(ipc_metrics::kMetricDartPosts);
     } else {
       // Post failed - port may be invalid or Dart isolate terminated.
       // Future enhancement: Remove invalid ports from registry.
-      std::cerr << "Failed to post to Dart port: " << port << std::endl;
+      ipc_metrics::Increment(ipc_metrics::kMetricDartPostFailures);
+      IPC_LOG_ERROR("Failed to post to Dart port: {}",
+                    registration.subscriber.port);
     }
   }
 }
 
+bool DartPortManager::ShouldDeliver(const PortRegistration& registration,
+                                    const DartPortUpdate& update) {
+  const DartPortSubscription& subscription = registration.subscription;
+
+  if (subscription.filter_flags & kDartPortFilterCrossesThreshold) {
+    // Without a previous value there is nothing to cross from.
+    if (update.previous_value < 0) {
+      return false;
+    }
+    bool was_below = update.previous_value < subscription.threshold;
+    bool is_below = update.value < subscription.threshold;
+    if (was_below == is_below) {
+      return false;
+    }
+  }
+
+  if (subscription.filter_flags & kDartPortFilterOtherProcesses) {
+    if (update.source_process_id != 0 &&
+        update.source_process_id == GetCurrentProcessId()) {
+      return false;
+    }
+  }
+
+  if (subscription.predicate && !subscription.predicate(update)) {
+    return false;
+  }
+
+  return true;
+}
+
+int64_t DartPortManager::EncodeMessage(const DartPortSubscription& subscription,
+                                       LONG value, uint32_t trace_id) {
+  if ((subscription.filter_flags & kDartPortTraceId) == 0) {
+    return static_cast<int64_t>(value);
+  }
+  // Packed rather than sent as a list so traced delivery stays a single
+  // kInt64 message with no extra allocation.
+  return static_cast<int64_t>((static_cast<uint64_t>(trace_id) << 32) |
+                              static_cast<uint32_t>(value));
+}
+
+bool DartPortManager::Deliver(const DartSubscriber& subscriber,
+                              int64_t message_value) {
+  if (subscriber.mode == kDartDeliveryListener) {
+    // NativeCallable.listener enqueues the call on the owning isolate and
+    // returns immediately; there is no message object to build or copy.
+    subscriber.listener(message_value);
+    return true;
+  }
+
+  // Create Dart_CObject message structure.
+  // Dart_CObject is a C struct that represents Dart objects for FFI.
+  // Using kInt64 type to send the value (see EncodeMessage) to Dart.
+  // Dart_PostCObject_DL posts message to Dart isolate's message queue.
+  // The Dart isolate's ReceivePort.listen() callback will receive it.
+  Dart_CObject message;
+  message.type = Dart_CObject_kInt64;
+  message.value.as_int64 = message_value;
+  return Dart_PostCObject_DL(subscriber.port, &message);
+}
+
 // ============================================================================
 // FFI Exports - C functions callable from Dart via FFI
 // ============================================================================
@@ -149,6 +318,10 @@ void SetCurrentWindowCount(LONG count) {
   g_current_window_count = count;
 }
 
+LONG GetCurrentWindowCount() {
+  return g_current_window_count;
+}
+
 extern "C" {
 
 /// Initialize Dart API DL function pointers.
@@ -188,11 +361,82 @@ __declspec(dllexport) intptr_t InitDartApiDL(void* data) {
 /// @return true if registration successful
 __declspec(dllexport) bool RegisterWindowCountPort(Dart_Port_DL port) {
   // Register port and send current window count immediately
-  std::cout << "RegisterWindowCountPort called with g_current_window_count = "
-            << g_current_window_count << std::endl;
+  IPC_LOG_DEBUG("RegisterWindowCountPort called with g_current_window_count = {}",
+                g_current_window_count);
   return g_dart_port_manager.RegisterPort(port, g_current_window_count);
 }
 
+/// Register Dart SendPort with a topic mask and native filters.
+///
+/// Like RegisterWindowCountPort, but updates that do not match the topic
+/// mask or fail a filter are dropped before Dart_PostCObject_DL is called.
+///
+/// Dart usage:
+///   registerWindowCountPortFiltered(
+///       receivePort.sendPort.nativePort,
+///       DartPortTopic.windowCount,
+///       DartPortFilter.crossesThreshold,
+///       3);
+///
+/// @param port Dart_Port_DL from SendPort.nativePort
+/// @param topic_mask Bitmask of DartPortTopic values
+/// @param filter_flags Bitmask of DartPortFilter values
+/// @param threshold Threshold for kDartPortFilterCrossesThreshold
+/// @return true if registration successful
+__declspec(dllexport) bool RegisterWindowCountPortFiltered(
+    Dart_Port_DL port, uint32_t topic_mask, uint32_t filter_flags,
+    int32_t threshold) {
+  DartPortSubscription subscription;
+  subscription.topic_mask = topic_mask;
+  subscription.filter_flags = filter_flags;
+  subscription.threshold = static_cast<LONG>(threshold);
+  return g_dart_port_manager.RegisterPort(port, g_current_window_count,
+                                          subscription);
+}
+
+/// Register a NativeCallable.listener for window count updates.
+///
+/// Same registry and filters as port registration, but updates are
+/// delivered by calling the listener directly from the notification thread.
+///
+/// Dart usage:
+///   final callable = NativeCallable<Void Function(Int64)>.listener(
+///       (int count) => setState(() { windowCount = count; }));
+///   registerWindowCountListener(
+///       callable.nativeFunction, DartPortTopic.all, DartPortFilter.none, 0);
+///
+/// @param listener NativeCallable.listener nativeFunction pointer
+/// @param topic_mask Bitmask of DartPortTopic values
+/// @param filter_flags Bitmask of DartPortFilter values
+/// @param threshold Threshold for kDartPortFilterCrossesThreshold
+/// @return true if registration successful
+__declspec(dllexport) bool RegisterWindowCountListener(
+    DartListenerCallback listener, uint32_t topic_mask, uint32_t filter_flags,
+    int32_t threshold) {
+  if (listener == nullptr) {
+    return false;
+  }
+  DartPortSubscription subscription;
+  subscription.topic_mask = topic_mask;
+  subscription.filter_flags = filter_flags;
+  subscription.threshold = static_cast<LONG>(threshold);
+  return g_dart_port_manager.Register(DartSubscriber::ForListener(listener),
+                                      g_current_window_count, subscription);
+}
+
+/// Unregister a NativeCallable.listener.
+///
+/// Dart usage (in dispose(), before closing the callable):
+///   unregisterWindowCountListener(callable.nativeFunction);
+///   callable.close();
+///
+/// @param listener Function pointer passed to RegisterWindowCountListener
+/// @return true if the listener was found and removed
+__declspec(dllexport) bool UnregisterWindowCountListener(
+    DartListenerCallback listener) {
+  return g_dart_port_manager.Unregister(DartSubscriber::ForListener(listener));
+}
+
 /// Unregister Dart SendPort when no longer needed.
 ///
 /// Removes the port from DartPortManager's registry. Should be called
@@ -222,29 +466,25 @@ __declspec(dllexport) bool UnregisterWindowCountPort(Dart_Port_DL port) {
 ///   closeWindow();
 ///
 /// The window finding strategy:
-/// 1. Try GetActiveWindow() - works if our window is active
-/// 2. Fall back to FindWindow by class name - finds Flutter window
-/// 3. Last resort: PostQuitMessage(0) - terminates cleanly
+/// 1. Enumerate top-level windows for this process's Flutter runner
+///    window. Every app window is its own process, so a desktop-wide
+///    lookup by class name (FindWindow) could close another window, and
+///    GetActiveWindow() sees nothing from the command port's thread.
+/// 2. Last resort: PostQuitMessage(0) - terminates cleanly
 __declspec(dllexport) void RequestWindowClose() {
-  std::cout << "RequestWindowClose called" << std::endl;
+  IPC_LOG_INFO("RequestWindowClose called");
 
-  // Strategy 1: Get the currently active window
-  HWND hwnd = GetActiveWindow();
-  std::cout << "GetActiveWindow returned: " << hwnd << std::endl;
-
-  // Strategy 2: Find Flutter window by class name if not active
-  if (hwnd == nullptr) {
-    hwnd = FindWindowA("FLUTTER_RUNNER_WIN32_WINDOW", nullptr);
-    std::cout << "FindWindowA returned: " << hwnd << std::endl;
-  }
+  HWND hwnd = nullptr;
+  EnumWindows(FindOwnRunnerWindow, reinterpret_cast<LPARAM>(&hwnd));
+  IPC_LOG_DEBUG("Runner window of this process: {}", hwnd);
 
   // Send WM_CLOSE to trigger proper cleanup path
   if (hwnd != nullptr) {
-    std::cout << "Posting WM_CLOSE to window " << hwnd << std::endl;
+    IPC_LOG_INFO("Posting WM_CLOSE to window {}", hwnd);
     PostMessageA(hwnd, WM_CLOSE, 0, 0);
   } else {
     // Fallback: post quit message directly
-    std::cout << "No window found, calling PostQuitMessage(0)" << std::endl;
+    IPC_LOG_WARN("No window found, calling PostQuitMessage(0)");
     PostQuitMessage(0);
   }
 }
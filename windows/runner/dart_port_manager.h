@@ -14,9 +14,103 @@
 #include <dart_api_dl.h>
 #include <windows.h>
 
+#include <cstdint>
+#include <functional>
 #include <mutex>
 #include <vector>
 
+/// Notification topics a Dart port can subscribe to (bitmask).
+///
+/// Each broadcast carries exactly one topic. A port only receives updates
+/// whose topic bit is set in its subscription's topic_mask.
+enum DartPortTopic : uint32_t {
+  kDartPortTopicWindowCount = 1u << 0,
+  kDartPortTopicAll = 0xFFFFFFFFu,
+};
+
+/// Number of topic bits in a DartPortTopic mask.
+constexpr uint32_t kDartPortTopicCount = 32;
+
+/// Built-in native filters for a port subscription (bitmask).
+///
+/// All set flags must pass for an update to be posted. Filters are plain
+/// flags so they can be passed across the FFI boundary from Dart.
+enum DartPortFilter : uint32_t {
+  kDartPortFilterNone = 0,
+  /// Deliver only when the value crosses the subscription threshold, i.e.
+  /// the previous value and the new value lie on different sides of it
+  /// (below vs. at-or-above).
+  kDartPortFilterCrossesThreshold = 1u << 0,
+  /// Deliver only changes made by another process. Updates with an unknown
+  /// source process (0) are delivered.
+  kDartPortFilterOtherProcesses = 1u << 1,
+  /// Not a filter: deliver (trace_id << 32) | value instead of the bare
+  /// value, so the Dart handler can report the update's ipc_trace ID.
+  /// Untraced updates (initial counts) carry trace ID 0.
+  kDartPortTraceId = 1u << 2,
+};
+
+/// A single update as seen by one registered port.
+struct DartPortUpdate {
+  uint32_t topic;             // One DartPortTopic bit
+  LONG value;                 // New value for the topic
+  LONG previous_value;        // Last value this port observed, -1 if none
+  DWORD source_process_id;    // Process that made the change, 0 if unknown
+  uint32_t trace_id;          // ipc_trace ID of the change, 0 if untraced
+};
+
+/// Predicate evaluated natively before posting. Return false to drop.
+using DartPortPredicate = std::function<bool(const DartPortUpdate& update)>;
+
+/// Describes which updates a registered port wants to receive.
+///
+/// The default subscription receives every update on every topic, which
+/// matches the behaviour of RegisterPort() without a subscription.
+struct DartPortSubscription {
+  uint32_t topic_mask = kDartPortTopicAll;
+  uint32_t filter_flags = kDartPortFilterNone;
+  LONG threshold = 0;           // Used by kDartPortFilterCrossesThreshold
+  DartPortPredicate predicate;  // Optional, C++ callers only
+};
+
+/// Native entry point of a Dart `NativeCallable<Void Function(Int64)>.listener`.
+///
+/// Calling it from any thread enqueues a call to the Dart listener function
+/// on its isolate, skipping the ReceivePort and StreamController hops and
+/// the Dart_CObject message copy of port delivery.
+typedef void (*DartListenerCallback)(int64_t value);
+
+/// How updates reach a subscriber.
+enum DartDeliveryMode {
+  /// Dart_PostCObject_DL to a SendPort, received by a ReceivePort.
+  kDartDeliveryPort,
+  /// Direct call of a NativeCallable.listener function pointer.
+  kDartDeliveryListener,
+};
+
+/// A destination for updates: either a SendPort or a listener callback.
+///
+/// Both kinds share the same registry, subscriptions and filters; only the
+/// final delivery step differs.
+struct DartSubscriber {
+  DartDeliveryMode mode;
+  Dart_Port_DL port;              // Valid for kDartDeliveryPort
+  DartListenerCallback listener;  // Valid for kDartDeliveryListener
+
+  static DartSubscriber ForPort(Dart_Port_DL port) {
+    return DartSubscriber{kDartDeliveryPort, port, nullptr};
+  }
+
+  static DartSubscriber ForListener(DartListenerCallback listener) {
+    return DartSubscriber{kDartDeliveryListener, 0, listener};
+  }
+
+  bool operator==(const DartSubscriber& other) const {
+    return mode == other.mode && port == other.port &&
+           listener == other.listener;
+  }
+};
+
 /// Manages communication from C++ to Dart isolates via Dart C API.
 ///
 /// DartPortManager maintains a registry of Dart SendPort handles and
@@ -56,6 +150,23 @@ class DartPortManager {
   /// @return true if registration successful
   bool RegisterPort(Dart_Port_DL port, LONG initial_count = -1);
 
+  /// Registers a Dart SendPort with a topic mask and native filters.
+  ///
+  /// Updates that do not match the subscription are dropped in native code
+  /// and never cross into Dart. The initial count, if provided, is always
+  /// posted so the port starts from the current state.
+  ///
+  /// Registering an already registered port replaces its subscription.
+  ///
+  /// Thread-safe: Can be called from FFI thread.
+  ///
+  /// @param port Dart_Port_DL obtained from SendPort.nativePort in Dart
+  /// @param initial_count Optional initial value to send to newly registered port
+  /// @param subscription Topics and filters for this port
+  /// @return true if registration successful
+  bool RegisterPort(Dart_Port_DL port, LONG initial_count,
+                    const DartPortSubscription& subscription);
+
   /// Unregisters a previously registered Dart SendPort.
   ///
   /// Removes the port from the internal registry. The port will no longer
@@ -67,6 +178,30 @@ class DartPortManager {
   /// @return true if port was found and removed, false if not found
   bool UnregisterPort(Dart_Port_DL port);
 
+  /// Registers any subscriber (SendPort or listener callback).
+  ///
+  /// RegisterPort() is shorthand for Register(DartSubscriber::ForPort(...)).
+  /// A listener receives its initial count through a direct call.
+  ///
+  /// Listener callbacks must be unregistered before the Dart side closes
+  /// the NativeCallable; calling a closed callable is undefined behaviour.
+  ///
+  /// Thread-safe: Can be called from FFI thread.
+  ///
+  /// @param subscriber Port or listener to deliver updates to
+  /// @param initial_count Optional initial value to deliver immediately
+  /// @param subscription Topics and filters for this subscriber
+  /// @return true if registration successful
+  bool Register(const DartSubscriber& subscriber, LONG initial_count,
+                const DartPortSubscription& subscription);
+
+  /// Unregisters a subscriber registered with Register() or RegisterPort().
+  ///
+  /// Thread-safe: Can be called from FFI thread.
+  ///
+  /// @return true if the subscriber was found and removed
+  bool Unregister(const DartSubscriber& subscriber);
+
   /// Broadcasts window count update to all registered Dart ports.
   ///
   /// Creates Dart_CObject message with the new window count and calls
@@ -79,12 +214,56 @@ class DartPortManager {
   /// Thread-safe: Can be called from background thread.
   ///
   /// @param new_count Current window count from SharedMemoryManager
-  void NotifyWindowCountChanged(LONG new_count);
+  /// @param source_process_id Process that made the change, 0 if unknown
+  /// @param trace_id ipc_trace ID of the change, 0 if untraced
+  void NotifyWindowCountChanged(LONG new_count, DWORD source_process_id = 0,
+                                uint32_t trace_id = 0);
+
+  /// Broadcasts an update on a single topic to all subscribed ports.
+  ///
+  /// Each port's topic mask, built-in filters and predicate are evaluated
+  /// here, on the calling thread, before Dart_PostCObject() is called.
+  ///
+  /// Thread-safe: Can be called from background thread.
+  ///
+  /// @param topic One DartPortTopic bit
+  /// @param value New value for the topic
+  /// @param source_process_id Process that made the change, 0 if unknown
+  /// @param trace_id ipc_trace ID of the change, 0 if untraced
+  void Notify(uint32_t topic, LONG value, DWORD source_process_id = 0,
+              uint32_t trace_id = 0);
 
  private:
+  /// A registered subscriber and the state its filters need.
+  struct PortRegistration {
+    DartSubscriber subscriber;
+    DartPortSubscription subscription;
+    // Previous value of each topic, by bit index, for threshold crossing;
+    // -1 until the port has observed the topic.
+    LONG last_observed_values[kDartPortTopicCount];
+
+    /// Forgets observed values; the window count starts at initial_count.
+    void ResetObserved(LONG initial_count);
+  };
+
+  /// Returns true if the update passes the registration's filters.
+  static bool ShouldDeliver(const PortRegistration& registration,
+                            const DartPortUpdate& update);
+
+  /// Builds the int64 a subscriber receives: the value, with the trace ID
+  /// in the upper 32 bits if the subscription asked for it.
+  static int64_t EncodeMessage(const DartPortSubscription& subscription,
+                               LONG value, uint32_t trace_id);
+
+  /// Delivers one encoded message to a subscriber using its delivery mode.
+  ///
+  /// @return false if posting to a port failed
+  static bool Deliver(const DartSubscriber& subscriber,
+                      int64_t message_value);
+
   /// Registered Dart SendPort handles.
   /// Protected by ports_mutex_ for thread-safe access.
-  std::vector<Dart_Port_DL> ports_;
+  std::vector<PortRegistration> ports_;
 
   /// Mutex protecting ports_ vector.
   /// Ensures thread-safe registration, unregistration, and broadcasting.
@@ -99,6 +278,10 @@ DartPortManager& GetGlobalDartPortManager();
 // Called by FlutterWindow to provide the count to newly registered ports.
 void SetCurrentWindowCount(LONG count);
 
+// Get the count last set by SetCurrentWindowCount.
+// Used as the initial value for ports registered outside the FFI exports.
+LONG GetCurrentWindowCount();
+
 // FFI Exports for Dart binding
 extern "C" {
 
@@ -126,6 +309,44 @@ __declspec(dllexport) intptr_t InitDartApiDL(void* data);
 /// @return true if registration successful
 __declspec(dllexport) bool RegisterWindowCountPort(Dart_Port_DL port);
 
+/// FFI export: Register Dart SendPort with a topic mask and native filters.
+///
+/// Called from Dart via FFI:
+///   registerFiltered(sendPort.nativePort, topicMask, filterFlags, threshold);
+///
+/// @param port Dart_Port_DL from SendPort.nativePort
+/// @param topic_mask Bitmask of DartPortTopic values
+/// @param filter_flags Bitmask of DartPortFilter values
+/// @param threshold Threshold for kDartPortFilterCrossesThreshold
+/// @return true if registration successful
+__declspec(dllexport) bool RegisterWindowCountPortFiltered(
+    Dart_Port_DL port, uint32_t topic_mask, uint32_t filter_flags,
+    int32_t threshold);
+
+/// FFI export: Register a NativeCallable.listener for window count updates.
+///
+/// Called from Dart via FFI:
+///   final callable = NativeCallable<Void Function(Int64)>.listener(onCount);
+///   registerListener(callable.nativeFunction, topicMask, filterFlags, 0);
+///
+/// @param listener NativeCallable.listener nativeFunction pointer
+/// @param topic_mask Bitmask of DartPortTopic values
+/// @param filter_flags Bitmask of DartPortFilter values
+/// @param threshold Threshold for kDartPortFilterCrossesThreshold
+/// @return true if registration successful
+__declspec(dllexport) bool RegisterWindowCountListener(
+    DartListenerCallback listener, uint32_t topic_mask, uint32_t filter_flags,
+    int32_t threshold);
+
+/// FFI export: Unregister a NativeCallable.listener.
+///
+/// Must be called before NativeCallable.close().
+///
+/// @param listener Function pointer passed to RegisterWindowCountListener
+/// @return true if the listener was found and removed
+__declspec(dllexport) bool UnregisterWindowCountListener(
+    DartListenerCallback listener);
+
 /// FFI export: Unregister Dart SendPort.
 ///
 /// Called from Dart via FFI when window is destroyed:
@@ -135,6 +356,13 @@ __declspec(dllexport) bool RegisterWindowCountPort(Dart_Port_DL port);
 /// @return true if port was found and removed
 __declspec(dllexport) bool UnregisterWindowCountPort(Dart_Port_DL port);
 
+/// FFI export: Request graceful window close via Win32 message loop.
+///
+/// Posts WM_CLOSE to the Flutter window so OnDestroy() runs and the
+/// window count is decremented. Also reachable asynchronously through
+/// DartCommandPort (kDartCommandRequestWindowClose).
+__declspec(dllexport) void RequestWindowClose();
+
 }  // extern "C"
 
 #endif  // RUNNER_DART_PORT_MANAGER_H_
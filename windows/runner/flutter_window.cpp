@@ -1,13 +1,11 @@
 #include "flutter_window.h"
 
-#include <iostream>
 #include <optional>
 
-#include "dart_port_manager.h"
 #include "flutter/generated_plugin_registrant.h"
 
 FlutterWindow::FlutterWindow(const flutter::DartProject& project)
-    : project_(project) {}
+    : project_(project), lifecycle_(this) {}
 
 FlutterWindow::~FlutterWindow() {}
 
@@ -16,48 +14,19 @@ bool FlutterWindow::OnCreate() {
     return false;
   }
 
-  // Initialize shared memory manager for multi-window synchronization
-  shared_memory_manager_ = std::make_unique<SharedMemoryManager>();
-  if (!shared_memory_manager_->Initialize()) {
-    std::cerr << "Failed to initialize SharedMemoryManager" << std::endl;
-    // Continue anyway - shared memory is not critical for basic functionality
-  } else {
-    // Increment window count to track active windows
-    shared_memory_manager_->IncrementWindowCount();
-  }
-
-  // Start event listener for window count change notifications
-  window_count_listener_ = std::make_unique<WindowCountListener>();
-
-  // Set callback to notify Dart isolates when window count changes.
-  // Lambda captures shared_memory_manager_ to read current count.
-  window_count_listener_->SetCallback([this](LONG /* placeholder */) {
-    // Read current window count from shared memory
-    LONG current_count = shared_memory_manager_->GetWindowCount();
-
-    std::cout << "Callback triggered: current_count = " << current_count << std::endl;
-
-    // Update global count for new port registrations
-    SetCurrentWindowCount(current_count);
-
-    std::cout << "About to call NotifyWindowCountChanged with count = " << current_count << std::endl;
-
-    // Notify all registered Dart isolates (Layer 3)
-    GetGlobalDartPortManager().NotifyWindowCountChanged(current_count);
-
-    std::cout << "NotifyWindowCountChanged returned" << std::endl;
-  });
+  // Shared memory and the window count listener come up first; the
+  // lifecycle then calls CreateContent() for the Flutter view.
+  return lifecycle_.OnCreate();
+}
 
-  if (!window_count_listener_->Start()) {
-    std::cerr << "Failed to start WindowCountListener" << std::endl;
-    // Continue anyway - listener is not critical for basic functionality
-  }
+void FlutterWindow::OnDestroy() {
+  // Tears down the IPC, then calls DestroyContent().
+  lifecycle_.OnDestroy();
 
-  // Update global window count so newly registered Dart ports receive it.
-  // This ensures Dart UI gets the current count immediately on registration.
-  LONG current_count = shared_memory_manager_->GetWindowCount();
-  SetCurrentWindowCount(current_count);
+  Win32Window::OnDestroy();
+}
 
+bool FlutterWindow::CreateContent() {
   RECT frame = GetClientArea();
 
   // The size here must match the window dimensions to avoid unnecessary surface
@@ -83,22 +52,10 @@ bool FlutterWindow::OnCreate() {
   return true;
 }
 
-void FlutterWindow::OnDestroy() {
-  // Decrement window count before destroying
-  if (shared_memory_manager_) {
-    shared_memory_manager_->DecrementWindowCount();
-  }
-
-  // Stop event listener
-  if (window_count_listener_) {
-    window_count_listener_->Stop();
-  }
-
+void FlutterWindow::DestroyContent() {
   if (flutter_controller_) {
     flutter_controller_ = nullptr;
   }
-
-  Win32Window::OnDestroy();
 }
 
 LRESULT
@@ -6,12 +6,14 @@
 
 #include <memory>
 
-#include "shared_memory_manager.h"
-#include "window_count_listener.h"
 #include "win32_window.h"
+#include "window_lifecycle.h"
 
 // A window that does nothing but host a Flutter view.
-class FlutterWindow : public Win32Window {
+//
+// The IPC steps of opening and closing the window live in WindowLifecycle;
+// this class supplies the Win32 and Flutter parts as its PlatformWindow.
+class FlutterWindow : public Win32Window, public PlatformWindow {
  public:
   // Creates a new FlutterWindow hosting a Flutter view running |project|.
   explicit FlutterWindow(const flutter::DartProject& project);
@@ -24,6 +26,10 @@ class FlutterWindow : public Win32Window {
   LRESULT MessageHandler(HWND window, UINT const message, WPARAM const wparam,
                          LPARAM const lparam) noexcept override;
 
+  // PlatformWindow:
+  bool CreateContent() override;
+  void DestroyContent() override;
+
  private:
   // The project to run.
   flutter::DartProject project_;
@@ -31,11 +37,8 @@ class FlutterWindow : public Win32Window {
   // The Flutter instance hosted by this window.
   std::unique_ptr<flutter::FlutterViewController> flutter_controller_;
 
-  // Shared memory manager for multi-window synchronization
-  std::unique_ptr<SharedMemoryManager> shared_memory_manager_;
-
-  // Event listener for window count change notifications
-  std::unique_ptr<WindowCountListener> window_count_listener_;
+  // Shared memory, listener and Dart notification for this window.
+  WindowLifecycle lifecycle_;
 };
 
 #endif  // RUNNER_FLUTTER_WINDOW_H_
@@ -0,0 +1,217 @@
+// ipc_callback_executor.cpp
+//
+// Implementation of IpcCallbackExecutor and IpcCallbackQueue.
+//
+// Lock order: the executor's mutex and a queue's mutex are never held
+// together, so Submit(), Close() and the workers cannot deadlock each other.
+
+#include "ipc_callback_executor.h"
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <utility>
+
+#include "ipc_log.h"
+#include "ipc_metrics.h"
+
+namespace {
+
+// The process's shared pool, see IpcCallbackExecutor::Acquire().
+std::mutex g_executor_mutex;
+std::weak_ptr<IpcCallbackExecutor> g_executor;
+
+void Invoke(const IpcCallbackTask& task) {
+  try {
+    task();
+  } catch (const std::exception& e) {
+    IPC_LOG_ERROR("IPC callback threw exception: {}", e.what());
+  } catch (...) {
+    IPC_LOG_ERROR("IPC callback threw unknown exception");
+  }
+}
+
+}  // anonymous namespace
+
+std::shared_ptr<IpcCallbackExecutor> IpcCallbackExecutor::Acquire() {
+  std::lock_guard<std::mutex> lock(g_executor_mutex);
+  std::shared_ptr<IpcCallbackExecutor> executor = g_executor.lock();
+  if (!executor) {
+    executor = std::make_shared<IpcCallbackExecutor>(kSharedThreads);
+    g_executor = executor;
+  }
+  return executor;
+}
+
+IpcCallbackExecutor::IpcCallbackExecutor(size_t threads) : stopping_(false) {
+  threads = std::max<size_t>(threads, 1);
+  workers_.reserve(threads);
+  for (size_t i = 0; i < threads; i++) {
+    workers_.emplace_back(&IpcCallbackExecutor::WorkerLoop, this);
+  }
+}
+
+IpcCallbackExecutor::~IpcCallbackExecutor() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  ready_changed_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+void IpcCallbackExecutor::Schedule(IpcCallbackQueue* queue) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ready_.push_back(queue);
+  }
+  ready_changed_.notify_one();
+}
+
+bool IpcCallbackExecutor::Unschedule(IpcCallbackQueue* queue) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = std::find(ready_.begin(), ready_.end(), queue);
+  if (it == ready_.end()) {
+    return false;
+  }
+  ready_.erase(it);
+  return true;
+}
+
+void IpcCallbackExecutor::WorkerLoop() {
+  for (;;) {
+    IpcCallbackQueue* queue = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      ready_changed_.wait(lock,
+                          [this] { return stopping_ || !ready_.empty(); });
+      if (stopping_) {
+        return;
+      }
+      queue = ready_.front();
+      ready_.pop_front();
+    }
+    // Back of the line after each task, so every queue gets its turn.
+    if (queue->RunOne()) {
+      Schedule(queue);
+    }
+  }
+}
+
+IpcCallbackQueue::IpcCallbackQueue(
+    std::shared_ptr<IpcCallbackExecutor> executor, size_t capacity)
+    : executor_(std::move(executor)),
+      capacity_(std::max<size_t>(capacity, 1)),
+      scheduled_(false),
+      closed_(false) {}
+
+IpcCallbackQueue::~IpcCallbackQueue() {
+  Close();
+}
+
+IpcCallbackQueue::Result IpcCallbackQueue::Submit(IpcCallbackTask task) {
+  if (!executor_) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (closed_) {
+        return kClosed;
+      }
+    }
+    Invoke(task);
+    return kRanInline;
+  }
+
+  Result result;
+  bool schedule = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (closed_) {
+      return kClosed;
+    }
+    if (tasks_.size() >= capacity_) {
+      // The newest queued task has not started; this one supersedes it.
+      tasks_.back() = std::move(task);
+      result = kCollapsed;
+    } else {
+      tasks_.push_back(std::move(task));
+      result = kQueued;
+    }
+    if (!scheduled_) {
+      scheduled_ = true;
+      schedule = true;
+    }
+  }
+  if (schedule) {
+    executor_->Schedule(this);
+  }
+
+  ipc_metrics::Increment(result == kCollapsed
+                             ? ipc_metrics::kMetricCallbacksCollapsed
+                             : ipc_metrics::kMetricCallbacksQueued);
+  return result;
+}
+
+void IpcCallbackQueue::Close() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (closed_ && !scheduled_) {
+      return;
+    }
+    closed_ = true;
+    tasks_.clear();
+  }
+  if (!executor_) {
+    return;
+  }
+
+  // Waiting on the ready list: no worker has it, take it back directly.
+  bool unscheduled = executor_->Unschedule(this);
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (unscheduled) {
+    scheduled_ = false;
+  }
+  // Called from our own task, the worker is this thread: it lets go once
+  // the task returns, so waiting here would never end.
+  if (running_thread_ == std::this_thread::get_id()) {
+    return;
+  }
+  // Otherwise a worker has it (or is about to): it runs at most the task
+  // already started, finds the queue empty and lets go.
+  idle_.wait(lock, [this] { return !scheduled_; });
+}
+
+size_t IpcCallbackQueue::GetPendingCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return tasks_.size();
+}
+
+bool IpcCallbackQueue::RunOne() {
+  IpcCallbackTask task;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (tasks_.empty()) {
+      scheduled_ = false;
+      idle_.notify_all();
+      return false;
+    }
+    task = std::move(tasks_.front());
+    tasks_.pop_front();
+    running_thread_ = std::this_thread::get_id();
+  }
+
+  Invoke(task);
+  task = nullptr;  // Release captures before the owner can go away
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  running_thread_ = std::thread::id();
+  if (tasks_.empty()) {
+    // Notified under the lock: Close() may destroy the queue once it can
+    // take the lock again.
+    scheduled_ = false;
+    idle_.notify_all();
+    return false;
+  }
+  return true;
+}
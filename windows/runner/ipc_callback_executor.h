@@ -0,0 +1,149 @@
+// ipc_callback_executor.h
+//
+// Runs notification callbacks off the thread that waits for notifications.
+//
+// A listener that runs its callback inline cannot wait while the callback
+// runs: a callback that logs to a console, takes a contended lock or
+// rebuilds UI state delays the next wakeup, and on the shared IpcReactor it
+// delays every other source as well. An IpcCallbackQueue takes the
+// callback instead and hands it to an IpcCallbackExecutor, so the waiting
+// thread only queues a task and goes straight back to waiting.
+//
+// Each queue runs its tasks one at a time and in order, so a callback never
+// runs concurrently with itself. The queue is bounded: when it is full, a
+// new task replaces the newest queued one (latest-value collapse). That
+// fits notification callbacks, which read the latest shared state when
+// they run, so a burst collapses into one late callback instead of a
+// backlog, however slow the callback is. Queued and collapsed tasks are
+// counted as kMetricCallbacksQueued and kMetricCallbacksCollapsed.
+//
+// Three ways to run a queue:
+//   inline     no executor; Submit() runs the task on the calling thread
+//   dedicated  an executor of its own with one worker thread
+//   shared     the process's callback pool, IpcCallbackExecutor::Acquire(),
+//              whose few workers serve the queues of every listener
+//
+// Example usage:
+//   IpcCallbackQueue queue(IpcCallbackExecutor::Acquire(), 4);
+//   queue.Submit([] { SlowCallback(); });  // Returns at once
+//   ...
+//   queue.Close();  // Drops queued tasks, waits for a running one
+
+#ifndef RUNNER_IPC_CALLBACK_EXECUTOR_H_
+#define RUNNER_IPC_CALLBACK_EXECUTOR_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class IpcCallbackQueue;
+
+// One queued callback.
+using IpcCallbackTask = std::function<void()>;
+
+// Worker threads that run the tasks of IpcCallbackQueues.
+class IpcCallbackExecutor {
+ public:
+  // Workers of the process's shared callback pool.
+  static constexpr size_t kSharedThreads = 2;
+
+  // Returns the process's shared callback pool, starting it for the first
+  // user. It stops when the last user drops its reference.
+  static std::shared_ptr<IpcCallbackExecutor> Acquire();
+
+  // Starts threads worker threads (at least one).
+  explicit IpcCallbackExecutor(size_t threads);
+
+  // Joins the workers. Queues hold a reference, so none is left by then.
+  ~IpcCallbackExecutor();
+
+  IpcCallbackExecutor(const IpcCallbackExecutor&) = delete;
+  IpcCallbackExecutor& operator=(const IpcCallbackExecutor&) = delete;
+
+  size_t thread_count() const { return workers_.size(); }
+
+ private:
+  friend class IpcCallbackQueue;
+
+  // Adds a queue with tasks to the ready list.
+  void Schedule(IpcCallbackQueue* queue);
+
+  // Takes a queue off the ready list. Returns true if it was there.
+  bool Unschedule(IpcCallbackQueue* queue);
+
+  // Worker: runs one task of the oldest ready queue at a time, so a busy
+  // queue cannot starve the others.
+  void WorkerLoop();
+
+  std::mutex mutex_;
+  std::condition_variable ready_changed_;
+  std::deque<IpcCallbackQueue*> ready_;  // Queues with tasks, in order
+  bool stopping_;
+  std::vector<std::thread> workers_;
+};
+
+// Bounded, serial task queue with latest-value collapse, see the file
+// comment. Thread-safe.
+class IpcCallbackQueue {
+ public:
+  // Queue length used when none is given.
+  static constexpr size_t kDefaultCapacity = 4;
+
+  // What Submit() did with a task.
+  enum Result {
+    kRanInline,  // No executor: ran on the calling thread
+    kQueued,     // Added to the queue
+    kCollapsed,  // Queue full: replaced the newest queued task
+    kClosed,     // Queue closed: dropped
+  };
+
+  // Queue on executor, or inline if executor is nullptr. Holds at most
+  // capacity tasks (at least one) besides the one running.
+  IpcCallbackQueue(std::shared_ptr<IpcCallbackExecutor> executor,
+                   size_t capacity = kDefaultCapacity);
+
+  // Closes the queue.
+  ~IpcCallbackQueue();
+
+  IpcCallbackQueue(const IpcCallbackQueue&) = delete;
+  IpcCallbackQueue& operator=(const IpcCallbackQueue&) = delete;
+
+  // Queues task, or runs it at once without an executor. Never blocks on a
+  // running task.
+  Result Submit(IpcCallbackTask task);
+
+  // Stops accepting tasks, drops the queued ones and waits for a running
+  // one to finish. Safe to call twice. Called from this queue's own task,
+  // it does not wait (the task is the caller); the queue must then not be
+  // destroyed until that task has returned.
+  void Close();
+
+  // Tasks waiting to run.
+  size_t GetPendingCount() const;
+
+  bool is_inline() const { return executor_ == nullptr; }
+
+ private:
+  friend class IpcCallbackExecutor;
+
+  // Runs the oldest task. Returns true if more are waiting and the queue
+  // stays scheduled, false once the executor is done with it.
+  bool RunOne();
+
+  std::shared_ptr<IpcCallbackExecutor> executor_;
+  size_t capacity_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable idle_;  // Signaled when scheduled_ drops
+  std::deque<IpcCallbackTask> tasks_;
+  bool scheduled_;  // Ready on, or running on, the executor
+  bool closed_;
+  std::thread::id running_thread_;  // Worker running a task, if any
+};
+
+#endif  // RUNNER_IPC_CALLBACK_EXECUTOR_H_
@@ -0,0 +1,215 @@
+// ipc_capture.cpp
+//
+// Implementation of IPC traffic capture files.
+
+#include "ipc_capture.h"
+
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "ipc_log.h"
+
+namespace ipc_capture {
+
+namespace {
+// How often the background capture drains the ring. The default ring holds
+// 4096 events, so this keeps up with bursts of ~400k events per second.
+constexpr DWORD kCapturePollMs = 10;
+
+// Background capture started through StartCapture().
+struct CaptureSession {
+  std::mutex mutex;  // Guards Start/Stop, not the polling
+  std::unique_ptr<CaptureWriter> writer;
+  std::thread thread;
+  HANDLE stop_event = nullptr;
+};
+
+CaptureSession& GetSession() {
+  // Intentionally leaked like the other globals: a capture may still be
+  // polling during static destruction.
+  static CaptureSession* session = new CaptureSession();
+  return *session;
+}
+}  // anonymous namespace
+
+// ============================================================================
+// CaptureWriter
+// ============================================================================
+
+CaptureWriter::CaptureWriter(const ipc_flight::FlightRecorder* recorder)
+    : recorder_(recorder), next_index_(0), record_count_(0), lost_count_(0) {}
+
+CaptureWriter::~CaptureWriter() {
+  Close();
+}
+
+bool CaptureWriter::Open(const std::string& path) {
+  file_.open(path, std::ios::out | std::ios::trunc | std::ios::binary);
+  if (!file_) {
+    return false;
+  }
+
+  LARGE_INTEGER frequency;
+  LARGE_INTEGER now;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&now);
+  CaptureFileHeader header = {};
+  header.magic = kCaptureMagic;
+  header.version = kCaptureVersion;
+  header.record_size = sizeof(CaptureRecord);
+  header.frequency = frequency.QuadPart;
+  header.start_ticks = now.QuadPart;
+  file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  next_index_ = recorder_->GetWriteIndex();
+  record_count_ = 0;
+  lost_count_ = 0;
+  return static_cast<bool>(file_);
+}
+
+size_t CaptureWriter::Poll() {
+  if (!file_.is_open()) {
+    return 0;
+  }
+
+  pending_.clear();
+  lost_count_ += recorder_->CollectFrom(&next_index_, &pending_);
+  for (const ipc_flight::FlightEvent& event : pending_) {
+    CaptureRecord record = {};
+    record.ticks = event.ticks;
+    record.value = event.value;
+    record.detail = event.detail;
+    record.process_id = event.process_id;
+    record.thread_id = event.thread_id;
+    record.trace_id = event.trace_id;
+    record.kind = event.kind;
+    file_.write(reinterpret_cast<const char*>(&record), sizeof(record));
+  }
+  record_count_ += pending_.size();
+  return pending_.size();
+}
+
+bool CaptureWriter::Close() {
+  if (!file_.is_open()) {
+    return true;
+  }
+  Poll();
+  file_.close();
+  // The stream keeps its failbit after close if any write failed.
+  bool ok = !file_.fail();
+  file_.clear();
+  return ok;
+}
+
+bool ReadCaptureFile(const std::string& path, CaptureFileHeader* header,
+                     std::vector<CaptureRecord>* records) {
+  std::ifstream file(path, std::ios::in | std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  if (!file.read(reinterpret_cast<char*>(header), sizeof(*header)) ||
+      header->magic != kCaptureMagic || header->version != kCaptureVersion ||
+      header->record_size != sizeof(CaptureRecord) ||
+      header->frequency <= 0) {
+    return false;
+  }
+
+  records->clear();
+  CaptureRecord record;
+  while (file.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+    records->push_back(record);
+  }
+  return true;
+}
+
+bool StartCapture(const std::string& path) {
+  CaptureSession& session = GetSession();
+  std::lock_guard<std::mutex> lock(session.mutex);
+  if (session.writer) {
+    IPC_LOG_WARN("IPC capture already running");
+    return false;
+  }
+
+  auto writer = std::make_unique<CaptureWriter>(
+      &ipc_flight::GetFlightRecorder());
+  if (!writer->Open(path)) {
+    IPC_LOG_ERROR("Failed to create IPC capture file: {}", path);
+    return false;
+  }
+  session.stop_event = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+  if (session.stop_event == nullptr) {
+    IPC_LOG_ERROR("CreateEventA failed for IPC capture: {}", GetLastError());
+    return false;
+  }
+
+  session.writer = std::move(writer);
+  CaptureWriter* polled = session.writer.get();
+  HANDLE stop_event = session.stop_event;
+  session.thread = std::thread([polled, stop_event] {
+    while (WaitForSingleObject(stop_event, kCapturePollMs) == WAIT_TIMEOUT) {
+      polled->Poll();
+    }
+  });
+  IPC_LOG_INFO("IPC capture started: {}", path);
+  return true;
+}
+
+bool StopCapture(uint64_t* record_count, uint64_t* lost_count) {
+  CaptureSession& session = GetSession();
+  std::lock_guard<std::mutex> lock(session.mutex);
+  if (!session.writer) {
+    return false;
+  }
+
+  SetEvent(session.stop_event);
+  session.thread.join();
+  CloseHandle(session.stop_event);
+  session.stop_event = nullptr;
+
+  bool ok = session.writer->Close();
+  uint64_t records = session.writer->GetRecordCount();
+  uint64_t lost = session.writer->GetLostCount();
+  session.writer.reset();
+  if (record_count != nullptr) {
+    *record_count = records;
+  }
+  if (lost_count != nullptr) {
+    *lost_count = lost;
+  }
+
+  if (!ok) {
+    IPC_LOG_ERROR("Failed to write IPC capture file");
+    return false;
+  }
+  IPC_LOG_INFO("IPC capture stopped: {} events, {} lost", records, lost);
+  return true;
+}
+
+}  // namespace ipc_capture
+
+// ============================================================================
+// FFI Exports - C functions callable from Dart via FFI
+// ============================================================================
+
+extern "C" {
+
+/// Start capturing the IPC traffic of all windows to a file.
+///
+/// @param path Output file, e.g. "%TEMP%\\ipc_capture.bin"
+/// @return true if the capture started
+__declspec(dllexport) bool StartIpcCapture(const char* path) {
+  if (path == nullptr) {
+    return false;
+  }
+  return ipc_capture::StartCapture(path);
+}
+
+/// Stop the capture started by StartIpcCapture.
+///
+/// @return true if a capture was running and its file was written
+__declspec(dllexport) bool StopIpcCapture() {
+  return ipc_capture::StopCapture();
+}
+
+}  // extern "C"
@@ -0,0 +1,130 @@
+// ipc_capture.h
+//
+// Capture of IPC traffic to a compact binary file, for offline replay.
+//
+// The flight recorder ring (ipc_flight_recorder.h) already sees every count
+// change, listener start/stop/wake, Dart post and subscriber change of all
+// windows, but keeps only the newest events. A capture drains the ring
+// incrementally into a file for as long as it runs, so a burst of window
+// open/close traffic is recorded in full and can be re-driven later by the
+// ipc_replay tool (windows/test/ipc_replay.cpp), at the recorded pace or as
+// fast as possible.
+//
+// Capturing only reads the ring; windows record exactly as they always do.
+// Events overwritten before the capture read them (more than the ring
+// capacity between two polls) are counted as lost.
+//
+// File layout: one CaptureFileHeader, then CaptureRecords in write order.
+// Timestamps are raw QueryPerformanceCounter ticks; the header carries the
+// frequency they were taken at.
+
+#ifndef RUNNER_IPC_CAPTURE_H_
+#define RUNNER_IPC_CAPTURE_H_
+
+#include <windows.h>
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "ipc_flight_recorder.h"
+
+namespace ipc_capture {
+
+constexpr DWORD kCaptureMagic = 0x43435049;  // 'IPCC'
+constexpr DWORD kCaptureVersion = 1;
+
+struct CaptureFileHeader {
+  DWORD magic;
+  DWORD version;
+  DWORD record_size;
+  DWORD reserved;
+  int64_t frequency;    // QueryPerformanceFrequency of the capturing machine
+  int64_t start_ticks;  // When the capture started
+};
+
+// One event; value and detail as in ipc_flight::EventKind.
+struct CaptureRecord {
+  int64_t ticks;
+  int64_t value;
+  int64_t detail;
+  DWORD process_id;
+  DWORD thread_id;
+  uint32_t trace_id;
+  uint16_t kind;  // ipc_flight::EventKind
+  uint16_t reserved;
+};
+
+static_assert(sizeof(CaptureFileHeader) == 32, "File layout");
+static_assert(sizeof(CaptureRecord) == 40, "File layout");
+
+// Drains a flight recorder into a capture file.
+//
+// Not thread-safe: one thread opens, polls and closes.
+class CaptureWriter {
+ public:
+  // recorder must be open (read-only is enough) and outlive the writer.
+  explicit CaptureWriter(const ipc_flight::FlightRecorder* recorder);
+  ~CaptureWriter();
+
+  CaptureWriter(const CaptureWriter&) = delete;
+  CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+  // Creates the file and writes the header. Only events recorded after
+  // this call are captured.
+  bool Open(const std::string& path);
+
+  // Appends the events recorded since the last poll. Returns how many.
+  size_t Poll();
+
+  // Polls one last time and closes the file. Returns false if any write
+  // failed.
+  bool Close();
+
+  uint64_t GetRecordCount() const { return record_count_; }
+  uint64_t GetLostCount() const { return lost_count_; }
+
+ private:
+  const ipc_flight::FlightRecorder* recorder_;
+  std::ofstream file_;
+  uint32_t next_index_;
+  uint64_t record_count_;
+  uint64_t lost_count_;
+  std::vector<ipc_flight::FlightEvent> pending_;  // Reused between polls
+};
+
+// Reads a capture file. A trailing partial record (capture killed while
+// writing) is ignored. Returns false if the file is missing or not a
+// capture of this version.
+bool ReadCaptureFile(const std::string& path, CaptureFileHeader* header,
+                     std::vector<CaptureRecord>* records);
+
+// Captures the global flight recorder on a background thread, polling
+// every few milliseconds, until StopCapture(). One capture per process.
+bool StartCapture(const std::string& path);
+
+// Stops the running capture and reports what it wrote. Returns false if
+// none was running or writing failed.
+bool StopCapture(uint64_t* record_count = nullptr,
+                 uint64_t* lost_count = nullptr);
+
+}  // namespace ipc_capture
+
+// FFI Exports for Dart binding
+extern "C" {
+
+/// FFI export: Start capturing the IPC traffic of all windows to a file.
+///
+/// @param path UTF-8/ANSI file path
+/// @return true if the capture started
+__declspec(dllexport) bool StartIpcCapture(const char* path);
+
+/// FFI export: Stop the capture started by StartIpcCapture.
+///
+/// @return true if a capture was running and its file was written
+__declspec(dllexport) bool StopIpcCapture();
+
+}  // extern "C"
+
+#endif  // RUNNER_IPC_CAPTURE_H_
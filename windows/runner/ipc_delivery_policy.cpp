@@ -0,0 +1,166 @@
+// ipc_delivery_policy.cpp
+//
+// Implementation of the notification delivery policies.
+
+#include "ipc_delivery_policy.h"
+
+#include <windows.h>
+
+#include <cstdlib>
+
+namespace {
+
+constexpr uint32_t kMaxFramesPerSecond = 1000;
+
+// Parses a positive decimal number up to max. Returns 0 on error.
+uint32_t ParseValue(const std::string& text, uint32_t max) {
+  if (text.empty() || text.size() > 10) {
+    return 0;
+  }
+  for (char c : text) {
+    if (c < '0' || c > '9') {
+      return 0;
+    }
+  }
+  unsigned long long value = std::strtoull(text.c_str(), nullptr, 10);
+  return value <= max ? static_cast<uint32_t>(value) : 0;
+}
+
+}  // anonymous namespace
+
+IpcDeliveryPolicy IpcDeliveryPolicy::Immediate() {
+  return IpcDeliveryPolicy{};
+}
+
+IpcDeliveryPolicy IpcDeliveryPolicy::Coalesce(uint32_t window_us) {
+  return IpcDeliveryPolicy{IpcDeliveryMode::kCoalesce, window_us};
+}
+
+IpcDeliveryPolicy IpcDeliveryPolicy::Debounce(uint32_t quiet_us) {
+  return IpcDeliveryPolicy{IpcDeliveryMode::kDebounce, quiet_us};
+}
+
+IpcDeliveryPolicy IpcDeliveryPolicy::FrameAligned(uint32_t frames_per_second) {
+  uint32_t hz = frames_per_second > 0 ? frames_per_second : 1;
+  return IpcDeliveryPolicy{IpcDeliveryMode::kFrameAligned, 1000000 / hz};
+}
+
+bool ParseDeliveryPolicy(const std::string& text, IpcDeliveryPolicy* policy) {
+  if (text == "immediate") {
+    *policy = IpcDeliveryPolicy::Immediate();
+    return true;
+  }
+  size_t colon = text.find(':');
+  if (colon == std::string::npos) {
+    return false;
+  }
+  std::string mode = text.substr(0, colon);
+  std::string value = text.substr(colon + 1);
+  if (mode == "frame") {
+    uint32_t hz = ParseValue(value, kMaxFramesPerSecond);
+    if (hz == 0) {
+      return false;
+    }
+    *policy = IpcDeliveryPolicy::FrameAligned(hz);
+    return true;
+  }
+  uint32_t period_us = ParseValue(value, kMaxDeliveryPeriodUs);
+  if (period_us == 0) {
+    return false;
+  }
+  if (mode == "coalesce") {
+    *policy = IpcDeliveryPolicy::Coalesce(period_us);
+  } else if (mode == "debounce") {
+    *policy = IpcDeliveryPolicy::Debounce(period_us);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+std::string FormatDeliveryPolicy(const IpcDeliveryPolicy& policy) {
+  switch (policy.mode) {
+    case IpcDeliveryMode::kImmediate:
+      break;
+    case IpcDeliveryMode::kCoalesce:
+      return "coalesce:" + std::to_string(policy.period_us);
+    case IpcDeliveryMode::kDebounce:
+      return "debounce:" + std::to_string(policy.period_us);
+    case IpcDeliveryMode::kFrameAligned:
+      return "frame:" + std::to_string(
+                            policy.period_us > 0 ? 1000000 / policy.period_us
+                                                 : 0);
+  }
+  return "immediate";
+}
+
+IpcDeliveryPolicy GetEnvironmentDeliveryPolicy() {
+  IpcDeliveryPolicy policy;
+  char value[64];
+  DWORD length =
+      GetEnvironmentVariableA(kDeliveryPolicyEnvironmentVariable, value,
+                              static_cast<DWORD>(sizeof(value)));
+  if (length > 0 && length < sizeof(value)) {
+    ParseDeliveryPolicy(value, &policy);  // Invalid values are ignored
+  }
+  return policy;
+}
+
+IpcDeliveryScheduler::IpcDeliveryScheduler(const IpcDeliveryPolicy& policy,
+                                           int64_t ticks_per_second)
+    : policy_(policy),
+      period_ticks_(static_cast<int64_t>(policy.period_us) *
+                    ticks_per_second / 1000000),
+      pending_(false),
+      deadline_(0),
+      quiet_until_(0) {
+  if (period_ticks_ < 1) {
+    period_ticks_ = 1;
+  }
+}
+
+IpcDeliveryScheduler::Action IpcDeliveryScheduler::OnChange(int64_t now) {
+  switch (policy_.mode) {
+    case IpcDeliveryMode::kImmediate:
+      return kDeliverNow;
+
+    case IpcDeliveryMode::kCoalesce:
+      if (pending_) {
+        return kMerged;
+      }
+      pending_ = true;
+      deadline_ = now + period_ticks_;
+      return kScheduled;
+
+    case IpcDeliveryMode::kDebounce: {
+      bool quiet = now >= quiet_until_;
+      quiet_until_ = now + period_ticks_;
+      if (quiet && !pending_) {
+        return kDeliverNow;  // Leading edge
+      }
+      deadline_ = quiet_until_;  // Every change restarts the quiet period
+      if (pending_) {
+        return kMerged;
+      }
+      pending_ = true;
+      return kScheduled;
+    }
+
+    case IpcDeliveryMode::kFrameAligned:
+      if (pending_) {
+        return kMerged;
+      }
+      pending_ = true;
+      deadline_ = (now / period_ticks_ + 1) * period_ticks_;
+      return kScheduled;
+  }
+  return kDeliverNow;
+}
+
+bool IpcDeliveryScheduler::OnDeadline(int64_t now) {
+  if (!pending_ || now < deadline_) {
+    return false;
+  }
+  pending_ = false;
+  return true;
+}
@@ -0,0 +1,118 @@
+// ipc_delivery_policy.h
+//
+// When a window process delivers count changes to Dart and to native
+// subscribers.
+//
+// Opening 20 windows in a burst makes 20 changes; delivered one by one,
+// every window rebuilds its UI 20 times for a result only the last update
+// shows. A delivery policy trades a little latency for fewer deliveries:
+//
+//   immediate      Every listener wakeup is delivered (the default).
+//   coalesce:N     The first change opens an N microsecond window; one
+//                  delivery with the latest state closes it.
+//   debounce:N     Leading and trailing edge: a change after a quiet period
+//                  is delivered at once, later changes are held until N
+//                  microseconds pass without one, then delivered once.
+//   frame:HZ       Deliveries wait for the next tick of a HZ frame clock
+//                  (60 or 120 for a display), so a window gets at most one
+//                  update per frame. Ticks are multiples of the period on
+//                  QueryPerformanceCounter, so every process agrees on them.
+//
+// Every held delivery carries the state at delivery time, never a stale
+// one. Changes folded into a pending delivery are counted per policy in
+// ipc_metrics (kMetricCoalesceMerged, kMetricDebounceMerged,
+// kMetricFrameMerged).
+//
+// IpcDeliveryScheduler holds the policy logic only, with time passed in,
+// so it can be tested without clocks. IpcRuntime drives it with a waitable
+// timer on the IPC reactor.
+//
+// The process default comes from the FLUTTER_IPC_DELIVERY environment
+// variable ("frame:60" etc.) and can be changed at runtime through
+// IpcRuntime::SetDefaultDeliveryPolicy() or the SetIpcDeliveryPolicy FFI
+// export.
+
+#ifndef RUNNER_IPC_DELIVERY_POLICY_H_
+#define RUNNER_IPC_DELIVERY_POLICY_H_
+
+#include <cstdint>
+#include <string>
+
+// Values are part of the SetIpcDeliveryPolicy FFI export.
+enum class IpcDeliveryMode : int32_t {
+  kImmediate = 0,
+  kCoalesce = 1,
+  kDebounce = 2,
+  kFrameAligned = 3,
+};
+
+struct IpcDeliveryPolicy {
+  IpcDeliveryMode mode = IpcDeliveryMode::kImmediate;
+  // Coalescing window or debounce quiet time; frame period for
+  // kFrameAligned. Unused for kImmediate.
+  uint32_t period_us = 0;
+
+  static IpcDeliveryPolicy Immediate();
+  static IpcDeliveryPolicy Coalesce(uint32_t window_us);
+  static IpcDeliveryPolicy Debounce(uint32_t quiet_us);
+  static IpcDeliveryPolicy FrameAligned(uint32_t frames_per_second);
+
+  bool operator==(const IpcDeliveryPolicy& other) const {
+    return mode == other.mode && period_us == other.period_us;
+  }
+};
+
+// Environment variable holding the process default policy.
+constexpr char kDeliveryPolicyEnvironmentVariable[] = "FLUTTER_IPC_DELIVERY";
+
+// Longest accepted coalescing window or debounce time: one second.
+constexpr uint32_t kMaxDeliveryPeriodUs = 1000000;
+
+// Parses "immediate", "coalesce:<us>", "debounce:<us>" or "frame:<hz>".
+// Returns false, leaving policy untouched, for anything else, a zero
+// value or a value beyond kMaxDeliveryPeriodUs (or 1000 Hz).
+bool ParseDeliveryPolicy(const std::string& text, IpcDeliveryPolicy* policy);
+
+// Inverse of ParseDeliveryPolicy(), for logs and tools.
+std::string FormatDeliveryPolicy(const IpcDeliveryPolicy& policy);
+
+// Policy from FLUTTER_IPC_DELIVERY, or immediate if unset or invalid.
+IpcDeliveryPolicy GetEnvironmentDeliveryPolicy();
+
+// Decides, for one delivery target, whether a change is delivered now or
+// later. Times are QueryPerformanceCounter ticks. Not thread-safe.
+class IpcDeliveryScheduler {
+ public:
+  // What to do with a change.
+  enum Action {
+    kDeliverNow,  // Deliver at once
+    kScheduled,   // A delivery is now pending; arm a timer for deadline()
+    kMerged,      // Folded into the pending delivery
+  };
+
+  IpcDeliveryScheduler(const IpcDeliveryPolicy& policy,
+                       int64_t ticks_per_second);
+
+  // Handles a change seen at now. After kScheduled, and after kMerged for
+  // debounce, deadline() has moved.
+  Action OnChange(int64_t now);
+
+  // Call when the timer for deadline() fires. Returns true if the pending
+  // delivery is due now; false for an early or stale timer, in which case
+  // deadline() says when to try again (0 if nothing is pending).
+  bool OnDeadline(int64_t now);
+
+  // When the pending delivery is due, 0 if none is pending.
+  int64_t deadline() const { return pending_ ? deadline_ : 0; }
+
+  const IpcDeliveryPolicy& policy() const { return policy_; }
+
+ private:
+  IpcDeliveryPolicy policy_;
+  int64_t period_ticks_;
+  bool pending_;        // A change waits for deadline_
+  int64_t deadline_;    // Pending delivery time
+  int64_t quiet_until_; // Debounce: end of the current quiet period
+};
+
+#endif  // RUNNER_IPC_DELIVERY_POLICY_H_
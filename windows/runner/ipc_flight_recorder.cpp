@@ -0,0 +1,417 @@
+// ipc_flight_recorder.cpp
+//
+// Implementation of the cross-process IPC flight recorder ring.
+
+#include "ipc_flight_recorder.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <utility>
+
+#include "ipc_log.h"
+#include "ipc_namespace.h"
+
+namespace ipc_flight {
+
+namespace {
+constexpr DWORD kFlightRingMagic = 0x54484c46;  // 'FLHT'
+
+// How long an opener waits for the creator to finish initializing.
+constexpr int kInitWaitMs = 100;
+
+int64_t QpcFrequency() {
+  static const int64_t frequency = [] {
+    LARGE_INTEGER value;
+    QueryPerformanceFrequency(&value);
+    return value.QuadPart;
+  }();
+  return frequency;
+}
+
+int64_t Now() {
+  LARGE_INTEGER now;
+  QueryPerformanceCounter(&now);
+  return now.QuadPart;
+}
+}  // anonymous namespace
+
+const char* EventKindName(EventKind kind) {
+  switch (kind) {
+    case kFlightIncrement:
+      return "count.increment";
+    case kFlightDecrement:
+      return "count.decrement";
+    case kFlightListenerStart:
+      return "listener.start";
+    case kFlightListenerStop:
+      return "listener.stop";
+    case kFlightListenerWake:
+      return "listener.wake";
+    case kFlightDartPost:
+      return "dart.post";
+    case kFlightDartPostFailed:
+      return "dart.post_failed";
+    case kFlightSubscriberAdd:
+      return "subscriber.add";
+    case kFlightSubscriberRemove:
+      return "subscriber.remove";
+  }
+  return "unknown";
+}
+
+// ============================================================================
+// FlightRecorder
+// ============================================================================
+
+FlightRecorder::FlightRecorder(std::string ring_name, uint32_t capacity)
+    : ring_name_(std::move(ring_name)),
+      capacity_(capacity),
+      mapping_(nullptr),
+      read_only_(false),
+      header_(nullptr),
+      slots_(nullptr) {}
+
+FlightRecorder::~FlightRecorder() {
+  Close();
+}
+
+bool FlightRecorder::Open() {
+  if (header_ != nullptr) {
+    return true;
+  }
+
+  size_t size = sizeof(FlightRingHeader) + capacity_ * sizeof(FlightSlot);
+  mapping_ = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                0, static_cast<DWORD>(size),
+                                ring_name_.c_str());
+  if (mapping_ == nullptr) {
+    IPC_LOG_ERROR("CreateFileMappingA failed for flight recorder: {}",
+                  GetLastError());
+    return false;
+  }
+  bool already_exists = (GetLastError() == ERROR_ALREADY_EXISTS);
+
+  void* view = MapViewOfFile(mapping_, FILE_MAP_ALL_ACCESS, 0, 0, size);
+  if (view == nullptr) {
+    IPC_LOG_ERROR("MapViewOfFile failed for flight recorder: {}",
+                  GetLastError());
+    Close();
+    return false;
+  }
+  header_ = static_cast<FlightRingHeader*>(view);
+  slots_ = reinterpret_cast<FlightSlot*>(header_ + 1);
+
+  // Pages of a new mapping are zeroed, so every slot starts unwritten.
+  if (!already_exists) {
+    header_->capacity = capacity_;
+    header_->slot_size = sizeof(FlightSlot);
+    MemoryBarrier();
+    header_->magic = kFlightRingMagic;
+  } else {
+    for (int i = 0; i < kInitWaitMs && header_->magic != kFlightRingMagic;
+         i++) {
+      Sleep(1);  // Creator still initializing
+    }
+    if (header_->magic != kFlightRingMagic ||
+        header_->capacity != capacity_ ||
+        header_->slot_size != sizeof(FlightSlot)) {
+      IPC_LOG_WARN("Flight recorder layout mismatch: capacity {}",
+                   header_->capacity);
+      Close();
+      return false;
+    }
+  }
+  return true;
+}
+
+bool FlightRecorder::OpenReadOnly() {
+  if (header_ != nullptr) {
+    return true;
+  }
+
+  mapping_ = OpenFileMappingA(FILE_MAP_READ, FALSE, ring_name_.c_str());
+  if (mapping_ == nullptr) {
+    return false;  // No window has created the ring
+  }
+
+  // Map the header first to learn the capacity, then the whole ring.
+  void* view =
+      MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, sizeof(FlightRingHeader));
+  if (view == nullptr) {
+    Close();
+    return false;
+  }
+  const FlightRingHeader* probe = static_cast<const FlightRingHeader*>(view);
+  bool valid = probe->magic == kFlightRingMagic &&
+               probe->slot_size == sizeof(FlightSlot) &&
+               probe->capacity != 0 &&
+               (probe->capacity & (probe->capacity - 1)) == 0;
+  uint32_t capacity = probe->capacity;
+  UnmapViewOfFile(view);
+  if (!valid) {
+    Close();
+    return false;
+  }
+
+  size_t size = sizeof(FlightRingHeader) + capacity * sizeof(FlightSlot);
+  view = MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, size);
+  if (view == nullptr) {
+    Close();
+    return false;
+  }
+  header_ = static_cast<FlightRingHeader*>(view);
+  slots_ = reinterpret_cast<FlightSlot*>(header_ + 1);
+  capacity_ = capacity;
+  read_only_ = true;
+  return true;
+}
+
+void FlightRecorder::Record(EventKind kind, int64_t value, int64_t detail,
+                            uint32_t trace_id) {
+  if (header_ == nullptr || read_only_) {
+    return;  // Not opened, the mapping is unavailable, or an inspector
+  }
+
+  LONG index = InterlockedIncrement(&header_->write_index) - 1;
+  FlightSlot* slot = &slots_[static_cast<uint32_t>(index) & (capacity_ - 1)];
+
+  // Claim the slot by stamping it odd with our lap. A slot still odd from
+  // an older lap belongs to a writer that died (or stalled for a whole
+  // lap) mid-write; take it over instead of dropping every later event.
+  // Drop only if a writer of a later lap got there first; never wait.
+  uint32_t claim = static_cast<uint32_t>(index) * 2 + 1;
+  LONG claimed = static_cast<LONG>(claim);
+  LONG sequence = ReadAcquire(&slot->sequence);
+  // Claim value of the slot's current or last writer
+  uint32_t holder = static_cast<uint32_t>(sequence) - ((sequence & 1) ^ 1);
+  if ((sequence != 0 && static_cast<int32_t>(claim - holder) <= 0) ||
+      InterlockedCompareExchange(&slot->sequence, claimed, sequence) !=
+          sequence) {
+    InterlockedIncrement(&header_->dropped);
+    return;
+  }
+
+  slot->kind = kind;
+  slot->process_id = GetCurrentProcessId();
+  slot->thread_id = GetCurrentThreadId();
+  slot->ticks = Now();
+  slot->value = value;
+  slot->detail = detail;
+  slot->trace_id = trace_id;
+  slot->index = static_cast<uint32_t>(index);
+
+  // Publish (full barrier orders the field stores before it), unless a
+  // later lap took the slot over while this writer stalled.
+  if (InterlockedCompareExchange(&slot->sequence, claimed + 1, claimed) !=
+      claimed) {
+    InterlockedIncrement(&header_->dropped);
+  }
+}
+
+std::vector<FlightEvent> FlightRecorder::Collect() const {
+  std::vector<FlightEvent> events;
+  if (header_ == nullptr) {
+    return events;
+  }
+  events.reserve(capacity_);
+
+  for (uint32_t i = 0; i < capacity_; i++) {
+    FlightEvent event;
+    if (ReadSlot(&slots_[i], &event)) {
+      events.push_back(event);
+    }
+  }
+
+  // QPC is system-wide, so timestamps order events across processes; the
+  // write index breaks ties.
+  std::sort(events.begin(), events.end(),
+            [](const FlightEvent& a, const FlightEvent& b) {
+              if (a.ticks != b.ticks) {
+                return a.ticks < b.ticks;
+              }
+              return static_cast<int32_t>(a.index - b.index) < 0;
+            });
+  return events;
+}
+
+uint32_t FlightRecorder::GetWriteIndex() const {
+  return header_ != nullptr
+             ? static_cast<uint32_t>(ReadAcquire(&header_->write_index))
+             : 0;
+}
+
+uint32_t FlightRecorder::CollectFrom(uint32_t* next_index,
+                                     std::vector<FlightEvent>* events) const {
+  if (header_ == nullptr || next_index == nullptr || events == nullptr) {
+    return 0;
+  }
+
+  uint32_t lost = 0;
+  uint32_t write_index = GetWriteIndex();
+  // Anything more than a lap behind the writers has been reused.
+  if (write_index - *next_index > capacity_) {
+    lost += write_index - *next_index - capacity_;
+    *next_index = write_index - capacity_;
+  }
+
+  while (*next_index != write_index) {
+    FlightEvent event;
+    // Positive if a later lap wrote the slot, negative if it still holds
+    // an earlier lap.
+    int32_t ahead = -1;
+    if (ReadSlot(&slots_[*next_index & (capacity_ - 1)], &event)) {
+      ahead = static_cast<int32_t>(event.index - *next_index);
+    }
+    if (ahead == 0) {
+      events->push_back(event);
+    } else if (ahead > 0) {
+      lost++;  // A writer a lap ahead already reused the slot
+    } else if (write_index - *next_index < capacity_) {
+      break;  // Not published yet; retry on the next call
+    } else {
+      lost++;  // Claimed but never completed (dropped, or writer died)
+    }
+    (*next_index)++;
+  }
+  return lost;
+}
+
+LONG FlightRecorder::GetDroppedCount() const {
+  return header_ != nullptr ? ReadAcquire(&header_->dropped) : 0;
+}
+
+bool FlightRecorder::DumpToFile(const std::string& path) const {
+  // No logging here: shmem_top dumps through a read-only recorder and must
+  // not write to the shared log.
+  std::vector<FlightEvent> events = Collect();
+  char line[96];
+  int length = std::snprintf(line, sizeof(line),
+                             "# IPC flight recorder: %zu events, %ld dropped\n",
+                             events.size(),
+                             static_cast<long>(GetDroppedCount()));
+  std::string text(line, static_cast<size_t>(std::max(length, 0)));
+  text += FormatEvents(events);
+
+  std::ofstream file(path, std::ios::out | std::ios::trunc | std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  file.write(text.data(), static_cast<std::streamsize>(text.size()));
+  file.close();
+  return static_cast<bool>(file);
+}
+
+std::string FlightRecorder::FormatEvents(
+    const std::vector<FlightEvent>& events) {
+  // Heading and rows share the column widths.
+  char line[160];
+  int length = std::snprintf(line, sizeof(line),
+                             "#%14s %8s %8s  %-18s %12s %20s %11s\n",
+                             "offset_ms", "pid", "tid", "event", "value",
+                             "detail", "trace");
+  std::string text(line, static_cast<size_t>(std::max(length, 0)));
+  if (events.empty()) {
+    return text;
+  }
+
+  int64_t newest = events.back().ticks;
+  double ticks_per_ms = static_cast<double>(QpcFrequency()) / 1000.0;
+  for (const FlightEvent& event : events) {
+    length = std::snprintf(
+        line, sizeof(line), "%15.6f %8lu %8lu  %-18s %12lld %20lld %11u\n",
+        static_cast<double>(event.ticks - newest) / ticks_per_ms,
+        static_cast<unsigned long>(event.process_id),
+        static_cast<unsigned long>(event.thread_id), EventKindName(event.kind),
+        static_cast<long long>(event.value),
+        static_cast<long long>(event.detail), event.trace_id);
+    if (length > 0) {
+      text.append(line, static_cast<size_t>(std::min(
+                            length, static_cast<int>(sizeof(line) - 1))));
+    }
+  }
+  return text;
+}
+
+bool FlightRecorder::ReadSlot(const FlightSlot* slot, FlightEvent* event) {
+  LONG before = ReadAcquire(&slot->sequence);
+  if (before == 0 || (before & 1) != 0) {
+    return false;  // Never written, or being written right now
+  }
+
+  event->index = slot->index;
+  event->kind = static_cast<EventKind>(slot->kind);
+  event->process_id = slot->process_id;
+  event->thread_id = slot->thread_id;
+  event->ticks = slot->ticks;
+  event->value = slot->value;
+  event->detail = slot->detail;
+  event->trace_id = slot->trace_id;
+
+  // Order the field loads before re-reading the sequence. The index must
+  // match the lap in the sequence: a stalled writer whose slot was taken
+  // over may still store into it after the new writer published.
+  MemoryBarrier();
+  return ReadNoFence(&slot->sequence) == before &&
+         static_cast<LONG>(event->index * 2 + 2) == before;
+}
+
+void FlightRecorder::Close() {
+  if (header_) {
+    UnmapViewOfFile(header_);
+    header_ = nullptr;
+    slots_ = nullptr;
+  }
+  if (mapping_) {
+    CloseHandle(mapping_);
+    mapping_ = nullptr;
+  }
+  read_only_ = false;
+}
+
+// ============================================================================
+// Global helpers
+// ============================================================================
+
+FlightRecorder& GetFlightRecorder() {
+  // Intentionally leaked, like the global logger: events may still be
+  // recorded from threads that outlive static destruction.
+  static FlightRecorder* recorder = [] {
+    FlightRecorder* created = new FlightRecorder(
+        ipc_namespace::Qualify(FlightRecorder::kDefaultRingName));
+    created->Open();
+    return created;
+  }();
+  return *recorder;
+}
+
+void Record(EventKind kind, int64_t value, int64_t detail,
+            uint32_t trace_id) {
+  GetFlightRecorder().Record(kind, value, detail, trace_id);
+}
+
+}  // namespace ipc_flight
+
+// ============================================================================
+// FFI Exports - C functions callable from Dart via FFI
+// ============================================================================
+
+extern "C" {
+
+/// Write the flight recorder of all windows to a text file.
+///
+/// @param path Output file, e.g. "%TEMP%\\ipc_flight.txt"
+/// @return true if the file was written
+__declspec(dllexport) bool DumpIpcFlightRecorder(const char* path) {
+  if (path == nullptr) {
+    return false;
+  }
+  if (!ipc_flight::GetFlightRecorder().DumpToFile(path)) {
+    IPC_LOG_ERROR("Failed to write flight recorder dump: {}", path);
+    return false;
+  }
+  IPC_LOG_INFO("IPC flight recorder dumped: {}", path);
+  return true;
+}
+
+}  // extern "C"
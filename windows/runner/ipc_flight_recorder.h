@@ -0,0 +1,182 @@
+// ipc_flight_recorder.h
+//
+// Always-on flight recorder of IPC events, for post-mortem analysis.
+//
+// Every window process appends the events that change IPC state (count
+// increments and decrements, listener start/stop and wakeups, Dart posts
+// and their results, subscriber registrations) with its process ID, thread
+// ID and a QueryPerformanceCounter timestamp to one bounded ring in named
+// shared memory. The ring belongs to the mapping, not to any process, so
+// the history written by a window that hung or crashed stays readable by
+// every surviving window and by shmem_top, which can dump it to a text
+// file.
+//
+// Recording costs one interlocked increment to claim a slot and a per-slot
+// seqlock around a few plain stores; it never blocks and never allocates.
+// The oldest events are overwritten.
+
+#ifndef RUNNER_IPC_FLIGHT_RECORDER_H_
+#define RUNNER_IPC_FLIGHT_RECORDER_H_
+
+#include <windows.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ipc_flight {
+
+// What happened. value and detail are interpreted per kind.
+enum EventKind : uint16_t {
+  kFlightIncrement = 1,     // value: new count, detail: delta
+  kFlightDecrement,         // value: new count, detail: delta
+  kFlightListenerStart,     // -
+  kFlightListenerStop,      // -
+  kFlightListenerWake,      // value: wait result
+  kFlightDartPost,          // value: posted value, detail: port
+  kFlightDartPostFailed,    // value: posted value, detail: port
+  kFlightSubscriberAdd,     // value: subscriber count, detail: port
+  kFlightSubscriberRemove,  // value: subscriber count, detail: port
+};
+
+// Name used in dumps, e.g. "count.increment".
+const char* EventKindName(EventKind kind);
+
+// One recorded event as returned by FlightRecorder::Collect().
+struct FlightEvent {
+  uint32_t index;  // Position in the global write order (wraps)
+  EventKind kind;
+  DWORD process_id;
+  DWORD thread_id;
+  int64_t ticks;  // QueryPerformanceCounter
+  int64_t value;
+  int64_t detail;
+  uint32_t trace_id;  // ipc_trace ID of the update, 0 if none
+};
+
+// Shared ring slot (48 bytes). The sequence is a per-slot seqlock stamped
+// with the lap of its writer: 2 * index + 1 while the writer of event
+// index fills the slot, 2 * index + 2 once published, 0 if the slot was
+// never written.
+struct FlightSlot {
+  volatile LONG sequence;
+  uint16_t kind;
+  uint16_t reserved;
+  DWORD process_id;
+  DWORD thread_id;
+  int64_t ticks;
+  int64_t value;
+  int64_t detail;
+  uint32_t trace_id;
+  uint32_t index;
+};
+
+struct FlightRingHeader {
+  DWORD magic;
+  DWORD capacity;
+  DWORD slot_size;
+  volatile LONG write_index;
+  volatile LONG dropped;  // Events lost to a slot held by another writer
+  DWORD reserved[11];     // Pad header to one cache line
+};
+
+static_assert(sizeof(FlightSlot) == 48, "Shared layout");
+static_assert(sizeof(FlightRingHeader) == 64, "Shared layout");
+
+// Cross-process flight recorder ring.
+//
+// Thread-safe; any number of threads in any number of processes may record
+// concurrently with interlocked operations only.
+class FlightRecorder {
+ public:
+  static constexpr uint32_t kDefaultCapacity = 4096;  // Power of two, 192 KiB
+  static constexpr char kDefaultRingName[] =
+      "Local\\FlutterMultiWindowFlightRecorder";
+
+  explicit FlightRecorder(std::string ring_name = kDefaultRingName,
+                          uint32_t capacity = kDefaultCapacity);
+  ~FlightRecorder();
+
+  FlightRecorder(const FlightRecorder&) = delete;
+  FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+  // Creates or opens the shared ring. Until it succeeds Record() does
+  // nothing and Collect() returns nothing. Not thread-safe: call it before
+  // sharing the recorder.
+  bool Open();
+
+  // Opens an existing ring with FILE_MAP_READ, for inspectors. Never
+  // creates the ring or logs; Record() stays a no-op. The capacity is
+  // taken from the ring.
+  //
+  // Returns false if no window has created the ring or its layout differs.
+  bool OpenReadOnly();
+
+  void Record(EventKind kind, int64_t value = 0, int64_t detail = 0,
+              uint32_t trace_id = 0);
+
+  // Copies every complete event in the ring (all processes), oldest first.
+  std::vector<FlightEvent> Collect() const;
+
+  // Index the next recorded event will get. A reader that starts here sees
+  // only events recorded from now on.
+  uint32_t GetWriteIndex() const;
+
+  // Incremental read for captures: appends the events numbered *next_index
+  // up to the write index, in write order, and advances *next_index past
+  // them. Stops at a slot that is still being written and resumes there on
+  // the next call; a slot that never completes is given up once the ring
+  // has wrapped past it.
+  //
+  // Returns how many events were overwritten, or never completed, before
+  // they could be read.
+  uint32_t CollectFrom(uint32_t* next_index,
+                       std::vector<FlightEvent>* events) const;
+
+  // Events lost because their slot was still being written.
+  LONG GetDroppedCount() const;
+
+  // Writes FormatEvents(Collect()) to path. Returns false on I/O error.
+  bool DumpToFile(const std::string& path) const;
+
+  // One line per event, timestamps relative to the newest event so the
+  // moments before a failure read as negative offsets. Exposed for tests.
+  static std::string FormatEvents(const std::vector<FlightEvent>& events);
+
+ private:
+  // Copies a slot under its seqlock. False if the slot was never written or
+  // changed while being copied.
+  static bool ReadSlot(const FlightSlot* slot, FlightEvent* event);
+
+  void Close();
+
+  std::string ring_name_;
+  uint32_t capacity_;
+  HANDLE mapping_;
+  bool read_only_;  // Mapped by OpenReadOnly(); never written
+  FlightRingHeader* header_;
+  FlightSlot* slots_;
+};
+
+// Global recorder used by the IPC layers and the FFI export. Opened on
+// first use; intentionally leaked like the global logger.
+FlightRecorder& GetFlightRecorder();
+
+// Records an event on the global recorder.
+void Record(EventKind kind, int64_t value = 0, int64_t detail = 0,
+            uint32_t trace_id = 0);
+
+}  // namespace ipc_flight
+
+// FFI Exports for Dart binding
+extern "C" {
+
+/// FFI export: Write the flight recorder of all windows to a text file.
+///
+/// @param path UTF-8/ANSI file path
+/// @return true if the file was written
+__declspec(dllexport) bool DumpIpcFlightRecorder(const char* path);
+
+}  // extern "C"
+
+#endif  // RUNNER_IPC_FLIGHT_RECORDER_H_
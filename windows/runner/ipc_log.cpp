@@ -0,0 +1,638 @@
+// ipc_log.cpp
+//
+// Implementation of the asynchronous IPC logger.
+
+#include "ipc_log.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+#include "ipc_namespace.h"
+
+namespace ipc_log {
+
+namespace {
+constexpr DWORD kSharedRingMagic = 0x474F4C49;  // 'ILOG'
+constexpr DWORD kSharedRingCapacity = 1024;     // Power of two, 256 KiB
+constexpr size_t kSharedRingSize =
+    sizeof(SharedLogRingHeader) + kSharedRingCapacity * sizeof(SharedLogSlot);
+
+// A producer that reserved a slot and then died leaves it unfinished
+// forever; the drainer skips such a slot after this long.
+constexpr ULONGLONG kStuckSlotTimeoutMs = 1000;
+
+// How long an opener waits for the creator to finish initializing.
+constexpr int kInitWaitMs = 100;
+
+// A claimed slot's sequence is 2^31 away from its position; anything this
+// far from the position looked for is a claim, not a lap.
+constexpr LONG kClaimDistance = 0x40000000;
+
+const char* kLevelNames[] = {"DEBUG", "INFO ", "WARN ", "ERROR"};
+
+std::atomic<uint64_t> g_next_logger_id{1};
+
+int64_t QpcFrequency() {
+  static const int64_t frequency = [] {
+    LARGE_INTEGER value;
+    QueryPerformanceFrequency(&value);
+    return value.QuadPart;
+  }();
+  return frequency;
+}
+
+// Per-thread lookup from logger to ring. The single-entry cache in front
+// keeps the hot path to one compare for the usual one-logger process.
+struct ThreadCache {
+  uint64_t last_id = 0;
+  ThreadRing* last_ring = nullptr;
+  std::vector<std::pair<uint64_t, std::shared_ptr<ThreadRing>>> rings;
+
+  ~ThreadCache() {
+    for (auto& entry : rings) {
+      entry.second->Orphan();
+    }
+  }
+};
+
+thread_local ThreadCache t_cache;
+
+// Appends src to buf at *pos, truncating at size - 1.
+void Append(char* buf, size_t size, size_t* pos, const char* src,
+            size_t length) {
+  if (*pos + 1 >= size) {
+    return;
+  }
+  size_t room = size - 1 - *pos;
+  size_t n = length < room ? length : room;
+  std::memcpy(buf + *pos, src, n);
+  *pos += n;
+}
+}  // anonymous namespace
+
+// ============================================================================
+// ThreadRing
+// ============================================================================
+
+ThreadRing::ThreadRing(DWORD thread_id)
+    : head_(0), tail_(0), dropped_(0), orphaned_(false),
+      thread_id_(thread_id) {}
+
+Record* ThreadRing::BeginWrite() {
+  uint32_t head = head_.load(std::memory_order_relaxed);
+  if (head - tail_.load(std::memory_order_acquire) >= kCapacity) {
+    return nullptr;  // Full
+  }
+  return &records_[head & (kCapacity - 1)];
+}
+
+void ThreadRing::EndWrite() {
+  head_.store(head_.load(std::memory_order_relaxed) + 1,
+              std::memory_order_release);
+}
+
+const Record* ThreadRing::Peek() const {
+  uint32_t tail = tail_.load(std::memory_order_relaxed);
+  if (tail == head_.load(std::memory_order_acquire)) {
+    return nullptr;  // Empty
+  }
+  return &records_[tail & (kCapacity - 1)];
+}
+
+void ThreadRing::Pop() {
+  tail_.store(tail_.load(std::memory_order_relaxed) + 1,
+              std::memory_order_release);
+}
+
+// ============================================================================
+// Logger
+// ============================================================================
+
+Logger::Logger(LoggerOptions options)
+    : options_(std::move(options)),
+      id_(g_next_logger_id.fetch_add(1)),
+      is_running_(false),
+      wake_event_(CreateEventA(nullptr, FALSE, FALSE, nullptr)),
+      ring_mapping_(nullptr),
+      ring_(nullptr),
+      slots_(nullptr),
+      drainer_mutex_(nullptr),
+      is_drainer_(false),
+      stuck_pos_(0),
+      stuck_since_(0) {
+  if (options_.file_path.empty()) {
+    char temp_path[MAX_PATH];
+    DWORD length = GetTempPathA(MAX_PATH, temp_path);
+    options_.file_path =
+        std::string(temp_path, length > 0 && length < MAX_PATH ? length : 0) +
+        "flutter_multi_window.log";
+  }
+  if (!OpenSharedRing()) {
+    // Still usable: lines go straight to this process's sink/file.
+    std::cerr << "ipc_log: shared log ring unavailable, logging locally"
+              << std::endl;
+  }
+}
+
+Logger::~Logger() {
+  Shutdown();
+  CloseSharedRing();
+  if (wake_event_) {
+    CloseHandle(wake_event_);
+  }
+}
+
+void Logger::Capture(Record* record, const char* value) {
+  if (record->arg_count >= kMaxArgs) {
+    return;
+  }
+  Arg& arg = record->args[record->arg_count++];
+  arg.type = Arg::kString;
+  if (value == nullptr) {
+    value = "(null)";
+  }
+
+  size_t available = kStringBytes - record->strings_used;
+  if (available == 0) {
+    // Buffer full; its last byte is a terminator, so this reads as "".
+    arg.as_string_offset = static_cast<uint16_t>(kStringBytes - 1);
+    return;
+  }
+  size_t length = std::strlen(value);
+  if (length > available - 1) {
+    length = available - 1;
+  }
+  std::memcpy(record->strings + record->strings_used, value, length);
+  record->strings[record->strings_used + length] = '\0';
+  arg.as_string_offset = record->strings_used;
+  record->strings_used = static_cast<uint16_t>(record->strings_used + length + 1);
+}
+
+void Logger::Capture(Record* record, char* value) {
+  Capture(record, static_cast<const char*>(value));
+}
+
+void Logger::Capture(Record* record, const std::string& value) {
+  Capture(record, value.c_str());
+}
+
+void Logger::Capture(Record* record, bool value) {
+  if (record->arg_count >= kMaxArgs) {
+    return;
+  }
+  Arg& arg = record->args[record->arg_count++];
+  arg.type = Arg::kBool;
+  arg.as_bool = value;
+}
+
+void Logger::Capture(Record* record, double value) {
+  if (record->arg_count >= kMaxArgs) {
+    return;
+  }
+  Arg& arg = record->args[record->arg_count++];
+  arg.type = Arg::kDouble;
+  arg.as_double = value;
+}
+
+size_t Logger::Format(const Record& record, char* buf, size_t size) {
+  if (size == 0) {
+    return 0;
+  }
+  size_t pos = 0;
+  size_t next_arg = 0;
+  const char* p = record.format;
+  while (*p != '\0') {
+    // "{}" formats naturally; "{:x}" prints integers as 0x-prefixed hex.
+    bool plain = p[0] == '{' && p[1] == '}';
+    bool hex = p[0] == '{' && p[1] == ':' && p[2] == 'x' && p[3] == '}';
+    if ((plain || hex) && next_arg < record.arg_count) {
+      const Arg& arg = record.args[next_arg++];
+      char scratch[32];
+      int n = 0;
+      switch (arg.type) {
+        case Arg::kInt:
+          n = std::snprintf(scratch, sizeof(scratch), hex ? "0x%llX" : "%lld",
+                            static_cast<long long>(arg.as_int));
+          break;
+        case Arg::kUint:
+          n = std::snprintf(scratch, sizeof(scratch), hex ? "0x%llX" : "%llu",
+                            static_cast<unsigned long long>(arg.as_uint));
+          break;
+        case Arg::kDouble:
+          n = std::snprintf(scratch, sizeof(scratch), "%g", arg.as_double);
+          break;
+        case Arg::kBool:
+          n = std::snprintf(scratch, sizeof(scratch), "%s",
+                            arg.as_bool ? "true" : "false");
+          break;
+        case Arg::kPointer:
+          n = std::snprintf(scratch, sizeof(scratch), "%p", arg.as_pointer);
+          break;
+        case Arg::kString: {
+          const char* text = record.strings + arg.as_string_offset;
+          Append(buf, size, &pos, text, std::strlen(text));
+          break;
+        }
+      }
+      if (n > 0) {
+        Append(buf, size, &pos, scratch, static_cast<size_t>(n));
+      }
+      p += hex ? 4 : 2;
+    } else {
+      Append(buf, size, &pos, p, 1);
+      p++;
+    }
+  }
+  buf[pos] = '\0';
+  return pos;
+}
+
+ThreadRing* Logger::GetThreadRing() {
+  if (t_cache.last_id == id_) {
+    return t_cache.last_ring;
+  }
+  for (auto& entry : t_cache.rings) {
+    if (entry.first == id_) {
+      t_cache.last_id = id_;
+      t_cache.last_ring = entry.second.get();
+      return t_cache.last_ring;
+    }
+  }
+  return RegisterThread();
+}
+
+ThreadRing* Logger::RegisterThread() {
+  auto ring = std::make_shared<ThreadRing>(GetCurrentThreadId());
+  {
+    std::lock_guard<std::mutex> lock(threads_mutex_);
+    rings_.push_back(ring);
+  }
+  t_cache.rings.emplace_back(id_, ring);
+  t_cache.last_id = id_;
+  t_cache.last_ring = ring.get();
+
+  EnsureWriterStarted();
+  return ring.get();
+}
+
+void Logger::Wake() {
+  if (wake_event_) {
+    SetEvent(wake_event_);
+  }
+}
+
+void Logger::EnsureWriterStarted() {
+  std::call_once(writer_started_, [this]() {
+    is_running_ = true;
+    writer_thread_ = std::thread(&Logger::WriterThreadFunction, this);
+  });
+}
+
+void Logger::Flush() {
+  std::lock_guard<std::mutex> lock(drain_mutex_);
+  DrainThreadRings();
+  if (is_drainer_) {
+    DrainSharedRing();
+  }
+}
+
+void Logger::Shutdown() {
+  if (is_running_.exchange(false)) {
+    Wake();
+    if (writer_thread_.joinable()) {
+      writer_thread_.join();
+    }
+  }
+}
+
+uint64_t Logger::GetDroppedCount() const {
+  std::lock_guard<std::mutex> lock(threads_mutex_);
+  uint64_t dropped = 0;
+  for (const auto& ring : rings_) {
+    dropped += ring->dropped();
+  }
+  return dropped;
+}
+
+LONG Logger::GetSharedDroppedCount() const {
+  return ring_ ? ring_->dropped : 0;
+}
+
+void Logger::WriterThreadFunction() {
+  TryBecomeDrainer();
+
+  while (is_running_) {
+    size_t work = 0;
+    {
+      std::lock_guard<std::mutex> lock(drain_mutex_);
+      work += DrainThreadRings();
+      // The drainer may have exited; take over its file if so.
+      if (!is_drainer_) {
+        TryBecomeDrainer();
+      }
+      if (is_drainer_) {
+        work += DrainSharedRing();
+      }
+    }
+    ReleaseOrphanedRings();
+
+    if (work == 0) {
+      WaitForSingleObject(wake_event_, options_.flush_interval_ms);
+    }
+  }
+
+  Flush();
+  if (is_drainer_) {
+    // Hand the file over; another process's writer picks it up.
+    ReleaseMutex(drainer_mutex_);
+    is_drainer_ = false;
+  }
+  if (file_) {
+    file_->flush();
+    file_.reset();
+  }
+}
+
+size_t Logger::DrainThreadRings() {
+  std::vector<std::shared_ptr<ThreadRing>> rings;
+  {
+    std::lock_guard<std::mutex> lock(threads_mutex_);
+    rings = rings_;
+  }
+
+  const DWORD pid = GetCurrentProcessId();
+  const double frequency = static_cast<double>(QpcFrequency());
+  size_t count = 0;
+  char line[sizeof(SharedLogSlot::text)];
+
+  for (auto& ring : rings) {
+    const Record* record;
+    while ((record = ring->Peek()) != nullptr) {
+      // QPC is system-wide, so timestamps from different window processes
+      // are directly comparable in the merged file.
+      int header = std::snprintf(
+          line, sizeof(line), "%.6f [%lu:%lu] %s ",
+          static_cast<double>(record->timestamp) / frequency,
+          static_cast<unsigned long>(pid),
+          static_cast<unsigned long>(record->thread_id),
+          kLevelNames[record->level]);
+      size_t length = header > 0 ? static_cast<size_t>(header) : 0;
+      if (length >= sizeof(line) - 1) {
+        length = sizeof(line) - 2;
+      }
+      length += Format(*record, line + length, sizeof(line) - 1 - length);
+      line[length++] = '\n';
+      ring->Pop();
+
+      if (options_.echo_to_console) {
+        std::fwrite(line, 1, length, stdout);
+      }
+      if (!PushShared(line, length)) {
+        if (ring_ == nullptr) {
+          WriteLine(line, length);  // No shared ring: write locally
+        }
+      }
+      count++;
+    }
+  }
+
+  if (count > 0 && options_.echo_to_console) {
+    std::fflush(stdout);
+  }
+  return count;
+}
+
+bool WriteSharedSlot(SharedLogSlot* slot, DWORD pos, const char* text,
+                     size_t length) {
+  // Claim before writing: once the drainer has skipped the slot it may
+  // already hold a later lap's line.
+  LONG writing = static_cast<LONG>(pos ^ kSharedLogSlotWriting);
+  if (InterlockedCompareExchange(&slot->sequence, writing,
+                                 static_cast<LONG>(pos)) !=
+      static_cast<LONG>(pos)) {
+    return false;
+  }
+  if (length > sizeof(slot->text)) {
+    length = sizeof(slot->text);
+  }
+  std::memcpy(slot->text, text, length);
+  slot->length = static_cast<WORD>(length);
+  // Publish: full barrier orders the text before the sequence. Fails if
+  // the drainer gave up on us while we wrote.
+  return InterlockedCompareExchange(&slot->sequence,
+                                    static_cast<LONG>(pos + 1),
+                                    writing) == writing;
+}
+
+bool Logger::PushShared(const char* text, size_t length) {
+  if (ring_ == nullptr) {
+    return false;
+  }
+  const DWORD mask = ring_->capacity - 1;
+  DWORD pos = static_cast<DWORD>(ReadAcquire(&ring_->write_index));
+  SharedLogSlot* slot;
+  for (;;) {
+    slot = &slots_[pos & mask];
+    DWORD sequence = static_cast<DWORD>(ReadAcquire(&slot->sequence));
+    LONG diff = static_cast<LONG>(sequence - pos);
+    if (diff == 0) {
+      DWORD previous = static_cast<DWORD>(InterlockedCompareExchange(
+          &ring_->write_index, static_cast<LONG>(pos + 1),
+          static_cast<LONG>(pos)));
+      if (previous == pos) {
+        break;  // Slot reserved
+      }
+      pos = previous;
+    } else if (diff < 0 || diff > kClaimDistance) {
+      // Full: drainer behind, or the slot's producer is still writing
+      InterlockedIncrement(&ring_->dropped);
+      return false;
+    } else {
+      pos = static_cast<DWORD>(ReadAcquire(&ring_->write_index));
+    }
+  }
+
+  if (!WriteSharedSlot(slot, pos, text, length)) {
+    InterlockedIncrement(&ring_->dropped);  // Skipped while we stalled
+    return false;
+  }
+  return true;
+}
+
+size_t Logger::DrainSharedRing() {
+  if (ring_ == nullptr) {
+    return 0;
+  }
+  const DWORD capacity = ring_->capacity;
+  size_t count = 0;
+
+  LONG dropped = InterlockedExchange(&ring_->dropped, 0);
+  if (dropped > 0) {
+    char note[64];
+    int n = std::snprintf(note, sizeof(note),
+                          "[ipc_log] %ld line(s) dropped, ring full\n",
+                          static_cast<long>(dropped));
+    WriteLine(note, static_cast<size_t>(n));
+  }
+
+  for (;;) {
+    DWORD pos = static_cast<DWORD>(ring_->read_index);
+    SharedLogSlot* slot = &slots_[pos & (capacity - 1)];
+    DWORD sequence = static_cast<DWORD>(ReadAcquire(&slot->sequence));
+
+    if (sequence != pos + 1) {
+      // Empty, or a producer reserved this slot and has not finished.
+      if (static_cast<DWORD>(ReadAcquire(&ring_->write_index)) == pos) {
+        stuck_since_ = 0;
+        break;
+      }
+      ULONGLONG now = GetTickCount64();
+      if (stuck_since_ == 0 || stuck_pos_ != pos) {
+        // First sight of this slot unfinished; its timeout starts now.
+        stuck_pos_ = pos;
+        stuck_since_ = now;
+        break;
+      }
+      if (now - stuck_since_ < kStuckSlotTimeoutMs) {
+        break;
+      }
+      // Producer died (or stalled) mid-write; skip its slot. Against the
+      // exact value seen, so a line published meanwhile is kept, and a
+      // producer that resumes finds the slot gone (WriteSharedSlot()).
+      if (InterlockedCompareExchange(
+              &slot->sequence, static_cast<LONG>(pos + capacity),
+              static_cast<LONG>(sequence)) != static_cast<LONG>(sequence)) {
+        continue;
+      }
+      stuck_since_ = 0;
+    } else {
+      WriteLine(slot->text, slot->length);
+      count++;
+      stuck_since_ = 0;  // Any earlier wait was for a slot now consumed
+      InterlockedExchange(&slot->sequence, static_cast<LONG>(pos + capacity));
+    }
+
+    InterlockedExchange(&ring_->read_index, static_cast<LONG>(pos + 1));
+  }
+
+  if (count > 0 && file_) {
+    file_->flush();
+  }
+  return count;
+}
+
+void Logger::ReleaseOrphanedRings() {
+  std::lock_guard<std::mutex> lock(threads_mutex_);
+  for (auto it = rings_.begin(); it != rings_.end();) {
+    if ((*it)->orphaned() && (*it)->Peek() == nullptr) {
+      it = rings_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+bool Logger::OpenSharedRing() {
+  ring_mapping_ = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr,
+                                     PAGE_READWRITE, 0,
+                                     static_cast<DWORD>(kSharedRingSize),
+                                     options_.ring_name.c_str());
+  if (ring_mapping_ == nullptr) {
+    return false;
+  }
+  bool already_exists = (GetLastError() == ERROR_ALREADY_EXISTS);
+
+  void* view = MapViewOfFile(ring_mapping_, FILE_MAP_ALL_ACCESS, 0, 0,
+                             kSharedRingSize);
+  if (view == nullptr) {
+    CloseSharedRing();
+    return false;
+  }
+  ring_ = static_cast<SharedLogRingHeader*>(view);
+  slots_ = reinterpret_cast<SharedLogSlot*>(ring_ + 1);
+
+  if (!already_exists) {
+    ring_->capacity = kSharedRingCapacity;
+    for (DWORD i = 0; i < kSharedRingCapacity; i++) {
+      slots_[i].sequence = static_cast<LONG>(i);
+    }
+    MemoryBarrier();
+    ring_->magic = kSharedRingMagic;
+  } else {
+    for (int i = 0; i < kInitWaitMs && ring_->magic != kSharedRingMagic; i++) {
+      Sleep(1);  // Creator still initializing
+    }
+    if (ring_->magic != kSharedRingMagic ||
+        ring_->capacity != kSharedRingCapacity) {
+      CloseSharedRing();
+      return false;
+    }
+  }
+
+  std::string mutex_name = options_.ring_name + ".Drainer";
+  drainer_mutex_ = CreateMutexA(nullptr, FALSE, mutex_name.c_str());
+  return true;
+}
+
+bool Logger::TryBecomeDrainer() {
+  if (ring_ == nullptr) {
+    return false;  // Local-only logging; this process writes its own lines
+  }
+  if (drainer_mutex_ == nullptr) {
+    return false;
+  }
+  DWORD result = WaitForSingleObject(drainer_mutex_, 0);
+  if (result == WAIT_OBJECT_0 || result == WAIT_ABANDONED) {
+    // WAIT_ABANDONED: previous drainer crashed; we own the mutex now.
+    is_drainer_ = true;
+    return true;
+  }
+  return false;
+}
+
+void Logger::WriteLine(const char* text, size_t length) {
+  if (options_.sink) {
+    options_.sink(text, length);
+    return;
+  }
+  if (!file_) {
+    file_ = std::make_unique<std::ofstream>(
+        options_.file_path, std::ios::out | std::ios::app | std::ios::binary);
+  }
+  file_->write(text, static_cast<std::streamsize>(length));
+}
+
+void Logger::CloseSharedRing() {
+  if (drainer_mutex_) {
+    CloseHandle(drainer_mutex_);
+    drainer_mutex_ = nullptr;
+  }
+  if (ring_) {
+    UnmapViewOfFile(ring_);
+    ring_ = nullptr;
+    slots_ = nullptr;
+  }
+  if (ring_mapping_) {
+    CloseHandle(ring_mapping_);
+    ring_mapping_ = nullptr;
+  }
+}
+
+Logger& GetLogger() {
+  // Intentionally leaked: other static destructors may still log during
+  // process exit. Shutdown() flushes explicitly before that.
+  static Logger* logger = [] {
+    LoggerOptions options;
+    options.ring_name = ipc_namespace::Qualify(options.ring_name.c_str());
+    return new Logger(std::move(options));
+  }();
+  return *logger;
+}
+
+void Shutdown() {
+  GetLogger().Shutdown();
+}
+
+}  // namespace ipc_log
@@ -0,0 +1,343 @@
+// ipc_log.h
+//
+// Asynchronous logger for the IPC layers.
+//
+// Logging on a notification path must not block the thread it measures.
+// Instead of a synchronous, console-locked std::cout << std::endl, a log
+// call copies its raw arguments into a per-thread lock-free ring and
+// returns. A background writer thread formats the records and pushes the
+// finished lines into a shared-memory ring that every window process
+// writes to. One process at a time (elected with a named mutex) drains
+// that ring into a single log file, so the output of all windows is
+// merged in one place.
+//
+// Levels below IPC_LOG_MIN_LEVEL compile to nothing: their arguments are
+// not even evaluated. Release builds (NDEBUG) default to INFO, so DEBUG
+// diagnostics cost nothing there.
+//
+// Format strings use "{}" placeholders ("{:x}" for hex integers) and must
+// be string literals:
+//   IPC_LOG_INFO("Window count incremented: {}", new_count);
+
+#ifndef RUNNER_IPC_LOG_H_
+#define RUNNER_IPC_LOG_H_
+
+#include <windows.h>
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#define IPC_LOG_LEVEL_DEBUG 0
+#define IPC_LOG_LEVEL_INFO 1
+#define IPC_LOG_LEVEL_WARN 2
+#define IPC_LOG_LEVEL_ERROR 3
+#define IPC_LOG_LEVEL_OFF 4
+
+// Lowest level compiled in. Override per target with a compile definition.
+#ifndef IPC_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define IPC_LOG_MIN_LEVEL IPC_LOG_LEVEL_INFO
+#else
+#define IPC_LOG_MIN_LEVEL IPC_LOG_LEVEL_DEBUG
+#endif
+#endif
+
+#define IPC_LOG_AT(level, ...)                                   \
+  do {                                                           \
+    if constexpr (static_cast<int>(level) >= IPC_LOG_MIN_LEVEL) { \
+      ::ipc_log::GetLogger().Log(level, __VA_ARGS__);            \
+    }                                                            \
+  } while (0)
+
+#define IPC_LOG_DEBUG(...) IPC_LOG_AT(::ipc_log::kDebug, __VA_ARGS__)
+#define IPC_LOG_INFO(...) IPC_LOG_AT(::ipc_log::kInfo, __VA_ARGS__)
+#define IPC_LOG_WARN(...) IPC_LOG_AT(::ipc_log::kWarn, __VA_ARGS__)
+#define IPC_LOG_ERROR(...) IPC_LOG_AT(::ipc_log::kError, __VA_ARGS__)
+
+namespace ipc_log {
+
+enum Level : uint8_t {
+  kDebug = IPC_LOG_LEVEL_DEBUG,
+  kInfo = IPC_LOG_LEVEL_INFO,
+  kWarn = IPC_LOG_LEVEL_WARN,
+  kError = IPC_LOG_LEVEL_ERROR,
+};
+
+// Record limits. Extra arguments are ignored; long strings are truncated.
+constexpr size_t kMaxArgs = 8;
+constexpr size_t kStringBytes = 104;
+
+// One captured argument. Formatting happens later on the writer thread.
+struct Arg {
+  enum Type : uint8_t { kInt, kUint, kDouble, kBool, kPointer, kString };
+  Type type;
+  union {
+    int64_t as_int;
+    uint64_t as_uint;
+    double as_double;
+    bool as_bool;
+    const void* as_pointer;
+    uint16_t as_string_offset;  // Into Record::strings
+  };
+};
+
+// Unformatted log call as stored in a per-thread ring (256 bytes).
+struct Record {
+  int64_t timestamp;   // QueryPerformanceCounter ticks
+  const char* format;  // String literal, never freed
+  DWORD thread_id;
+  Level level;
+  uint8_t arg_count;
+  uint16_t strings_used;
+  Arg args[kMaxArgs];
+  char strings[kStringBytes];
+};
+
+static_assert(sizeof(Record) == 256, "Keep records to four cache lines");
+
+// Single-producer single-consumer ring owned by one logging thread.
+// The producer never blocks: when the ring is full the record is dropped
+// and counted.
+class ThreadRing {
+ public:
+  static constexpr uint32_t kCapacity = 256;  // Power of two, 64 KiB
+
+  explicit ThreadRing(DWORD thread_id);
+
+  // Producer side. Returns a slot to fill, or nullptr if full.
+  Record* BeginWrite();
+  void EndWrite();
+
+  // Consumer side. Returns the oldest record, or nullptr if empty.
+  const Record* Peek() const;
+  void Pop();
+
+  DWORD thread_id() const { return thread_id_; }
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+  void CountDrop() { dropped_.fetch_add(1, std::memory_order_relaxed); }
+
+  // Set when the owning thread exits; the writer frees the ring once empty.
+  void Orphan() { orphaned_.store(true, std::memory_order_release); }
+  bool orphaned() const { return orphaned_.load(std::memory_order_acquire); }
+
+ private:
+  Record records_[kCapacity];
+  alignas(64) std::atomic<uint32_t> head_;  // Next write (producer)
+  alignas(64) std::atomic<uint32_t> tail_;  // Next read (consumer)
+  std::atomic<uint64_t> dropped_;
+  std::atomic<bool> orphaned_;
+  DWORD thread_id_;
+};
+
+// Cross-process ring of formatted lines in named shared memory.
+//
+// Bounded multi-producer queue (one sequence word per slot), so writer
+// threads of every window process can push concurrently with interlocked
+// operations only. A single drainer pops.
+//
+// A slot's sequence is its ring position while free, the position with
+// kSharedLogSlotWriting flipped while a producer fills it (half the
+// sequence space away from any position in use), and position + 1
+// once published. The drainer skips a slot left unfinished too long by
+// moving it on to the next lap with a compare-exchange, so a producer
+// that was only stalled finds the slot gone and drops its line.
+struct SharedLogSlot {
+  volatile LONG sequence;
+  WORD length;
+  WORD reserved;
+  char text[248];
+};
+
+struct SharedLogRingHeader {
+  DWORD magic;
+  DWORD capacity;
+  volatile LONG write_index;
+  volatile LONG read_index;
+  volatile LONG dropped;
+  DWORD reserved[11];  // Pad header to one cache line
+};
+
+static_assert(sizeof(SharedLogSlot) == 256, "Shared layout");
+static_assert(sizeof(SharedLogRingHeader) == 64, "Shared layout");
+
+// Flipped in a slot's sequence while its producer writes the text.
+constexpr DWORD kSharedLogSlotWriting = 0x80000000;
+
+// Fills and publishes the slot reserved at ring position pos. Returns
+// false, having written nothing visible, if the drainer already skipped
+// the slot. Exposed for tests standing in for other processes.
+bool WriteSharedSlot(SharedLogSlot* slot, DWORD pos, const char* text,
+                     size_t length);
+
+// Writes finished lines somewhere; used by tests instead of a file.
+using LineSink = std::function<void(const char* text, size_t length)>;
+
+struct LoggerOptions {
+  // Name of the shared log ring and of the drainer mutex derived from it.
+  std::string ring_name = "Local\\FlutterMultiWindowLog";
+  // Merged log file. Empty selects %TEMP%\flutter_multi_window.log.
+  std::string file_path;
+  // Replaces the file when set.
+  LineSink sink;
+  // Also print this process's lines to stdout (from the writer thread).
+  bool echo_to_console = true;
+  // Writer thread wake-up interval when idle.
+  DWORD flush_interval_ms = 20;
+};
+
+// Process-wide logger. The writer thread starts on the first log call.
+class Logger {
+ public:
+  explicit Logger(LoggerOptions options = LoggerOptions());
+
+  // Flushes everything and stops the writer thread.
+  ~Logger();
+
+  Logger(const Logger&) = delete;
+  Logger& operator=(const Logger&) = delete;
+
+  // Captures a log call. Lock-free after the calling thread's first call.
+  template <typename... Args>
+  void Log(Level level, const char* format, const Args&... args) {
+    ThreadRing* ring = GetThreadRing();
+    Record* record = ring->BeginWrite();
+    if (record == nullptr) {
+      ring->CountDrop();
+      return;
+    }
+    record->level = level;
+    record->format = format;
+    record->thread_id = ring->thread_id();
+    record->arg_count = 0;
+    record->strings_used = 0;
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    record->timestamp = now.QuadPart;
+    (Capture(record, args), ...);
+    ring->EndWrite();
+
+    // Warnings and errors are flushed promptly; everything else waits for
+    // the next writer tick.
+    if (level >= kWarn) {
+      Wake();
+    }
+  }
+
+  // Formats everything logged so far and drains the shared ring if this
+  // process is the drainer. Blocks the caller; for shutdown and tests.
+  void Flush();
+
+  // Stops the writer thread after a final flush. Safe to call twice.
+  void Shutdown();
+
+  // Records dropped because a per-thread ring was full.
+  uint64_t GetDroppedCount() const;
+
+  // True if this process currently writes the merged log file.
+  bool IsDrainer() const { return is_drainer_; }
+
+  // Lines dropped because the shared ring was full (all processes).
+  LONG GetSharedDroppedCount() const;
+
+  // Formats a record into buf; returns the number of characters written.
+  // Exposed for tests.
+  static size_t Format(const Record& record, char* buf, size_t size);
+
+ private:
+  static void Capture(Record* record, const char* value);
+  static void Capture(Record* record, char* value);
+  static void Capture(Record* record, const std::string& value);
+  static void Capture(Record* record, bool value);
+  static void Capture(Record* record, double value);
+
+  template <typename T>
+  static void Capture(Record* record, const T& value) {
+    if (record->arg_count >= kMaxArgs) {
+      return;
+    }
+    Arg& arg = record->args[record->arg_count++];
+    if constexpr (std::is_pointer_v<T>) {
+      arg.type = Arg::kPointer;
+      arg.as_pointer = value;
+    } else if constexpr (std::is_enum_v<T>) {
+      arg.type = Arg::kInt;
+      arg.as_int = static_cast<int64_t>(value);
+    } else if constexpr (std::is_floating_point_v<T>) {
+      arg.type = Arg::kDouble;
+      arg.as_double = static_cast<double>(value);
+    } else if constexpr (std::is_signed_v<T>) {
+      arg.type = Arg::kInt;
+      arg.as_int = static_cast<int64_t>(value);
+    } else {
+      static_assert(std::is_unsigned_v<T>, "Unsupported log argument type");
+      arg.type = Arg::kUint;
+      arg.as_uint = static_cast<uint64_t>(value);
+    }
+  }
+
+  // Returns the calling thread's ring, creating it on first use.
+  ThreadRing* GetThreadRing();
+  ThreadRing* RegisterThread();
+
+  void Wake();
+  void EnsureWriterStarted();
+  void WriterThreadFunction();
+
+  // Formats all pending thread records into the shared ring.
+  size_t DrainThreadRings();
+
+  // Pushes one line into the shared ring; false if full.
+  bool PushShared(const char* text, size_t length);
+
+  // Writes shared ring lines to the sink/file if this process is drainer.
+  size_t DrainSharedRing();
+
+  // Frees rings of exited threads once they are empty.
+  void ReleaseOrphanedRings();
+
+  bool OpenSharedRing();
+  bool TryBecomeDrainer();
+  void WriteLine(const char* text, size_t length);
+  void CloseSharedRing();
+
+  LoggerOptions options_;
+  const uint64_t id_;  // Distinguishes loggers in the per-thread cache
+
+  mutable std::mutex threads_mutex_;  // Guards rings_ (not the hot path)
+  std::vector<std::shared_ptr<ThreadRing>> rings_;
+
+  std::once_flag writer_started_;
+  std::thread writer_thread_;
+  std::atomic<bool> is_running_;
+  HANDLE wake_event_;
+
+  // Serializes Flush() callers with the writer thread.
+  std::mutex drain_mutex_;
+
+  HANDLE ring_mapping_;
+  SharedLogRingHeader* ring_;
+  SharedLogSlot* slots_;
+  HANDLE drainer_mutex_;
+  std::atomic<bool> is_drainer_;
+  DWORD stuck_pos_;        // Ring position of the unfinished slot, if any
+  ULONGLONG stuck_since_;  // Tick it was first seen unfinished, 0 = none
+  std::unique_ptr<std::ofstream> file_;  // Opened by the drainer
+};
+
+// Global logger used by the IPC_LOG_* macros.
+Logger& GetLogger();
+
+// Flushes and stops the global logger. Call before process exit.
+void Shutdown();
+
+}  // namespace ipc_log
+
+#endif  // RUNNER_IPC_LOG_H_
@@ -0,0 +1,753 @@
+// ipc_metrics.cpp
+//
+// Implementation of the cross-process metrics region and its aggregation.
+
+#include "ipc_metrics.h"
+
+#include <cstdio>
+#include <utility>
+
+#include "ipc_log.h"
+#include "ipc_namespace.h"
+#include "ipc_process.h"
+
+namespace ipc_metrics {
+
+namespace {
+constexpr DWORD kMetricsRegionMagic = 0x4D435049;  // 'IPCM'
+
+// Owner of a slot whose totals are being folded into the retired slot.
+// Neither claimable nor summed as live.
+constexpr LONG kReleasingOwner = -1;
+
+// Slot holding the folded totals of processes that released their slot.
+constexpr uint32_t kRetiredSlot = 0;
+
+// How long an opener waits for the creator to finish initializing.
+constexpr int kInitWaitMs = 100;
+
+constexpr uint32_t kSubBuckets = 8;  // Linear buckets per power of two
+
+int64_t QpcNow() {
+  LARGE_INTEGER now;
+  QueryPerformanceCounter(&now);
+  return now.QuadPart;
+}
+
+int64_t QpcFrequency() {
+  static const int64_t frequency = [] {
+    LARGE_INTEGER value;
+    QueryPerformanceFrequency(&value);
+    return value.QuadPart;
+  }();
+  return frequency;
+}
+
+int64_t TicksToNanos(int64_t ticks) {
+  // Split so ticks * 1e9 cannot overflow for long durations.
+  int64_t frequency = QpcFrequency();
+  return (ticks / frequency) * 1000000000 +
+         (ticks % frequency) * 1000000000 / frequency;
+}
+
+void UpdateMax(volatile LONG64* target, int64_t value) {
+  LONG64 current = ReadAcquire64(target);
+  while (value > current) {
+    LONG64 seen = InterlockedCompareExchange64(target, value, current);
+    if (seen == current) {
+      break;
+    }
+    current = seen;
+  }
+}
+
+// Adds the totals of one slot to another and clears the source. Gauges
+// describe the source process's live state, so they are cleared only.
+void FoldInto(MetricsSlot* target, MetricsSlot* source) {
+  for (uint32_t i = 0; i < kMaxCounters; i++) {
+    LONG64 value = InterlockedExchange64(&source->counters[i], 0);
+    if (value != 0) {
+      InterlockedExchangeAdd64(&target->counters[i], value);
+    }
+  }
+  for (uint32_t i = 0; i < kMaxGauges; i++) {
+    InterlockedExchange64(&source->gauges[i], 0);
+  }
+  for (uint32_t h = 0; h < kMaxHistograms; h++) {
+    MetricsHistogramData& from = source->histograms[h];
+    MetricsHistogramData& to = target->histograms[h];
+    for (uint32_t b = 0; b < kHistogramBuckets; b++) {
+      LONG value = InterlockedExchange(&from.buckets[b], 0);
+      if (value != 0) {
+        InterlockedExchangeAdd(&to.buckets[b], value);
+      }
+    }
+    InterlockedExchangeAdd64(&to.count, InterlockedExchange64(&from.count, 0));
+    InterlockedExchangeAdd64(&to.sum, InterlockedExchange64(&from.sum, 0));
+    UpdateMax(&to.max, InterlockedExchange64(&from.max, 0));
+  }
+}
+
+// Value at quantile q of the aggregated buckets (see HistogramSummary).
+int64_t Percentile(const int64_t* buckets, int64_t count, int64_t max,
+                   double q) {
+  if (count == 0) {
+    return 0;
+  }
+  int64_t rank = static_cast<int64_t>(q * static_cast<double>(count));
+  if (rank >= count) {
+    rank = count - 1;
+  }
+  int64_t seen = 0;
+  for (uint32_t b = 0; b < kHistogramBuckets; b++) {
+    seen += buckets[b];
+    if (seen > rank) {
+      int64_t bound = MetricsRegistry::BucketUpperBound(b);
+      return bound < max ? bound : max;
+    }
+  }
+  return max;
+}
+}  // anonymous namespace
+
+const char* CounterName(Counter counter) {
+  switch (counter) {
+    case kMetricNotificationsSent:
+      return "notifications.sent";
+    case kMetricNotificationsReceived:
+      return "notifications.received";
+    case kMetricCoalescedEvents:
+      return "notifications.coalesced";
+    case kMetricDartPosts:
+      return "dart.posts";
+    case kMetricDartPostFailures:
+      return "dart.post_failures";
+    case kMetricDartFiltered:
+      return "dart.filtered";
+    case kMetricSpinHits:
+      return "spin.hits";
+    case kMetricSpinNanoseconds:
+      return "spin.nanoseconds";
+    case kMetricCoalesceMerged:
+      return "delivery.coalesce_merged";
+    case kMetricDebounceMerged:
+      return "delivery.debounce_merged";
+    case kMetricFrameMerged:
+      return "delivery.frame_merged";
+    case kMetricTopicPublishes:
+      return "topics.published";
+    case kMetricTopicWakeups:
+      return "topics.wakeups";
+    case kMetricCallbacksQueued:
+      return "callbacks.queued";
+    case kMetricCallbacksCollapsed:
+      return "callbacks.collapsed";
+    case kCounterCount:
+      break;
+  }
+  return "unknown";
+}
+
+const char* GaugeName(Gauge gauge) {
+  switch (gauge) {
+    case kMetricDartSubscribers:
+      return "dart.subscribers";
+    case kMetricListenersRunning:
+      return "listeners.running";
+    case kGaugeCount:
+      break;
+  }
+  return "unknown";
+}
+
+const char* HistogramName(Histogram histogram) {
+  switch (histogram) {
+    case kMetricWakeLatency:
+      return "wake_latency_ns";
+    case kMetricCallbackDuration:
+      return "callback_duration_ns";
+    case kMetricDartPostDuration:
+      return "dart_post_duration_ns";
+    case kMetricSpinWakeLatency:
+      return "spin_wake_latency_ns";
+    case kHistogramCount:
+      break;
+  }
+  return "unknown";
+}
+
+double MetricsSnapshot::Rate(const MetricsSnapshot& earlier,
+                             const MetricsSnapshot& later, Counter counter) {
+  int64_t ticks = later.timestamp_ticks - earlier.timestamp_ticks;
+  if (ticks <= 0 || later.ticks_per_second <= 0) {
+    return 0.0;
+  }
+  double seconds = static_cast<double>(ticks) /
+                   static_cast<double>(later.ticks_per_second);
+  return static_cast<double>(later.counters[counter] -
+                             earlier.counters[counter]) /
+         seconds;
+}
+
+// ============================================================================
+// MetricsRegistry
+// ============================================================================
+
+MetricsRegistry::MetricsRegistry(std::string region_name, uint32_t slot_count)
+    : region_name_(std::move(region_name)),
+      slot_count_(slot_count),
+      mapping_(nullptr),
+      read_only_(false),
+      header_(nullptr),
+      slot_(nullptr) {}
+
+MetricsRegistry::~MetricsRegistry() {
+  Release();
+  Close();
+}
+
+bool MetricsRegistry::Open() {
+  if (slot_ != nullptr) {
+    return true;
+  }
+
+  if (header_ == nullptr) {
+    size_t size =
+        sizeof(MetricsRegionHeader) + slot_count_ * sizeof(MetricsSlot);
+    mapping_ = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr,
+                                  PAGE_READWRITE, 0, static_cast<DWORD>(size),
+                                  region_name_.c_str());
+    if (mapping_ == nullptr) {
+      IPC_LOG_ERROR("CreateFileMappingA failed for metrics region: {}",
+                    GetLastError());
+      return false;
+    }
+    bool already_exists = (GetLastError() == ERROR_ALREADY_EXISTS);
+
+    void* view = MapViewOfFile(mapping_, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (view == nullptr) {
+      IPC_LOG_ERROR("MapViewOfFile failed for metrics region: {}",
+                    GetLastError());
+      Close();
+      return false;
+    }
+    header_ = static_cast<MetricsRegionHeader*>(view);
+
+    // Pages of a new mapping are zeroed, so every slot starts free.
+    if (!already_exists) {
+      header_->slot_count = slot_count_;
+      header_->slot_size = sizeof(MetricsSlot);
+      MemoryBarrier();
+      header_->magic = kMetricsRegionMagic;
+    } else {
+      for (int i = 0; i < kInitWaitMs && header_->magic != kMetricsRegionMagic;
+           i++) {
+        Sleep(1);  // Creator still initializing
+      }
+      if (header_->magic != kMetricsRegionMagic ||
+          header_->slot_count != slot_count_ ||
+          header_->slot_size != sizeof(MetricsSlot)) {
+        IPC_LOG_WARN("Metrics region layout mismatch: {} slots of {} bytes",
+                     header_->slot_count, header_->slot_size);
+        Close();
+        return false;
+      }
+    }
+  }
+
+  LONG pid = static_cast<LONG>(GetCurrentProcessId());
+
+  // Free slots are always zeroed, so a claimed one is ready to record.
+  for (uint32_t i = kRetiredSlot + 1; i < slot_count_; i++) {
+    MetricsSlot* slot = SlotAt(i);
+    if (InterlockedCompareExchange(&slot->owner_pid, pid, 0) == 0) {
+      slot_ = slot;
+      return true;
+    }
+  }
+
+  // Every slot is owned; take over one whose process died without
+  // releasing it, keeping its totals.
+  for (uint32_t i = kRetiredSlot + 1; i < slot_count_; i++) {
+    MetricsSlot* slot = SlotAt(i);
+    LONG owner = ReadAcquire(&slot->owner_pid);
+    if (owner <= 0 || !ipc_process::IsProcessGone(static_cast<DWORD>(owner))) {
+      continue;
+    }
+    if (InterlockedCompareExchange(&slot->owner_pid, kReleasingOwner, owner) !=
+        owner) {
+      continue;  // Another process reclaimed it first
+    }
+    FoldInto(SlotAt(kRetiredSlot), slot);
+    WriteRelease(&slot->owner_pid, pid);
+    IPC_LOG_INFO("Reclaimed metrics slot of exited process {}", owner);
+    slot_ = slot;
+    return true;
+  }
+
+  IPC_LOG_WARN("No free metrics slot; this process records no metrics");
+  return false;
+}
+
+bool MetricsRegistry::OpenReadOnly() {
+  if (header_ != nullptr) {
+    return true;
+  }
+
+  mapping_ = OpenFileMappingA(FILE_MAP_READ, FALSE, region_name_.c_str());
+  if (mapping_ == nullptr) {
+    return false;  // No window has created the region
+  }
+
+  // Map the header first to learn the slot count, then the whole region.
+  void* view = MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0,
+                             sizeof(MetricsRegionHeader));
+  if (view == nullptr) {
+    Close();
+    return false;
+  }
+  const MetricsRegionHeader* probe =
+      static_cast<const MetricsRegionHeader*>(view);
+  bool valid = probe->magic == kMetricsRegionMagic &&
+               probe->slot_size == sizeof(MetricsSlot) &&
+               probe->slot_count > kRetiredSlot;
+  uint32_t slot_count = probe->slot_count;
+  UnmapViewOfFile(view);
+  if (!valid) {
+    Close();
+    return false;
+  }
+
+  size_t size = sizeof(MetricsRegionHeader) + slot_count * sizeof(MetricsSlot);
+  view = MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, size);
+  if (view == nullptr) {
+    Close();
+    return false;
+  }
+  header_ = static_cast<MetricsRegionHeader*>(view);
+  slot_count_ = slot_count;
+  read_only_ = true;
+  return true;
+}
+
+void MetricsRegistry::Release() {
+  if (slot_ == nullptr) {
+    return;
+  }
+  MetricsSlot* slot = slot_;
+  slot_ = nullptr;
+
+  // Hide the slot from snapshots and claimers while its totals move.
+  WriteRelease(&slot->owner_pid, kReleasingOwner);
+  FoldInto(SlotAt(kRetiredSlot), slot);
+  WriteRelease(&slot->owner_pid, 0);
+}
+
+void MetricsRegistry::Increment(Counter counter, int64_t delta) {
+  if (slot_ == nullptr) {
+    return;
+  }
+  InterlockedExchangeAdd64(&slot_->counters[counter], delta);
+}
+
+void MetricsRegistry::SetGauge(Gauge gauge, int64_t value) {
+  if (slot_ == nullptr) {
+    return;
+  }
+  InterlockedExchange64(&slot_->gauges[gauge], value);
+}
+
+void MetricsRegistry::AddGauge(Gauge gauge, int64_t delta) {
+  if (slot_ == nullptr) {
+    return;
+  }
+  InterlockedExchangeAdd64(&slot_->gauges[gauge], delta);
+}
+
+void MetricsRegistry::RecordValue(Histogram histogram, int64_t value) {
+  if (slot_ == nullptr) {
+    return;
+  }
+  if (value < 0) {
+    value = 0;
+  }
+  MetricsHistogramData& data = slot_->histograms[histogram];
+  InterlockedIncrement(&data.buckets[BucketIndex(value)]);
+  InterlockedExchangeAdd64(&data.sum, value);
+  UpdateMax(&data.max, value);
+  // Count last: a snapshot racing with this call sees at most one bucket
+  // entry more than the count, never fewer.
+  InterlockedIncrement64(&data.count);
+}
+
+void MetricsRegistry::RecordDuration(Histogram histogram, int64_t start_ticks,
+                                     int64_t end_ticks) {
+  RecordValue(histogram, TicksToNanos(end_ticks - start_ticks));
+}
+
+void MetricsRegistry::RecordNotifySent() {
+  if (header_ == nullptr || read_only_) {
+    return;
+  }
+  // Shared fields are bumped even without a slot so other processes'
+  // coalescing and latency math stays right.
+  InterlockedExchange64(&header_->last_notify_ticks, QpcNow());
+  InterlockedIncrement64(&header_->notify_sequence);
+  Increment(kMetricNotificationsSent);
+}
+
+void MetricsRegistry::RecordListenerWake(int64_t wake_ticks,
+                                         int64_t* last_seen_sequence) {
+  if (header_ == nullptr || read_only_) {
+    return;
+  }
+  Increment(kMetricNotificationsReceived);
+
+  int64_t sequence = ReadAcquire64(&header_->notify_sequence);
+  int64_t missed = sequence - *last_seen_sequence;
+  if (missed > 1) {
+    Increment(kMetricCoalescedEvents, missed - 1);
+  }
+  if (missed > 0) {
+    *last_seen_sequence = sequence;
+  }
+
+  // Latency to the most recent notification; skipped if that one was sent
+  // after this wakeup (it will cause a wakeup of its own).
+  int64_t sent_ticks = ReadAcquire64(&header_->last_notify_ticks);
+  if (sent_ticks != 0 && sent_ticks <= wake_ticks) {
+    RecordDuration(kMetricWakeLatency, sent_ticks, wake_ticks);
+  }
+}
+
+void MetricsRegistry::RecordWrite() {
+  if (header_ == nullptr || read_only_) {
+    return;
+  }
+  InterlockedExchange64(&header_->last_write_ticks, QpcNow());
+}
+
+void MetricsRegistry::RecordSpinHit(int64_t spin_start_ticks,
+                                    int64_t seen_ticks) {
+  if (header_ == nullptr || read_only_) {
+    return;
+  }
+  Increment(kMetricSpinHits);
+  Increment(kMetricSpinNanoseconds,
+            TicksToNanos(seen_ticks - spin_start_ticks));
+
+  // As in RecordListenerWake(): a later write has a latency of its own.
+  int64_t write_ticks = ReadAcquire64(&header_->last_write_ticks);
+  if (write_ticks != 0 && write_ticks <= seen_ticks) {
+    RecordDuration(kMetricSpinWakeLatency, write_ticks, seen_ticks);
+  }
+}
+
+void MetricsRegistry::RecordSpinMiss(int64_t spin_start_ticks,
+                                     int64_t end_ticks) {
+  Increment(kMetricSpinNanoseconds,
+            TicksToNanos(end_ticks - spin_start_ticks));
+}
+
+int64_t MetricsRegistry::GetNotifySequence() const {
+  return header_ != nullptr ? ReadAcquire64(&header_->notify_sequence) : 0;
+}
+
+bool MetricsRegistry::Snapshot(MetricsSnapshot* snapshot) const {
+  if (header_ == nullptr || snapshot == nullptr) {
+    return false;
+  }
+
+  MetricsSnapshot result = {};
+  result.timestamp_ticks = QpcNow();
+  result.ticks_per_second = QpcFrequency();
+  result.notify_sequence = ReadAcquire64(&header_->notify_sequence);
+
+  int64_t buckets[kMaxHistograms][kHistogramBuckets] = {};
+
+  for (uint32_t i = 0; i < slot_count_; i++) {
+    const MetricsSlot* slot = SlotAt(i);
+    LONG owner = ReadAcquire(&slot->owner_pid);
+    if (i != kRetiredSlot && owner <= 0) {
+      continue;  // Free, or being folded into the retired slot
+    }
+
+    // A crashed process keeps its totals until its slot is reclaimed, but
+    // its gauges no longer describe anything live.
+    bool live = i != kRetiredSlot &&
+                (static_cast<DWORD>(owner) == GetCurrentProcessId() ||
+                 !ipc_process::IsProcessGone(static_cast<DWORD>(owner)));
+    if (live) {
+      result.process_count++;
+      for (uint32_t g = 0; g < kMaxGauges; g++) {
+        result.gauges[g] += ReadNoFence64(&slot->gauges[g]);
+      }
+    }
+
+    for (uint32_t c = 0; c < kMaxCounters; c++) {
+      result.counters[c] += ReadNoFence64(&slot->counters[c]);
+    }
+    for (uint32_t h = 0; h < kMaxHistograms; h++) {
+      const MetricsHistogramData& data = slot->histograms[h];
+      HistogramSummary& summary = result.histograms[h];
+      summary.count += ReadNoFence64(&data.count);
+      summary.sum += ReadNoFence64(&data.sum);
+      int64_t max = ReadNoFence64(&data.max);
+      if (max > summary.max) {
+        summary.max = max;
+      }
+      for (uint32_t b = 0; b < kHistogramBuckets; b++) {
+        buckets[h][b] += ReadNoFence(&data.buckets[b]);
+      }
+    }
+  }
+
+  for (uint32_t h = 0; h < kMaxHistograms; h++) {
+    HistogramSummary& summary = result.histograms[h];
+    summary.p50 = Percentile(buckets[h], summary.count, summary.max, 0.50);
+    summary.p90 = Percentile(buckets[h], summary.count, summary.max, 0.90);
+    summary.p99 = Percentile(buckets[h], summary.count, summary.max, 0.99);
+    summary.p999 = Percentile(buckets[h], summary.count, summary.max, 0.999);
+  }
+
+  *snapshot = result;
+  return true;
+}
+
+bool MetricsRegistry::SnapshotBuckets(Histogram histogram,
+                                      std::vector<int64_t>* buckets) const {
+  if (header_ == nullptr || buckets == nullptr ||
+      histogram >= kMaxHistograms) {
+    return false;
+  }
+
+  buckets->assign(kHistogramBuckets, 0);
+  for (uint32_t i = 0; i < slot_count_; i++) {
+    const MetricsSlot* slot = SlotAt(i);
+    if (i != kRetiredSlot && ReadAcquire(&slot->owner_pid) <= 0) {
+      continue;  // Free, or being folded into the retired slot
+    }
+    const MetricsHistogramData& data = slot->histograms[histogram];
+    for (uint32_t b = 0; b < kHistogramBuckets; b++) {
+      (*buckets)[b] += ReadNoFence(&data.buckets[b]);
+    }
+  }
+  return true;
+}
+
+int64_t MetricsRegistry::BucketPercentile(const std::vector<int64_t>& buckets,
+                                          double q) {
+  if (buckets.size() != kHistogramBuckets) {
+    return 0;
+  }
+  int64_t count = 0;
+  int64_t max = 0;
+  for (uint32_t b = 0; b < kHistogramBuckets; b++) {
+    if (buckets[b] > 0) {
+      count += buckets[b];
+      max = BucketUpperBound(b);
+    }
+  }
+  return Percentile(buckets.data(), count, max, q);
+}
+
+std::vector<MetricsSlotInfo> MetricsRegistry::ListSlots() const {
+  std::vector<MetricsSlotInfo> slots;
+  if (header_ == nullptr) {
+    return slots;
+  }
+
+  for (uint32_t i = kRetiredSlot + 1; i < slot_count_; i++) {
+    const MetricsSlot* slot = SlotAt(i);
+    LONG owner = ReadAcquire(&slot->owner_pid);
+    if (owner <= 0) {
+      continue;
+    }
+    MetricsSlotInfo info = {};
+    info.index = i;
+    info.process_id = static_cast<DWORD>(owner);
+    info.live = info.process_id == GetCurrentProcessId() ||
+                !ipc_process::IsProcessGone(info.process_id);
+    for (uint32_t c = 0; c < kMaxCounters; c++) {
+      info.counters[c] = ReadNoFence64(&slot->counters[c]);
+    }
+    for (uint32_t g = 0; g < kMaxGauges; g++) {
+      info.gauges[g] = ReadNoFence64(&slot->gauges[g]);
+    }
+    slots.push_back(info);
+  }
+  return slots;
+}
+
+uint32_t MetricsRegistry::BucketIndex(int64_t value) {
+  if (value < static_cast<int64_t>(kSubBuckets)) {
+    return value < 0 ? 0 : static_cast<uint32_t>(value);
+  }
+  uint64_t bits = static_cast<uint64_t>(value);
+  uint32_t msb = 0;
+  for (uint32_t shift = 32; shift > 0; shift /= 2) {
+    if (bits >> shift) {
+      bits >>= shift;
+      msb += shift;
+    }
+  }
+  // Bucket (msb - 2) * 8 + the three bits below the most significant one.
+  uint64_t index = (msb - 2) * kSubBuckets +
+                   ((static_cast<uint64_t>(value) >> (msb - 3)) &
+                    (kSubBuckets - 1));
+  return index < kHistogramBuckets ? static_cast<uint32_t>(index)
+                                   : kHistogramBuckets - 1;
+}
+
+int64_t MetricsRegistry::BucketUpperBound(uint32_t index) {
+  if (index < kSubBuckets) {
+    return index;
+  }
+  uint32_t shift = index / kSubBuckets - 1;
+  int64_t lower = static_cast<int64_t>(kSubBuckets + index % kSubBuckets)
+                  << shift;
+  return lower + (int64_t{1} << shift) - 1;
+}
+
+MetricsSlot* MetricsRegistry::SlotAt(uint32_t index) const {
+  return reinterpret_cast<MetricsSlot*>(header_ + 1) + index;
+}
+
+void MetricsRegistry::Close() {
+  if (header_) {
+    UnmapViewOfFile(header_);
+    header_ = nullptr;
+  }
+  if (mapping_) {
+    CloseHandle(mapping_);
+    mapping_ = nullptr;
+  }
+  read_only_ = false;
+}
+
+// ============================================================================
+// Global helpers
+// ============================================================================
+
+MetricsRegistry& GetRegistry() {
+  // Intentionally leaked, like the global logger: metrics may still be
+  // recorded from threads that outlive static destruction.
+  static MetricsRegistry* registry = [] {
+    MetricsRegistry* created = new MetricsRegistry(
+        ipc_namespace::Qualify(MetricsRegistry::kDefaultRegionName));
+    created->Open();
+    return created;
+  }();
+  return *registry;
+}
+
+void Increment(Counter counter, int64_t delta) {
+  GetRegistry().Increment(counter, delta);
+}
+
+void AddGauge(Gauge gauge, int64_t delta) {
+  GetRegistry().AddGauge(gauge, delta);
+}
+
+void RecordDuration(Histogram histogram, int64_t start_ticks,
+                    int64_t end_ticks) {
+  GetRegistry().RecordDuration(histogram, start_ticks, end_ticks);
+}
+
+std::string FormatMetrics(const MetricsSnapshot& snapshot) {
+  std::string text;
+  char line[256];
+  std::snprintf(line, sizeof(line), "IPC metrics (%lld processes)\n",
+                static_cast<long long>(snapshot.process_count));
+  text += line;
+
+  for (uint32_t c = 0; c < kCounterCount; c++) {
+    std::snprintf(line, sizeof(line), "  %-26s %lld\n",
+                  CounterName(static_cast<Counter>(c)),
+                  static_cast<long long>(snapshot.counters[c]));
+    text += line;
+  }
+  for (uint32_t g = 0; g < kGaugeCount; g++) {
+    std::snprintf(line, sizeof(line), "  %-26s %lld\n",
+                  GaugeName(static_cast<Gauge>(g)),
+                  static_cast<long long>(snapshot.gauges[g]));
+    text += line;
+  }
+  for (uint32_t h = 0; h < kHistogramCount; h++) {
+    const HistogramSummary& summary = snapshot.histograms[h];
+    std::snprintf(line, sizeof(line),
+                  "  %-26s count=%lld p50=%lld p90=%lld p99=%lld "
+                  "p99.9=%lld max=%lld\n",
+                  HistogramName(static_cast<Histogram>(h)),
+                  static_cast<long long>(summary.count),
+                  static_cast<long long>(summary.p50),
+                  static_cast<long long>(summary.p90),
+                  static_cast<long long>(summary.p99),
+                  static_cast<long long>(summary.p999),
+                  static_cast<long long>(summary.max));
+    text += line;
+  }
+  return text;
+}
+
+void LogMetrics(const MetricsSnapshot& snapshot, ipc_log::Logger* logger) {
+  logger->Log(ipc_log::kInfo, "IPC metrics ({} processes)",
+              snapshot.process_count);
+  for (uint32_t c = 0; c < kCounterCount; c++) {
+    logger->Log(ipc_log::kInfo, "  {} {}", CounterName(static_cast<Counter>(c)),
+                snapshot.counters[c]);
+  }
+  for (uint32_t g = 0; g < kGaugeCount; g++) {
+    logger->Log(ipc_log::kInfo, "  {} {}", GaugeName(static_cast<Gauge>(g)),
+                snapshot.gauges[g]);
+  }
+  for (uint32_t h = 0; h < kHistogramCount; h++) {
+    const HistogramSummary& summary = snapshot.histograms[h];
+    logger->Log(ipc_log::kInfo,
+                "  {} count={} p50={} p90={} p99={} p99.9={} max={}",
+                HistogramName(static_cast<Histogram>(h)), summary.count,
+                summary.p50, summary.p90, summary.p99, summary.p999,
+                summary.max);
+  }
+}
+
+void DumpMetrics() {
+  MetricsSnapshot snapshot;
+  if (!GetRegistry().Snapshot(&snapshot)) {
+    IPC_LOG_WARN("IPC metrics unavailable");
+    return;
+  }
+  LogMetrics(snapshot, &ipc_log::GetLogger());
+}
+
+void Shutdown() {
+  GetRegistry().Release();
+}
+
+}  // namespace ipc_metrics
+
+// ============================================================================
+// FFI Exports - C functions callable from Dart via FFI
+// ============================================================================
+
+extern "C" {
+
+/// Aggregate the metrics of all windows into a caller-provided buffer.
+///
+/// Dart usage:
+///   final snapshot = IpcMetrics.snapshot();
+///   print(snapshot?.counters['notifications.sent']);
+__declspec(dllexport) bool GetIpcMetricsSnapshot(
+    ipc_metrics::MetricsSnapshot* snapshot) {
+  return ipc_metrics::GetRegistry().Snapshot(snapshot);
+}
+
+/// Log the metrics of all windows.
+///
+/// Dart usage:
+///   IpcMetrics.dump();
+__declspec(dllexport) void DumpIpcMetrics() {
+  ipc_metrics::DumpMetrics();
+}
+
+}  // extern "C"
@@ -0,0 +1,319 @@
+// ipc_metrics.h
+//
+// Runtime metrics of the IPC layers, aggregated across all window processes.
+//
+// Every process claims one slot in a named shared-memory region and records
+// counters, gauges and histograms into it with interlocked adds only; no
+// locks, and no other process ever writes the slot. Slots are padded to
+// whole cache lines so processes never share one. Aggregation happens when
+// a snapshot is taken: any process can sum every live slot and see the
+// whole fleet of open windows.
+//
+// When a process releases its slot (clean exit, or reclaimed after a crash)
+// its counters and histograms are folded into a retired slot, so fleet
+// totals never go backwards. Gauges describe live state and are dropped.
+//
+// Histograms are HDR-style: 8 linear sub-buckets per power of two, so any
+// value from 0 to ~36 minutes in nanoseconds is kept to within 12.5%.
+//
+// Rates such as listener wakeups per second come from two snapshots:
+//   double per_second = MetricsSnapshot::Rate(earlier, later,
+//                                             kMetricNotificationsReceived);
+// The rate of kMetricSpinNanoseconds divided by 1e9 is the number of cores
+// spinning listeners keep busy.
+
+#ifndef RUNNER_IPC_METRICS_H_
+#define RUNNER_IPC_METRICS_H_
+
+#include <windows.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ipc_log {
+class Logger;
+}  // namespace ipc_log
+
+namespace ipc_metrics {
+
+// Monotonic event counts.
+enum Counter : uint32_t {
+  kMetricNotificationsSent = 0,  // SetEvent after a count change (writer)
+  kMetricNotificationsReceived,  // Listener wakeups on the change event
+  kMetricCoalescedEvents,        // Changes folded into another wakeup
+  kMetricDartPosts,              // Updates delivered to a Dart subscriber
+  kMetricDartPostFailures,       // Dart_PostCObject_DL returned false
+  kMetricDartFiltered,           // Updates dropped by native filters
+  kMetricSpinHits,               // Changes a spinning listener saw first
+  kMetricSpinNanoseconds,        // Time listeners spent spinning (CPU burn)
+  kMetricCoalesceMerged,         // Changes merged by the coalesce policy
+  kMetricDebounceMerged,         // Changes merged by the debounce policy
+  kMetricFrameMerged,            // Changes merged by the frame policy
+  kMetricTopicPublishes,         // IpcTopicBoard::Publish() calls
+  kMetricTopicWakeups,           // Processes a topic publish signaled
+  kMetricCallbacksQueued,        // Callbacks handed to a callback executor
+  kMetricCallbacksCollapsed,     // Queued callbacks replaced by a newer one
+  kCounterCount,
+};
+
+// Current values, summed across live processes.
+enum Gauge : uint32_t {
+  kMetricDartSubscribers = 0,  // Registered ports and listeners
+  kMetricListenersRunning,     // Started WindowCountListeners
+  kGaugeCount,
+};
+
+// Value distributions, in nanoseconds.
+enum Histogram : uint32_t {
+  kMetricWakeLatency = 0,  // Writer's SetEvent until a listener woke
+  kMetricCallbackDuration,  // One listener callback (snapshot and fan-out)
+  kMetricDartPostDuration,  // One Dart_PostCObject_DL or listener call
+  kMetricSpinWakeLatency,   // Shared write until a spinning listener saw it
+  kHistogramCount,
+};
+
+// Fixed array sizes of the shared layout and of MetricsSnapshot, so new
+// metrics do not change either.
+constexpr uint32_t kMaxCounters = 16;
+constexpr uint32_t kMaxGauges = 8;
+constexpr uint32_t kMaxHistograms = 4;
+constexpr uint32_t kHistogramBuckets = 312;
+
+static_assert(kCounterCount <= kMaxCounters, "Counter slots");
+static_assert(kGaugeCount <= kMaxGauges, "Gauge slots");
+static_assert(kHistogramCount <= kMaxHistograms, "Histogram slots");
+
+// Names used by FormatMetrics(), e.g. "notifications.sent".
+const char* CounterName(Counter counter);
+const char* GaugeName(Gauge gauge);
+const char* HistogramName(Histogram histogram);
+
+// Aggregated histogram. Percentiles are bucket upper bounds, capped at max.
+struct HistogramSummary {
+  int64_t count;
+  int64_t sum;
+  int64_t max;
+  int64_t p50;
+  int64_t p90;
+  int64_t p99;
+  int64_t p999;
+  int64_t reserved;
+};
+
+// Fleet-wide aggregate returned by MetricsRegistry::Snapshot() and the
+// GetIpcMetricsSnapshot FFI export. Plain int64 fields only, so Dart reads
+// it as an Int64List (see lib/ipc_metrics.dart).
+struct MetricsSnapshot {
+  int64_t process_count;     // Live slots summed into gauges
+  int64_t timestamp_ticks;   // QueryPerformanceCounter at the snapshot
+  int64_t ticks_per_second;  // QueryPerformanceFrequency
+  int64_t notify_sequence;   // Total notifications sent since creation
+  int64_t counters[kMaxCounters];
+  int64_t gauges[kMaxGauges];
+  HistogramSummary histograms[kMaxHistograms];
+
+  // Per-second rate of a counter between two snapshots, 0 if no time
+  // passed. Approximate across a window crash until its slot is reclaimed.
+  static double Rate(const MetricsSnapshot& earlier,
+                     const MetricsSnapshot& later, Counter counter);
+};
+
+static_assert(sizeof(MetricsSnapshot) == (4 + 16 + 8 + 4 * 8) * 8,
+              "FFI layout");
+
+// Shared layout. Sizes are whole cache lines and the mapping is page
+// aligned, so every slot and every histogram starts on its own line.
+struct MetricsHistogramData {
+  volatile LONG64 count;
+  volatile LONG64 sum;
+  volatile LONG64 max;
+  volatile LONG64 reserved;
+  volatile LONG buckets[kHistogramBuckets];
+};
+
+struct MetricsSlot {
+  volatile LONG owner_pid;  // 0 = free
+  DWORD reserved[15];
+  volatile LONG64 counters[kMaxCounters];
+  volatile LONG64 gauges[kMaxGauges];
+  MetricsHistogramData histograms[kMaxHistograms];
+};
+
+struct MetricsRegionHeader {
+  DWORD magic;
+  DWORD slot_count;
+  DWORD slot_size;
+  DWORD reserved0;
+  volatile LONG64 notify_sequence;    // Bumped before every SetEvent
+  volatile LONG64 last_notify_ticks;  // QueryPerformanceCounter of it
+  volatile LONG64 last_write_ticks;   // Inside the last shared write
+  DWORD reserved[6];
+};
+
+static_assert(sizeof(MetricsHistogramData) % 64 == 0, "Cache-line layout");
+static_assert(sizeof(MetricsSlot) % 64 == 0, "Cache-line layout");
+static_assert(sizeof(MetricsRegionHeader) == 64, "Cache-line layout");
+
+// One owned slot, as listed by MetricsRegistry::ListSlots().
+struct MetricsSlotInfo {
+  uint32_t index;
+  DWORD process_id;
+  bool live;  // Owner process still running
+  int64_t counters[kMaxCounters];
+  int64_t gauges[kMaxGauges];
+};
+
+// One process's view of the shared metrics region.
+//
+// Recording methods are thread-safe and wait-free. Before Open() succeeds
+// (or if no slot is free) they do nothing.
+class MetricsRegistry {
+ public:
+  // Slot 0 holds the totals of retired processes; the rest are claimable.
+  static constexpr uint32_t kDefaultSlotCount = 65;
+  static constexpr char kDefaultRegionName[] =
+      "Local\\FlutterMultiWindowMetrics";
+
+  explicit MetricsRegistry(std::string region_name = kDefaultRegionName,
+                           uint32_t slot_count = kDefaultSlotCount);
+  ~MetricsRegistry();
+
+  MetricsRegistry(const MetricsRegistry&) = delete;
+  MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+  // Creates or opens the region and claims a slot, reclaiming slots of
+  // processes that exited without releasing theirs. Not thread-safe: call
+  // it before sharing the registry.
+  //
+  // Returns false if the region is unavailable or every slot is taken; in
+  // the latter case Snapshot() still works.
+  bool Open();
+
+  // Opens an existing region with FILE_MAP_READ, for inspectors. Never
+  // creates the region, claims a slot or logs; recording stays a no-op and
+  // only Snapshot() and ListSlots() work. The slot count is taken from the
+  // region.
+  //
+  // Returns false if no window has created the region or its layout
+  // differs.
+  bool OpenReadOnly();
+
+  // Folds this process's totals into the retired slot and frees the slot.
+  // Called by the destructor; recording afterwards does nothing.
+  void Release();
+
+  void Increment(Counter counter, int64_t delta = 1);
+  void SetGauge(Gauge gauge, int64_t value);
+  void AddGauge(Gauge gauge, int64_t delta);
+  void RecordValue(Histogram histogram, int64_t value);
+
+  // Records end_ticks - start_ticks (QueryPerformanceCounter) in ns.
+  void RecordDuration(Histogram histogram, int64_t start_ticks,
+                      int64_t end_ticks);
+
+  // Counts a change notification; call right before SetEvent so listeners
+  // that wake see it.
+  void RecordNotifySent();
+
+  // Counts a listener wakeup at wake_ticks. last_seen_sequence is the
+  // listener's own notify sequence, initialised from GetNotifySequence();
+  // notifications since then beyond the first were coalesced into this
+  // wakeup.
+  void RecordListenerWake(int64_t wake_ticks, int64_t* last_seen_sequence);
+
+  // Stamps the time of a shared count write; call inside the write, so a
+  // reader that sees the new state also sees at least this time.
+  void RecordWrite();
+
+  // Counts a change a spinning listener saw at seen_ticks after spinning
+  // since spin_start_ticks, and the latency from the write.
+  void RecordSpinHit(int64_t spin_start_ticks, int64_t seen_ticks);
+
+  // Adds spin time that ended without a change.
+  void RecordSpinMiss(int64_t spin_start_ticks, int64_t end_ticks);
+
+  int64_t GetNotifySequence() const;
+
+  // Aggregates all slots. Returns false if the region is not open.
+  bool Snapshot(MetricsSnapshot* snapshot) const;
+
+  // Aggregated bucket counts of one histogram, kHistogramBuckets entries.
+  // Unlike Snapshot() percentiles, the difference of two calls gives the
+  // distribution of just the values recorded in between. Returns false if
+  // the region is not open.
+  bool SnapshotBuckets(Histogram histogram,
+                       std::vector<int64_t>* buckets) const;
+
+  // Value at quantile q of bucket counts from SnapshotBuckets() (or the
+  // difference of two): a bucket upper bound, 0 if there are none.
+  static int64_t BucketPercentile(const std::vector<int64_t>& buckets,
+                                  double q);
+
+  // Per-process view of every owned slot, in slot order.
+  std::vector<MetricsSlotInfo> ListSlots() const;
+
+  // True once a slot is claimed and recording takes effect.
+  bool HasSlot() const { return slot_ != nullptr; }
+
+  // Histogram bucket math, exposed for tests.
+  static uint32_t BucketIndex(int64_t value);
+  static int64_t BucketUpperBound(uint32_t index);
+
+ private:
+  MetricsSlot* SlotAt(uint32_t index) const;
+  void Close();
+
+  std::string region_name_;
+  uint32_t slot_count_;
+  HANDLE mapping_;
+  bool read_only_;  // Mapped by OpenReadOnly(); never written
+  MetricsRegionHeader* header_;
+  MetricsSlot* slot_;  // Claimed slot, nullptr if none
+};
+
+// Process-wide registry used by the IPC layers and the FFI exports.
+// Opened on first use, in the default IPC namespace of that moment;
+// intentionally leaked like the global logger.
+MetricsRegistry& GetRegistry();
+
+// Shorthands for the global registry.
+void Increment(Counter counter, int64_t delta = 1);
+void AddGauge(Gauge gauge, int64_t delta);
+void RecordDuration(Histogram histogram, int64_t start_ticks,
+                    int64_t end_ticks);
+
+// Multi-line, human-readable form of a snapshot.
+std::string FormatMetrics(const MetricsSnapshot& snapshot);
+
+// Logs a snapshot at INFO level, one record per metric: a record keeps
+// only ipc_log::kStringBytes of string arguments, far less than the whole
+// FormatMetrics() report.
+void LogMetrics(const MetricsSnapshot& snapshot, ipc_log::Logger* logger);
+
+// Logs the fleet snapshot through the global logger (LogMetrics()).
+void DumpMetrics();
+
+// Releases the global registry's slot. Call once at process exit.
+void Shutdown();
+
+}  // namespace ipc_metrics
+
+// FFI Exports for Dart binding
+extern "C" {
+
+/// FFI export: Aggregate the metrics of all windows.
+///
+/// Safe to bind as a leaf call.
+///
+/// @param snapshot Caller-provided buffer of sizeof(MetricsSnapshot) bytes
+/// @return true if the region is open and the snapshot was written
+__declspec(dllexport) bool GetIpcMetricsSnapshot(
+    ipc_metrics::MetricsSnapshot* snapshot);
+
+/// FFI export: Log the metrics of all windows (see ipc_log).
+__declspec(dllexport) void DumpIpcMetrics();
+
+}  // extern "C"
+
+#endif  // RUNNER_IPC_METRICS_H_
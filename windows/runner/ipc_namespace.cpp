@@ -0,0 +1,90 @@
+// ipc_namespace.cpp
+//
+// Implementation of IPC instance namespaces.
+//
+// Does not log: the logger itself asks for the default namespace when it
+// opens its ring.
+
+#include "ipc_namespace.h"
+
+#include <windows.h>
+
+#include <atomic>
+#include <mutex>
+
+namespace ipc_namespace {
+
+namespace {
+
+std::mutex g_mutex;
+bool g_loaded = false;        // g_default read from the environment
+std::string g_default;        // Guarded by g_mutex
+std::atomic<long> g_unique_counter{0};
+
+// Reads the environment once; an invalid value is ignored.
+void LoadLocked() {
+  if (g_loaded) {
+    return;
+  }
+  g_loaded = true;
+  char value[kMaxLength + 1];
+  DWORD length = GetEnvironmentVariableA(kEnvironmentVariable, value,
+                                         static_cast<DWORD>(sizeof(value)));
+  if (length > 0 && length < sizeof(value) && IsValid(value)) {
+    g_default = value;
+  }
+}
+
+}  // anonymous namespace
+
+bool IsValid(const std::string& ipc_namespace) {
+  if (ipc_namespace.size() > kMaxLength) {
+    return false;
+  }
+  for (char c : ipc_namespace) {
+    bool allowed = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                   (c >= '0' && c <= '9') || c == '-' || c == '_' || c == '.';
+    if (!allowed) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string GetDefault() {
+  std::lock_guard<std::mutex> lock(g_mutex);
+  LoadLocked();
+  return g_default;
+}
+
+bool SetDefault(const std::string& ipc_namespace) {
+  if (!IsValid(ipc_namespace)) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(g_mutex);
+  g_loaded = true;
+  g_default = ipc_namespace;
+  // Child processes (new windows, benchmark workers) inherit the variable
+  SetEnvironmentVariableA(
+      kEnvironmentVariable,
+      ipc_namespace.empty() ? nullptr : ipc_namespace.c_str());
+  return true;
+}
+
+std::string Qualify(const char* name, const std::string& ipc_namespace) {
+  if (ipc_namespace.empty()) {
+    return name;
+  }
+  return std::string(name) + "." + ipc_namespace;
+}
+
+std::string Qualify(const char* name) {
+  return Qualify(name, GetDefault());
+}
+
+std::string MakeUnique(const char* prefix) {
+  return std::string(prefix) + "." + std::to_string(GetCurrentProcessId()) +
+         "." + std::to_string(++g_unique_counter);
+}
+
+}  // namespace ipc_namespace
@@ -0,0 +1,61 @@
+// ipc_namespace.h
+//
+// Instance namespaces for the named kernel objects of the IPC layers.
+//
+// All window processes of one app instance meet in the same named objects:
+// the counter segment, the change event, the buffer pool, and the metrics,
+// trace, log and flight recorder rings. A namespace is appended to every
+// one of those names ("Local\FlutterMultiWindowCounter.<namespace>"), so
+// instances in different namespaces never see each other: test suites
+// under ctest -j, a benchmark next to the running app, or two app profiles
+// side by side. The empty namespace keeps the original names.
+//
+// SharedMemoryManager, WindowCountListener and SharedBufferPool take a
+// namespace at construction; their default constructors use the process
+// default. The process-wide registries and rings use the default in effect
+// when they are first used.
+//
+// The process default starts from the FLUTTER_IPC_NAMESPACE environment
+// variable (the app also accepts --ipc-namespace=<name>). SetDefault()
+// updates the variable too, so child processes join the same instance.
+
+#ifndef RUNNER_IPC_NAMESPACE_H_
+#define RUNNER_IPC_NAMESPACE_H_
+
+#include <cstddef>
+#include <string>
+
+namespace ipc_namespace {
+
+// Environment variable holding the process default namespace.
+constexpr char kEnvironmentVariable[] = "FLUTTER_IPC_NAMESPACE";
+
+// Longest namespace accepted; keeps every object name well below MAX_PATH.
+constexpr size_t kMaxLength = 64;
+
+// True for the empty namespace and for up to kMaxLength letters, digits,
+// '-', '_' and '.'. Backslashes would leave the "Local\" scope.
+bool IsValid(const std::string& ipc_namespace);
+
+// Process default namespace, "" unless set. Thread-safe.
+std::string GetDefault();
+
+// Replaces the process default and exports it to child processes.
+// Returns false, leaving the default unchanged, if the name is invalid.
+bool SetDefault(const std::string& ipc_namespace);
+
+// Object name in a namespace: |name| itself for "", else
+// "<name>.<namespace>".
+std::string Qualify(const char* name, const std::string& ipc_namespace);
+
+// Object name in the process default namespace.
+std::string Qualify(const char* name);
+
+// A namespace no other process and no earlier call in this one has used,
+// "<prefix>.<pid>.<n>". For tests and benchmarks that need a private
+// instance.
+std::string MakeUnique(const char* prefix);
+
+}  // namespace ipc_namespace
+
+#endif  // RUNNER_IPC_NAMESPACE_H_
@@ -0,0 +1,95 @@
+// ipc_poll_handle.cpp
+//
+// Implementation of the pollable window count notification.
+
+#include "ipc_poll_handle.h"
+
+#include <utility>
+
+#include "ipc_log.h"
+#include "ipc_namespace.h"
+
+std::unique_ptr<IpcPollHandle> IpcPollHandle::Open() {
+  return Open(ipc_namespace::GetDefault());
+}
+
+std::unique_ptr<IpcPollHandle> IpcPollHandle::Open(
+    const std::string& ipc_namespace) {
+  std::shared_ptr<IpcRuntime> runtime = IpcRuntime::Acquire(ipc_namespace);
+  if (runtime->shared_memory_manager() == nullptr) {
+    IPC_LOG_ERROR("IpcPollHandle: shared memory unavailable");
+    return nullptr;
+  }
+
+  // Unnamed, auto-reset, initially signaled: the first wait returns at
+  // once so the loop picks up the current state.
+  HANDLE event = CreateEventA(nullptr, FALSE, TRUE, nullptr);
+  if (event == nullptr) {
+    IPC_LOG_ERROR("IpcPollHandle CreateEventA failed: {}", GetLastError());
+    return nullptr;
+  }
+  return std::unique_ptr<IpcPollHandle>(
+      new IpcPollHandle(std::move(runtime), event));
+}
+
+IpcPollHandle::IpcPollHandle(std::shared_ptr<IpcRuntime> runtime, HANDLE event)
+    : runtime_(std::move(runtime)),
+      event_(event),
+      drained_(false),
+      last_sequence_(0) {
+  // Runs on the callback pool; only wakes the loop, which reads the
+  // state itself in Drain().
+  subscription_ = runtime_->Subscribe(
+      [event](const SharedMemorySnapshot& /* snapshot */) { SetEvent(event); });
+}
+
+IpcPollHandle::~IpcPollHandle() {
+  // Once unsubscribed the event is no longer set
+  runtime_->Unsubscribe(subscription_);
+  CloseHandle(event_);
+}
+
+bool IpcPollHandle::Drain(SharedMemorySnapshot* snapshot) {
+  // Reset before reading: a change after the read signals again.
+  ResetEvent(event_);
+
+  SharedMemorySnapshot current{};
+  if (!runtime_->shared_memory_manager()->ReadSnapshot(&current)) {
+    return false;
+  }
+  if (drained_ && current.sequence == last_sequence_) {
+    return false;  // Already reported
+  }
+  drained_ = true;
+  last_sequence_ = current.sequence;
+  *snapshot = current;
+  return true;
+}
+
+// ============================================================================
+// Exports for native plugins
+// ============================================================================
+
+extern "C" {
+
+__declspec(dllexport) IpcPollHandle* OpenIpcPollHandle() {
+  return IpcPollHandle::Open().release();
+}
+
+__declspec(dllexport) HANDLE GetIpcPollHandleEvent(IpcPollHandle* poll) {
+  return poll != nullptr ? poll->handle() : nullptr;
+}
+
+__declspec(dllexport) bool DrainIpcPollHandle(IpcPollHandle* poll,
+                                              SharedMemorySnapshot* snapshot) {
+  if (poll == nullptr || snapshot == nullptr) {
+    return false;
+  }
+  return poll->Drain(snapshot);
+}
+
+__declspec(dllexport) void CloseIpcPollHandle(IpcPollHandle* poll) {
+  delete poll;
+}
+
+}  // extern "C"
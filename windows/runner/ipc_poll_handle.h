@@ -0,0 +1,105 @@
+// ipc_poll_handle.h
+//
+// Window count changes as a waitable handle, for native code that runs its
+// own event loop.
+//
+// WindowCountListener delivers changes on a thread it owns, and IpcRuntime
+// subscribers run on the callback pool; a plugin with a loop of its own
+// would have to hop threads to consume them. IpcPollHandle instead exposes
+// a private auto-reset event that becomes signaled when the shared state
+// changes. The loop adds handle() to its own wait (WaitForMultipleObjects,
+// MsgWaitForMultipleObjects, an IpcReactor, ...) and calls Drain() when it
+// is signaled, or whenever it likes: Drain() never blocks.
+//
+// The handle rides on the process's IpcRuntime, which already listens for
+// changes, so it adds no thread. Several changes between two Drain() calls
+// collapse into one: Drain() returns the latest state, not every step.
+//
+// Example usage:
+//   std::unique_ptr<IpcPollHandle> poll = IpcPollHandle::Open();
+//   HANDLE handles[] = {my_event, poll->handle()};
+//   while (...) {
+//     DWORD r = WaitForMultipleObjects(2, handles, FALSE, INFINITE);
+//     SharedMemorySnapshot snapshot;
+//     if (r == WAIT_OBJECT_0 + 1 && poll->Drain(&snapshot)) {
+//       OnCount(snapshot.window_count);
+//     }
+//   }
+
+#ifndef RUNNER_IPC_POLL_HANDLE_H_
+#define RUNNER_IPC_POLL_HANDLE_H_
+
+#include <windows.h>
+
+#include <memory>
+#include <string>
+
+#include "ipc_runtime.h"
+#include "shared_memory_manager.h"
+
+class IpcPollHandle {
+ public:
+  // Opens a handle on the runtime of the process default IPC namespace.
+  // The handle starts signaled, so the first Drain() reports the current
+  // state.
+  //
+  // Returns nullptr if shared memory or the event is unavailable.
+  static std::unique_ptr<IpcPollHandle> Open();
+
+  // Same, for the given IPC namespace (see ipc_namespace.h).
+  static std::unique_ptr<IpcPollHandle> Open(const std::string& ipc_namespace);
+
+  // Stops notifications and closes the event. Remove handle() from any
+  // wait first.
+  ~IpcPollHandle();
+
+  IpcPollHandle(const IpcPollHandle&) = delete;
+  IpcPollHandle& operator=(const IpcPollHandle&) = delete;
+
+  // Auto-reset event, signaled after each change. Owned by this object:
+  // wait on it, but do not close, set or reset it.
+  HANDLE handle() const { return event_; }
+
+  // Reads the current state without blocking and resets handle().
+  //
+  // Returns true and fills snapshot if the state changed since the last
+  // Drain() (always, on the first call). Returns false if nothing changed,
+  // e.g. after a wakeup for a change an earlier Drain() already returned,
+  // or if the segment could not be read.
+  bool Drain(SharedMemorySnapshot* snapshot);
+
+ private:
+  IpcPollHandle(std::shared_ptr<IpcRuntime> runtime, HANDLE event);
+
+  std::shared_ptr<IpcRuntime> runtime_;  // Keeps the listener running
+  HANDLE event_;                         // Private auto-reset event
+  IpcRuntime::SubscriptionId subscription_;
+  bool drained_;                         // Drain() returned a snapshot
+  LONG last_sequence_;                   // Sequence of that snapshot
+};
+
+// Exports for native plugins, which cannot share the C++ ABI. Resolve with
+// GetProcAddress(GetModuleHandle(nullptr), "OpenIpcPollHandle") etc.
+extern "C" {
+
+/// Export: Open a pollable window count notification.
+///
+/// @return handle, or nullptr if shared memory is unavailable
+__declspec(dllexport) IpcPollHandle* OpenIpcPollHandle();
+
+/// Export: Auto-reset event signaled after each change; owned by poll.
+__declspec(dllexport) HANDLE GetIpcPollHandleEvent(IpcPollHandle* poll);
+
+/// Export: Non-blocking read of the latest state; resets the event.
+///
+/// @param snapshot Receives the state if it changed since the last drain
+/// @return true if snapshot was filled
+__declspec(dllexport) bool DrainIpcPollHandle(IpcPollHandle* poll,
+                                              SharedMemorySnapshot* snapshot);
+
+/// Export: Close a handle from OpenIpcPollHandle(). Accepts nullptr.
+__declspec(dllexport) void CloseIpcPollHandle(IpcPollHandle* poll);
+
+}  // extern "C"
+
+#endif  // RUNNER_IPC_POLL_HANDLE_H_
@@ -0,0 +1,51 @@
+// ipc_probes.cpp
+//
+// ETW provider definition and registration for the IPC static tracepoints.
+// USDT probes live entirely in the instrumented code and need nothing here.
+
+#include "ipc_probes.h"
+
+namespace ipc_probes {
+
+#if defined(IPC_PROBES_BACKEND_ETW)
+
+// GUID derived from the provider name (EventSource convention), so tools
+// can enable it as "*FlutterMultiWindow.Ipc" without knowing the GUID.
+// {7392950c-c402-5d22-7dfc-6d837389dc69}
+TRACELOGGING_DEFINE_PROVIDER(g_provider, "FlutterMultiWindow.Ipc",
+                             (0x7392950c, 0xc402, 0x5d22, 0x7d, 0xfc, 0x6d,
+                              0x83, 0x73, 0x89, 0xdc, 0x69));
+
+namespace {
+// TraceLoggingRegister must not be called twice on one provider.
+volatile LONG g_registered = 0;
+}  // anonymous namespace
+
+bool Register() {
+  if (InterlockedCompareExchange(&g_registered, 1, 0) != 0) {
+    return true;  // Already registered
+  }
+  if (FAILED(TraceLoggingRegister(g_provider))) {
+    InterlockedExchange(&g_registered, 0);
+    return false;
+  }
+  return true;
+}
+
+void Unregister() {
+  if (InterlockedCompareExchange(&g_registered, 0, 1) == 1) {
+    TraceLoggingUnregister(g_provider);
+  }
+}
+
+#else
+
+bool Register() {
+  return true;
+}
+
+void Unregister() {}
+
+#endif
+
+}  // namespace ipc_probes
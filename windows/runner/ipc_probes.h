@@ -0,0 +1,174 @@
+// ipc_probes.h
+//
+// Static tracepoints on the IPC hot paths, for profiling release builds in
+// the field without rebuilding.
+//
+// Windows builds emit TraceLogging (ETW) events from the provider
+// "FlutterMultiWindow.Ipc"; Linux builds with <sys/sdt.h> emit USDT probes
+// of provider "flutter_ipc". Until a tracing session attaches, a probe
+// costs one predictable branch on the provider's enabled state (ETW) or a
+// single nop (USDT), so the probes stay compiled into shipped builds:
+//
+//   wpr / tracelog / PerfView:  *FlutterMultiWindow.Ipc
+//   bpftrace -e 'usdt:./runner:flutter_ipc:dart_post { @[arg4] = count(); }'
+//
+// Define IPC_PROBES_DISABLED to compile every probe out.
+//
+// ETW only evaluates probe arguments while a session listens, so arguments
+// must be free of side effects.
+//
+// Probes (USDT arguments in order; ETW field names in parentheses):
+//   count_change      delta (Delta), new_count (NewCount),
+//                     trace_id (TraceId)
+//   listener_sleep    -
+//   listener_wake     wait_result (WaitResult)
+//   callback_start    -
+//   callback_done     duration_ticks (DurationTicks)
+//   dart_post         port (Port), topic (Topic), value (Value),
+//                     trace_id (TraceId), posted (Posted)
+//   subscriber_add    port (Port), subscriber_count (SubscriberCount)
+//   subscriber_remove port (Port), subscriber_count (SubscriberCount)
+
+#ifndef RUNNER_IPC_PROBES_H_
+#define RUNNER_IPC_PROBES_H_
+
+#include <windows.h>
+
+#include <cstdint>
+
+#if defined(IPC_PROBES_DISABLED)
+#define IPC_PROBES_BACKEND_NONE 1
+#elif defined(_WIN32)
+#include <TraceLoggingProvider.h>
+#define IPC_PROBES_BACKEND_ETW 1
+#elif defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define IPC_PROBES_BACKEND_USDT 1
+#else
+#define IPC_PROBES_BACKEND_NONE 1
+#endif
+#else
+#define IPC_PROBES_BACKEND_NONE 1
+#endif
+
+namespace ipc_probes {
+
+// ETW keywords, one per layer, so a session can enable a subset.
+constexpr uint64_t kKeywordCounter = 0x1;   // SharedMemoryManager
+constexpr uint64_t kKeywordListener = 0x2;  // WindowCountListener
+constexpr uint64_t kKeywordDart = 0x4;      // DartPortManager
+
+#if defined(IPC_PROBES_BACKEND_ETW)
+TRACELOGGING_DECLARE_PROVIDER(g_provider);
+#endif
+
+// Registers the ETW provider. Probes fired before this (or after
+// Unregister()) do nothing. Idempotent; no-op for USDT, which needs no
+// registration.
+//
+// Returns false if ETW registration failed.
+bool Register();
+
+// Unregisters the ETW provider. Call once at process exit.
+void Unregister();
+
+}  // namespace ipc_probes
+
+#if defined(IPC_PROBES_BACKEND_ETW)
+
+// Spelled out per event: TraceLoggingWrite must see its fields directly,
+// which forwarding __VA_ARGS__ through another macro breaks on MSVC.
+#define IPC_PROBE_COUNT_CHANGE(delta, new_count, trace_id)              \
+  TraceLoggingWrite(::ipc_probes::g_provider, "CountChange",            \
+                    TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),          \
+                    TraceLoggingKeyword(::ipc_probes::kKeywordCounter), \
+                    TraceLoggingInt32((delta), "Delta"),                \
+                    TraceLoggingInt32((new_count), "NewCount"),         \
+                    TraceLoggingUInt32((trace_id), "TraceId"))
+#define IPC_PROBE_LISTENER_SLEEP()                                       \
+  TraceLoggingWrite(::ipc_probes::g_provider, "ListenerSleep",           \
+                    TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),           \
+                    TraceLoggingKeyword(::ipc_probes::kKeywordListener))
+#define IPC_PROBE_LISTENER_WAKE(wait_result)                             \
+  TraceLoggingWrite(::ipc_probes::g_provider, "ListenerWake",            \
+                    TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),           \
+                    TraceLoggingKeyword(::ipc_probes::kKeywordListener), \
+                    TraceLoggingUInt32((wait_result), "WaitResult"))
+#define IPC_PROBE_CALLBACK_START()                                       \
+  TraceLoggingWrite(::ipc_probes::g_provider, "CallbackStart",           \
+                    TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),           \
+                    TraceLoggingKeyword(::ipc_probes::kKeywordListener))
+#define IPC_PROBE_CALLBACK_DONE(duration_ticks)                           \
+  TraceLoggingWrite(::ipc_probes::g_provider, "CallbackDone",             \
+                    TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),            \
+                    TraceLoggingKeyword(::ipc_probes::kKeywordListener),  \
+                    TraceLoggingInt64((duration_ticks), "DurationTicks"))
+#define IPC_PROBE_DART_POST(port, topic, value, trace_id, posted)    \
+  TraceLoggingWrite(::ipc_probes::g_provider, "DartPost",            \
+                    TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),       \
+                    TraceLoggingKeyword(::ipc_probes::kKeywordDart), \
+                    TraceLoggingInt64((port), "Port"),               \
+                    TraceLoggingUInt32((topic), "Topic"),            \
+                    TraceLoggingInt32((value), "Value"),             \
+                    TraceLoggingUInt32((trace_id), "TraceId"),       \
+                    TraceLoggingBool((posted), "Posted"))
+#define IPC_PROBE_SUBSCRIBER_ADD(port, subscriber_count)                       \
+  TraceLoggingWrite(::ipc_probes::g_provider, "SubscriberAdd",                 \
+                    TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),                 \
+                    TraceLoggingKeyword(::ipc_probes::kKeywordDart),           \
+                    TraceLoggingInt64((port), "Port"),                         \
+                    TraceLoggingUInt64((subscriber_count), "SubscriberCount"))
+#define IPC_PROBE_SUBSCRIBER_REMOVE(port, subscriber_count)                    \
+  TraceLoggingWrite(::ipc_probes::g_provider, "SubscriberRemove",              \
+                    TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),                 \
+                    TraceLoggingKeyword(::ipc_probes::kKeywordDart),           \
+                    TraceLoggingInt64((port), "Port"),                         \
+                    TraceLoggingUInt64((subscriber_count), "SubscriberCount"))
+
+#elif defined(IPC_PROBES_BACKEND_USDT)
+
+// Casts pin the argument widths bpftrace sees, whatever the caller's types.
+#define IPC_PROBE_COUNT_CHANGE(delta, new_count, trace_id) \
+  DTRACE_PROBE3(flutter_ipc, count_change,                 \
+                static_cast<int32_t>(delta),               \
+                static_cast<int32_t>(new_count),           \
+                static_cast<uint32_t>(trace_id))
+#define IPC_PROBE_LISTENER_SLEEP() DTRACE_PROBE(flutter_ipc, listener_sleep)
+#define IPC_PROBE_LISTENER_WAKE(wait_result)        \
+  DTRACE_PROBE1(flutter_ipc, listener_wake,         \
+                static_cast<uint32_t>(wait_result))
+#define IPC_PROBE_CALLBACK_START() DTRACE_PROBE(flutter_ipc, callback_start)
+#define IPC_PROBE_CALLBACK_DONE(duration_ticks)       \
+  DTRACE_PROBE1(flutter_ipc, callback_done,           \
+                static_cast<int64_t>(duration_ticks))
+#define IPC_PROBE_DART_POST(port, topic, value, trace_id, posted) \
+  DTRACE_PROBE5(flutter_ipc, dart_post,                           \
+                static_cast<int64_t>(port),                       \
+                static_cast<uint32_t>(topic),                     \
+                static_cast<int32_t>(value),                      \
+                static_cast<uint32_t>(trace_id),                  \
+                static_cast<int32_t>((posted) ? 1 : 0))
+#define IPC_PROBE_SUBSCRIBER_ADD(port, subscriber_count) \
+  DTRACE_PROBE2(flutter_ipc, subscriber_add,             \
+                static_cast<int64_t>(port),              \
+                static_cast<uint64_t>(subscriber_count))
+#define IPC_PROBE_SUBSCRIBER_REMOVE(port, subscriber_count) \
+  DTRACE_PROBE2(flutter_ipc, subscriber_remove,             \
+                static_cast<int64_t>(port),                 \
+                static_cast<uint64_t>(subscriber_count))
+
+#else  // IPC_PROBES_BACKEND_NONE
+
+#define IPC_PROBE_COUNT_CHANGE(delta, new_count, trace_id) ((void)0)
+#define IPC_PROBE_LISTENER_SLEEP() ((void)0)
+#define IPC_PROBE_LISTENER_WAKE(wait_result) ((void)0)
+#define IPC_PROBE_CALLBACK_START() ((void)0)
+#define IPC_PROBE_CALLBACK_DONE(duration_ticks) ((void)0)
+#define IPC_PROBE_DART_POST(port, topic, value, trace_id, posted) ((void)0)
+#define IPC_PROBE_SUBSCRIBER_ADD(port, subscriber_count) ((void)0)
+#define IPC_PROBE_SUBSCRIBER_REMOVE(port, subscriber_count) ((void)0)
+
+#endif
+
+#endif  // RUNNER_IPC_PROBES_H_
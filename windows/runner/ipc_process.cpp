@@ -0,0 +1,21 @@
+// ipc_process.cpp
+//
+// Implementation of the process liveness checks.
+
+#include "ipc_process.h"
+
+namespace ipc_process {
+
+bool IsProcessGone(DWORD pid) {
+  HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+  if (process == nullptr) {
+    return true;
+  }
+  DWORD exit_code = 0;
+  bool gone = GetExitCodeProcess(process, &exit_code) &&
+              exit_code != STILL_ACTIVE;
+  CloseHandle(process);
+  return gone;
+}
+
+}  // namespace ipc_process
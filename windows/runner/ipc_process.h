@@ -0,0 +1,23 @@
+// ipc_process.h
+//
+// Liveness checks on other window processes.
+//
+// The shared tables of the IPC layers (buffer pool slots and receivers,
+// metrics slots, topic board slots) record owners by process ID. A window
+// that crashes never clears its entries, so whoever needs one back first
+// asks whether its owner is still running.
+
+#ifndef RUNNER_IPC_PROCESS_H_
+#define RUNNER_IPC_PROCESS_H_
+
+#include <windows.h>
+
+namespace ipc_process {
+
+// Returns true if the process has exited (or never existed). A process
+// that cannot be opened counts as gone.
+bool IsProcessGone(DWORD pid);
+
+}  // namespace ipc_process
+
+#endif  // RUNNER_IPC_PROCESS_H_
@@ -0,0 +1,343 @@
+// ipc_reactor.cpp
+//
+// Implementation of the IPC reactor thread.
+
+#include "ipc_reactor.h"
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+#include "ipc_log.h"
+
+namespace {
+
+constexpr DWORD kFailureBackoffMs = 1000;
+
+// The process's shared reactor, see IpcReactor::Acquire().
+std::mutex g_reactor_mutex;
+std::weak_ptr<IpcReactor> g_reactor;
+
+void Invoke(const IpcReactorHandler& handler) {
+  try {
+    handler();
+  } catch (const std::exception& e) {
+    IPC_LOG_ERROR("IPC reactor handler threw exception: {}", e.what());
+  } catch (...) {
+    IPC_LOG_ERROR("IPC reactor handler threw unknown exception");
+  }
+}
+
+// Erases the registration with the given ID. Returns true if found.
+template <typename Registrations, typename Id>
+bool EraseById(Registrations* registrations, Id id) {
+  auto it = std::find_if(registrations->begin(), registrations->end(),
+                         [id](const auto& r) { return r.id == id; });
+  if (it == registrations->end()) {
+    return false;
+  }
+  registrations->erase(it);
+  return true;
+}
+
+}  // anonymous namespace
+
+std::shared_ptr<IpcReactor> IpcReactor::Acquire() {
+  std::lock_guard<std::mutex> lock(g_reactor_mutex);
+  std::shared_ptr<IpcReactor> reactor = g_reactor.lock();
+  if (!reactor) {
+    reactor = std::make_shared<IpcReactor>();
+    if (!reactor->Start()) {
+      return nullptr;
+    }
+    g_reactor = reactor;
+  }
+  return reactor;
+}
+
+IpcReactor::IpcReactor()
+    : wake_event_(nullptr),
+      is_running_(false),
+      thread_id_(0),
+      next_id_(1),
+      changes_(0),
+      changes_applied_(0) {}
+
+IpcReactor::~IpcReactor() {
+  Stop();
+  if (wake_event_) {
+    CloseHandle(wake_event_);
+    wake_event_ = nullptr;
+  }
+}
+
+bool IpcReactor::Start() {
+  if (is_running_) {
+    return true;  // Idempotent - already started
+  }
+
+  if (wake_event_ == nullptr) {
+    // Unnamed auto-reset event: private to this reactor
+    wake_event_ = CreateEventA(nullptr, FALSE, FALSE, nullptr);
+    if (wake_event_ == nullptr) {
+      IPC_LOG_ERROR("IPC reactor CreateEventA failed: {}", GetLastError());
+      return false;
+    }
+  }
+
+  is_running_ = true;
+  reactor_thread_ = std::thread(&IpcReactor::ReactorThreadFunction, this);
+  IPC_LOG_INFO("IPC reactor started");
+  return true;
+}
+
+void IpcReactor::Stop() {
+  if (!is_running_) {
+    return;  // Not running, nothing to stop
+  }
+
+  is_running_ = false;
+  Wake();
+  if (reactor_thread_.joinable()) {
+    reactor_thread_.join();
+  }
+  thread_id_ = 0;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    posted_.clear();
+  }
+  // Release Remove() calls that raced with Stop()
+  applied_.notify_all();
+  IPC_LOG_INFO("IPC reactor stopped");
+}
+
+bool IpcReactor::IsRunning() const {
+  return is_running_;
+}
+
+bool IpcReactor::IsReactorThread() const {
+  return thread_id_ == GetCurrentThreadId();
+}
+
+IpcReactor::HandlerId IpcReactor::AddHandle(HANDLE handle,
+                                            IpcReactorHandler handler) {
+  HandlerId id;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (handles_.size() >= kMaxHandles) {
+      IPC_LOG_ERROR("IPC reactor: wait set full ({} handles)", kMaxHandles);
+      return kInvalidHandler;
+    }
+    id = next_id_++;
+    handles_.push_back(
+        {id, handle, 0, 0,
+         std::make_shared<IpcReactorHandler>(std::move(handler))});
+  }
+  Wake();
+  return id;
+}
+
+IpcReactor::HandlerId IpcReactor::AddTimer(DWORD interval_ms,
+                                           IpcReactorHandler handler) {
+  HandlerId id;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    id = next_id_++;
+    interval_ms = std::max<DWORD>(interval_ms, 1);
+    timers_.push_back(
+        {id, nullptr, interval_ms, GetTickCount64() + interval_ms,
+         std::make_shared<IpcReactorHandler>(std::move(handler))});
+  }
+  Wake();  // The new timer may be due before the current wait ends
+  return id;
+}
+
+bool IpcReactor::Post(IpcReactorHandler task) {
+  if (!is_running_) {
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    posted_.push_back(std::move(task));
+  }
+  Wake();
+  return true;
+}
+
+void IpcReactor::Remove(HandlerId id) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!EraseById(&handles_, id) && !EraseById(&timers_, id)) {
+    return;  // Unknown or already removed
+  }
+  if (!is_running_ || IsReactorThread()) {
+    return;  // Dispatch() checks the registration before every call
+  }
+
+  // Wait until the reactor has finished its current iteration and built a
+  // wait set without the handle.
+  uint64_t change = ++changes_;
+  Wake();
+  applied_.wait(lock, [this, change] {
+    return changes_applied_ >= change || !is_running_;
+  });
+}
+
+size_t IpcReactor::GetHandleCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return handles_.size();
+}
+
+size_t IpcReactor::GetTimerCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return timers_.size();
+}
+
+void IpcReactor::ReactorThreadFunction() {
+  thread_id_ = GetCurrentThreadId();
+  IPC_LOG_DEBUG("IPC reactor thread started");
+
+  HANDLE wait_handles[MAXIMUM_WAIT_OBJECTS];
+  HandlerId ids[MAXIMUM_WAIT_OBJECTS];
+  while (is_running_) {
+    // Rebuild the wait set; slot 0 is the reactor's own wake event
+    DWORD count = 0;
+    wait_handles[count] = wake_event_;
+    ids[count++] = kInvalidHandler;
+    DWORD timeout;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (const Registration& r : handles_) {
+        wait_handles[count] = r.handle;
+        ids[count++] = r.id;
+      }
+      timeout = GetWaitTimeout();
+      changes_applied_ = changes_;
+    }
+    applied_.notify_all();
+
+    DWORD result = WaitForMultipleObjects(count, wait_handles, FALSE, timeout);
+    if (!is_running_) {
+      break;  // Stop requested
+    }
+
+    if (result > WAIT_OBJECT_0 && result < WAIT_OBJECT_0 + count) {
+      DWORD first = result - WAIT_OBJECT_0;
+      Dispatch(ids[first]);
+      // The wait reports only the lowest signaled handle; serve the later
+      // ones now so a busy handle cannot starve them.
+      for (DWORD i = first + 1; i < count; i++) {
+        if (IsRegistered(ids[i]) &&
+            WaitForSingleObject(wait_handles[i], 0) == WAIT_OBJECT_0) {
+          Dispatch(ids[i]);
+        }
+      }
+    } else if (result == WAIT_FAILED) {
+      DWORD error = GetLastError();
+      if (DropInvalidHandles() == 0) {
+        // Keep serving Remove() and Stop(); retry after a pause
+        IPC_LOG_ERROR("IPC reactor wait failed: {}", error);
+        Sleep(kFailureBackoffMs);
+      }
+    }
+
+    RunDueTimers();
+    RunPostedTasks();
+  }
+
+  IPC_LOG_DEBUG("IPC reactor thread exiting");
+}
+
+void IpcReactor::Dispatch(HandlerId id) {
+  std::shared_ptr<IpcReactorHandler> handler;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto* registrations : {&handles_, &timers_}) {
+      for (const Registration& r : *registrations) {
+        if (r.id == id) {
+          handler = r.handler;
+        }
+      }
+    }
+  }
+  if (handler) {
+    Invoke(*handler);
+  }
+}
+
+bool IpcReactor::IsRegistered(HandlerId id) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return std::any_of(handles_.begin(), handles_.end(),
+                     [id](const Registration& r) { return r.id == id; });
+}
+
+DWORD IpcReactor::GetWaitTimeout() const {
+  // Called with mutex_ held.
+  if (timers_.empty()) {
+    return INFINITE;
+  }
+  ULONGLONG now = GetTickCount64();
+  ULONGLONG next = timers_.front().due_ticks;
+  for (const Registration& r : timers_) {
+    next = std::min(next, r.due_ticks);
+  }
+  if (next <= now) {
+    return 0;
+  }
+  return static_cast<DWORD>(
+      std::min<ULONGLONG>(next - now, static_cast<ULONGLONG>(INFINITE - 1)));
+}
+
+void IpcReactor::RunDueTimers() {
+  std::vector<HandlerId> due;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ULONGLONG now = GetTickCount64();
+    for (Registration& r : timers_) {
+      if (r.due_ticks > now) {
+        continue;
+      }
+      due.push_back(r.id);
+      r.due_ticks += r.interval_ms;
+      if (r.due_ticks <= now) {
+        r.due_ticks = now + r.interval_ms;  // Fell behind; do not catch up
+      }
+    }
+  }
+  for (HandlerId id : due) {
+    Dispatch(id);
+  }
+}
+
+void IpcReactor::RunPostedTasks() {
+  std::deque<IpcReactorHandler> tasks;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks.swap(posted_);
+  }
+  for (const IpcReactorHandler& task : tasks) {
+    Invoke(task);
+  }
+}
+
+size_t IpcReactor::DropInvalidHandles() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t dropped = 0;
+  for (auto it = handles_.begin(); it != handles_.end();) {
+    DWORD flags = 0;
+    if (GetHandleInformation(it->handle, &flags)) {
+      ++it;
+      continue;
+    }
+    IPC_LOG_ERROR("IPC reactor dropped invalid handle (handler {})", it->id);
+    it = handles_.erase(it);
+    dropped++;
+  }
+  return dropped;
+}
+
+void IpcReactor::Wake() {
+  if (wake_event_) {
+    SetEvent(wake_event_);
+  }
+}
@@ -0,0 +1,156 @@
+// ipc_reactor.h
+//
+// One thread that waits on many IPC notification sources at once.
+//
+// WindowCountListener and the SharedBufferPool receiver each used to own a
+// thread blocked on a single event, so every new kind of notification
+// would add another thread to the process. IpcReactor waits on up to
+// kMaxHandles handles with WaitForMultipleObjects, together with interval
+// timers and tasks posted from other threads, and runs the registered
+// handler of whatever became ready. The thread count stays at one however
+// many sources are registered.
+//
+// Handlers run on the reactor thread, one at a time, so a slow handler
+// delays every other source: keep them short. Handlers of manual-reset
+// events must reset the event themselves.
+//
+// Example usage:
+//   std::shared_ptr<IpcReactor> reactor = IpcReactor::Acquire();
+//   IpcReactor::HandlerId id = reactor->AddHandle(event, [] { ... });
+//   ...
+//   reactor->Remove(id);  // Before closing the event
+//   CloseHandle(event);
+
+#ifndef RUNNER_IPC_REACTOR_H_
+#define RUNNER_IPC_REACTOR_H_
+
+#include <windows.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Called on the reactor thread when a handle is signaled, a timer is due
+// or a posted task runs.
+using IpcReactorHandler = std::function<void()>;
+
+class IpcReactor {
+ public:
+  using HandlerId = uint64_t;
+
+  static constexpr HandlerId kInvalidHandler = 0;
+
+  // One wait slot is the reactor's own wake event.
+  static constexpr DWORD kMaxHandles = MAXIMUM_WAIT_OBJECTS - 1;
+
+  // Returns the process's shared reactor, starting it for the first user.
+  // It stops when the last user drops its reference. Returns nullptr if
+  // the reactor thread cannot be started.
+  static std::shared_ptr<IpcReactor> Acquire();
+
+  // Constructs a stopped reactor with no registrations.
+  IpcReactor();
+
+  // Stops the reactor thread.
+  ~IpcReactor();
+
+  IpcReactor(const IpcReactor&) = delete;
+  IpcReactor& operator=(const IpcReactor&) = delete;
+
+  // Starts the reactor thread. Registrations made before Start() take
+  // effect immediately.
+  //
+  // Returns true on success. Safe to call multiple times (idempotent).
+  bool Start();
+
+  // Stops and joins the reactor thread. Registrations are kept; tasks
+  // posted but not yet run are discarded. Must not be called from a
+  // handler.
+  void Stop();
+
+  // Returns true if the reactor thread is running.
+  bool IsRunning() const;
+
+  // Returns true on the reactor thread, i.e. inside a handler.
+  bool IsReactorThread() const;
+
+  // Runs handler each time handle is signaled. The handle must stay open
+  // until Remove() returns.
+  //
+  // Returns kInvalidHandler if kMaxHandles handles are already registered.
+  HandlerId AddHandle(HANDLE handle, IpcReactorHandler handler);
+
+  // Runs handler every interval_ms milliseconds. Timers have the
+  // resolution of GetTickCount64() and never fire twice to catch up.
+  HandlerId AddTimer(DWORD interval_ms, IpcReactorHandler handler);
+
+  // Runs task once on the reactor thread.
+  //
+  // Returns false if the reactor is not running.
+  bool Post(IpcReactorHandler task);
+
+  // Removes a handle or timer. Once this returns the handler is not
+  // running and will not be called again, and the reactor no longer waits
+  // on its handle. From a handler, removal takes effect at once without
+  // waiting. Unknown IDs are ignored.
+  void Remove(HandlerId id);
+
+  size_t GetHandleCount() const;
+  size_t GetTimerCount() const;
+
+ private:
+  struct Registration {
+    HandlerId id;
+    HANDLE handle;        // nullptr for timers
+    DWORD interval_ms;    // Timers only
+    ULONGLONG due_ticks;  // Timers only, GetTickCount64() time
+    std::shared_ptr<IpcReactorHandler> handler;  // Shared with Dispatch()
+  };
+
+  // Wait loop: rebuild the wait set, wait, dispatch, repeat.
+  void ReactorThreadFunction();
+
+  // Runs the handler of a registration that is still present.
+  void Dispatch(HandlerId id);
+
+  // Returns true if id is still registered.
+  bool IsRegistered(HandlerId id) const;
+
+  // Milliseconds until the next timer is due, or INFINITE.
+  DWORD GetWaitTimeout() const;
+
+  // Runs and reschedules every due timer.
+  void RunDueTimers();
+
+  // Runs the tasks posted since the last iteration.
+  void RunPostedTasks();
+
+  // Drops handles the wait rejected, e.g. closed without Remove().
+  // Returns the number dropped.
+  size_t DropInvalidHandles();
+
+  // Wakes the reactor so it rebuilds its wait set.
+  void Wake();
+
+  HANDLE wake_event_;                 // Auto-reset, slot 0 of every wait
+  std::thread reactor_thread_;        // The one reactor thread
+  std::atomic<bool> is_running_;      // Thread running flag
+  std::atomic<DWORD> thread_id_;      // Reactor thread ID while running
+
+  mutable std::mutex mutex_;          // Guards everything below
+  std::condition_variable applied_;   // Signaled when a wait set is built
+  std::vector<Registration> handles_;
+  std::vector<Registration> timers_;
+  std::deque<IpcReactorHandler> posted_;
+  HandlerId next_id_;
+  uint64_t changes_;                  // Registration changes requested
+  uint64_t changes_applied_;          // Changes the wait set reflects
+};
+
+#endif  // RUNNER_IPC_REACTOR_H_
@@ -0,0 +1,426 @@
+// ipc_runtime.cpp
+//
+// Implementation of the per-process IPC runtime.
+
+#include "ipc_runtime.h"
+
+#include <atomic>
+#include <exception>
+#include <map>
+#include <utility>
+
+#include "dart_port_manager.h"
+#include "ipc_log.h"
+#include "ipc_metrics.h"
+#include "ipc_namespace.h"
+#include "ipc_trace.h"
+#include "shared_buffer_pool.h"
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+namespace {
+
+// Deliveries queued behind the running one. One is enough: a queued
+// delivery reads the latest state when it runs.
+constexpr size_t kDeliveryQueueCapacity = 1;
+
+// Runtimes by namespace. Guards creation, so two windows opening at once
+// share one runtime, and the published Dart view.
+std::mutex g_runtimes_mutex;
+std::map<std::string, std::weak_ptr<IpcRuntime>> g_runtimes;
+
+// Runtime whose manager backs the GetSharedMemoryView FFI export.
+const IpcRuntime* g_published_runtime = nullptr;
+
+std::atomic<int> g_live_count{0};
+
+// Policy of new runtimes, see IpcRuntime::SetDefaultDeliveryPolicy().
+// Separate from g_runtimes_mutex, which Start() runs under.
+std::mutex g_delivery_mutex;
+bool g_delivery_loaded = false;  // g_delivery read from the environment
+IpcDeliveryPolicy g_delivery;
+
+int64_t TicksPerSecond() {
+  LARGE_INTEGER frequency;
+  QueryPerformanceFrequency(&frequency);
+  return frequency.QuadPart;
+}
+
+// High resolution where available (Windows 10 1803+): a normal timer
+// fires on the ~15.6 ms system tick, too coarse for a frame clock.
+HANDLE CreateDeliveryTimer() {
+  HANDLE timer = CreateWaitableTimerExW(
+      nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+      TIMER_ALL_ACCESS);
+  if (timer == nullptr) {
+    timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+  }
+  return timer;
+}
+
+ipc_metrics::Counter MergedCounter(IpcDeliveryMode mode) {
+  switch (mode) {
+    case IpcDeliveryMode::kDebounce:
+      return ipc_metrics::kMetricDebounceMerged;
+    case IpcDeliveryMode::kFrameAligned:
+      return ipc_metrics::kMetricFrameMerged;
+    default:
+      return ipc_metrics::kMetricCoalesceMerged;
+  }
+}
+
+}  // anonymous namespace
+
+std::shared_ptr<IpcRuntime> IpcRuntime::Acquire() {
+  return Acquire(ipc_namespace::GetDefault());
+}
+
+std::shared_ptr<IpcRuntime> IpcRuntime::Acquire(
+    const std::string& ipc_namespace) {
+  std::lock_guard<std::mutex> lock(g_runtimes_mutex);
+  std::shared_ptr<IpcRuntime> runtime = g_runtimes[ipc_namespace].lock();
+  if (!runtime) {
+    runtime.reset(new IpcRuntime(ipc_namespace));
+    runtime->Start();
+    g_runtimes[ipc_namespace] = runtime;
+  }
+  return runtime;
+}
+
+int IpcRuntime::GetLiveCount() {
+  return g_live_count.load();
+}
+
+IpcRuntime::IpcRuntime(std::string ipc_namespace)
+    : ipc_namespace_(std::move(ipc_namespace)),
+      is_default_namespace_(ipc_namespace_ == ipc_namespace::GetDefault()),
+      delivery_timer_(nullptr),
+      delivery_timer_handler_(IpcReactor::kInvalidHandler),
+      delivery_scheduler_(IpcDeliveryPolicy::Immediate(), TicksPerSecond()),
+      flush_pending_(false),
+      next_subscription_id_(1) {
+  g_live_count++;
+}
+
+IpcRuntime::~IpcRuntime() {
+  {
+    std::lock_guard<std::mutex> lock(g_runtimes_mutex);
+    if (g_published_runtime == this) {
+      SetGlobalSharedMemoryManager(nullptr);
+      g_published_runtime = nullptr;
+    }
+    // A new runtime may already have replaced this one
+    auto it = g_runtimes.find(ipc_namespace_);
+    if (it != g_runtimes.end() && it->second.expired()) {
+      g_runtimes.erase(it);
+    }
+  }
+
+  // The timer and the listener go first: both deliver through the manager.
+  if (delivery_timer_handler_ != IpcReactor::kInvalidHandler) {
+    reactor_->Remove(delivery_timer_handler_);
+  }
+  if (delivery_timer_ != nullptr) {
+    CancelWaitableTimer(delivery_timer_);
+    CloseHandle(delivery_timer_);
+    delivery_timer_ = nullptr;
+  }
+  if (window_count_listener_) {
+    window_count_listener_->Stop();
+  }
+  // Nothing queues deliveries now; wait for a running one
+  if (delivery_queue_) {
+    delivery_queue_->Close();
+  }
+
+  // Stop receiving shared buffers; unclaimed buffers targeted at this
+  // process are reclaimed by other windows once it exits. The receiver
+  // belongs to the default namespace, like the Dart view.
+  if (is_default_namespace_) {
+    GetGlobalSharedBufferPool().StopReceiving();
+  }
+
+  window_count_listener_.reset();
+  delivery_queue_.reset();
+  shared_memory_manager_.reset();
+  reactor_.reset();
+  g_live_count--;
+  IPC_LOG_INFO("IPC runtime stopped");
+}
+
+void IpcRuntime::Start() {
+  shared_memory_manager_ =
+      std::make_unique<SharedMemoryManager>(ipc_namespace_);
+  if (!shared_memory_manager_->Initialize()) {
+    IPC_LOG_ERROR("Failed to initialize SharedMemoryManager");
+    // Continue anyway - shared memory is not critical for basic functionality
+    shared_memory_manager_.reset();
+  } else if (is_default_namespace_) {
+    // Expose the read-only view to Dart (GetSharedMemoryView FFI export).
+    // Called with g_runtimes_mutex held.
+    SetGlobalSharedMemoryManager(shared_memory_manager_.get());
+    g_published_runtime = this;
+  }
+
+  delivery_queue_ = std::make_unique<IpcCallbackQueue>(
+      IpcCallbackExecutor::Acquire(), kDeliveryQueueCapacity);
+
+  // One listener for every window of the process
+  window_count_listener_ =
+      std::make_unique<WindowCountListener>(ipc_namespace_);
+  window_count_listener_->SetCallback(
+      [this](LONG /* placeholder */) { OnCountChanged(); });
+  // On the shared reactor if there is one, else on a thread of its own
+  reactor_ = IpcReactor::Acquire();
+  bool started = reactor_ ? window_count_listener_->Start(reactor_.get())
+                          : window_count_listener_->Start();
+  if (!started) {
+    IPC_LOG_ERROR("Failed to start WindowCountListener");
+    // Continue anyway - listener is not critical for basic functionality
+  }
+
+  // Held deliveries need the reactor to time them
+  if (reactor_) {
+    delivery_timer_ = CreateDeliveryTimer();
+    if (delivery_timer_ == nullptr) {
+      IPC_LOG_ERROR("CreateWaitableTimerExW failed: {}", GetLastError());
+    } else {
+      delivery_timer_handler_ =
+          reactor_->AddHandle(delivery_timer_, [this] { OnDeliveryTimer(); });
+    }
+  }
+  IpcDeliveryPolicy policy = GetDefaultDeliveryPolicy();
+  if (!(policy == IpcDeliveryPolicy::Immediate())) {
+    SetDeliveryPolicy(policy);
+  }
+  IPC_LOG_INFO("IPC runtime started");
+}
+
+bool IpcRuntime::IsListening() const {
+  return window_count_listener_ && window_count_listener_->IsRunning();
+}
+
+IpcRuntime::SubscriptionId IpcRuntime::Subscribe(
+    IpcRuntimeSubscriber subscriber) {
+  std::lock_guard<std::mutex> lock(subscribers_mutex_);
+  SubscriptionId id = next_subscription_id_++;
+  subscribers_.emplace_back(id, std::move(subscriber));
+  return id;
+}
+
+void IpcRuntime::Unsubscribe(SubscriptionId id) {
+  std::lock_guard<std::mutex> lock(subscribers_mutex_);
+  for (auto it = subscribers_.begin(); it != subscribers_.end(); ++it) {
+    if (it->first == id) {
+      subscribers_.erase(it);
+      return;
+    }
+  }
+}
+
+size_t IpcRuntime::GetSubscriberCount() const {
+  std::lock_guard<std::mutex> lock(subscribers_mutex_);
+  return subscribers_.size();
+}
+
+bool IpcRuntime::SetDeliveryPolicy(const IpcDeliveryPolicy& policy) {
+  if (policy.mode != IpcDeliveryMode::kImmediate &&
+      delivery_timer_handler_ == IpcReactor::kInvalidHandler) {
+    IPC_LOG_WARN("IPC runtime has no delivery timer; delivering immediately");
+    return false;
+  }
+  bool flush;
+  {
+    std::lock_guard<std::mutex> lock(delivery_mutex_);
+    flush = delivery_scheduler_.deadline() != 0;
+    delivery_scheduler_ = IpcDeliveryScheduler(policy, TicksPerSecond());
+    flush_pending_ = flush_pending_ || flush;
+  }
+  if (flush) {
+    ArmDeliveryTimer(0);  // Fires at once
+  }
+  IPC_LOG_INFO("IPC runtime delivery policy: {}",
+               FormatDeliveryPolicy(policy));
+  return true;
+}
+
+IpcDeliveryPolicy IpcRuntime::GetDeliveryPolicy() const {
+  std::lock_guard<std::mutex> lock(delivery_mutex_);
+  return delivery_scheduler_.policy();
+}
+
+bool IpcRuntime::SetDefaultDeliveryPolicy(const IpcDeliveryPolicy& policy) {
+  {
+    std::lock_guard<std::mutex> lock(g_delivery_mutex);
+    g_delivery_loaded = true;
+    g_delivery = policy;
+  }
+
+  // Applied outside g_runtimes_mutex: dropping the last reference to a
+  // runtime here would run its destructor, which takes the mutex.
+  std::vector<std::shared_ptr<IpcRuntime>> live;
+  {
+    std::lock_guard<std::mutex> lock(g_runtimes_mutex);
+    for (const auto& entry : g_runtimes) {
+      if (std::shared_ptr<IpcRuntime> runtime = entry.second.lock()) {
+        live.push_back(std::move(runtime));
+      }
+    }
+  }
+  bool ok = true;
+  for (const std::shared_ptr<IpcRuntime>& runtime : live) {
+    ok = runtime->SetDeliveryPolicy(policy) && ok;
+  }
+  return ok;
+}
+
+IpcDeliveryPolicy IpcRuntime::GetDefaultDeliveryPolicy() {
+  std::lock_guard<std::mutex> lock(g_delivery_mutex);
+  if (!g_delivery_loaded) {
+    g_delivery_loaded = true;
+    g_delivery = GetEnvironmentDeliveryPolicy();
+  }
+  return g_delivery;
+}
+
+void IpcRuntime::OnCountChanged() {
+  // Ends the wake trace stage here, on the listener's thread; the
+  // delivery reads the state again when it runs.
+  ReadLatest();
+
+  IpcDeliveryScheduler::Action action;
+  IpcDeliveryMode mode;
+  int64_t deadline;
+  {
+    std::lock_guard<std::mutex> lock(delivery_mutex_);
+    action = delivery_scheduler_.OnChange(ipc_trace::Now());
+    mode = delivery_scheduler_.policy().mode;
+    deadline = delivery_scheduler_.deadline();
+  }
+
+  switch (action) {
+    case IpcDeliveryScheduler::kDeliverNow:
+      QueueDelivery();
+      break;
+    case IpcDeliveryScheduler::kScheduled:
+      ArmDeliveryTimer(deadline);
+      break;
+    case IpcDeliveryScheduler::kMerged:
+      ipc_metrics::Increment(MergedCounter(mode));
+      if (mode == IpcDeliveryMode::kDebounce) {
+        ArmDeliveryTimer(deadline);  // The quiet period starts over
+      }
+      break;
+  }
+}
+
+void IpcRuntime::OnDeliveryTimer() {
+  bool deliver;
+  int64_t deadline;
+  {
+    std::lock_guard<std::mutex> lock(delivery_mutex_);
+    deliver = delivery_scheduler_.OnDeadline(ipc_trace::Now());
+    deliver = deliver || flush_pending_;
+    flush_pending_ = false;
+    deadline = delivery_scheduler_.deadline();
+  }
+  if (deliver) {
+    QueueDelivery();
+  } else if (deadline != 0) {
+    ArmDeliveryTimer(deadline);  // Fired early
+  }
+}
+
+void IpcRuntime::ArmDeliveryTimer(int64_t deadline) {
+  // Relative due time in 100 ns units; never zero, which means absolute
+  int64_t remaining = deadline - ipc_trace::Now();
+  int64_t hundred_ns =
+      remaining > 0 ? remaining * 10000000 / TicksPerSecond() : 0;
+  LARGE_INTEGER due;
+  due.QuadPart = -(hundred_ns > 0 ? hundred_ns : 1);
+  if (!SetWaitableTimer(delivery_timer_, &due, 0, nullptr, nullptr, FALSE)) {
+    IPC_LOG_ERROR("SetWaitableTimer failed: {}", GetLastError());
+  }
+}
+
+SharedMemorySnapshot IpcRuntime::ReadLatest() {
+  // Read count, writer and trace ID of the same write from shared memory
+  SharedMemorySnapshot snapshot{};
+  SharedMemoryManager* manager = shared_memory_manager_.get();
+  if (manager != nullptr && !manager->ReadSnapshot(&snapshot)) {
+    snapshot.window_count = manager->GetWindowCount();
+    snapshot.last_writer_pid = manager->GetLastWriterProcessId();
+  }
+  ipc_trace::EndDeferred(snapshot.trace_id);
+  return snapshot;
+}
+
+void IpcRuntime::QueueDelivery() {
+  // Read when the delivery runs, so a collapsed one still carries the
+  // latest state.
+  delivery_queue_->Submit([this] { Deliver(ReadLatest()); });
+}
+
+void IpcRuntime::Deliver(const SharedMemorySnapshot& snapshot) {
+  LONG current_count = snapshot.window_count;
+  {
+    ipc_trace::Span span(ipc_trace::kStageCallback, snapshot.trace_id);
+    IPC_LOG_DEBUG("Callback triggered: current_count = {}", current_count);
+
+    // Update global count for new port registrations
+    SetCurrentWindowCount(current_count);
+
+    // Notify all registered Dart isolates (Layer 3) once for the whole
+    // process. The writer's process ID lets ports filter out changes made
+    // by their own window.
+    GetGlobalDartPortManager().NotifyWindowCountChanged(
+        current_count, snapshot.last_writer_pid, snapshot.trace_id);
+  }
+
+  std::lock_guard<std::mutex> lock(subscribers_mutex_);
+  for (const auto& entry : subscribers_) {
+    try {
+      entry.second(snapshot);
+    } catch (const std::exception& e) {
+      IPC_LOG_ERROR("IPC runtime subscriber threw exception: {}", e.what());
+    } catch (...) {
+      IPC_LOG_ERROR("IPC runtime subscriber threw unknown exception");
+    }
+  }
+}
+
+// ============================================================================
+// FFI Exports
+// ============================================================================
+
+extern "C" {
+
+__declspec(dllexport) bool SetIpcDeliveryPolicy(int32_t mode, uint32_t value) {
+  std::string text;
+  switch (static_cast<IpcDeliveryMode>(mode)) {
+    case IpcDeliveryMode::kImmediate:
+      text = "immediate";
+      break;
+    case IpcDeliveryMode::kCoalesce:
+      text = "coalesce:" + std::to_string(value);
+      break;
+    case IpcDeliveryMode::kDebounce:
+      text = "debounce:" + std::to_string(value);
+      break;
+    case IpcDeliveryMode::kFrameAligned:
+      text = "frame:" + std::to_string(value);
+      break;
+    default:
+      return false;
+  }
+  // Same validation as FLUTTER_IPC_DELIVERY
+  IpcDeliveryPolicy policy;
+  if (!ParseDeliveryPolicy(text, &policy)) {
+    return false;
+  }
+  return IpcRuntime::SetDefaultDeliveryPolicy(policy);
+}
+
+}  // extern "C"
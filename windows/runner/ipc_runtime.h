@@ -0,0 +1,183 @@
+// ipc_runtime.h
+//
+// One IPC runtime per process, shared by every window the process hosts.
+//
+// A window needs the counter segment to count itself and a listener to hear
+// about other windows. Giving each window its own SharedMemoryManager and
+// WindowCountListener costs a mapping, an event handle and an OS thread per
+// window, and every count change wakes all of those threads and posts the
+// same update to the Dart ports once per window. IpcRuntime holds one
+// manager and one listener for the whole process: a change wakes one thread,
+// which updates the Dart ports once and then calls the native subscribers.
+// The listener runs on the process's IpcReactor (ipc_reactor.h), the same
+// thread that serves the shared buffer pool receiver and every runtime of
+// other IPC namespaces. Deliveries themselves, the Dart fan-out and the
+// subscribers, run on the shared callback pool (ipc_callback_executor.h),
+// so a slow subscriber holds up neither the reactor nor other runtimes.
+// Deliveries queue one deep: while one runs, further changes collapse into
+// a single delivery of the latest state after it.
+//
+// Deliveries follow the runtime's IpcDeliveryPolicy (ipc_delivery_policy.h):
+// at every wakeup, or coalesced, debounced or aligned to a frame clock. Held
+// deliveries are timed by a waitable timer on the reactor and always carry
+// the latest state.
+//
+// The runtime is reference counted. Acquire() starts it for the first user
+// and hands out the same instance until the last user drops its reference;
+// then the listener stops and the segment is unmapped.
+//
+// The read-only Dart view (GetSharedMemoryView) and the shared buffer pool
+// receiver exist once per process, for the default IPC namespace. Only
+// that namespace's runtime publishes the view, and only it unpublishes the
+// view and stops the receiver when it goes; runtimes of other namespaces
+// leave both alone.
+//
+// Example usage:
+//   std::shared_ptr<IpcRuntime> runtime = IpcRuntime::Acquire();
+//   runtime->shared_memory_manager()->IncrementWindowCount();
+//   ...
+//   runtime->shared_memory_manager()->DecrementWindowCount();
+//   runtime.reset();  // Last user stops the runtime
+
+#ifndef RUNNER_IPC_RUNTIME_H_
+#define RUNNER_IPC_RUNTIME_H_
+
+#include <windows.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ipc_callback_executor.h"
+#include "ipc_delivery_policy.h"
+#include "ipc_reactor.h"
+#include "shared_memory_manager.h"
+#include "window_count_listener.h"
+
+// Called on a callback pool thread after each delivery, with the state the
+// Dart ports were just notified of. Never called concurrently with itself.
+using IpcRuntimeSubscriber =
+    std::function<void(const SharedMemorySnapshot& snapshot)>;
+
+class IpcRuntime {
+ public:
+  using SubscriptionId = uint64_t;
+
+  // Returns the runtime of the process default IPC namespace, starting it
+  // if this is its first user. Never returns nullptr: shared memory and
+  // listener failures are logged and tolerated, as for a single window.
+  static std::shared_ptr<IpcRuntime> Acquire();
+
+  // Same, for the given IPC namespace (see ipc_namespace.h).
+  static std::shared_ptr<IpcRuntime> Acquire(const std::string& ipc_namespace);
+
+  // Number of runtimes currently alive in this process.
+  static int GetLiveCount();
+
+  // Stops the listener and releases everything; runs when the last
+  // reference is dropped.
+  ~IpcRuntime();
+
+  IpcRuntime(const IpcRuntime&) = delete;
+  IpcRuntime& operator=(const IpcRuntime&) = delete;
+
+  // The process's manager, or nullptr if shared memory is unavailable.
+  SharedMemoryManager* shared_memory_manager() const {
+    return shared_memory_manager_.get();
+  }
+
+  // True if the listener is running.
+  bool IsListening() const;
+
+  const std::string& ipc_namespace() const { return ipc_namespace_; }
+
+  // Adds a native subscriber. Thread-safe. Must not be called from a
+  // subscriber.
+  SubscriptionId Subscribe(IpcRuntimeSubscriber subscriber);
+
+  // Removes a subscriber. Once this returns the subscriber is not running
+  // and will not be called again. Must not be called from a subscriber.
+  void Unsubscribe(SubscriptionId id);
+
+  size_t GetSubscriberCount() const;
+
+  // Changes how this runtime delivers changes. Thread-safe. A delivery the
+  // old policy was holding is made at once.
+  //
+  // Returns false, leaving the policy immediate, if the runtime has no
+  // reactor to time held deliveries.
+  bool SetDeliveryPolicy(const IpcDeliveryPolicy& policy);
+
+  IpcDeliveryPolicy GetDeliveryPolicy() const;
+
+  // Policy of runtimes started from now on, initially from the
+  // FLUTTER_IPC_DELIVERY environment variable. Also applied to every live
+  // runtime of the process. Thread-safe.
+  static bool SetDefaultDeliveryPolicy(const IpcDeliveryPolicy& policy);
+  static IpcDeliveryPolicy GetDefaultDeliveryPolicy();
+
+ private:
+  explicit IpcRuntime(std::string ipc_namespace);
+
+  // Maps the segment and starts the listener.
+  void Start();
+
+  // Listener callback: asks the delivery scheduler whether to deliver now.
+  void OnCountChanged();
+
+  // Delivery timer fired: delivers if the held delivery is due.
+  void OnDeliveryTimer();
+
+  // Sets the timer to fire at deadline (QueryPerformanceCounter ticks).
+  void ArmDeliveryTimer(int64_t deadline);
+
+  // Queues a delivery of the latest state on delivery_queue_.
+  void QueueDelivery();
+
+  // One snapshot, one Dart fan-out, then subscribers.
+  void Deliver(const SharedMemorySnapshot& snapshot);
+
+  // Reads the latest state; ends the listener's deferred wake trace.
+  SharedMemorySnapshot ReadLatest();
+
+  std::string ipc_namespace_;
+  bool is_default_namespace_;  // Owns the Dart view and buffer receiver
+  std::shared_ptr<IpcReactor> reactor_;  // Outlives the listener
+  std::unique_ptr<SharedMemoryManager> shared_memory_manager_;
+  std::unique_ptr<WindowCountListener> window_count_listener_;
+
+  // Held deliveries, see SetDeliveryPolicy()
+  HANDLE delivery_timer_;  // Auto-reset waitable timer, nullptr if none
+  IpcReactor::HandlerId delivery_timer_handler_;
+  mutable std::mutex delivery_mutex_;  // Guards the scheduler
+  IpcDeliveryScheduler delivery_scheduler_;
+  bool flush_pending_;  // Deliver at the next timer: policy was replaced
+
+  // Runs deliveries on the shared callback pool, one at a time
+  std::unique_ptr<IpcCallbackQueue> delivery_queue_;
+
+  // Held while subscribers run, so Unsubscribe() waits for them.
+  mutable std::mutex subscribers_mutex_;
+  std::vector<std::pair<SubscriptionId, IpcRuntimeSubscriber>> subscribers_;
+  SubscriptionId next_subscription_id_;
+};
+
+// FFI Exports for Dart binding
+extern "C" {
+
+/// FFI export: Set how this process delivers window count changes, for
+/// every runtime (see IpcRuntime::SetDefaultDeliveryPolicy()).
+///
+/// @param mode IpcDeliveryMode value
+/// @param value Microseconds for coalesce and debounce, frames per second
+///              for frame-aligned; ignored for immediate
+/// @return true if the policy is valid and was applied
+__declspec(dllexport) bool SetIpcDeliveryPolicy(int32_t mode, uint32_t value);
+
+}  // extern "C"
+
+#endif  // RUNNER_IPC_RUNTIME_H_
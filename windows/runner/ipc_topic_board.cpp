@@ -0,0 +1,335 @@
+// ipc_topic_board.cpp
+//
+// Implementation of IpcTopicBoard, the topic-aware wakeup board.
+
+#include "ipc_topic_board.h"
+
+#include <map>
+#include <utility>
+
+#include "ipc_log.h"
+#include "ipc_metrics.h"
+#include "ipc_namespace.h"
+#include "ipc_process.h"
+
+namespace {
+
+// Per-process wake event; the process ID is appended (after the namespace)
+// so a publisher can wake exactly the processes interested in a topic.
+const char* kWakeEventName = "Local\\FlutterIpcTopicWake";
+
+constexpr DWORD kBoardMagic = 0x43504F54;  // 'TOPC'
+constexpr size_t kBoardSize = sizeof(IpcTopicBoardHeader);
+
+// How long an opener waits for the creator to finish initializing.
+constexpr int kInitWaitMs = 100;
+
+// Boards by namespace, so every user in a process shares one slot.
+std::mutex g_boards_mutex;
+std::map<std::string, std::weak_ptr<IpcTopicBoard>> g_boards;
+
+}  // anonymous namespace
+
+std::shared_ptr<IpcTopicBoard> IpcTopicBoard::Acquire() {
+  return Acquire(ipc_namespace::GetDefault());
+}
+
+std::shared_ptr<IpcTopicBoard> IpcTopicBoard::Acquire(
+    const std::string& ipc_namespace) {
+  std::shared_ptr<IpcTopicBoard> failed;  // Destroyed after the lock
+  std::lock_guard<std::mutex> lock(g_boards_mutex);
+  std::shared_ptr<IpcTopicBoard> board = g_boards[ipc_namespace].lock();
+  if (!board) {
+    board.reset(new IpcTopicBoard(ipc_namespace));
+    if (!board->Initialize()) {
+      // ~IpcTopicBoard() takes g_boards_mutex
+      failed = std::move(board);
+      return nullptr;
+    }
+    g_boards[ipc_namespace] = board;
+  }
+  return board;
+}
+
+IpcTopicBoard::IpcTopicBoard(std::string ipc_namespace)
+    : ipc_namespace_(std::move(ipc_namespace)),
+      wake_event_prefix_(
+          ipc_namespace::Qualify(kWakeEventName, ipc_namespace_) + "."),
+      mapping_handle_(nullptr),
+      header_(nullptr),
+      wake_event_(nullptr),
+      slot_(nullptr),
+      wake_handler_(IpcReactor::kInvalidHandler),
+      next_subscription_id_(1),
+      running_subscription_(kInvalidSubscription) {}
+
+IpcTopicBoard::~IpcTopicBoard() {
+  {
+    std::lock_guard<std::mutex> lock(g_boards_mutex);
+    auto it = g_boards.find(ipc_namespace_);
+    if (it != g_boards.end() && it->second.expired()) {
+      g_boards.erase(it);
+    }
+  }
+
+  // Once removed, DrainPending() is not running
+  if (wake_handler_ != IpcReactor::kInvalidHandler) {
+    reactor_->Remove(wake_handler_);
+  }
+  reactor_.reset();
+
+  if (slot_ != nullptr) {
+    InterlockedExchange(&slot_->interest, 0);
+    InterlockedExchange(&slot_->pending, 0);
+    InterlockedCompareExchange(&slot_->pid, 0,
+                               static_cast<LONG>(GetCurrentProcessId()));
+  }
+  if (wake_event_) {
+    CloseHandle(wake_event_);
+  }
+  if (header_) {
+    UnmapViewOfFile(header_);
+  }
+  if (mapping_handle_) {
+    CloseHandle(mapping_handle_);
+  }
+}
+
+bool IpcTopicBoard::Initialize() {
+  std::string name = ipc_namespace::Qualify(kIpcTopicBoardName, ipc_namespace_);
+  mapping_handle_ = CreateFileMappingA(
+      INVALID_HANDLE_VALUE,  // Backed by the paging file
+      nullptr,               // Default security
+      PAGE_READWRITE,        // Read/write access
+      0, static_cast<DWORD>(kBoardSize), name.c_str());
+  if (mapping_handle_ == nullptr) {
+    IPC_LOG_ERROR("CreateFileMappingA failed for topic board: {}",
+                  GetLastError());
+    return false;
+  }
+  bool already_exists = (GetLastError() == ERROR_ALREADY_EXISTS);
+
+  header_ = static_cast<IpcTopicBoardHeader*>(
+      MapViewOfFile(mapping_handle_, FILE_MAP_ALL_ACCESS, 0, 0, kBoardSize));
+  if (header_ == nullptr) {
+    IPC_LOG_ERROR("MapViewOfFile failed for topic board: {}", GetLastError());
+    return false;
+  }
+
+  if (!already_exists) {
+    // New sections are zero-filled: no interest, every sequence at 0.
+    header_->layout_version = kIpcTopicBoardLayoutVersion;
+    header_->topic_count = kMaxIpcTopics;
+    header_->slot_count = kMaxIpcTopicProcesses;
+    MemoryBarrier();
+    header_->magic = kBoardMagic;
+  } else {
+    for (int i = 0; i < kInitWaitMs && header_->magic != kBoardMagic; i++) {
+      Sleep(1);  // Creator still initializing
+    }
+    if (header_->magic != kBoardMagic ||
+        header_->layout_version != kIpcTopicBoardLayoutVersion ||
+        header_->slot_count != kMaxIpcTopicProcesses) {
+      IPC_LOG_ERROR("Topic board layout mismatch: version {}, {} slots",
+                    header_->layout_version, header_->slot_count);
+      return false;
+    }
+  }
+
+  // Auto-reset, and only this process waits on it: one wakeup per signal.
+  wake_event_ = CreateEventA(nullptr, FALSE, FALSE,
+                             WakeEventName(GetCurrentProcessId()).c_str());
+  if (wake_event_ == nullptr) {
+    IPC_LOG_ERROR("CreateEventA failed for topic board: {}", GetLastError());
+    return false;
+  }
+  return true;
+}
+
+LONG IpcTopicBoard::Publish(uint32_t topic) {
+  if (topic >= kMaxIpcTopics) {
+    return -1;
+  }
+  LONG sequence = InterlockedIncrement(&header_->sequences[topic]);
+
+  LONG bit = static_cast<LONG>(IpcTopicBit(topic));
+  int64_t woken = 0;
+  for (DWORD i = 0; i < kMaxIpcTopicProcesses; i++) {
+    IpcTopicSlot& slot = header_->slots[i];
+    LONG pid = ReadAcquire(&slot.pid);
+    if (pid == 0 || (ReadAcquire(&slot.interest) & bit) == 0) {
+      continue;
+    }
+    // Only the first pending topic signals; later ones ride on that
+    // wakeup, since the process takes all pending bits at once.
+    if (InterlockedOr(&slot.pending, bit) == 0) {
+      WakeProcess(static_cast<DWORD>(pid));
+      woken++;
+    }
+  }
+
+  ipc_metrics::Increment(ipc_metrics::kMetricTopicPublishes);
+  if (woken > 0) {
+    ipc_metrics::Increment(ipc_metrics::kMetricTopicWakeups, woken);
+  }
+  return sequence;
+}
+
+LONG IpcTopicBoard::GetSequence(uint32_t topic) const {
+  if (topic >= kMaxIpcTopics) {
+    return 0;
+  }
+  return ReadAcquire(&header_->sequences[topic]);
+}
+
+IpcTopicBoard::SubscriptionId IpcTopicBoard::Subscribe(
+    uint32_t topic_mask, IpcTopicCallback callback) {
+  if (topic_mask == 0) {
+    return kInvalidSubscription;
+  }
+  std::lock_guard<std::mutex> lock(subscribers_mutex_);
+  if (ClaimSlot() == nullptr) {
+    IPC_LOG_ERROR("IpcTopicBoard: process table full");
+    return kInvalidSubscription;
+  }
+  if (wake_handler_ == IpcReactor::kInvalidHandler) {
+    reactor_ = IpcReactor::Acquire();
+    if (reactor_) {
+      wake_handler_ =
+          reactor_->AddHandle(wake_event_, [this] { DrainPending(); });
+    }
+    if (wake_handler_ == IpcReactor::kInvalidHandler) {
+      IPC_LOG_ERROR("IpcTopicBoard: IPC reactor unavailable");
+      reactor_.reset();
+      return kInvalidSubscription;
+    }
+  }
+
+  SubscriptionId id = next_subscription_id_++;
+  subscribers_.push_back(Subscriber{
+      id, topic_mask,
+      std::make_shared<IpcTopicCallback>(std::move(callback))});
+  UpdateInterest();
+  return id;
+}
+
+void IpcTopicBoard::Unsubscribe(SubscriptionId id) {
+  std::unique_lock<std::mutex> lock(subscribers_mutex_);
+  for (auto it = subscribers_.begin(); it != subscribers_.end(); ++it) {
+    if (it->id == id) {
+      subscribers_.erase(it);
+      UpdateInterest();
+      break;
+    }
+  }
+  // On the reactor thread the running subscriber is our caller (or none).
+  if (reactor_ && !reactor_->IsReactorThread()) {
+    subscriber_returned_.wait(
+        lock, [this, id] { return running_subscription_ != id; });
+  }
+}
+
+uint32_t IpcTopicBoard::GetInterest() const {
+  std::lock_guard<std::mutex> lock(subscribers_mutex_);
+  return slot_ != nullptr ? static_cast<uint32_t>(slot_->interest) : 0;
+}
+
+IpcTopicSlot* IpcTopicBoard::ClaimSlot() {
+  if (slot_ != nullptr) {
+    return slot_;
+  }
+  LONG pid = static_cast<LONG>(GetCurrentProcessId());
+  // Free slots first; only a full table pays for checking on owners.
+  for (int pass = 0; pass < 2 && slot_ == nullptr; pass++) {
+    for (DWORD i = 0; i < kMaxIpcTopicProcesses && slot_ == nullptr; i++) {
+      IpcTopicSlot& slot = header_->slots[i];
+      LONG current = slot.pid;
+      bool claimable =
+          pass == 0 ? (current == 0 || current == pid)
+                    : ipc_process::IsProcessGone(static_cast<DWORD>(current));
+      if (claimable &&
+          InterlockedCompareExchange(&slot.pid, pid, current) == current) {
+        slot_ = &slot;
+      }
+    }
+  }
+  if (slot_ != nullptr) {
+    // A previous owner's topics would wake us for nothing.
+    InterlockedExchange(&slot_->interest, 0);
+    InterlockedExchange(&slot_->pending, 0);
+  }
+  return slot_;
+}
+
+void IpcTopicBoard::UpdateInterest() {
+  uint32_t interest = 0;
+  for (const Subscriber& subscriber : subscribers_) {
+    interest |= subscriber.topic_mask;
+  }
+  InterlockedExchange(&slot_->interest, static_cast<LONG>(interest));
+}
+
+std::string IpcTopicBoard::WakeEventName(DWORD pid) const {
+  return wake_event_prefix_ + std::to_string(pid);
+}
+
+void IpcTopicBoard::WakeProcess(DWORD pid) {
+  if (pid == GetCurrentProcessId()) {
+    SetEvent(wake_event_);
+    return;
+  }
+  HANDLE event = OpenEventA(EVENT_MODIFY_STATE, FALSE,
+                            WakeEventName(pid).c_str());
+  if (event == nullptr) {
+    return;  // Exited; its slot is reclaimed by the next process to need it
+  }
+  SetEvent(event);
+  CloseHandle(event);
+}
+
+void IpcTopicBoard::DrainPending() {
+  struct Delivery {
+    SubscriptionId id;
+    std::shared_ptr<IpcTopicCallback> callback;
+    uint32_t topic;
+    LONG sequence;
+  };
+  std::vector<Delivery> deliveries;
+  std::unique_lock<std::mutex> lock(subscribers_mutex_);
+  // Publishes after the exchange set a bit again and signal again.
+  uint32_t pending =
+      static_cast<uint32_t>(InterlockedExchange(&slot_->pending, 0));
+  for (uint32_t topic = 0; pending != 0; topic++, pending >>= 1) {
+    if ((pending & 1) == 0) {
+      continue;
+    }
+    LONG sequence = ReadAcquire(&header_->sequences[topic]);
+    for (const Subscriber& subscriber : subscribers_) {
+      if (subscriber.topic_mask & IpcTopicBit(topic)) {
+        deliveries.push_back(
+            Delivery{subscriber.id, subscriber.callback, topic, sequence});
+      }
+    }
+  }
+
+  // Subscribers run without the lock, so they may subscribe and
+  // unsubscribe. One removed by an earlier subscriber is skipped.
+  for (const Delivery& delivery : deliveries) {
+    bool subscribed = false;
+    for (const Subscriber& subscriber : subscribers_) {
+      if (subscriber.id == delivery.id) {
+        subscribed = true;
+        break;
+      }
+    }
+    if (!subscribed) {
+      continue;
+    }
+    running_subscription_ = delivery.id;
+    lock.unlock();
+    (*delivery.callback)(delivery.topic, delivery.sequence);
+    lock.lock();
+    running_subscription_ = kInvalidSubscription;
+    subscriber_returned_.notify_all();
+  }
+}
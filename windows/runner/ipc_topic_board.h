@@ -0,0 +1,191 @@
+// ipc_topic_board.h
+//
+// Topic-aware wakeups: a producer wakes only the processes interested in
+// what it changed.
+//
+// Every listener waits on the one named change event, so every change wakes
+// every window process, whether or not it cares: with N windows a change
+// costs N wakeups. IpcTopicBoard is a small shared section with one wait
+// word (a sequence, bumped on every publish) per topic and one slot per
+// process holding that process's interest mask. Publish(topic) bumps the
+// topic's word, marks the topic pending in the slot of every process
+// interested in it and signals only those processes, each through its own
+// auto-reset event, the way SharedBufferPool wakes receivers.
+//
+// A process has one slot however many subscribers it has: its interest is
+// the union of their topic masks, and a wakeup runs every subscriber of
+// every pending topic on the process's IpcReactor. Publishes to a topic
+// before the process drains its slot collapse into one callback carrying
+// the latest sequence, and a process whose wakeup is already pending is
+// not signaled again.
+//
+// The window count keeps its broadcast event: every window displays it,
+// so targeting cannot save a wakeup there. Topics are for state only some
+// windows watch. Topic 0 is reserved for the window count, matching
+// kDartPortTopicWindowCount.
+//
+// Example usage:
+//   std::shared_ptr<IpcTopicBoard> board = IpcTopicBoard::Acquire();
+//   auto id = board->Subscribe(IpcTopicBit(kMyTopic),
+//                              [](uint32_t topic, LONG sequence) { ... });
+//   ...
+//   board->Publish(kMyTopic);  // In any process of the namespace
+//   ...
+//   board->Unsubscribe(id);
+
+#ifndef RUNNER_IPC_TOPIC_BOARD_H_
+#define RUNNER_IPC_TOPIC_BOARD_H_
+
+#include <windows.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ipc_reactor.h"
+
+// Name of the topic section. Namespaced like kSharedMemoryName.
+constexpr char kIpcTopicBoardName[] = "Local\\FlutterIpcTopicBoard";
+
+// Board geometry. Fixed at compile time so every process agrees on offsets.
+constexpr uint32_t kMaxIpcTopics = 32;  // One bit of a mask per topic
+constexpr DWORD kMaxIpcTopicProcesses = 256;
+
+// Version of the board layout. Bump whenever the header or slot changes.
+constexpr DWORD kIpcTopicBoardLayoutVersion = 1;
+
+// Topic of the window count (see the file comment).
+constexpr uint32_t kIpcTopicWindowCount = 0;
+
+// Mask bit of one topic.
+constexpr uint32_t IpcTopicBit(uint32_t topic) {
+  return 1u << topic;
+}
+
+// Interest and pending topics of one process (16 bytes).
+struct IpcTopicSlot {
+  volatile LONG pid;       // Owning process, 0 = free
+  volatile LONG interest;  // Topic bits the process waits for
+  volatile LONG pending;   // Topic bits published since its last drain
+  LONG reserved;
+};
+
+static_assert(sizeof(IpcTopicSlot) == 16, "Shared layout");
+
+// The whole section.
+struct IpcTopicBoardHeader {
+  DWORD magic;
+  DWORD layout_version;
+  DWORD topic_count;
+  DWORD slot_count;
+  // Wait word of each topic: bumped by every publish, so a reader can tell
+  // whether a topic changed since it last looked.
+  alignas(64) volatile LONG sequences[kMaxIpcTopics];
+  IpcTopicSlot slots[kMaxIpcTopicProcesses];
+};
+
+// Called on the process's IpcReactor thread with a topic that was
+// published and its sequence at delivery time.
+using IpcTopicCallback = std::function<void(uint32_t topic, LONG sequence)>;
+
+class IpcTopicBoard {
+ public:
+  using SubscriptionId = uint64_t;
+  static constexpr SubscriptionId kInvalidSubscription = 0;
+
+  // Returns the board of the process default IPC namespace, opening it for
+  // the first user, or nullptr if the section or the wake event cannot be
+  // created.
+  static std::shared_ptr<IpcTopicBoard> Acquire();
+
+  // Same, for the given IPC namespace (see ipc_namespace.h).
+  static std::shared_ptr<IpcTopicBoard> Acquire(
+      const std::string& ipc_namespace);
+
+  // Stops waking this process, frees its slot and unmaps the board.
+  ~IpcTopicBoard();
+
+  IpcTopicBoard(const IpcTopicBoard&) = delete;
+  IpcTopicBoard& operator=(const IpcTopicBoard&) = delete;
+
+  // Bumps the topic's sequence and wakes every process interested in it,
+  // this one included.
+  //
+  // Returns the new sequence, or -1 if topic is not below kMaxIpcTopics.
+  LONG Publish(uint32_t topic);
+
+  // Current sequence of a topic, 0 if never published or out of range.
+  LONG GetSequence(uint32_t topic) const;
+
+  // Adds a subscriber for the topics in topic_mask and adds them to this
+  // process's interest. Thread-safe, also from a subscriber.
+  //
+  // Only publishes after this returns are delivered; read GetSequence()
+  // afterwards for the current state. Returns kInvalidSubscription for an
+  // empty mask, a full process table or if the reactor is unavailable.
+  SubscriptionId Subscribe(uint32_t topic_mask, IpcTopicCallback callback);
+
+  // Removes a subscriber and drops topics no other subscriber needs from
+  // the interest. Once this returns the subscriber will not be called
+  // again and, unless this is called from a subscriber (on the reactor
+  // thread), is not running either. A subscriber may remove itself.
+  void Unsubscribe(SubscriptionId id);
+
+  // Topics this process is woken for: the union of all subscriptions.
+  uint32_t GetInterest() const;
+
+  const std::string& ipc_namespace() const { return ipc_namespace_; }
+
+ private:
+  explicit IpcTopicBoard(std::string ipc_namespace);
+
+  // Creates or opens the section and this process's wake event.
+  bool Initialize();
+
+  // Finds or claims this process's slot, reusing slots of exited
+  // processes. Called with subscribers_mutex_ held.
+  IpcTopicSlot* ClaimSlot();
+
+  // Stores the union of the subscribers' masks in the slot. Called with
+  // subscribers_mutex_ held.
+  void UpdateInterest();
+
+  // Name of the wake event of one process.
+  std::string WakeEventName(DWORD pid) const;
+
+  // Signals the wake event of one process.
+  void WakeProcess(DWORD pid);
+
+  // Reactor handler for the wake event: takes the pending topics and runs
+  // their subscribers.
+  void DrainPending();
+
+  std::string ipc_namespace_;
+  std::string wake_event_prefix_;        // Namespaced, followed by a PID
+  HANDLE mapping_handle_;                // Board section
+  IpcTopicBoardHeader* header_;          // Mapped section
+  HANDLE wake_event_;                    // This process's auto-reset event
+  IpcTopicSlot* slot_;                   // Claimed by the first Subscribe()
+  std::shared_ptr<IpcReactor> reactor_;  // Runs DrainPending()
+  IpcReactor::HandlerId wake_handler_;   // Wake event registration
+
+  struct Subscriber {
+    SubscriptionId id;
+    uint32_t topic_mask;
+    // Shared with a drain that copied it, so it outlives Unsubscribe().
+    std::shared_ptr<IpcTopicCallback> callback;
+  };
+
+  // Guards the subscribers; not held while one runs.
+  mutable std::mutex subscribers_mutex_;
+  std::vector<Subscriber> subscribers_;
+  SubscriptionId next_subscription_id_;
+  SubscriptionId running_subscription_;  // Being called by DrainPending()
+  std::condition_variable subscriber_returned_;  // Signaled when it clears
+};
+
+#endif  // RUNNER_IPC_TOPIC_BOARD_H_
@@ -0,0 +1,405 @@
+// ipc_trace.cpp
+//
+// Implementation of the cross-process latency trace ring and its Chrome
+// JSON export.
+
+#include "ipc_trace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <utility>
+
+#include "ipc_log.h"
+#include "ipc_namespace.h"
+
+namespace ipc_trace {
+
+namespace {
+constexpr DWORD kTraceRingMagic = 0x43525449;  // 'ITRC'
+
+// How long an opener waits for the creator to finish initializing.
+constexpr int kInitWaitMs = 100;
+
+int64_t QpcFrequency() {
+  static const int64_t frequency = [] {
+    LARGE_INTEGER value;
+    QueryPerformanceFrequency(&value);
+    return value.QuadPart;
+  }();
+  return frequency;
+}
+
+double TicksToMicros(int64_t ticks) {
+  return static_cast<double>(ticks) * 1e6 /
+         static_cast<double>(QpcFrequency());
+}
+
+// Stage started by BeginDeferred() on this thread, waiting for its ID.
+struct DeferredStage {
+  Stage stage = static_cast<Stage>(0);
+  int64_t start = 0;
+};
+
+thread_local DeferredStage t_deferred;
+}  // anonymous namespace
+
+const char* StageName(Stage stage) {
+  switch (stage) {
+    case kStageCounterWrite:
+      return "counter.write";
+    case kStageEventSignal:
+      return "event.signal";
+    case kStageListenerWake:
+      return "listener.wake";
+    case kStageCallback:
+      return "listener.callback";
+    case kStageDartPost:
+      return "dart.post";
+    case kStageDartReceive:
+      return "dart.receive";
+  }
+  return "unknown";
+}
+
+// ============================================================================
+// TraceRecorder
+// ============================================================================
+
+TraceRecorder::TraceRecorder(std::string ring_name, uint32_t capacity)
+    : ring_name_(std::move(ring_name)),
+      capacity_(capacity),
+      mapping_(nullptr),
+      header_(nullptr),
+      slots_(nullptr) {}
+
+TraceRecorder::~TraceRecorder() {
+  Close();
+}
+
+bool TraceRecorder::Open() {
+  if (header_ != nullptr) {
+    return true;
+  }
+
+  size_t size = sizeof(TraceRingHeader) + capacity_ * sizeof(TraceSlot);
+  mapping_ = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                0, static_cast<DWORD>(size),
+                                ring_name_.c_str());
+  if (mapping_ == nullptr) {
+    IPC_LOG_ERROR("CreateFileMappingA failed for trace ring: {}",
+                  GetLastError());
+    return false;
+  }
+  bool already_exists = (GetLastError() == ERROR_ALREADY_EXISTS);
+
+  void* view = MapViewOfFile(mapping_, FILE_MAP_ALL_ACCESS, 0, 0, size);
+  if (view == nullptr) {
+    IPC_LOG_ERROR("MapViewOfFile failed for trace ring: {}", GetLastError());
+    Close();
+    return false;
+  }
+  header_ = static_cast<TraceRingHeader*>(view);
+  slots_ = reinterpret_cast<TraceSlot*>(header_ + 1);
+
+  // Pages of a new mapping are zeroed, so every slot starts unwritten.
+  if (!already_exists) {
+    header_->capacity = capacity_;
+    MemoryBarrier();
+    header_->magic = kTraceRingMagic;
+  } else {
+    for (int i = 0; i < kInitWaitMs && header_->magic != kTraceRingMagic;
+         i++) {
+      Sleep(1);  // Creator still initializing
+    }
+    if (header_->magic != kTraceRingMagic || header_->capacity != capacity_) {
+      IPC_LOG_WARN("Trace ring layout mismatch: capacity {}",
+                   header_->capacity);
+      Close();
+      return false;
+    }
+  }
+  return true;
+}
+
+void TraceRecorder::Record(Stage stage, uint32_t trace_id,
+                           int64_t start_ticks, int64_t end_ticks) {
+  if (header_ == nullptr) {
+    return;  // Not opened, or the mapping is unavailable
+  }
+
+  LONG index = InterlockedIncrement(&header_->write_index) - 1;
+  TraceSlot* slot = &slots_[static_cast<uint32_t>(index) & (capacity_ - 1)];
+
+  // Claim the slot by stamping it odd with our lap. A slot still odd from
+  // an older lap belongs to a writer that died (or stalled for a whole
+  // lap) mid-record; take it over instead of dropping every later span.
+  // Drop only if a writer of a later lap got there first; never wait.
+  uint32_t claim = static_cast<uint32_t>(index) * 2 + 1;
+  LONG claimed = static_cast<LONG>(claim);
+  LONG sequence = ReadAcquire(&slot->sequence);
+  // Claim value of the slot's current or last writer
+  uint32_t holder = static_cast<uint32_t>(sequence) - ((sequence & 1) ^ 1);
+  if ((sequence != 0 && static_cast<int32_t>(claim - holder) <= 0) ||
+      InterlockedCompareExchange(&slot->sequence, claimed, sequence) !=
+          sequence) {
+    InterlockedIncrement(&header_->dropped);
+    return;
+  }
+
+  slot->trace_id = trace_id;
+  slot->start_ticks = start_ticks;
+  slot->duration_ticks = static_cast<uint32_t>(
+      end_ticks > start_ticks ? end_ticks - start_ticks : 0);
+  slot->process_id = GetCurrentProcessId();
+  slot->thread_id = GetCurrentThreadId();
+  slot->stage = stage;
+  slot->lap = static_cast<uint16_t>(index);
+
+  // Publish (full barrier orders the field stores before it), unless a
+  // later lap took the slot over while this writer stalled.
+  if (InterlockedCompareExchange(&slot->sequence, claimed + 1, claimed) !=
+      claimed) {
+    InterlockedIncrement(&header_->dropped);
+  }
+}
+
+std::vector<TraceEvent> TraceRecorder::Collect() {
+  std::vector<TraceEvent> events;
+  if (header_ == nullptr) {
+    return events;
+  }
+  events.reserve(capacity_);
+
+  for (uint32_t i = 0; i < capacity_; i++) {
+    const TraceSlot* slot = &slots_[i];
+    LONG before = ReadAcquire(&slot->sequence);
+    if (before == 0 || (before & 1) != 0) {
+      continue;  // Never written, or being written right now
+    }
+
+    TraceEvent event;
+    event.trace_id = slot->trace_id;
+    event.stage = static_cast<Stage>(slot->stage);
+    event.process_id = slot->process_id;
+    event.thread_id = slot->thread_id;
+    event.start_ticks = slot->start_ticks;
+    event.duration_ticks = slot->duration_ticks;
+
+    uint16_t lap = slot->lap;
+
+    // Order the field loads before re-reading the sequence. A lap that
+    // does not match the sequence means a stalled writer of an older lap
+    // stored into the slot after it was taken over.
+    MemoryBarrier();
+    if (ReadNoFence(&slot->sequence) == before &&
+        lap == static_cast<uint16_t>((static_cast<uint32_t>(before) - 2) / 2)) {
+      events.push_back(event);
+    }
+  }
+
+  std::sort(events.begin(), events.end(),
+            [](const TraceEvent& a, const TraceEvent& b) {
+              return a.start_ticks < b.start_ticks;
+            });
+  return events;
+}
+
+LONG TraceRecorder::GetDroppedCount() const {
+  return header_ != nullptr ? ReadAcquire(&header_->dropped) : 0;
+}
+
+bool TraceRecorder::ExportChromeTrace(const std::string& path) {
+  std::string json = ToChromeJson(Collect());
+  std::ofstream file(path, std::ios::out | std::ios::trunc | std::ios::binary);
+  if (!file) {
+    IPC_LOG_ERROR("Failed to open trace file: {}", path);
+    return false;
+  }
+  file.write(json.data(), static_cast<std::streamsize>(json.size()));
+  file.close();
+  if (!file) {
+    IPC_LOG_ERROR("Failed to write trace file: {}", path);
+    return false;
+  }
+  IPC_LOG_INFO("IPC trace exported: {}", path);
+  return true;
+}
+
+std::string TraceRecorder::ToChromeJson(const std::vector<TraceEvent>& events) {
+  // Events of one trace ID in input (Collect: time) order, for the flow
+  // arrows.
+  std::map<uint32_t, std::vector<size_t>> flows;
+  std::vector<DWORD> processes;
+  for (size_t i = 0; i < events.size(); i++) {
+    if (events[i].trace_id != 0) {
+      flows[events[i].trace_id].push_back(i);
+    }
+    if (std::find(processes.begin(), processes.end(),
+                  events[i].process_id) == processes.end()) {
+      processes.push_back(events[i].process_id);
+    }
+  }
+
+  std::string json = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  char buf[256];
+  bool first = true;
+  auto append = [&](int length) {
+    if (length <= 0) {
+      return;
+    }
+    if (!first) {
+      json += ",\n";
+    }
+    first = false;
+    json.append(buf, static_cast<size_t>(
+                         std::min(length, static_cast<int>(sizeof(buf) - 1))));
+  };
+
+  for (DWORD pid : processes) {
+    append(std::snprintf(buf, sizeof(buf),
+                         "{\"ph\":\"M\",\"name\":\"process_name\","
+                         "\"pid\":%lu,\"args\":{\"name\":\"window %lu\"}}",
+                         static_cast<unsigned long>(pid),
+                         static_cast<unsigned long>(pid)));
+  }
+
+  // One complete ("X") slice per stage. Timestamps are relative to the
+  // earliest event so they stay small and readable.
+  int64_t origin = 0;
+  for (size_t i = 0; i < events.size(); i++) {
+    if (i == 0 || events[i].start_ticks < origin) {
+      origin = events[i].start_ticks;
+    }
+  }
+  for (const TraceEvent& event : events) {
+    append(std::snprintf(
+        buf, sizeof(buf),
+        "{\"ph\":\"X\",\"cat\":\"ipc\",\"name\":\"%s\",\"pid\":%lu,"
+        "\"tid\":%lu,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"trace_id\":%u}}",
+        StageName(event.stage), static_cast<unsigned long>(event.process_id),
+        static_cast<unsigned long>(event.thread_id),
+        TicksToMicros(event.start_ticks - origin),
+        TicksToMicros(event.duration_ticks), event.trace_id));
+  }
+
+  // Flow events ("s" start, "t" step, "f" finish) bound to the enclosing
+  // slices join the stages of one update across threads and processes.
+  for (const auto& flow : flows) {
+    const std::vector<size_t>& steps = flow.second;
+    if (steps.size() < 2) {
+      continue;
+    }
+    for (size_t i = 0; i < steps.size(); i++) {
+      const TraceEvent& event = events[steps[i]];
+      const char* phase =
+          i == 0 ? "s" : (i + 1 == steps.size() ? "f" : "t");
+      append(std::snprintf(
+          buf, sizeof(buf),
+          "{\"ph\":\"%s\",\"cat\":\"ipc\",\"name\":\"update\",\"id\":%u,"
+          "\"pid\":%lu,\"tid\":%lu,\"ts\":%.3f,\"bp\":\"e\"}",
+          phase, flow.first, static_cast<unsigned long>(event.process_id),
+          static_cast<unsigned long>(event.thread_id),
+          TicksToMicros(event.start_ticks - origin)));
+    }
+  }
+
+  json += "]}\n";
+  return json;
+}
+
+void TraceRecorder::Close() {
+  if (header_) {
+    UnmapViewOfFile(header_);
+    header_ = nullptr;
+    slots_ = nullptr;
+  }
+  if (mapping_) {
+    CloseHandle(mapping_);
+    mapping_ = nullptr;
+  }
+}
+
+// ============================================================================
+// Global helpers
+// ============================================================================
+
+int64_t Now() {
+  LARGE_INTEGER now;
+  QueryPerformanceCounter(&now);
+  return now.QuadPart;
+}
+
+TraceRecorder& GetRecorder() {
+  // Intentionally leaked, like the global logger: stages may still be
+  // recorded from threads that outlive static destruction.
+  static TraceRecorder* recorder = [] {
+    TraceRecorder* created = new TraceRecorder(
+        ipc_namespace::Qualify(TraceRecorder::kDefaultRingName));
+    created->Open();
+    return created;
+  }();
+  return *recorder;
+}
+
+void Record(Stage stage, uint32_t trace_id, int64_t start_ticks,
+            int64_t end_ticks) {
+  GetRecorder().Record(stage, trace_id, start_ticks, end_ticks);
+}
+
+void BeginDeferred(Stage stage) {
+  BeginDeferred(stage, Now());
+}
+
+void BeginDeferred(Stage stage, int64_t start) {
+  t_deferred.stage = stage;
+  t_deferred.start = start;
+}
+
+int64_t TakeDeferred() {
+  int64_t start = t_deferred.start;
+  t_deferred.start = 0;
+  return start;
+}
+
+void EndDeferred(uint32_t trace_id) {
+  if (t_deferred.start == 0) {
+    return;
+  }
+  Record(t_deferred.stage, trace_id, t_deferred.start, Now());
+  t_deferred.start = 0;
+}
+
+}  // namespace ipc_trace
+
+// ============================================================================
+// FFI Exports - C functions callable from Dart via FFI
+// ============================================================================
+
+extern "C" {
+
+/// Dart handler reached for a traced update.
+///
+/// Dart usage:
+///   IpcTrace.markReceived(traceId);  // first thing in the handler
+__declspec(dllexport) void RecordIpcTraceDartReceive(uint32_t trace_id) {
+  if (trace_id == 0) {
+    return;
+  }
+  int64_t now = ipc_trace::Now();
+  ipc_trace::Record(ipc_trace::kStageDartReceive, trace_id, now, now);
+}
+
+/// Write the trace of all windows as Chrome JSON.
+///
+/// @param path Output file, e.g. "%TEMP%\\ipc_trace.json"
+/// @return true if the file was written
+__declspec(dllexport) bool ExportIpcTrace(const char* path) {
+  if (path == nullptr) {
+    return false;
+  }
+  return ipc_trace::GetRecorder().ExportChromeTrace(path);
+}
+
+}  // extern "C"
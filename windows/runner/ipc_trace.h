@@ -0,0 +1,194 @@
+// ipc_trace.h
+//
+// End-to-end latency tracing of window count updates.
+//
+// A count change travels InterlockedIncrement → SetEvent → listener wake →
+// callback → Dart_PostCObject_DL → Dart handler, usually across several
+// processes. Each change gets a trace ID inside the seqlock write; it is
+// stored in SharedMemoryData::trace_id so every process that reacts to the
+// change tags its stages with the same ID, and Dart receives it in the
+// upper 32 bits of traced updates (kDartPortTraceId).
+//
+// Stages are recorded into a fixed-size ring in named shared memory that
+// all window processes write to, so any one process can export the whole
+// picture. Timestamps are QueryPerformanceCounter ticks, which are
+// monotonic and system-wide, so stages from different processes line up
+// on one timeline. Export writes Chrome JSON (chrome://tracing,
+// ui.perfetto.dev) with flow arrows joining the stages of one trace ID.
+//
+// Recording never blocks: the oldest events are overwritten.
+
+#ifndef RUNNER_IPC_TRACE_H_
+#define RUNNER_IPC_TRACE_H_
+
+#include <windows.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ipc_trace {
+
+// Pipeline stages, in the order an update passes through them.
+enum Stage : uint16_t {
+  kStageCounterWrite = 1,  // Seqlock write of the new count (writer)
+  kStageEventSignal,       // SetEvent on the change event (writer)
+  kStageListenerWake,      // Listener wake until its callback starts
+  kStageCallback,          // Listener callback: snapshot and fan-out
+  kStageDartPost,          // One Dart_PostCObject_DL or listener call
+  kStageDartReceive,       // Dart handler ran (reported from Dart)
+};
+
+// Name used in exported traces, e.g. "counter.write".
+const char* StageName(Stage stage);
+
+// One recorded stage as returned by TraceRecorder::Collect().
+struct TraceEvent {
+  uint32_t trace_id;
+  Stage stage;
+  DWORD process_id;
+  DWORD thread_id;
+  int64_t start_ticks;      // QueryPerformanceCounter
+  uint32_t duration_ticks;  // 0 for instants
+};
+
+// Shared ring slot (32 bytes). The sequence is a per-slot seqlock stamped
+// with the lap of its writer: 2 * index + 1 while the writer of event
+// index fills the slot, 2 * index + 2 once published, 0 if the slot was
+// never written.
+struct TraceSlot {
+  volatile LONG sequence;
+  uint32_t trace_id;
+  int64_t start_ticks;
+  uint32_t duration_ticks;
+  DWORD process_id;
+  DWORD thread_id;
+  uint16_t stage;
+  uint16_t lap;  // Low 16 bits of the writer's event index
+};
+
+struct TraceRingHeader {
+  DWORD magic;
+  DWORD capacity;
+  volatile LONG write_index;
+  volatile LONG dropped;  // Slots skipped because a writer still held them
+  DWORD reserved[12];     // Pad header to one cache line
+};
+
+static_assert(sizeof(TraceSlot) == 32, "Shared layout");
+static_assert(sizeof(TraceRingHeader) == 64, "Shared layout");
+
+// Cross-process trace ring.
+//
+// Thread-safe; any number of threads in any number of processes may record
+// concurrently with interlocked operations only.
+class TraceRecorder {
+ public:
+  static constexpr uint32_t kDefaultCapacity = 8192;  // Power of two, 256 KiB
+  static constexpr char kDefaultRingName[] = "Local\\FlutterMultiWindowTrace";
+
+  explicit TraceRecorder(std::string ring_name = kDefaultRingName,
+                         uint32_t capacity = kDefaultCapacity);
+  ~TraceRecorder();
+
+  TraceRecorder(const TraceRecorder&) = delete;
+  TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+  // Creates or opens the shared ring. Must be called before recording;
+  // until it succeeds Record() does nothing and Collect() returns nothing.
+  // Not thread-safe: call it before sharing the recorder.
+  bool Open();
+
+  // Records a stage that ran from start_ticks to end_ticks.
+  void Record(Stage stage, uint32_t trace_id, int64_t start_ticks,
+              int64_t end_ticks);
+
+  // Copies every complete event in the ring (all processes), oldest first.
+  std::vector<TraceEvent> Collect();
+
+  // Events lost because their slot was still being written.
+  LONG GetDroppedCount() const;
+
+  // Writes Collect() as Chrome JSON to path. Returns false on I/O error.
+  bool ExportChromeTrace(const std::string& path);
+
+  // Chrome JSON for a set of events. Exposed for tests.
+  static std::string ToChromeJson(const std::vector<TraceEvent>& events);
+
+ private:
+  void Close();
+
+  std::string ring_name_;
+  uint32_t capacity_;
+  HANDLE mapping_;
+  TraceRingHeader* header_;
+  TraceSlot* slots_;
+};
+
+// Current QueryPerformanceCounter value.
+int64_t Now();
+
+// Global recorder used by the helpers below and the FFI exports. Opened on
+// first use.
+TraceRecorder& GetRecorder();
+
+// Records a stage on the global recorder.
+void Record(Stage stage, uint32_t trace_id, int64_t start_ticks,
+            int64_t end_ticks);
+
+// Records a stage covering the lifetime of the scope.
+//
+//   {
+//     ipc_trace::Span span(ipc_trace::kStageEventSignal, trace_id);
+//     SetEvent(update_event_);
+//   }
+class Span {
+ public:
+  Span(Stage stage, uint32_t trace_id)
+      : stage_(stage), trace_id_(trace_id), start_(Now()) {}
+  ~Span() { Record(stage_, trace_id_, start_, Now()); }
+
+  Span(const Span&) = delete;
+  Span& operator=(const Span&) = delete;
+
+ private:
+  Stage stage_;
+  uint32_t trace_id_;
+  int64_t start_;
+};
+
+// Starts a stage whose trace ID is not known yet, on the calling thread.
+// The listener uses this on wake; the callback completes it after reading
+// the trace ID from shared memory. A second Begin replaces the first.
+void BeginDeferred(Stage stage);
+
+// Same, with a start taken earlier, e.g. on another thread.
+void BeginDeferred(Stage stage, int64_t start);
+
+// Takes the calling thread's deferred stage away and returns its start, or
+// 0 if none. A listener that hands its callback to another thread passes
+// the start along, and that thread begins the stage again with it.
+int64_t TakeDeferred();
+
+// Completes the calling thread's deferred stage, if any, ending now.
+void EndDeferred(uint32_t trace_id);
+
+}  // namespace ipc_trace
+
+// FFI Exports for Dart binding
+extern "C" {
+
+/// FFI export: Record that a Dart handler received update trace_id.
+///
+/// Safe to bind as a leaf call. trace_id 0 (untraced update) is ignored.
+__declspec(dllexport) void RecordIpcTraceDartReceive(uint32_t trace_id);
+
+/// FFI export: Write the trace of all windows as Chrome JSON.
+///
+/// @param path UTF-8/ANSI file path
+/// @return true if the file was written
+__declspec(dllexport) bool ExportIpcTrace(const char* path);
+
+}  // extern "C"
+
+#endif  // RUNNER_IPC_TRACE_H_
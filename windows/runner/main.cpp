@@ -2,7 +2,14 @@
 #include <flutter/flutter_view_controller.h>
 #include <windows.h>
 
+#include <cstdio>
+
 #include "flutter_window.h"
+#include "ipc_capture.h"
+#include "ipc_log.h"
+#include "ipc_metrics.h"
+#include "ipc_namespace.h"
+#include "ipc_probes.h"
 #include "utils.h"
 
 int APIENTRY wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prev,
@@ -17,11 +24,25 @@ int APIENTRY wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prev,
   // plugins.
   ::CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
 
-  flutter::DartProject project(L"data");
-
   std::vector<std::string> command_line_arguments =
       GetCommandLineArguments();
 
+  // --ipc-namespace=<name> runs this window in a separate IPC instance, e.g.
+  // a second app profile. Must be set before any IPC object is created.
+  const std::string kNamespaceFlag = "--ipc-namespace=";
+  for (const std::string& argument : command_line_arguments) {
+    if (argument.compare(0, kNamespaceFlag.size(), kNamespaceFlag) == 0 &&
+        !ipc_namespace::SetDefault(argument.substr(kNamespaceFlag.size()))) {
+      std::fprintf(stderr, "Invalid IPC namespace: %s\n", argument.c_str());
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Static tracepoints stay dormant until an ETW session enables them.
+  ipc_probes::Register();
+
+  flutter::DartProject project(L"data");
+
   project.set_dart_entrypoint_arguments(std::move(command_line_arguments));
 
   FlutterWindow window(project);
@@ -38,6 +59,19 @@ int APIENTRY wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prev,
     ::DispatchMessage(&msg);
   }
 
+  // Finish a capture started from Dart so its file is complete.
+  ipc_capture::StopCapture();
+
+  // Log the fleet metrics, then hand this process's totals to the windows
+  // still open before the log is flushed.
+  ipc_metrics::DumpMetrics();
+  ipc_metrics::Shutdown();
+
+  // Write out buffered log lines before the process exits.
+  ipc_log::Shutdown();
+
+  ipc_probes::Unregister();
+
   ::CoUninitialize();
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,601 @@
+// shared_buffer_pool.cpp
+//
+// Implementation of SharedBufferPool, the zero-copy payload channel between
+// window processes.
+
+#include "shared_buffer_pool.h"
+
+#include <string>
+
+#include "ipc_log.h"
+#include "ipc_namespace.h"
+#include "ipc_process.h"
+
+namespace {
+const char* kPoolName = "Local\\FlutterMultiWindowBufferPool";
+
+// Per-process wake event; the process ID is appended (after the namespace)
+// so a publisher can wake exactly the receiver it targets.
+const char* kWakeEventName = "Local\\FlutterMultiWindowBufferReady";
+
+constexpr DWORD kPoolMagic = 0x42554646;  // 'BUFF'
+constexpr size_t kPoolSize =
+    kSharedBufferDataOffset +
+    static_cast<size_t>(kSharedBufferSlotCount) * kSharedBufferSlotSize;
+constexpr DWORD kRescanInterval = 5000;  // 5 second rescan for safety
+
+constexpr LONG64 kStateMask = 0x3;
+constexpr DWORD kGenerationMask = 0x3FFFFFFF;  // 30 bits above the state
+
+SharedBufferState StateOf(LONG64 word) {
+  return static_cast<SharedBufferState>(word & kStateMask);
+}
+
+DWORD GenerationOfWord(LONG64 word) {
+  return static_cast<DWORD>(word) >> 2;
+}
+
+LONG OwnerOf(LONG64 word) {
+  return static_cast<LONG>(static_cast<uint64_t>(word) >> 32);
+}
+
+// Holder of a slot in a state: the calling process while it writes or
+// reads the slot, nobody while it is Free or Published.
+LONG OwnerFor(SharedBufferState state) {
+  return state == kSharedBufferWriting || state == kSharedBufferReading
+             ? static_cast<LONG>(GetCurrentProcessId())
+             : 0;
+}
+
+LONG64 MakeStateWord(DWORD generation, SharedBufferState state,
+                     LONG owner_pid) {
+  return static_cast<LONG64>(
+      (static_cast<uint64_t>(static_cast<DWORD>(owner_pid)) << 32) |
+      ((generation & kGenerationMask) << 2) | state);
+}
+
+SharedBufferHandle MakeHandle(DWORD index, DWORD generation) {
+  return (static_cast<int64_t>(generation) << 32) | index;
+}
+
+DWORD IndexOf(SharedBufferHandle handle) {
+  return static_cast<DWORD>(handle & 0xFFFFFFFF);
+}
+
+DWORD GenerationOfHandle(SharedBufferHandle handle) {
+  return static_cast<DWORD>(handle >> 32);
+}
+
+}  // anonymous namespace
+
+SharedBufferPool::SharedBufferPool()
+    : SharedBufferPool(ipc_namespace::GetDefault()) {}
+
+SharedBufferPool::SharedBufferPool(const std::string& ipc_namespace)
+    : pool_name_(ipc_namespace::Qualify(kPoolName, ipc_namespace)),
+      wake_event_prefix_(
+          ipc_namespace::Qualify(kWakeEventName, ipc_namespace) + "."),
+      mapping_handle_(nullptr),
+      header_(nullptr),
+      data_(nullptr),
+      wake_event_(nullptr),
+      wake_handler_(IpcReactor::kInvalidHandler),
+      rescan_timer_(IpcReactor::kInvalidHandler),
+      is_receiving_(false),
+      callback_(nullptr) {}
+
+SharedBufferPool::~SharedBufferPool() {
+  StopReceiving();
+  Cleanup();
+}
+
+bool SharedBufferPool::Initialize() {
+  if (header_ != nullptr) {
+    return true;  // Idempotent - already initialized
+  }
+
+  mapping_handle_ = CreateFileMappingA(
+      INVALID_HANDLE_VALUE,                 // Backed by the paging file
+      nullptr,                              // Default security
+      PAGE_READWRITE,                       // Read/write access
+      static_cast<DWORD>(static_cast<uint64_t>(kPoolSize) >> 32),
+      static_cast<DWORD>(kPoolSize & 0xFFFFFFFF),
+      pool_name_.c_str());
+  if (mapping_handle_ == nullptr) {
+    IPC_LOG_ERROR("CreateFileMappingA failed for buffer pool: {}",
+                  GetLastError());
+    return false;
+  }
+  bool already_exists = (GetLastError() == ERROR_ALREADY_EXISTS);
+
+  void* view = MapViewOfFile(mapping_handle_, FILE_MAP_ALL_ACCESS, 0, 0,
+                             kPoolSize);
+  if (view == nullptr) {
+    IPC_LOG_ERROR("MapViewOfFile failed for buffer pool: {}", GetLastError());
+    Cleanup();
+    return false;
+  }
+  header_ = static_cast<SharedBufferPoolHeader*>(view);
+  data_ = static_cast<uint8_t*>(view) + kSharedBufferDataOffset;
+
+  if (!already_exists) {
+    // New sections are zero-filled, so every slot already reads as Free.
+    header_->layout_version = kSharedBufferLayoutVersion;
+    header_->slot_count = kSharedBufferSlotCount;
+    header_->slot_size = kSharedBufferSlotSize;
+    MemoryBarrier();
+    header_->magic = kPoolMagic;
+  } else if (header_->layout_version != kSharedBufferLayoutVersion ||
+             header_->slot_size != kSharedBufferSlotSize) {
+    IPC_LOG_ERROR("Buffer pool layout mismatch: version {}, slot size {}",
+                  header_->layout_version, header_->slot_size);
+    Cleanup();
+    return false;
+  }
+
+  // Auto-reset: exactly one wait is satisfied per signal, and only this
+  // process waits on it, so there is no reset race to paper over.
+  wake_event_ = CreateEventA(nullptr, FALSE, FALSE,
+                             WakeEventName(GetCurrentProcessId()).c_str());
+  if (wake_event_ == nullptr) {
+    IPC_LOG_ERROR("CreateEventA failed for buffer pool: {}", GetLastError());
+    Cleanup();
+    return false;
+  }
+
+  IPC_LOG_INFO("SharedBufferPool {}: {} x {} bytes",
+               already_exists ? "opened" : "created", kSharedBufferSlotCount,
+               kSharedBufferSlotSize);
+  return true;
+}
+
+SharedBufferHandle SharedBufferPool::Acquire() {
+  if (header_ == nullptr) {
+    return kInvalidSharedBuffer;
+  }
+
+  LONG pid = static_cast<LONG>(GetCurrentProcessId());
+  for (int pass = 0; pass < 2; pass++) {
+    for (DWORD i = 0; i < kSharedBufferSlotCount; i++) {
+      SharedBufferSlot& slot = header_->slots[i];
+      LONG64 word = slot.state_word;
+      if (StateOf(word) != kSharedBufferFree) {
+        continue;
+      }
+      DWORD generation = (GenerationOfWord(word) + 1) & kGenerationMask;
+      if (InterlockedCompareExchange64(
+              &slot.state_word,
+              MakeStateWord(generation, kSharedBufferWriting, pid),
+              word) != word) {
+        continue;  // Another writer took it
+      }
+      slot.sender_pid = pid;
+      slot.target_pid = 0;
+      slot.length = 0;
+      return MakeHandle(i, generation);
+    }
+
+    // Pool exhausted: recover slots from crashed windows, then retry once.
+    if (ReclaimAbandonedSlots() == 0) {
+      break;
+    }
+  }
+
+  IPC_LOG_WARN("SharedBufferPool exhausted");
+  return kInvalidSharedBuffer;
+}
+
+uint8_t* SharedBufferPool::GetData(SharedBufferHandle handle) const {
+  if (Resolve(handle, kSharedBufferWriting) == nullptr &&
+      Resolve(handle, kSharedBufferReading) == nullptr) {
+    return nullptr;
+  }
+  return data_ + static_cast<size_t>(IndexOf(handle)) * kSharedBufferSlotSize;
+}
+
+bool SharedBufferPool::Publish(SharedBufferHandle handle, DWORD length,
+                               DWORD target_pid) {
+  SharedBufferSlot* slot = Resolve(handle, kSharedBufferWriting);
+  if (slot == nullptr || length > kSharedBufferSlotSize ||
+      OwnerOf(slot->state_word) !=
+          static_cast<LONG>(GetCurrentProcessId())) {
+    IPC_LOG_ERROR("SharedBufferPool: invalid publish of handle {:x}", handle);
+    return false;
+  }
+
+  slot->length = length;
+  slot->target_pid = static_cast<LONG>(target_pid);
+  // Interlocked transition is a full barrier: payload and descriptor
+  // writes are visible before a receiver can observe Published.
+  if (!Transition(handle, kSharedBufferWriting, kSharedBufferPublished)) {
+    return false;
+  }
+
+  WakeReceivers(target_pid);
+  return true;
+}
+
+SharedBufferHandle SharedBufferPool::Claim(DWORD* length, DWORD* sender_pid) {
+  if (header_ == nullptr) {
+    return kInvalidSharedBuffer;
+  }
+
+  LONG pid = static_cast<LONG>(GetCurrentProcessId());
+  for (DWORD i = 0; i < kSharedBufferSlotCount; i++) {
+    SharedBufferSlot& slot = header_->slots[i];
+    LONG64 word = slot.state_word;
+    if (StateOf(word) != kSharedBufferPublished) {
+      continue;
+    }
+    // Targeted buffers go to their target only; untargeted buffers go to
+    // the first receiver that is not the sender.
+    LONG target = slot.target_pid;
+    if (target != 0 ? target != pid : slot.sender_pid == pid) {
+      continue;
+    }
+    SharedBufferHandle handle = MakeHandle(i, GenerationOfWord(word));
+    if (!Transition(handle, kSharedBufferPublished, kSharedBufferReading)) {
+      continue;  // Another receiver won the race
+    }
+    if (length) {
+      *length = slot.length;
+    }
+    if (sender_pid) {
+      *sender_pid = static_cast<DWORD>(slot.sender_pid);
+    }
+    return handle;
+  }
+  return kInvalidSharedBuffer;
+}
+
+bool SharedBufferPool::Release(SharedBufferHandle handle) {
+  return Transition(handle, kSharedBufferReading, kSharedBufferFree) ||
+         Transition(handle, kSharedBufferWriting, kSharedBufferFree);
+}
+
+bool SharedBufferPool::StartReceiving(SharedBufferCallback callback) {
+  if (is_receiving_) {
+    return true;  // Idempotent - already receiving
+  }
+  if (header_ == nullptr && !Initialize()) {
+    return false;
+  }
+  std::shared_ptr<IpcReactor> reactor = IpcReactor::Acquire();
+  if (!reactor) {
+    IPC_LOG_ERROR("SharedBufferPool: IPC reactor unavailable");
+    return false;
+  }
+
+  // Register in the receiver table so untargeted publishes wake us.
+  LONG pid = static_cast<LONG>(GetCurrentProcessId());
+  bool registered = false;
+  for (DWORD i = 0; i < kMaxSharedBufferReceivers && !registered; i++) {
+    LONG current = header_->receiver_pids[i];
+    if (current == pid) {
+      registered = true;
+    } else if (current == 0 ||
+               ipc_process::IsProcessGone(static_cast<DWORD>(current))) {
+      registered = InterlockedCompareExchange(&header_->receiver_pids[i], pid,
+                                              current) == current;
+    }
+  }
+  if (!registered) {
+    IPC_LOG_ERROR("SharedBufferPool: receiver table full");
+    return false;
+  }
+
+  callback_ = callback;
+  is_receiving_ = true;
+  reactor_ = reactor;
+  wake_handler_ = reactor_->AddHandle(wake_event_, [this] { DrainClaimed(); });
+  // The rescan covers a publisher that found no receiver to wake.
+  rescan_timer_ =
+      reactor_->AddTimer(kRescanInterval, [this] { DrainClaimed(); });
+  if (wake_handler_ == IpcReactor::kInvalidHandler) {
+    StopReceiving();
+    return false;
+  }
+
+  // Buffers may have been published to us before we registered.
+  SetEvent(wake_event_);
+  return true;
+}
+
+void SharedBufferPool::StopReceiving() {
+  if (!is_receiving_) {
+    return;  // Not running, nothing to stop
+  }
+
+  is_receiving_ = false;
+  // Once removed, the handlers are not running
+  reactor_->Remove(wake_handler_);
+  reactor_->Remove(rescan_timer_);
+  wake_handler_ = IpcReactor::kInvalidHandler;
+  rescan_timer_ = IpcReactor::kInvalidHandler;
+  reactor_.reset();
+
+  LONG pid = static_cast<LONG>(GetCurrentProcessId());
+  for (DWORD i = 0; i < kMaxSharedBufferReceivers; i++) {
+    InterlockedCompareExchange(&header_->receiver_pids[i], 0, pid);
+  }
+}
+
+DWORD SharedBufferPool::GetFreeSlotCount() const {
+  if (header_ == nullptr) {
+    return 0;
+  }
+  DWORD free_slots = 0;
+  for (DWORD i = 0; i < kSharedBufferSlotCount; i++) {
+    if (StateOf(header_->slots[i].state_word) == kSharedBufferFree) {
+      free_slots++;
+    }
+  }
+  return free_slots;
+}
+
+SharedBufferSlot* SharedBufferPool::Resolve(SharedBufferHandle handle,
+                                            SharedBufferState state) const {
+  if (header_ == nullptr || handle < 0 ||
+      IndexOf(handle) >= kSharedBufferSlotCount) {
+    return nullptr;
+  }
+  SharedBufferSlot& slot = header_->slots[IndexOf(handle)];
+  LONG64 word = slot.state_word;
+  if (StateOf(word) != state ||
+      GenerationOfWord(word) != GenerationOfHandle(handle)) {
+    return nullptr;  // Stale handle or wrong state
+  }
+  return &slot;
+}
+
+bool SharedBufferPool::Transition(SharedBufferHandle handle,
+                                  SharedBufferState from,
+                                  SharedBufferState to) {
+  SharedBufferSlot* slot = Resolve(handle, from);
+  if (slot == nullptr) {
+    return false;
+  }
+  LONG64 expected = slot->state_word;
+  if (StateOf(expected) != from ||
+      GenerationOfWord(expected) != GenerationOfHandle(handle)) {
+    return false;  // Moved on since Resolve()
+  }
+  return InterlockedCompareExchange64(
+             &slot->state_word,
+             MakeStateWord(GenerationOfHandle(handle), to, OwnerFor(to)),
+             expected) == expected;
+}
+
+DWORD SharedBufferPool::ReclaimAbandonedSlots() {
+  DWORD reclaimed = 0;
+  for (DWORD i = 0; i < kSharedBufferSlotCount; i++) {
+    SharedBufferSlot& slot = header_->slots[i];
+    LONG64 word = slot.state_word;
+    SharedBufferState state = StateOf(word);
+    // The process responsible for the slot: the holder of a Writing/Reading
+    // slot, the target of a targeted Published slot, or the sender of an
+    // untargeted one (nobody else is waiting for it).
+    LONG responsible = 0;
+    if (state == kSharedBufferWriting || state == kSharedBufferReading) {
+      responsible = OwnerOf(word);
+    } else if (state == kSharedBufferPublished) {
+      responsible = slot.target_pid != 0 ? slot.target_pid : slot.sender_pid;
+    }
+    if (responsible == 0 ||
+        !ipc_process::IsProcessGone(static_cast<DWORD>(responsible))) {
+      continue;
+    }
+    // Against the exact word read: a slot that changed hands since is not
+    // abandoned.
+    LONG64 free_word =
+        MakeStateWord(GenerationOfWord(word), kSharedBufferFree, 0);
+    if (InterlockedCompareExchange64(&slot.state_word, free_word, word) ==
+        word) {
+      reclaimed++;
+    }
+  }
+  if (reclaimed > 0) {
+    IPC_LOG_INFO("SharedBufferPool reclaimed {} abandoned slot(s)", reclaimed);
+  }
+  return reclaimed;
+}
+
+std::string SharedBufferPool::WakeEventName(DWORD pid) const {
+  return wake_event_prefix_ + std::to_string(pid);
+}
+
+void SharedBufferPool::WakeProcess(DWORD pid) {
+  if (pid == GetCurrentProcessId()) {
+    SetEvent(wake_event_);
+    return;
+  }
+  HANDLE event = OpenEventA(EVENT_MODIFY_STATE, FALSE,
+                            WakeEventName(pid).c_str());
+  if (event == nullptr) {
+    return;  // Receiver not running; it will scan when it starts
+  }
+  SetEvent(event);
+  CloseHandle(event);
+}
+
+void SharedBufferPool::WakeReceivers(DWORD target_pid) {
+  if (target_pid != 0) {
+    WakeProcess(target_pid);
+    return;
+  }
+  DWORD self = GetCurrentProcessId();
+  for (DWORD i = 0; i < kMaxSharedBufferReceivers; i++) {
+    DWORD pid = static_cast<DWORD>(header_->receiver_pids[i]);
+    if (pid != 0 && pid != self) {
+      WakeProcess(pid);
+    }
+  }
+}
+
+void SharedBufferPool::DrainClaimed() {
+  // One signal may cover several publishes; drain everything ours.
+  DWORD length = 0;
+  DWORD sender_pid = 0;
+  SharedBufferHandle handle;
+  while ((handle = Claim(&length, &sender_pid)) != kInvalidSharedBuffer) {
+    if (callback_) {
+      callback_(handle, GetData(handle), length, sender_pid);
+    } else {
+      Release(handle);
+    }
+  }
+}
+
+void SharedBufferPool::Cleanup() {
+  if (wake_event_) {
+    CloseHandle(wake_event_);
+    wake_event_ = nullptr;
+  }
+  if (header_) {
+    UnmapViewOfFile(header_);
+    header_ = nullptr;
+    data_ = nullptr;
+  }
+  if (mapping_handle_) {
+    CloseHandle(mapping_handle_);
+    mapping_handle_ = nullptr;
+  }
+}
+
+// ============================================================================
+// Dart delivery
+// ============================================================================
+
+namespace {
+// Finalizer attached to the external Uint8List. Runs on a Dart thread when
+// the list is garbage collected; the peer carries the buffer handle.
+void SharedBufferFinalizer(void* /* isolate_callback_data */, void* peer) {
+  GetGlobalSharedBufferPool().Release(
+      static_cast<SharedBufferHandle>(reinterpret_cast<intptr_t>(peer)));
+}
+}  // anonymous namespace
+
+bool PostSharedBufferToPort(Dart_Port_DL port, SharedBufferHandle handle,
+                            uint8_t* data, DWORD length, DWORD sender_pid) {
+  Dart_CObject handle_object;
+  handle_object.type = Dart_CObject_kInt64;
+  handle_object.value.as_int64 = handle;
+
+  Dart_CObject sender_object;
+  sender_object.type = Dart_CObject_kInt64;
+  sender_object.value.as_int64 = sender_pid;
+
+  Dart_CObject data_object;
+  data_object.type = Dart_CObject_kExternalTypedData;
+  data_object.value.as_external_typed_data.type = Dart_TypedData_kUint8;
+  data_object.value.as_external_typed_data.length = length;
+  data_object.value.as_external_typed_data.data = data;
+  data_object.value.as_external_typed_data.peer =
+      reinterpret_cast<void*>(static_cast<intptr_t>(handle));
+  data_object.value.as_external_typed_data.callback = SharedBufferFinalizer;
+
+  Dart_CObject* elements[] = {&handle_object, &sender_object, &data_object};
+  Dart_CObject message;
+  message.type = Dart_CObject_kArray;
+  message.value.as_array.length = 3;
+  message.value.as_array.values = elements;
+
+  if (!Dart_PostCObject_DL(port, &message)) {
+    // The VM only takes ownership (and calls the finalizer) on success.
+    IPC_LOG_ERROR("Failed to post shared buffer to port {}", port);
+    GetGlobalSharedBufferPool().Release(handle);
+    return false;
+  }
+  return true;
+}
+
+// ============================================================================
+// FFI Exports - C functions callable from Dart via FFI
+// ============================================================================
+
+SharedBufferPool& GetGlobalSharedBufferPool() {
+  static SharedBufferPool pool;
+  return pool;
+}
+
+extern "C" {
+
+/// Open the pool and start delivering received buffers.
+///
+/// Dart usage:
+///   final inbox = ReceivePort();
+///   openSharedBufferPool(inbox.sendPort.nativePort);
+///   inbox.listen((message) {
+///     final [handle, sender, Uint8List data] = message as List;
+///     // data points into shared memory; slot is freed when data is GC'd
+///   });
+///
+/// @param receive_port Dart_Port_DL that receives buffers for this window
+/// @return true if the receiver is running
+__declspec(dllexport) bool OpenSharedBufferPool(Dart_Port_DL receive_port) {
+  SharedBufferPool& pool = GetGlobalSharedBufferPool();
+  if (!pool.Initialize()) {
+    return false;
+  }
+  return pool.StartReceiving([receive_port](SharedBufferHandle handle,
+                                            uint8_t* data, DWORD length,
+                                            DWORD sender_pid) {
+    PostSharedBufferToPort(receive_port, handle, data, length, sender_pid);
+  });
+}
+
+/// Stop delivering received buffers to the port given to
+/// OpenSharedBufferPool. Buffers already posted stay valid until Dart
+/// collects them; buffers for this window published later wait in the pool
+/// (and are reclaimed once the process exits) instead of going to a closed
+/// port.
+///
+/// Dart usage:
+///   pool.close();  // before closing the ReceivePort
+__declspec(dllexport) void CloseSharedBufferPool() {
+  GetGlobalSharedBufferPool().StopReceiving();
+}
+
+/// Reserve a slot for writing. The pool must have been opened with
+/// OpenSharedBufferPool: this is a leaf call from Dart, so it does not map
+/// the pool itself.
+///
+/// Dart usage:
+///   final handle = acquireSharedBuffer();
+///   final bytes = getSharedBufferData(handle).asTypedList(capacity);
+///   bytes.setAll(0, payload);  // writes straight into shared memory
+///   publishSharedBuffer(handle, payload.length, 0);
+///
+/// @return buffer handle, or -1 if the pool is full
+__declspec(dllexport) int64_t AcquireSharedBuffer() {
+  return GetGlobalSharedBufferPool().Acquire();
+}
+
+/// @return writable payload memory of an acquired slot, or nullptr
+__declspec(dllexport) uint8_t* GetSharedBufferData(int64_t handle) {
+  return GetGlobalSharedBufferPool().GetData(handle);
+}
+
+/// @return capacity of every slot in bytes
+__declspec(dllexport) uint32_t GetSharedBufferCapacity() {
+  return kSharedBufferSlotSize;
+}
+
+/// Publish a filled slot to another window.
+///
+/// @param target_pid receiving window process, 0 for any other window
+/// @return true if published
+__declspec(dllexport) bool PublishSharedBuffer(int64_t handle,
+                                               uint32_t length,
+                                               uint32_t target_pid) {
+  return GetGlobalSharedBufferPool().Publish(handle, length, target_pid);
+}
+
+/// Abandon an acquired slot without publishing it.
+///
+/// @return true if the slot was returned to the pool
+__declspec(dllexport) bool ReleaseSharedBuffer(int64_t handle) {
+  return GetGlobalSharedBufferPool().Release(handle);
+}
+
+}  // extern "C"
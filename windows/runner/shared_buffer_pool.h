@@ -0,0 +1,266 @@
+// shared_buffer_pool.h
+//
+// SharedBufferPool: Zero-copy transfer of large payloads between windows.
+//
+// A fixed pool of buffers lives in one named shared memory section next to
+// the window counter. A sender acquires a slot, fills it in place (Dart
+// writes straight into the mapping through a Uint8List view), and publishes
+// its handle. The receiving process claims the slot and hands Dart a
+// Dart_CObject_kExternalTypedData that points into the same mapping; the
+// typed data's finalizer returns the slot to the pool. Payload bytes are
+// never copied in native code.
+//
+// Thread Safety: Slot state transitions use interlocked compare-exchange on
+// the shared slot table, so any thread of any process may call Acquire(),
+// Publish(), Claim() and Release() concurrently.
+
+#ifndef RUNNER_SHARED_BUFFER_POOL_H_
+#define RUNNER_SHARED_BUFFER_POOL_H_
+
+#include <dart_api_dl.h>
+#include <windows.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "ipc_reactor.h"
+
+// Pool geometry. Fixed at compile time so every process agrees on offsets.
+constexpr DWORD kSharedBufferSlotCount = 16;
+constexpr DWORD kSharedBufferSlotSize = 4 * 1024 * 1024;  // 4 MiB per slot
+constexpr DWORD kMaxSharedBufferReceivers = 16;
+
+// Version of the pool layout. Bump whenever the header or slot changes.
+constexpr DWORD kSharedBufferLayoutVersion = 2;
+
+// Lifecycle of one slot:
+//   Free → Writing (Acquire) → Published (Publish) → Reading (Claim) → Free
+// A writer may also abandon its slot (Writing → Free via Release).
+enum SharedBufferState : LONG {
+  kSharedBufferFree = 0,
+  kSharedBufferWriting = 1,
+  kSharedBufferPublished = 2,
+  kSharedBufferReading = 3,
+};
+
+// Slot descriptor in the shared header (32 bytes).
+//
+// State, generation and owner share one word,
+// (owner_pid << 32) | (generation << 2) | state, so every transition is a
+// single compare-exchange that also checks the caller's handle is current
+// and publishes the new holder with the state. A stale handle can never
+// move a reused slot, and crash recovery never sees a Writing or Reading
+// slot with its previous holder.
+struct SharedBufferSlot {
+  volatile LONG64 state_word;  // Owner, generation and SharedBufferState
+  volatile LONG sender_pid;    // Process that published the payload
+  volatile LONG target_pid;    // Receiving process, 0 = first other process
+  DWORD length;                // Payload length in bytes
+  DWORD reserved[3];
+};
+
+static_assert(sizeof(SharedBufferSlot) == 32, "Shared layout");
+
+// Header at the start of the pool section. Payload data starts at
+// kSharedBufferDataOffset so every slot is page aligned.
+struct SharedBufferPoolHeader {
+  DWORD magic;
+  DWORD layout_version;
+  DWORD slot_count;
+  DWORD slot_size;
+  // Processes running a receiver, 0 = empty entry. Used to wake
+  // receivers when a buffer is published to "any other process".
+  volatile LONG receiver_pids[kMaxSharedBufferReceivers];
+  SharedBufferSlot slots[kSharedBufferSlotCount];
+};
+
+constexpr size_t kSharedBufferDataOffset = 4096;
+static_assert(sizeof(SharedBufferPoolHeader) <= kSharedBufferDataOffset,
+              "Pool header must fit in the first page");
+
+// Opaque buffer handle: (generation << 32) | slot index.
+// The generation is bumped on every Acquire, which makes a stale handle
+// (e.g. a late finalizer) harmless. Negative values are invalid.
+typedef int64_t SharedBufferHandle;
+constexpr SharedBufferHandle kInvalidSharedBuffer = -1;
+
+// Called on the process's IpcReactor thread for every claimed buffer. The
+// slot stays in the Reading state until Release(handle) is called.
+using SharedBufferCallback =
+    std::function<void(SharedBufferHandle handle, uint8_t* data,
+                       DWORD length, DWORD sender_pid)>;
+
+// Manages the shared buffer pool section and this process's receiver.
+//
+// Example usage (sender):
+//   SharedBufferHandle handle = pool.Acquire();
+//   memcpy(pool.GetData(handle), bytes, size);  // or fill in place
+//   pool.Publish(handle, size, 0);              // any other window
+//
+// Example usage (receiver):
+//   pool.StartReceiving([&](SharedBufferHandle h, uint8_t* data,
+//                           DWORD length, DWORD sender) {
+//     Consume(data, length);
+//     pool.Release(h);
+//   });
+class SharedBufferPool {
+ public:
+  // Pool of the process default IPC namespace (ipc_namespace::GetDefault()).
+  SharedBufferPool();
+
+  // Pool of the given IPC namespace; "" is the app's own instance.
+  explicit SharedBufferPool(const std::string& ipc_namespace);
+
+  // Stops the receiver and unmaps the pool.
+  ~SharedBufferPool();
+
+  // Creates or opens the pool section and this process's wake event.
+  //
+  // Returns true on success. Safe to call multiple times (idempotent).
+  bool Initialize();
+
+  // Reserves a free slot for writing.
+  //
+  // If the pool is exhausted, first reclaims slots stuck on processes that
+  // have exited. Returns kInvalidSharedBuffer if still none is free.
+  SharedBufferHandle Acquire();
+
+  // Returns the slot's payload memory, or nullptr if the handle is stale.
+  // Valid for kSharedBufferSlotSize bytes while the caller holds the slot.
+  uint8_t* GetData(SharedBufferHandle handle) const;
+
+  // Hands a written slot to a receiver and wakes it.
+  //
+  // @param handle Slot returned by Acquire()
+  // @param length Payload bytes, at most kSharedBufferSlotSize
+  // @param target_pid Receiving process, or 0 for the first other process
+  //                   running a receiver
+  // @return true if the slot was published
+  bool Publish(SharedBufferHandle handle, DWORD length, DWORD target_pid);
+
+  // Takes one buffer published to this process, if any.
+  //
+  // @param length Receives the payload length
+  // @param sender_pid Receives the publishing process ID
+  // @return Handle in the Reading state, or kInvalidSharedBuffer
+  SharedBufferHandle Claim(DWORD* length, DWORD* sender_pid);
+
+  // Returns a slot in the Writing or Reading state to the pool.
+  //
+  // Stale handles (generation mismatch) are ignored and return false, so
+  // a finalizer that runs after the slot was reused cannot free it.
+  bool Release(SharedBufferHandle handle);
+
+  // Claims buffers for this process on the shared IpcReactor and passes
+  // each to callback. Registers this process as a receiver.
+  //
+  // Returns true on success. Safe to call multiple times (idempotent).
+  bool StartReceiving(SharedBufferCallback callback);
+
+  // Stops receiving and unregisters this process. Must not be called from
+  // the callback. Safe to call when not running (no-op).
+  void StopReceiving();
+
+  // True between StartReceiving() and StopReceiving().
+  bool IsReceiving() const { return is_receiving_; }
+
+  // Returns number of slots currently in the Free state.
+  DWORD GetFreeSlotCount() const;
+
+ private:
+  // Returns the slot a handle refers to if its generation is current and
+  // it is in the given state, else nullptr.
+  SharedBufferSlot* Resolve(SharedBufferHandle handle,
+                            SharedBufferState state) const;
+
+  // Moves a slot from one state to another if the handle is still current.
+  bool Transition(SharedBufferHandle handle, SharedBufferState from,
+                  SharedBufferState to);
+
+  // Frees slots stuck on a process that has exited: Writing/Reading slots
+  // of a dead owner, Published slots targeted at a dead receiver, and
+  // untargeted Published slots of a dead sender.
+  DWORD ReclaimAbandonedSlots();
+
+  // Name of the wake event of one receiver process.
+  std::string WakeEventName(DWORD pid) const;
+
+  // Signals the wake event of one receiver process.
+  void WakeProcess(DWORD pid);
+
+  // Signals the target, or every other registered receiver if target is 0.
+  void WakeReceivers(DWORD target_pid);
+
+  // Reactor handler for the wake event and the rescan timer: claims and
+  // delivers everything published to this process.
+  void DrainClaimed();
+
+  // Unmaps the section and closes handles.
+  void Cleanup();
+
+  std::string pool_name_;               // Namespaced section name
+  std::string wake_event_prefix_;       // Namespaced, followed by a PID
+  HANDLE mapping_handle_;               // Pool section
+  SharedBufferPoolHeader* header_;      // Mapped header
+  uint8_t* data_;                       // First slot payload
+  HANDLE wake_event_;                   // This process's auto-reset event
+  std::shared_ptr<IpcReactor> reactor_;  // Runs the receiver handlers
+  IpcReactor::HandlerId wake_handler_;   // Wake event registration
+  IpcReactor::HandlerId rescan_timer_;   // Periodic rescan registration
+  std::atomic<bool> is_receiving_;      // Receiver running flag
+  SharedBufferCallback callback_;       // Receiver callback
+};
+
+// Get global SharedBufferPool instance.
+SharedBufferPool& GetGlobalSharedBufferPool();
+
+// Posts a claimed buffer to a Dart port as [handle, sender_pid, Uint8List].
+//
+// The Uint8List is Dart_CObject_kExternalTypedData over the mapped slot;
+// its finalizer releases the slot when Dart garbage-collects it. If the
+// post fails the slot is released immediately.
+//
+// @return true if the message was posted
+bool PostSharedBufferToPort(Dart_Port_DL port, SharedBufferHandle handle,
+                            uint8_t* data, DWORD length, DWORD sender_pid);
+
+// FFI Exports for Dart binding
+extern "C" {
+
+/// FFI export: Open the pool and deliver received buffers to receive_port.
+///
+/// Each message is a List: [handle (int), sender_pid (int), data (Uint8List)]
+/// where data is a zero-copy view into shared memory.
+///
+/// @return true if the pool is open and the receiver is running
+__declspec(dllexport) bool OpenSharedBufferPool(Dart_Port_DL receive_port);
+
+/// FFI export: Stop delivering buffers to the port given to
+/// OpenSharedBufferPool.
+__declspec(dllexport) void CloseSharedBufferPool();
+
+/// FFI export: Reserve a slot for writing. Returns -1 if the pool is full
+/// or was not opened with OpenSharedBufferPool.
+__declspec(dllexport) int64_t AcquireSharedBuffer();
+
+/// FFI export: Writable payload memory of an acquired slot, or nullptr.
+__declspec(dllexport) uint8_t* GetSharedBufferData(int64_t handle);
+
+/// FFI export: Capacity of every slot in bytes.
+__declspec(dllexport) uint32_t GetSharedBufferCapacity();
+
+/// FFI export: Publish a filled slot (target_pid 0 = any other window).
+__declspec(dllexport) bool PublishSharedBuffer(int64_t handle,
+                                               uint32_t length,
+                                               uint32_t target_pid);
+
+/// FFI export: Abandon an acquired slot without publishing it.
+__declspec(dllexport) bool ReleaseSharedBuffer(int64_t handle);
+
+}  // extern "C"
+
+#endif  // RUNNER_SHARED_BUFFER_POOL_H_
@@ -4,23 +4,52 @@
 
 #include "shared_memory_manager.h"
 
-#include <iostream>
+#include "ipc_flight_recorder.h"
+#include "ipc_log.h"
+#include "ipc_metrics.h"
+#include "ipc_namespace.h"
+#include "ipc_probes.h"
+#include "ipc_trace.h"
 
 // Shared memory configuration constants
 namespace {
-// Use "Local\" namespace to scope shared memory to current login session.
-// Alternative "Global\" would require administrator privileges and share
-// memory across all sessions, which is unnecessary for this use case.
-const char* kSharedMemoryName = "Local\\FlutterMultiWindowCounter";
+// kSharedMemoryName uses the "Local\" namespace (see header). Alternative
+// "Global\" would require administrator privileges and share memory across
+// all sessions, which is unnecessary for this use case.
 constexpr size_t kSharedMemorySize = sizeof(SharedMemoryData);
-const char* kEventName = "Local\\FlutterWindowCountChanged";
+
+// Seqlock reader retry budget. A write holds the sequence odd for two
+// interlocked operations, so this is only exhausted if a writer died
+// mid-update.
+constexpr int kMaxSnapshotRetries = 10000;
+
+// Writer spins this many times before yielding its time slice.
+constexpr int kWriterSpinsBeforeYield = 64;
+
+// A sequence that stays at the same odd value this long belongs to a writer
+// that died mid-update (a live one holds it for two interlocked operations);
+// the next writer takes the seqlock over instead of waiting forever.
+constexpr ULONGLONG kWriterStallMs = 100;
+
+// How long an opener waits for the creator to finish initializing.
+constexpr int kInitWaitMs = 100;
+
+// Manager whose read-only view is exported to Dart (see GetSharedMemoryView).
+SharedMemoryManager* g_shared_memory_manager = nullptr;
 }  // anonymous namespace
 
 SharedMemoryManager::SharedMemoryManager()
-    : shared_memory_handle_(nullptr),
+    : SharedMemoryManager(ipc_namespace::GetDefault()) {}
+
+SharedMemoryManager::SharedMemoryManager(const std::string& ipc_namespace)
+    : shared_memory_name_(
+          ipc_namespace::Qualify(kSharedMemoryName, ipc_namespace)),
+      event_name_(ipc_namespace::Qualify(kWindowCountEventName, ipc_namespace)),
+      shared_memory_handle_(nullptr),
       shared_data_(nullptr),
       is_initialized_(false),
-      update_event_(nullptr) {
+      update_event_(nullptr),
+      read_only_view_(nullptr) {
   // Constructor initializes all members to safe defaults
   // Actual initialization happens in Initialize()
   // TODO: In GREEN phase, create update_event_ in CreateSharedMemory()
@@ -32,12 +61,12 @@ SharedMemoryManager::~SharedMemoryManager() {
 
 bool SharedMemoryManager::Initialize() {
   if (is_initialized_) {
-    std::cout << "SharedMemoryManager already initialized" << std::endl;
+    IPC_LOG_DEBUG("SharedMemoryManager already initialized");
     return true;
   }
 
   if (!CreateSharedMemory()) {
-    std::cerr << "Failed to create/open shared memory" << std::endl;
+    IPC_LOG_ERROR("Failed to create/open shared memory");
     return false;
   }
 
@@ -47,32 +76,47 @@ bool SharedMemoryManager::Initialize() {
 
 LONG SharedMemoryManager::IncrementWindowCount() {
   if (!is_initialized_ || !shared_data_) {
-    std::cerr << "SharedMemoryManager not initialized" << std::endl;
+    IPC_LOG_ERROR("SharedMemoryManager not initialized");
     return -1;
   }
 
-  LONG new_count = InterlockedIncrement(&shared_data_->window_count);
-  std::cout << "Window count incremented: " << new_count << std::endl;
-
-  // Signal event to notify listeners of count change
-  if (update_event_) {
-    SetEvent(update_event_);
-  }
-
+  LONG new_count = ApplyCountChange(1);
+  IPC_LOG_INFO("Window count incremented: {}", new_count);
   return new_count;
 }
 
 LONG SharedMemoryManager::DecrementWindowCount() {
   if (!is_initialized_ || !shared_data_) {
-    std::cerr << "SharedMemoryManager not initialized" << std::endl;
+    IPC_LOG_ERROR("SharedMemoryManager not initialized");
     return -1;
   }
 
-  LONG new_count = InterlockedDecrement(&shared_data_->window_count);
-  std::cout << "Window count decremented: " << new_count << std::endl;
+  LONG new_count = ApplyCountChange(-1);
+  IPC_LOG_INFO("Window count decremented: {}", new_count);
+  return new_count;
+}
+
+LONG SharedMemoryManager::ApplyCountChange(LONG delta) {
+  int64_t write_start = ipc_trace::Now();
+  LONG write_sequence = BeginWrite();
+  LONG new_count =
+      InterlockedExchangeAdd(&shared_data_->window_count, delta) + delta;
+  InterlockedExchange(&shared_data_->last_writer_pid,
+                      static_cast<LONG>(GetCurrentProcessId()));
+  DWORD trace_id = AssignTraceId();
+  ipc_metrics::GetRegistry().RecordWrite();  // For spinning listeners
+  EndWrite(write_sequence);
+  IPC_PROBE_COUNT_CHANGE(delta, new_count, trace_id);
+  ipc_flight::Record(
+      delta > 0 ? ipc_flight::kFlightIncrement : ipc_flight::kFlightDecrement,
+      new_count, delta, trace_id);
+  ipc_trace::Record(ipc_trace::kStageCounterWrite, trace_id, write_start,
+                    ipc_trace::Now());
 
   // Signal event to notify listeners of count change
   if (update_event_) {
+    ipc_trace::Span span(ipc_trace::kStageEventSignal, trace_id);
+    ipc_metrics::GetRegistry().RecordNotifySent();
     SetEvent(update_event_);
   }
 
@@ -86,6 +130,131 @@ LONG SharedMemoryManager::GetWindowCount() const {
   return shared_data_->window_count;
 }
 
+DWORD SharedMemoryManager::GetLastWriterProcessId() const {
+  if (!shared_data_) {
+    return 0;
+  }
+  return static_cast<DWORD>(shared_data_->last_writer_pid);
+}
+
+bool SharedMemoryManager::ReadSnapshot(SharedMemorySnapshot* snapshot) const {
+  if (!shared_data_ || !snapshot) {
+    return false;
+  }
+
+  if (!ReadSnapshotFrom(shared_data_, snapshot)) {
+    IPC_LOG_ERROR("SharedMemoryManager: snapshot retries exhausted");
+    return false;
+  }
+  return true;
+}
+
+bool SharedMemoryManager::ReadSnapshotFrom(const SharedMemoryData* data,
+                                           SharedMemorySnapshot* snapshot) {
+  if (!data || !snapshot) {
+    return false;
+  }
+
+  for (int attempt = 0; attempt < kMaxSnapshotRetries; attempt++) {
+    LONG before = ReadAcquire(&data->sequence);
+    if (before & 1) {
+      YieldProcessor();  // Writer in progress
+      continue;
+    }
+
+    SharedMemorySnapshot copy;
+    copy.window_count = ReadNoFence(&data->window_count);
+    copy.last_writer_pid =
+        static_cast<DWORD>(ReadNoFence(&data->last_writer_pid));
+    copy.sequence = before;
+    copy.trace_id = static_cast<DWORD>(ReadNoFence(&data->trace_id));
+
+    // Order the field loads before re-reading the sequence.
+    MemoryBarrier();
+    if (ReadNoFence(&data->sequence) == before) {
+      *snapshot = copy;
+      return true;
+    }
+  }
+  return false;
+}
+
+const SharedMemoryData* SharedMemoryManager::GetReadOnlyView() {
+  if (!is_initialized_ || !shared_memory_handle_) {
+    return nullptr;
+  }
+
+  if (read_only_view_ == nullptr) {
+    // A second view of the same section, mapped read-only, so Dart cannot
+    // write shared state through the pointer it is given.
+    read_only_view_ = static_cast<const SharedMemoryData*>(
+        MapViewOfFile(shared_memory_handle_, FILE_MAP_READ, 0, 0,
+                      kSharedMemorySize));
+    if (read_only_view_ == nullptr) {
+      IPC_LOG_ERROR("MapViewOfFile(FILE_MAP_READ) failed: {}", GetLastError());
+    }
+  }
+
+  return read_only_view_;
+}
+
+LONG SharedMemoryManager::BeginWrite() {
+  LONG stalled_sequence = 0;  // Odd value being waited on, 0 if none
+  ULONGLONG stalled_since = 0;
+  for (int spins = 0;; spins++) {
+    LONG sequence = ReadAcquire(&shared_data_->sequence);
+    if ((sequence & 1) == 0) {
+      if (InterlockedCompareExchange(&shared_data_->sequence, sequence + 1,
+                                     sequence) == sequence) {
+        return sequence + 1;
+      }
+      continue;  // Another writer got in first
+    }
+    if (spins < kWriterSpinsBeforeYield) {
+      YieldProcessor();
+      continue;
+    }
+
+    ULONGLONG now = GetTickCount64();
+    if (sequence != stalled_sequence) {
+      stalled_sequence = sequence;  // Progress; start timing this writer
+      stalled_since = now;
+    } else if (now - stalled_since >= kWriterStallMs) {
+      // Writer died mid-update: close its write so the counter is usable
+      // again. The count itself is updated atomically, so nothing is lost.
+      if (InterlockedCompareExchange(&shared_data_->sequence, sequence + 1,
+                                     sequence) == sequence) {
+        IPC_LOG_WARN("Seqlock held at {} for {} ms; writer presumed dead",
+                     sequence, now - stalled_since);
+      }
+      stalled_sequence = 0;
+      continue;
+    }
+    SwitchToThread();
+  }
+}
+
+void SharedMemoryManager::EndWrite(LONG write_sequence) {
+  // Only if the write is still ours: a writer stalled past kWriterStallMs
+  // may have been taken over, and incrementing then would leave the
+  // sequence odd for good.
+  InterlockedCompareExchange(&shared_data_->sequence, write_sequence + 1,
+                             write_sequence);
+}
+
+DWORD SharedMemoryManager::AssignTraceId() {
+  // Interlocked even inside the write: after a kWriterStallMs takeover the
+  // stalled writer may still be running, and must not get the same ID.
+  DWORD trace_id =
+      static_cast<DWORD>(InterlockedIncrement(&shared_data_->trace_id));
+  if (trace_id == 0) {
+    // Skip 0 on wrap-around
+    trace_id =
+        static_cast<DWORD>(InterlockedIncrement(&shared_data_->trace_id));
+  }
+  return trace_id;
+}
+
 bool SharedMemoryManager::CreateSharedMemory() {
   // Create or open shared memory section using Windows file mapping.
   // INVALID_HANDLE_VALUE tells Windows to use the paging file rather than
@@ -97,23 +266,22 @@ bool SharedMemoryManager::CreateSharedMemory() {
       nullptr,               // Default security descriptor
       PAGE_READWRITE,        // Read/write access for all processes
       0,                     // High-order DWORD of maximum size
-      kSharedMemorySize,     // Low-order DWORD of maximum size (16 bytes)
-      kSharedMemoryName);    // Name of mapping object
+      kSharedMemorySize,     // Low-order DWORD of maximum size (32 bytes)
+      shared_memory_name_.c_str());  // Name of mapping object
 
   // CRITICAL: Get error code IMMEDIATELY before any other Windows API calls
   DWORD last_error = GetLastError();
   bool already_exists = (last_error == ERROR_ALREADY_EXISTS);
 
   // Log diagnostic information for Test 1.1
-  std::cout << "[TEST 1.1] CreateFileMappingA for '" << kSharedMemoryName << "'" << std::endl;
-  std::cout << "  Handle: " << shared_memory_handle_ << std::endl;
-  std::cout << "  GetLastError(): " << last_error << std::endl;
-  std::cout << "  ERROR_ALREADY_EXISTS: " << ERROR_ALREADY_EXISTS << std::endl;
-  std::cout << "  already_exists: " << (already_exists ? "true" : "false") << std::endl;
+  IPC_LOG_DEBUG("[TEST 1.1] CreateFileMappingA for '{}' handle={} "
+                "GetLastError()={} already_exists={}",
+                shared_memory_name_, shared_memory_handle_, last_error,
+                already_exists);
 
   if (shared_memory_handle_ == nullptr) {
-    std::cerr << "CreateFileMappingA failed for '" << kSharedMemoryName
-              << "': Error code " << last_error << std::endl;
+    IPC_LOG_ERROR("CreateFileMappingA failed for '{}': Error code {}",
+                  shared_memory_name_, last_error);
     return false;
   }
 
@@ -129,8 +297,8 @@ bool SharedMemoryManager::CreateSharedMemory() {
 
   if (shared_data_ == nullptr) {
     DWORD error = GetLastError();
-    std::cerr << "MapViewOfFile failed for '" << kSharedMemoryName
-              << "': Error code " << error << std::endl;
+    IPC_LOG_ERROR("MapViewOfFile failed for '{}': Error code {}",
+                  shared_memory_name_, error);
     CloseHandle(shared_memory_handle_);
     shared_memory_handle_ = nullptr;
     return false;
@@ -143,26 +311,47 @@ bool SharedMemoryManager::CreateSharedMemory() {
   if (!already_exists) {
     // First process: Initialize and set magic marker
     shared_data_->window_count = 0;
-    shared_data_->reserved[0] = 0xDEADBEEF;  // Magic marker for Test 1.2
-    shared_data_->reserved[1] = 0;
-    shared_data_->reserved[2] = 0;
-
-    std::cout << "Shared memory created: " << kSharedMemoryName << std::endl;
-    std::cout << "[TEST 1.2] Set magic marker: 0xDEADBEEF" << std::endl;
+    shared_data_->layout_version = kSharedMemoryLayoutVersion;
+    shared_data_->last_writer_pid = 0;
+    shared_data_->sequence = 0;
+    shared_data_->data_size = sizeof(SharedMemoryData);
+    shared_data_->trace_id = 0;
+    shared_data_->reserved = 0;
+    // Magic last: openers wait for it before reading the header
+    MemoryBarrier();
+    shared_data_->magic = kSharedMemoryMagic;  // Magic marker for Test 1.2
+
+    IPC_LOG_INFO("Shared memory created: {}", shared_memory_name_);
+    IPC_LOG_DEBUG("[TEST 1.2] Set magic marker: 0xDEADBEEF");
   } else {
     // Second+ process: Verify magic marker from first process
-    std::cout << "Shared memory opened (already exists): "
-              << kSharedMemoryName << std::endl;
-    std::cout << "[TEST 1.2] Read magic marker: 0x" << std::hex
-              << shared_data_->reserved[0] << std::dec << std::endl;
+    IPC_LOG_INFO("Shared memory opened (already exists): {}",
+                 shared_memory_name_);
+    for (int i = 0;
+         i < kInitWaitMs && shared_data_->magic != kSharedMemoryMagic; i++) {
+      Sleep(1);  // Creator still initializing
+    }
+    IPC_LOG_DEBUG("[TEST 1.2] Read magic marker: {:x}", shared_data_->magic);
 
     // Verify shared memory is actually shared
-    if (shared_data_->reserved[0] == 0xDEADBEEF) {
-      std::cout << "[TEST 1.2] ✓ PASS - Magic marker matches! Memory IS shared." << std::endl;
+    if (shared_data_->magic == kSharedMemoryMagic) {
+      IPC_LOG_DEBUG("[TEST 1.2] PASS - Magic marker matches! Memory IS shared.");
     } else {
-      std::cerr << "[TEST 1.2] ✗ FAIL - Magic marker mismatch! Memory is NOT shared." << std::endl;
-      std::cerr << "  Expected: 0xDEADBEEF, Got: 0x" << std::hex
-                << shared_data_->reserved[0] << std::dec << std::endl;
+      IPC_LOG_ERROR("Magic marker mismatch! Memory is NOT shared. "
+                    "Expected: {:x}, Got: {:x}",
+                    kSharedMemoryMagic, shared_data_->magic);
+      Cleanup();
+      return false;
+    }
+
+    // A creator built from a different layout would disagree on field
+    // offsets; refuse the segment rather than misread shared state.
+    if (shared_data_->layout_version != kSharedMemoryLayoutVersion) {
+      IPC_LOG_ERROR("Shared memory layout version mismatch: segment has {}, "
+                    "expected {}",
+                    shared_data_->layout_version, kSharedMemoryLayoutVersion);
+      Cleanup();
+      return false;
     }
   }
 
@@ -174,10 +363,10 @@ bool SharedMemoryManager::CreateSharedMemory() {
   // Event type: Manual-reset (TRUE) - stays signaled until explicitly reset
   // This allows ALL waiting threads across processes to wake up.
   // Event state: Non-signaled initially (FALSE)
-  update_event_ = CreateEventA(nullptr, TRUE, FALSE, kEventName);
+  update_event_ = CreateEventA(nullptr, TRUE, FALSE, event_name_.c_str());
   if (update_event_ == nullptr) {
     DWORD error = GetLastError();
-    std::cerr << "CreateEventA failed: " << error << std::endl;
+    IPC_LOG_ERROR("CreateEventA failed: {}", error);
     // Continue anyway - event is not critical for basic functionality
   }
 
@@ -188,7 +377,12 @@ void SharedMemoryManager::Cleanup() {
   // RAII cleanup: Release Windows resources in reverse order of acquisition.
   // Safe to call multiple times or with null handles.
 
-  // First, unmap the memory view (if mapped)
+  // First, unmap the memory views (if mapped)
+  if (read_only_view_) {
+    UnmapViewOfFile(read_only_view_);
+    read_only_view_ = nullptr;
+  }
+
   if (shared_data_) {
     UnmapViewOfFile(shared_data_);
     shared_data_ = nullptr;
@@ -208,3 +402,53 @@ void SharedMemoryManager::Cleanup() {
 
   is_initialized_ = false;
 }
+
+// ============================================================================
+// FFI Exports - C functions callable from Dart via FFI
+// ============================================================================
+
+void SetGlobalSharedMemoryManager(SharedMemoryManager* manager) {
+  g_shared_memory_manager = manager;
+}
+
+extern "C" {
+
+/// Read-only pointer to the mapped SharedMemoryData.
+///
+/// Dart usage:
+///   final view = SharedMemoryView.open();
+///   final count = view?.windowCount;  // plain memory load
+///
+/// @return FILE_MAP_READ view, or nullptr if not initialized
+__declspec(dllexport) const SharedMemoryData* GetSharedMemoryView() {
+  if (g_shared_memory_manager == nullptr) {
+    return nullptr;
+  }
+  return g_shared_memory_manager->GetReadOnlyView();
+}
+
+/// Layout version compiled into this executable.
+/// Dart compares it with its own Struct definition before reading.
+__declspec(dllexport) uint32_t GetSharedMemoryLayoutVersion() {
+  return kSharedMemoryLayoutVersion;
+}
+
+/// sizeof(SharedMemoryData) compiled into this executable.
+/// Dart compares it with sizeOf<SharedMemoryData>() before reading.
+__declspec(dllexport) uint32_t GetSharedMemoryDataSize() {
+  return static_cast<uint32_t>(sizeof(SharedMemoryData));
+}
+
+/// Consistent multi-field read for callers that cannot fence their loads.
+///
+/// @param snapshot Receives the snapshot on success
+/// @return true on success
+__declspec(dllexport) bool ReadSharedMemorySnapshot(
+    SharedMemorySnapshot* snapshot) {
+  if (g_shared_memory_manager == nullptr) {
+    return false;
+  }
+  return g_shared_memory_manager->ReadSnapshot(snapshot);
+}
+
+}  // extern "C"
@@ -9,11 +9,63 @@
 
 #include <windows.h>
 
-// Shared memory data structure (16 bytes, cache-aligned)
-// Used for cross-process communication between Flutter windows
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Name of the shared memory section. "Local\" scopes it to the current
+// login session. Instances outside the default namespace append
+// ".<namespace>" (see ipc_namespace.h).
+constexpr char kSharedMemoryName[] = "Local\\FlutterMultiWindowCounter";
+
+// Name of the manual-reset event signaled on every count change, which
+// WindowCountListener waits on. Namespaced like kSharedMemoryName.
+constexpr char kWindowCountEventName[] = "Local\\FlutterWindowCountChanged";
+
+// Marker written by the process that creates the shared memory section.
+constexpr DWORD kSharedMemoryMagic = 0xDEADBEEF;
+
+// Version of the SharedMemoryData layout. Bump whenever a field is added,
+// removed or moved, and update lib/shared_memory_view.dart to match.
+constexpr DWORD kSharedMemoryLayoutVersion = 2;
+
+// Shared memory data structure (32 bytes)
+// Used for cross-process communication between Flutter windows.
+//
+// The first 16 bytes keep the original layout (count, magic, -, writer) so
+// older readers such as standalone_shmem_test still find the same fields.
+// Dart maps this struct directly (see lib/shared_memory_view.dart), so the
+// offsets below are part of the FFI contract and checked by static_assert.
 struct SharedMemoryData {
-  volatile LONG window_count;  // Atomic counter for active windows
-  DWORD reserved[3];           // Reserved for future use (12 bytes)
+  volatile LONG window_count;     // Atomic counter for active windows
+  DWORD magic;                    // kSharedMemoryMagic once initialized
+  DWORD layout_version;           // kSharedMemoryLayoutVersion of creator
+  volatile LONG last_writer_pid;  // Process ID of the last count change
+  volatile LONG sequence;         // Seqlock: odd while a write is in progress
+  DWORD data_size;                // sizeof(SharedMemoryData) of creator
+  volatile LONG trace_id;         // ipc_trace ID of the last count change
+  DWORD reserved;                 // Reserved for future use (4 bytes)
+};
+
+static_assert(offsetof(SharedMemoryData, window_count) == 0, "FFI layout");
+static_assert(offsetof(SharedMemoryData, magic) == 4, "FFI layout");
+static_assert(offsetof(SharedMemoryData, layout_version) == 8, "FFI layout");
+static_assert(offsetof(SharedMemoryData, last_writer_pid) == 12, "FFI layout");
+static_assert(offsetof(SharedMemoryData, sequence) == 16, "FFI layout");
+static_assert(offsetof(SharedMemoryData, data_size) == 20, "FFI layout");
+static_assert(offsetof(SharedMemoryData, trace_id) == 24, "FFI layout");
+static_assert(sizeof(SharedMemoryData) == 32, "FFI layout");
+
+// Consistent copy of the multi-field shared state.
+//
+// Produced by SharedMemoryManager::ReadSnapshot() and the
+// ReadSharedMemorySnapshot FFI export using the seqlock protocol, so all
+// fields belong to the same write.
+struct SharedMemorySnapshot {
+  LONG window_count;
+  DWORD last_writer_pid;
+  LONG sequence;  // Even sequence number the snapshot was taken at
+  DWORD trace_id;  // ipc_trace ID of the write, 0 if untraced
 };
 
 // Manages a Windows shared memory section for cross-process communication.
@@ -34,10 +86,14 @@ struct SharedMemoryData {
 //   }
 class SharedMemoryManager {
  public:
-  // Constructs SharedMemoryManager with uninitialized handles.
+  // Constructs SharedMemoryManager with uninitialized handles, in the
+  // process default IPC namespace (ipc_namespace::GetDefault()).
   // Call Initialize() before using other methods.
   SharedMemoryManager();
 
+  // Same, in the given IPC namespace; "" is the app's own instance.
+  explicit SharedMemoryManager(const std::string& ipc_namespace);
+
   // Cleans up Windows handles and unmaps shared memory.
   // Uses RAII pattern for automatic resource management.
   ~SharedMemoryManager();
@@ -45,7 +101,9 @@ class SharedMemoryManager {
   // Initializes shared memory section.
   //
   // Creates new shared memory section or opens existing one.
-  // First process creates, subsequent processes open existing.
+  // First process creates, subsequent processes open existing. An opener
+  // waits briefly for the creator to write the header, and fails if the
+  // segment has no magic or another kSharedMemoryLayoutVersion.
   //
   // Returns true on success, false on error.
   // Call GetLastError() for detailed Windows error code on failure.
@@ -53,7 +111,8 @@ class SharedMemoryManager {
 
   // Atomically increments window count.
   //
-  // Thread-safe across all processes using InterlockedIncrement.
+  // Thread-safe across all processes (interlocked add inside a seqlock
+  // write). Records the trace stages of the change, see ipc_trace.h.
   // Must call Initialize() successfully before using this method.
   //
   // Returns new window count after incrementing, or -1 on error.
@@ -61,7 +120,8 @@ class SharedMemoryManager {
 
   // Atomically decrements window count.
   //
-  // Thread-safe across all processes using InterlockedDecrement.
+  // Thread-safe across all processes (interlocked add inside a seqlock
+  // write). Records the trace stages of the change, see ipc_trace.h.
   // Must call Initialize() successfully before using this method.
   //
   // Returns new window count after decrementing, or -1 on error.
@@ -75,7 +135,68 @@ class SharedMemoryManager {
   // Returns current window count, or 0 if not initialized.
   LONG GetWindowCount() const;
 
+  // Returns the process ID that made the most recent count change.
+  //
+  // Written with InterlockedExchange right after the counter update, so
+  // when two processes change the count concurrently the value may belong
+  // to either of them. Used by DartPortManager filters to tell local
+  // changes from changes made by other windows.
+  //
+  // Returns 0 if not initialized or no change has happened yet.
+  DWORD GetLastWriterProcessId() const;
+
+  // Reads count, last writer, sequence and trace ID as one consistent
+  // snapshot.
+  //
+  // Seqlock reader: retries while a writer is active or the sequence
+  // changed during the read. Gives up after a bounded number of attempts
+  // so a process that died mid-write cannot hang the caller.
+  //
+  // Returns true on success, false if not initialized or retries ran out.
+  bool ReadSnapshot(SharedMemorySnapshot* snapshot) const;
+
+  // Seqlock reader over any mapping of the segment, e.g. the FILE_MAP_READ
+  // view of an inspector that never initializes a manager (shmem_top).
+  // Same protocol and retry budget as ReadSnapshot(), but does not log.
+  static bool ReadSnapshotFrom(const SharedMemoryData* data,
+                               SharedMemorySnapshot* snapshot);
+
+  // Returns a read-only mapping of the shared memory section.
+  //
+  // The view is mapped with FILE_MAP_READ on first use, so any write
+  // through it faults instead of corrupting shared state. Handed to Dart
+  // via the GetSharedMemoryView FFI export. Valid until Cleanup().
+  //
+  // Returns nullptr if not initialized or mapping fails.
+  const SharedMemoryData* GetReadOnlyView();
+
+  // Full names of the section and change event in this manager's namespace.
+  const std::string& shared_memory_name() const {
+    return shared_memory_name_;
+  }
+  const std::string& event_name() const { return event_name_; }
+
  private:
+  // Seqlock writer entry: waits for an even sequence and makes it odd.
+  // Writers from all processes serialize here; the critical section is two
+  // interlocked operations long. A sequence left odd by a writer that died
+  // mid-update is forced even after kWriterStallMs instead of blocking
+  // every writer forever. Returns the odd sequence for EndWrite().
+  LONG BeginWrite();
+
+  // Seqlock writer exit: makes the sequence even again (full barrier),
+  // unless the write was taken over as stalled.
+  void EndWrite(LONG write_sequence);
+
+  // Allocates the next trace ID and stores it in the segment. Only call
+  // between BeginWrite() and EndWrite(), which serialize all writers, so
+  // IDs are unique across processes. Never returns 0 ("untraced").
+  DWORD AssignTraceId();
+
+  // Shared body of Increment/DecrementWindowCount: applies delta inside a
+  // seqlock write, signals listeners and records both trace stages.
+  LONG ApplyCountChange(LONG delta);
+
   // Creates or opens the shared memory section.
   //
   // Uses CreateFileMappingA to create/open named shared memory.
@@ -91,10 +212,44 @@ class SharedMemoryManager {
   // Safe to call multiple times or with null handles.
   void Cleanup();
 
+  std::string shared_memory_name_;  // kSharedMemoryName, namespaced
+  std::string event_name_;  // kWindowCountEventName, namespaced
   HANDLE shared_memory_handle_;  // Windows file mapping handle
   SharedMemoryData* shared_data_;  // Pointer to mapped shared memory
   bool is_initialized_;  // Tracks initialization state
   HANDLE update_event_;  // Event signaled when window count changes
+  const SharedMemoryData* read_only_view_;  // FILE_MAP_READ view for FFI
 };
 
+// Sets the manager whose read-only view is exported to Dart.
+// Called by FlutterWindow after Initialize(); pass nullptr before destroying.
+void SetGlobalSharedMemoryManager(SharedMemoryManager* manager);
+
+// FFI Exports for Dart binding
+extern "C" {
+
+/// FFI export: Read-only pointer to the mapped SharedMemoryData.
+///
+/// Dart wraps it as Pointer<SharedMemoryData> and reads fields with plain
+/// loads, e.g. during build(). Returns nullptr if shared memory is not
+/// initialized.
+__declspec(dllexport) const SharedMemoryData* GetSharedMemoryView();
+
+/// FFI export: Layout version this executable was compiled with.
+__declspec(dllexport) uint32_t GetSharedMemoryLayoutVersion();
+
+/// FFI export: sizeof(SharedMemoryData) this executable was compiled with.
+__declspec(dllexport) uint32_t GetSharedMemoryDataSize();
+
+/// FFI export: Consistent multi-field read using the seqlock protocol.
+///
+/// For callers that cannot order their own loads (Dart on weakly ordered
+/// CPUs). Safe to bind as a leaf call.
+///
+/// @return true on success, false if not initialized or retries ran out
+__declspec(dllexport) bool ReadSharedMemorySnapshot(
+    SharedMemorySnapshot* snapshot);
+
+}  // extern "C"
+
 #endif  // RUNNER_SHARED_MEMORY_MANAGER_H_
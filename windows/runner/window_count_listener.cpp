@@ -4,19 +4,80 @@
 
 #include "window_count_listener.h"
 
-#include <iostream>
+#include "ipc_flight_recorder.h"
+#include "ipc_log.h"
+#include "ipc_metrics.h"
+#include "ipc_namespace.h"
+#include "ipc_probes.h"
+#include "ipc_trace.h"
+#include "shared_memory_manager.h"
 
 // Event configuration constants
 namespace {
-const char* kEventName = "Local\\FlutterWindowCountChanged";
 constexpr DWORD kWaitTimeout = 5000;  // 5 second timeout for safety
+constexpr DWORD kResetDelayMs = 10;   // Grace period before ResetEvent
+
+// Spin mode: the clock is read, and other threads get the core, once per
+// this many YieldProcessor() spins.
+constexpr uint32_t kSpinsPerYield = 64;
+
+int64_t TicksPerSecond() {
+  LARGE_INTEGER frequency;
+  QueryPerformanceFrequency(&frequency);
+  return frequency.QuadPart;
+}
+
+// Sequence the segment has once a write in progress completes; writes
+// add 2, so an odd (in-progress) value settles one higher.
+LONG SettledSequence(LONG sequence) {
+  return (sequence + 1) & ~1L;
+}
 }  // anonymous namespace
 
+AdaptiveSpinBudget::AdaptiveSpinBudget(int64_t max_ticks)
+    : max_ticks_(max_ticks), last_arrival_(0), average_gap_(0) {}
+
+void AdaptiveSpinBudget::OnArrival(int64_t ticks) {
+  if (last_arrival_ != 0 && ticks > last_arrival_) {
+    int64_t gap = ticks - last_arrival_;
+    if (gap > 4 * max_ticks_) {
+      gap = 4 * max_ticks_;  // So a long idle period is soon forgotten
+    }
+    average_gap_ =
+        average_gap_ == 0 ? gap : average_gap_ + (gap - average_gap_) / 8;
+  }
+  last_arrival_ = ticks;
+}
+
+int64_t AdaptiveSpinBudget::GetBudgetTicks() const {
+  if (average_gap_ == 0 || average_gap_ > max_ticks_) {
+    return 0;  // Next change unlikely to arrive within the cap
+  }
+  return 2 * average_gap_ < max_ticks_ ? 2 * average_gap_ : max_ticks_;
+}
+
 WindowCountListener::WindowCountListener()
-    : update_event_(nullptr),
+    : WindowCountListener(ipc_namespace::GetDefault()) {}
+
+WindowCountListener::WindowCountListener(const std::string& ipc_namespace)
+    : event_name_(ipc_namespace::Qualify(kWindowCountEventName, ipc_namespace)),
+      update_event_(nullptr),
+      stop_event_(nullptr),
+      reactor_(nullptr),
+      reactor_handler_(IpcReactor::kInvalidHandler),
+      reset_timer_(IpcReactor::kInvalidHandler),
       is_running_(false),
       callback_(nullptr),
-      last_notified_count_(-1) {
+      last_notified_count_(-1),
+      last_notify_sequence_(0),
+      spin_view_(nullptr),
+      max_spin_us_(kDefaultMaxSpinMicros),
+      spin_active_(false),
+      spin_budget_(0),
+      delivered_sequence_(0),
+      last_delivery_ticks_(0),
+      callback_mode_(CallbackMode::kInline),
+      callback_queue_capacity_(IpcCallbackQueue::kDefaultCapacity) {
   // Constructor initializes members to safe defaults
   // Actual initialization happens in Start()
 }
@@ -28,22 +89,89 @@ WindowCountListener::~WindowCountListener() {
 
 bool WindowCountListener::Start() {
   if (is_running_) {
-    std::cout << "WindowCountListener already running" << std::endl;
+    IPC_LOG_DEBUG("WindowCountListener already running");
     return true;  // Idempotent - already started
   }
 
   if (!CreateUpdateEvent()) {
-    std::cerr << "Failed to create event for WindowCountListener" << std::endl;
+    IPC_LOG_ERROR("Failed to create event for WindowCountListener");
     return false;
   }
+  if (stop_event_ == nullptr) {
+    // Unnamed manual-reset: only Stop() sets it, nobody else can reset it
+    stop_event_ = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+    if (stop_event_ == nullptr) {
+      IPC_LOG_ERROR("CreateEventA failed for stop event: {}", GetLastError());
+      return false;
+    }
+  }
+  ResetEvent(stop_event_);  // Set by a previous Stop()
+
+  // Notifications sent before Start() are not coalesced into our wakeups
+  last_notify_sequence_ = ipc_metrics::GetRegistry().GetNotifySequence();
+
+  spin_active_ = spin_view_ != nullptr;
+  if (spin_active_) {
+    // Fresh history: the previous run's gaps say nothing about this one
+    spin_budget_ = AdaptiveSpinBudget(
+        static_cast<int64_t>(max_spin_us_) * TicksPerSecond() / 1000000);
+    delivered_sequence_ =
+        SettledSequence(ReadAcquire(&spin_view_->sequence));
+    last_delivery_ticks_ = 0;
+  }
+
+  OpenCallbackQueue();
 
   // Set running flag before starting thread
   is_running_ = true;
+  ipc_metrics::AddGauge(ipc_metrics::kMetricListenersRunning, 1);
+  ipc_flight::Record(ipc_flight::kFlightListenerStart);
 
   // Start background thread
   listener_thread_ = std::thread(&WindowCountListener::ListenerThreadFunction, this);
 
-  std::cout << "WindowCountListener started" << std::endl;
+  IPC_LOG_INFO("WindowCountListener started");
+  return true;
+}
+
+bool WindowCountListener::Start(IpcReactor* reactor) {
+  if (is_running_) {
+    IPC_LOG_DEBUG("WindowCountListener already running");
+    return true;  // Idempotent - already started
+  }
+
+  if (!CreateUpdateEvent()) {
+    IPC_LOG_ERROR("Failed to create event for WindowCountListener");
+    return false;
+  }
+
+  last_notify_sequence_ = ipc_metrics::GetRegistry().GetNotifySequence();
+  if (spin_view_ != nullptr) {
+    IPC_LOG_WARN("WindowCountListener: spin wait ignored on a reactor");
+  }
+  spin_active_ = false;
+  OpenCallbackQueue();
+
+  // Running before the handler is registered: it may fire at once.
+  reactor_ = reactor;
+  is_running_ = true;
+  {
+    std::lock_guard<std::mutex> lock(reactor_mutex_);
+    reactor_handler_ =
+        reactor->AddHandle(update_event_, [this] { OnReactorSignaled(); });
+  }
+  if (reactor_handler_ == IpcReactor::kInvalidHandler) {
+    IPC_LOG_ERROR("Failed to register WindowCountListener with reactor");
+    is_running_ = false;
+    reactor_ = nullptr;
+    CloseCallbackQueue();
+    return false;
+  }
+
+  ipc_metrics::AddGauge(ipc_metrics::kMetricListenersRunning, 1);
+  ipc_flight::Record(ipc_flight::kFlightListenerStart);
+
+  IPC_LOG_INFO("WindowCountListener started on reactor");
   return true;
 }
 
@@ -55,17 +183,40 @@ void WindowCountListener::Stop() {
   // Signal thread to stop
   is_running_ = false;
 
-  // Wake up the waiting thread by signaling the event
-  if (update_event_) {
-    SetEvent(update_event_);
-  }
+  if (reactor_ != nullptr) {
+    // With is_running_ cleared the handlers register nothing new, so these
+    // two are the last. Once Remove() returns neither is running; no
+    // thread to wake.
+    IpcReactor::HandlerId handler;
+    IpcReactor::HandlerId timer;
+    {
+      std::lock_guard<std::mutex> lock(reactor_mutex_);
+      handler = reactor_handler_;
+      timer = reset_timer_;
+      reactor_handler_ = IpcReactor::kInvalidHandler;
+      reset_timer_ = IpcReactor::kInvalidHandler;
+    }
+    reactor_->Remove(handler);
+    reactor_->Remove(timer);
+    reactor_ = nullptr;
+  } else {
+    // Wake up the waiting thread through its own event; the shared one
+    // may be reset by another listener before this thread sees it.
+    if (stop_event_) {
+      SetEvent(stop_event_);
+    }
 
-  // Wait for thread to finish
-  if (listener_thread_.joinable()) {
-    listener_thread_.join();
+    // Wait for thread to finish
+    if (listener_thread_.joinable()) {
+      listener_thread_.join();
+    }
   }
+  // Nothing queues callbacks any more
+  CloseCallbackQueue();
+  ipc_metrics::AddGauge(ipc_metrics::kMetricListenersRunning, -1);
+  ipc_flight::Record(ipc_flight::kFlightListenerStop);
 
-  std::cout << "WindowCountListener stopped" << std::endl;
+  IPC_LOG_INFO("WindowCountListener stopped");
 }
 
 void WindowCountListener::SetCallback(WindowCountCallback callback) {
@@ -76,38 +227,45 @@ bool WindowCountListener::IsRunning() const {
   return is_running_;
 }
 
+void WindowCountListener::EnableSpinWait(const SharedMemoryData* view,
+                                         DWORD max_spin_us) {
+  spin_view_ = view;
+  max_spin_us_ = max_spin_us;
+}
+
+void WindowCountListener::SetCallbackMode(CallbackMode mode,
+                                          size_t queue_capacity) {
+  callback_mode_ = mode;
+  callback_queue_capacity_ = queue_capacity;
+}
+
 void WindowCountListener::ListenerThreadFunction() {
-  std::cout << "WindowCountListener thread started" << std::endl;
+  IPC_LOG_DEBUG("WindowCountListener thread started");
 
   while (is_running_) {
+    if (spin_active_ && SpinForChange()) {
+      continue;  // Delivered without blocking
+    }
+
     // Wait for event to be signaled (blocks thread, zero CPU usage)
-    DWORD result = WaitForSingleObject(update_event_, kWaitTimeout);
+    IPC_PROBE_LISTENER_SLEEP();
+    HANDLE events[] = {update_event_, stop_event_};
+    DWORD result = WaitForMultipleObjects(2, events, FALSE, kWaitTimeout);
+    int64_t wake_ticks = ipc_trace::Now();
+    IPC_PROBE_LISTENER_WAKE(result);
+    if (result != WAIT_TIMEOUT) {  // Timeouts are routine, not history
+      ipc_flight::Record(ipc_flight::kFlightListenerWake, result);
+    }
 
-    if (!is_running_) {
+    if (!is_running_ || result == WAIT_OBJECT_0 + 1) {
       break;  // Stop requested
     }
 
     if (result == WAIT_OBJECT_0) {
-      // Event was signaled - window count changed
-      // With manual-reset event, ALL waiting threads across processes wake up.
-      std::cout << "Window count changed notification received" << std::endl;
-
-      // Reset event after short delay to allow other threads to wake.
-      // This is a compromise - gives ~10ms for other processes to catch the signal.
-      Sleep(10);
-      ResetEvent(update_event_);
-
-      // Execute callback if set
-      if (callback_) {
-        try {
-          // Note: Callback should read actual count from SharedMemoryManager.
-          // Pass 0 as placeholder - callback ignores this and reads from shared memory.
-          callback_(0);
-        } catch (const std::exception& e) {
-          std::cerr << "Callback threw exception: " << e.what() << std::endl;
-        } catch (...) {
-          std::cerr << "Callback threw unknown exception" << std::endl;
-        }
+      if (spin_active_) {
+        OnSpinModeSignaled(wake_ticks);
+      } else {
+        OnEventSignaled(wake_ticks);
       }
     } else if (result == WAIT_TIMEOUT) {
       // Timeout - continue loop (allows checking is_running_ periodically)
@@ -115,12 +273,207 @@ void WindowCountListener::ListenerThreadFunction() {
     } else {
       // Error occurred
       DWORD error = GetLastError();
-      std::cerr << "WaitForSingleObject failed: " << error << std::endl;
+      IPC_LOG_ERROR("WaitForMultipleObjects failed: {}", error);
       break;
     }
   }
 
-  std::cout << "WindowCountListener thread exiting" << std::endl;
+  IPC_LOG_DEBUG("WindowCountListener thread exiting");
+}
+
+void WindowCountListener::OnEventSignaled(int64_t wake_ticks) {
+  // Event was signaled - window count changed
+  // With manual-reset event, ALL waiting threads across processes wake up.
+  IPC_LOG_DEBUG("Window count changed notification received");
+
+  // Reset event after short delay to allow other threads to wake.
+  // This is a compromise - gives ~10ms for other processes to catch the signal.
+  Sleep(kResetDelayMs);
+  ResetEvent(update_event_);
+
+  // The trace ID is in shared memory, which this layer does not read;
+  // the callback completes the wake stage once it knows the ID. Started
+  // after the grace period, which is fixed and would otherwise dominate it.
+  ipc_trace::BeginDeferred(ipc_trace::kStageListenerWake);
+
+  // After the reset, so every notification whose SetEvent was absorbed
+  // by it is counted against this wakeup.
+  ipc_metrics::GetRegistry().RecordListenerWake(wake_ticks,
+                                               &last_notify_sequence_);
+
+  RunCallback();
+}
+
+void WindowCountListener::OnReactorSignaled() {
+  int64_t wake_ticks = ipc_trace::Now();
+  IPC_PROBE_LISTENER_WAKE(WAIT_OBJECT_0);
+  ipc_flight::Record(ipc_flight::kFlightListenerWake, WAIT_OBJECT_0);
+  IPC_LOG_DEBUG("Window count changed notification received");
+
+  // A manual-reset event left signaled would fire again on every reactor
+  // iteration, so stop waiting on it until it is reset.
+  std::lock_guard<std::mutex> lock(reactor_mutex_);
+  if (!is_running_) {
+    return;  // Stop() is removing us
+  }
+  reactor_->Remove(reactor_handler_);
+  reactor_handler_ = IpcReactor::kInvalidHandler;
+  reset_timer_ = reactor_->AddTimer(kResetDelayMs, [this, wake_ticks] {
+    OnResetDelayElapsed(wake_ticks);
+  });
+}
+
+void WindowCountListener::OnResetDelayElapsed(int64_t wake_ticks) {
+  {
+    std::lock_guard<std::mutex> lock(reactor_mutex_);
+    reactor_->Remove(reset_timer_);  // One shot
+    reset_timer_ = IpcReactor::kInvalidHandler;
+    if (!is_running_) {
+      return;  // Stop() is removing us
+    }
+    ResetEvent(update_event_);
+    // A change signaled from here on keeps the event up until we wait
+    reactor_handler_ =
+        reactor_->AddHandle(update_event_, [this] { OnReactorSignaled(); });
+    if (reactor_handler_ == IpcReactor::kInvalidHandler) {
+      IPC_LOG_ERROR("WindowCountListener lost its reactor registration");
+    }
+  }
+
+  // As in OnEventSignaled(): after the reset, so notifications it
+  // absorbed count against this wakeup.
+  ipc_metrics::GetRegistry().RecordListenerWake(wake_ticks,
+                                               &last_notify_sequence_);
+  ipc_trace::BeginDeferred(ipc_trace::kStageListenerWake);
+  RunCallback();
+}
+
+bool WindowCountListener::SpinForChange() {
+  int64_t spin_start = ipc_trace::Now();
+  int64_t deadline = spin_start + spin_budget_.GetBudgetTicks();
+  // Checked once even with no budget: a change may already be waiting
+  for (uint32_t spins = 1;; spins++) {
+    LONG sequence = ReadAcquire(&spin_view_->sequence);
+    if ((sequence & 1) == 0 && sequence != delivered_sequence_) {
+      int64_t seen_ticks = ipc_trace::Now();
+      ipc_metrics::GetRegistry().RecordSpinHit(spin_start, seen_ticks);
+      ipc_trace::BeginDeferred(ipc_trace::kStageListenerWake);
+      delivered_sequence_ = sequence;
+      last_delivery_ticks_ = seen_ticks;
+      spin_budget_.OnArrival(seen_ticks);
+      RunCallback();
+      return true;
+    }
+    if (spins % kSpinsPerYield != 0) {
+      YieldProcessor();
+      continue;
+    }
+    int64_t now = ipc_trace::Now();
+    if (now >= deadline || !is_running_) {
+      if (now > spin_start) {
+        ipc_metrics::GetRegistry().RecordSpinMiss(spin_start, now);
+      }
+      return false;
+    }
+    SwitchToThread();  // Lets a writer on this core finish
+  }
+}
+
+void WindowCountListener::OnSpinModeSignaled(int64_t wake_ticks) {
+  if (SettledSequence(ReadAcquire(&spin_view_->sequence)) ==
+      delivered_sequence_) {
+    // The signal of a change a spin already delivered. Keep it up for the
+    // rest of the grace period so other processes still see it, but stop
+    // waiting as soon as another change arrives; the spin at the top of
+    // the loop delivers that one.
+    int64_t reset_ticks =
+        last_delivery_ticks_ + kResetDelayMs * TicksPerSecond() / 1000;
+    while (ipc_trace::Now() < reset_ticks && is_running_) {
+      if (ReadAcquire(&spin_view_->sequence) != delivered_sequence_) {
+        return;
+      }
+      Sleep(1);
+    }
+    ResetEvent(update_event_);
+    // Absorbed, not coalesced: the spin already counted these changes
+    last_notify_sequence_ = ipc_metrics::GetRegistry().GetNotifySequence();
+    return;
+  }
+
+  // A change the spin missed: the ordinary wakeup, which also feeds the
+  // budget so spinning resumes once changes come close together again.
+  spin_budget_.OnArrival(wake_ticks);
+  Sleep(kResetDelayMs);
+  ResetEvent(update_event_);
+  ipc_trace::BeginDeferred(ipc_trace::kStageListenerWake);
+  ipc_metrics::GetRegistry().RecordListenerWake(wake_ticks,
+                                               &last_notify_sequence_);
+  delivered_sequence_ = SettledSequence(ReadAcquire(&spin_view_->sequence));
+  last_delivery_ticks_ = ipc_trace::Now();
+  RunCallback();
+}
+
+void WindowCountListener::RunCallback() {
+  if (!callback_) {
+    return;
+  }
+  if (!callback_queue_) {
+    InvokeCallback();
+    return;
+  }
+  // The wake stage started on this thread; it ends on the worker, once the
+  // callback has read the trace ID.
+  int64_t wake_start = ipc_trace::TakeDeferred();
+  callback_queue_->Submit([this, wake_start] {
+    if (wake_start != 0) {
+      ipc_trace::BeginDeferred(ipc_trace::kStageListenerWake, wake_start);
+    }
+    InvokeCallback();
+  });
+}
+
+void WindowCountListener::InvokeCallback() {
+  // Execute callback if set
+  if (callback_) {
+    int64_t callback_start = ipc_trace::Now();
+    IPC_PROBE_CALLBACK_START();
+    try {
+      // Note: Callback should read actual count from SharedMemoryManager.
+      // Pass 0 as placeholder - callback ignores this and reads from shared memory.
+      callback_(0);
+    } catch (const std::exception& e) {
+      IPC_LOG_ERROR("Callback threw exception: {}", e.what());
+    } catch (...) {
+      IPC_LOG_ERROR("Callback threw unknown exception");
+    }
+    int64_t callback_end = ipc_trace::Now();
+    ipc_metrics::RecordDuration(ipc_metrics::kMetricCallbackDuration,
+                                callback_start, callback_end);
+    IPC_PROBE_CALLBACK_DONE(callback_end - callback_start);
+  }
+}
+
+void WindowCountListener::OpenCallbackQueue() {
+  switch (callback_mode_) {
+    case CallbackMode::kInline:
+      callback_queue_.reset();
+      return;
+    case CallbackMode::kDedicatedWorker:
+      callback_queue_ = std::make_unique<IpcCallbackQueue>(
+          std::make_shared<IpcCallbackExecutor>(1), callback_queue_capacity_);
+      return;
+    case CallbackMode::kSharedPool:
+      callback_queue_ = std::make_unique<IpcCallbackQueue>(
+          IpcCallbackExecutor::Acquire(), callback_queue_capacity_);
+      return;
+  }
+}
+
+void WindowCountListener::CloseCallbackQueue() {
+  if (callback_queue_) {
+    callback_queue_->Close();
+    callback_queue_.reset();
+  }
 }
 
 bool WindowCountListener::CreateUpdateEvent() {
@@ -135,11 +488,11 @@ bool WindowCountListener::CreateUpdateEvent() {
       nullptr,       // Default security
       TRUE,          // Manual-reset event (allows all waiters to wake)
       FALSE,         // Initially non-signaled
-      kEventName);   // Event name
+      event_name_.c_str());  // Event name
 
   if (update_event_ == nullptr) {
     DWORD error = GetLastError();
-    std::cerr << "CreateEventA failed: " << error << std::endl;
+    IPC_LOG_ERROR("CreateEventA failed: {}", error);
     return false;
   }
 
@@ -148,11 +501,10 @@ bool WindowCountListener::CreateUpdateEvent() {
   bool already_exists = (GetLastError() == ERROR_ALREADY_EXISTS);
 
   if (already_exists) {
-    std::cout << "Window count listener event opened (already exists): "
-              << kEventName << std::endl;
+    IPC_LOG_INFO("Window count listener event opened (already exists): {}",
+                 event_name_);
   } else {
-    std::cout << "Window count listener event created: "
-              << kEventName << std::endl;
+    IPC_LOG_INFO("Window count listener event created: {}", event_name_);
   }
 
   return true;
@@ -163,4 +515,8 @@ void WindowCountListener::Cleanup() {
     CloseHandle(update_event_);
     update_event_ = nullptr;
   }
+  if (stop_event_) {
+    CloseHandle(stop_event_);
+    stop_event_ = nullptr;
+  }
 }
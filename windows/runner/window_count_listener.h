@@ -9,13 +9,53 @@
 #include <windows.h>
 
 #include <atomic>
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <thread>
 
+#include "ipc_callback_executor.h"
+#include "ipc_reactor.h"
+
+struct SharedMemoryData;
+
 // Callback function type for window count change notifications.
 // Called when window count changes, receives new count as parameter.
 using WindowCountCallback = std::function<void(LONG new_count)>;
 
+// How long a spinning listener watches for the next change before it
+// blocks, derived from recent inter-arrival times.
+//
+// Spinning pays off only when the next change is likely to arrive within
+// the budget; otherwise it burns a core for nothing. The budget is twice
+// the moving average of the gaps between changes, capped at max_ticks,
+// and zero (block at once) while the average exceeds max_ticks or no two
+// changes have been seen yet. Gaps are clamped to 4 * max_ticks, so a few
+// close changes after a long idle period re-enable spinning.
+//
+// Times are QueryPerformanceCounter ticks. Not thread-safe; owned by the
+// listener thread.
+class AdaptiveSpinBudget {
+ public:
+  explicit AdaptiveSpinBudget(int64_t max_ticks);
+
+  // Records a change observed at ticks.
+  void OnArrival(int64_t ticks);
+
+  // Ticks to spin before blocking; 0 means block at once.
+  int64_t GetBudgetTicks() const;
+
+  // Moving average of the gaps between changes, 0 until two are seen.
+  int64_t average_gap_ticks() const { return average_gap_; }
+
+ private:
+  int64_t max_ticks_;
+  int64_t last_arrival_;  // 0 until the first change
+  int64_t average_gap_;   // Exponential moving average, weight 1/8
+};
+
 // Listens for window count changes via Windows Event objects.
 //
 // Creates background thread that waits on named Event using
@@ -23,6 +63,15 @@ using WindowCountCallback = std::function<void(LONG new_count)>;
 // When SharedMemoryManager signals the event (via SetEvent),
 // the thread wakes up and can execute optional callback.
 //
+// Alternatively, Start(reactor) registers the event with an IpcReactor
+// instead, so the listener adds no thread of its own.
+//
+// For the lowest latency, EnableSpinWait() makes the listener thread watch
+// the shared sequence word for a short, adaptive time before it blocks.
+//
+// SetCallbackMode() moves the callback off the waiting thread, so a slow
+// callback does not hold up the next wait.
+//
 // Thread-safe: Uses atomic flag for start/stop control.
 // RAII: Automatically stops thread and cleans up resources.
 //
@@ -36,10 +85,14 @@ using WindowCountCallback = std::function<void(LONG new_count)>;
 //   listener.Stop();  // Or automatic on destruction
 class WindowCountListener {
  public:
-  // Constructs WindowCountListener with uninitialized state.
+  // Constructs WindowCountListener with uninitialized state, in the
+  // process default IPC namespace (ipc_namespace::GetDefault()).
   // Call Start() to begin listening.
   WindowCountListener();
 
+  // Same, listening to the SharedMemoryManager of the given IPC namespace.
+  explicit WindowCountListener(const std::string& ipc_namespace);
+
   // Stops listener thread and cleans up resources.
   // Uses RAII pattern for automatic cleanup.
   ~WindowCountListener();
@@ -54,10 +107,20 @@ class WindowCountListener {
   // Safe to call multiple times (idempotent).
   bool Start();
 
+  // Starts listening on reactor instead of a thread of its own. The
+  // callback runs on the reactor thread unless SetCallbackMode() moves it.
+  // reactor must outlive Stop().
+  //
+  // Returns true on success, false on error.
+  bool Start(IpcReactor* reactor);
+
   // Stops background listener thread.
   //
-  // Sets running flag to false, signals event to wake thread,
-  // then joins thread to wait for clean exit.
+  // Sets running flag to false, signals the listener's private stop
+  // event to wake the thread, then joins thread to wait for clean exit.
+  // (Not the shared update event: another process's listener could reset
+  // that before this thread wakes.) On a reactor, removes the event from
+  // it instead.
   //
   // Safe to call when not running (no-op).
   void Stop();
@@ -73,6 +136,56 @@ class WindowCountListener {
   // Returns true if listener thread is currently running.
   bool IsRunning() const;
 
+  // Default cap of the spin budget, see EnableSpinWait().
+  static constexpr DWORD kDefaultMaxSpinMicros = 1000;
+
+  // Switches the listener thread to spin-then-block waiting. Call before
+  // Start().
+  //
+  // Between changes the thread spins on view->sequence (YieldProcessor,
+  // with SwitchToThread every few dozen spins) for an AdaptiveSpinBudget
+  // of at most max_spin_us, and only then blocks on the event as usual. A
+  // change seen while spinning is delivered at once, without the event
+  // round trip or the 10ms reset delay; the event signal that follows it
+  // is recognised by its sequence and not delivered twice.
+  //
+  // Spin hits, spin CPU time and the write-to-spin latency are reported
+  // as kMetricSpinHits, kMetricSpinNanoseconds and kMetricSpinWakeLatency;
+  // blocking wakeups still count as notifications.received.
+  //
+  // view must be the mapped segment of this listener's namespace (e.g.
+  // SharedMemoryManager::GetReadOnlyView()) and outlive Stop(). Applies
+  // to Start() only: Start(reactor) never spins, since the reactor thread
+  // serves other sources too.
+  void EnableSpinWait(const SharedMemoryData* view,
+                      DWORD max_spin_us = kDefaultMaxSpinMicros);
+
+  // Where the callback runs, see SetCallbackMode().
+  enum class CallbackMode {
+    kInline,           // On the waiting thread (or reactor), the default
+    kDedicatedWorker,  // On a worker thread of this listener's own
+    kSharedPool,       // On the process's shared callback pool
+  };
+
+  // Chooses where the callback runs. Call before Start().
+  //
+  // Inline, the waiting thread cannot wait while the callback runs. The
+  // other modes hand each wakeup to an IpcCallbackQueue of at most
+  // queue_capacity callbacks (ipc_callback_executor.h) and go straight
+  // back to waiting. Callbacks still run one at a time and in order; when
+  // they fall behind, the newest queued callback is replaced rather than
+  // another queued, which loses nothing since the callback reads the
+  // latest state from shared memory. The wake trace stage ends in the
+  // callback as before, so it includes the time spent queued.
+  void SetCallbackMode(
+      CallbackMode mode,
+      size_t queue_capacity = IpcCallbackQueue::kDefaultCapacity);
+
+  CallbackMode callback_mode() const { return callback_mode_; }
+
+  // Full name of the event this listener waits on.
+  const std::string& event_name() const { return event_name_; }
+
  private:
   // Background thread function that waits on event.
   //
@@ -83,25 +196,80 @@ class WindowCountListener {
   // 4. Repeat until is_running_ becomes false
   void ListenerThreadFunction();
 
+  // Handles one signal of the event: lets other waiters see it, resets
+  // it and runs the callback. Thread mode; sleeps for the grace period.
+  void OnEventSignaled(int64_t wake_ticks);
+
+  // Reactor mode counterpart of OnEventSignaled(). Never sleeps on the
+  // reactor thread: stops waiting on the event and leaves it signaled for
+  // the grace period, then OnResetDelayElapsed() runs from a one-shot
+  // reactor timer.
+  void OnReactorSignaled();
+
+  // Reactor mode: resets the event, waits on it again and runs the
+  // callback for the wakeup at wake_ticks.
+  void OnResetDelayElapsed(int64_t wake_ticks);
+
+  // Spin mode: watches the sequence word for the current budget. Returns
+  // true if a change was seen and delivered.
+  bool SpinForChange();
+
+  // Spin mode: handles one signal of the event. Signals for changes a
+  // spin already delivered are absorbed without a callback.
+  void OnSpinModeSignaled(int64_t wake_ticks);
+
+  // Runs the callback, or queues it outside kInline mode.
+  void RunCallback();
+
+  // Runs the callback now and records its duration.
+  void InvokeCallback();
+
+  // Creates callback_queue_ for the callback mode.
+  void OpenCallbackQueue();
+
+  // Closes callback_queue_: queued callbacks are dropped, a running one is
+  // waited for.
+  void CloseCallbackQueue();
+
   // Creates Windows Event object.
   //
-  // Event name: "Local\FlutterWindowCountChanged"
-  // Type: Auto-reset (automatically resets after WaitForSingleObject)
+  // Event name: kWindowCountEventName in this listener's namespace
+  // Type: Manual-reset (reset by the listener thread after each wakeup)
   //
   // Returns true on success, false on error.
   bool CreateUpdateEvent();
 
-  // Cleans up event handle.
+  // Cleans up event handles.
   //
-  // Closes Windows Event handle if valid.
+  // Closes the Windows Event handles if valid.
   // Safe to call multiple times.
   void Cleanup();
 
+  std::string event_name_;               // Namespaced kWindowCountEventName
   HANDLE update_event_;                  // Event signaled on count change
+  HANDLE stop_event_;                    // Private; wakes our thread on Stop()
   std::thread listener_thread_;          // Background listener thread
+  IpcReactor* reactor_;                  // Reactor listening for us, if any
+  std::mutex reactor_mutex_;             // Guards the two registrations
+  IpcReactor::HandlerId reactor_handler_;  // Our event's registration
+  IpcReactor::HandlerId reset_timer_;    // One-shot reset timer, if pending
   std::atomic<bool> is_running_;         // Thread running flag (atomic)
   WindowCountCallback callback_;         // Optional notification callback
   std::atomic<LONG> last_notified_count_;  // Last count we notified (prevents loops)
+  int64_t last_notify_sequence_;         // ipc_metrics sequence at last wake
+
+  // Spin-then-block mode, see EnableSpinWait()
+  const SharedMemoryData* spin_view_;    // Segment to watch, nullptr if off
+  DWORD max_spin_us_;                    // Budget cap
+  bool spin_active_;                     // Started in thread mode with a view
+  AdaptiveSpinBudget spin_budget_;       // Thread-owned budget
+  LONG delivered_sequence_;              // Sequence of the last delivery
+  int64_t last_delivery_ticks_;          // When it was seen
+
+  // Callback off the waiting thread, see SetCallbackMode()
+  CallbackMode callback_mode_;
+  size_t callback_queue_capacity_;
+  std::unique_ptr<IpcCallbackQueue> callback_queue_;  // nullptr if inline
 };
 
 #endif  // RUNNER_WINDOW_COUNT_LISTENER_H_
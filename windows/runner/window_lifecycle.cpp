@@ -0,0 +1,93 @@
+// window_lifecycle.cpp
+//
+// Implementation of the IPC half of a window's lifecycle.
+
+#include "window_lifecycle.h"
+
+#include "dart_port_manager.h"
+#include "ipc_trace.h"
+
+const char* WindowLifecyclePhaseName(WindowLifecyclePhase phase) {
+  switch (phase) {
+    case kPhaseRuntimeAcquire:
+      return "runtime_acquire";
+    case kPhaseIncrement:
+      return "increment";
+    case kPhaseInitialCount:
+      return "initial_count";
+    case kPhaseContentCreate:
+      return "content_create";
+    case kPhaseDecrement:
+      return "decrement";
+    case kPhaseRuntimeRelease:
+      return "runtime_release";
+    case kPhaseContentDestroy:
+      return "content_destroy";
+    default:
+      return "unknown";
+  }
+}
+
+WindowLifecycle::WindowLifecycle(PlatformWindow* window)
+    : window_(window), created_(false), phase_ticks_() {}
+
+WindowLifecycle::~WindowLifecycle() {}
+
+bool WindowLifecycle::OnCreate() {
+  for (int64_t& ticks : phase_ticks_) {
+    ticks = 0;
+  }
+  created_ = true;
+  int64_t start = ipc_trace::Now();
+
+  // Shared memory and the count listener are per process: the first window
+  // starts them, later windows share them.
+  runtime_ = IpcRuntime::Acquire();
+  EndPhase(kPhaseRuntimeAcquire, &start);
+
+  // Increment window count to track active windows
+  SharedMemoryManager* manager = runtime_->shared_memory_manager();
+  if (manager != nullptr) {
+    manager->IncrementWindowCount();
+  }
+  EndPhase(kPhaseIncrement, &start);
+
+  // Update global window count so newly registered Dart ports receive it.
+  // This ensures Dart UI gets the current count immediately on registration.
+  LONG current_count = manager != nullptr ? manager->GetWindowCount() : 0;
+  SetCurrentWindowCount(current_count);
+  EndPhase(kPhaseInitialCount, &start);
+
+  bool content_created = window_->CreateContent();
+  EndPhase(kPhaseContentCreate, &start);
+  return content_created;
+}
+
+void WindowLifecycle::OnDestroy() {
+  if (!created_) {
+    return;
+  }
+  created_ = false;
+  int64_t start = ipc_trace::Now();
+
+  // Decrement window count before destroying
+  SharedMemoryManager* manager = runtime_->shared_memory_manager();
+  if (manager != nullptr) {
+    manager->DecrementWindowCount();
+  }
+  EndPhase(kPhaseDecrement, &start);
+
+  // The last window of the process stops the listener and unmaps the
+  // segment; otherwise this only drops a reference.
+  runtime_.reset();
+  EndPhase(kPhaseRuntimeRelease, &start);
+
+  window_->DestroyContent();
+  EndPhase(kPhaseContentDestroy, &start);
+}
+
+void WindowLifecycle::EndPhase(WindowLifecyclePhase phase, int64_t* start) {
+  int64_t now = ipc_trace::Now();
+  phase_ticks_[phase] = now - *start;
+  *start = now;
+}
@@ -0,0 +1,112 @@
+// window_lifecycle.h
+//
+// The IPC half of a window's lifecycle, split from FlutterWindow.
+//
+// Opening a window acquires the process's IpcRuntime (shared memory and a
+// WindowCountListener wired to DartPortManager, started by the first window
+// of the process), increments the window count, and only then creates the
+// Flutter view; closing it runs the same steps in reverse. WindowLifecycle
+// owns the IPC steps and calls out to a PlatformWindow for everything else,
+// so the sequence runs unchanged in FlutterWindow (Win32 window + Flutter
+// engine) and in the headless lifecycle driver
+// (windows/test/window_lifecycle_driver.cpp), which repeats it thousands of
+// times to measure what a window costs apart from Flutter.
+//
+// Each phase is timed on every run with QueryPerformanceCounter (a handful
+// of calls per window open/close).
+
+#ifndef RUNNER_WINDOW_LIFECYCLE_H_
+#define RUNNER_WINDOW_LIFECYCLE_H_
+
+#include <windows.h>
+
+#include <cstdint>
+#include <memory>
+
+#include "ipc_runtime.h"
+#include "shared_memory_manager.h"
+
+// Phases of OnCreate() and OnDestroy(), in the order they run.
+enum WindowLifecyclePhase {
+  // OnCreate()
+  kPhaseRuntimeAcquire = 0,  // Map the segment, start the listener (first
+                             // window of the process only)
+  kPhaseIncrement,           // Count this window
+  kPhaseInitialCount,        // Count for newly registered Dart ports
+  kPhaseContentCreate,       // PlatformWindow::CreateContent()
+  // OnDestroy()
+  kPhaseDecrement,           // Uncount this window
+  kPhaseRuntimeRelease,      // Stop the listener, unmap (last window only)
+  kPhaseContentDestroy,      // PlatformWindow::DestroyContent()
+
+  kWindowLifecyclePhaseCount
+};
+
+// Name of a phase for reports, e.g. "listener_start".
+const char* WindowLifecyclePhaseName(WindowLifecyclePhase phase);
+
+// Everything about a window that is not IPC: the native window and the
+// Flutter view it hosts.
+class PlatformWindow {
+ public:
+  virtual ~PlatformWindow() = default;
+
+  // Creates the window content. Called once the IPC is up, so the first
+  // frame already sees the current window count.
+  virtual bool CreateContent() = 0;
+
+  // Destroys the window content. Called after the IPC is torn down.
+  virtual void DestroyContent() = 0;
+};
+
+// Runs the IPC steps of opening and closing one window.
+//
+// OnCreate() and OnDestroy() may be repeated on one object; OnDestroy()
+// releases everything OnCreate() acquired. Not thread-safe: both run on the
+// thread that owns the window.
+class WindowLifecycle {
+ public:
+  // window must outlive the lifecycle.
+  explicit WindowLifecycle(PlatformWindow* window);
+  ~WindowLifecycle();
+
+  WindowLifecycle(const WindowLifecycle&) = delete;
+  WindowLifecycle& operator=(const WindowLifecycle&) = delete;
+
+  // Brings up the IPC, then creates the window content. Shared memory and
+  // listener failures are logged and tolerated; returns false only if the
+  // content could not be created.
+  bool OnCreate();
+
+  // Tears down the IPC, then destroys the window content. Does nothing
+  // after OnDestroy() or before OnCreate().
+  void OnDestroy();
+
+  // QPC ticks each phase took during the last OnCreate()/OnDestroy();
+  // 0 for phases that have not run.
+  int64_t GetPhaseTicks(WindowLifecyclePhase phase) const {
+    return phase_ticks_[phase];
+  }
+
+  // The process's manager while created, else nullptr.
+  SharedMemoryManager* shared_memory_manager() const {
+    return runtime_ ? runtime_->shared_memory_manager() : nullptr;
+  }
+
+  // The process's runtime while created, else nullptr.
+  IpcRuntime* runtime() const { return runtime_.get(); }
+
+ private:
+  // Stores the time since |*start| for |phase| and advances |*start|.
+  void EndPhase(WindowLifecyclePhase phase, int64_t* start);
+
+  PlatformWindow* window_;
+  bool created_;
+
+  // Shared memory and listener, shared with the process's other windows
+  std::shared_ptr<IpcRuntime> runtime_;
+
+  int64_t phase_ticks_[kWindowLifecyclePhaseCount];
+};
+
+#endif  // RUNNER_WINDOW_LIFECYCLE_H_
@@ -6,6 +6,8 @@
 // These tests verify the complete event-driven multi-window architecture
 
 #include <gtest/gtest.h>
+#include "ipc_metrics.h"
+#include "ipc_test_namespace.h"
 #include "shared_memory_manager.h"
 #include "window_count_listener.h"
 #include <windows.h>
@@ -13,6 +15,7 @@
 #include <atomic>
 #include <thread>
 #include <chrono>
+#include <vector>
 
 class CrossProcessTest : public ::testing::Test {
 protected:
@@ -183,32 +186,56 @@ TEST_F(CrossProcessTest, SimulateWindowLifecycle_OpenCloseSequence) {
 //==============================================================================
 
 TEST_F(CrossProcessTest, EventNotification_SubMillisecondLatency) {
+  // The callback runs only after the listener's 10ms reset delay, so timing
+  // it would measure that delay. The listener records SetEvent-to-wake in
+  // the wake latency histogram instead; that is what must be sub-ms.
+  const int kSamples = 20;  // Even: the count ends where it started
+
   auto memory_mgr = std::make_unique<SharedMemoryManager>();
   auto listener = std::make_unique<WindowCountListener>();
 
-  memory_mgr->Initialize();
+  ASSERT_TRUE(memory_mgr->Initialize());
 
-  callback_triggered_ = false;
   listener->SetCallback(TestCallback);
-  listener->Start();
-
-  auto start = std::chrono::high_resolution_clock::now();
-
-  memory_mgr->IncrementWindowCount();
-
-  // Wait for callback with reasonable timeout
-  int timeout_ms = 100;
-  auto deadline = start + std::chrono::milliseconds(timeout_ms);
-
-  while (!callback_triggered_ && std::chrono::high_resolution_clock::now() < deadline) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  ASSERT_TRUE(listener->Start());
+
+  // Bucket counts, not Snapshot() percentiles: those are cumulative over
+  // every earlier test in this process.
+  std::vector<int64_t> before;
+  ASSERT_TRUE(ipc_metrics::GetRegistry().SnapshotBuckets(
+      ipc_metrics::kMetricWakeLatency, &before));
+
+  for (int i = 0; i < kSamples; i++) {
+    int expected = callback_count_ + 1;
+    if (i % 2 == 0) {
+      memory_mgr->IncrementWindowCount();
+    } else {
+      memory_mgr->DecrementWindowCount();
+    }
+
+    // One change at a time, so each one gets its own wakeup
+    auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(50);
+    while (callback_count_ < expected &&
+           std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_GE(callback_count_, expected) << "Callback should be triggered";
   }
 
-  auto end = std::chrono::high_resolution_clock::now();
-  auto latency_us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+  std::vector<int64_t> after;
+  ASSERT_TRUE(ipc_metrics::GetRegistry().SnapshotBuckets(
+      ipc_metrics::kMetricWakeLatency, &after));
+  int64_t recorded = 0;
+  for (size_t b = 0; b < after.size(); b++) {
+    after[b] -= before[b];  // Just this test's wakeups
+    recorded += after[b];
+  }
 
-  EXPECT_TRUE(callback_triggered_) << "Callback should be triggered";
-  EXPECT_LT(latency_us, 50000) << "Event notification latency should be < 50ms (50000us)";
+  EXPECT_GE(recorded, kSamples) << "Every change should record a wake latency";
+  EXPECT_LT(ipc_metrics::MetricsRegistry::BucketPercentile(after, 0.50),
+            1000000)
+      << "Median wake latency should be < 1ms (1000000ns)";
 
   listener->Stop();
 }
@@ -367,5 +394,6 @@ TEST_F(CrossProcessTest, CRITICAL_MultiInstanceSync_CompleteWorkflow) {
 
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
+  UseIpcTestNamespaces("CrossProcessTest");
   return RUN_ALL_TESTS();
 }
@@ -0,0 +1,230 @@
+// dart_command_port_test.cpp
+//
+// Google Test unit tests for DartCommandPort (Dart → C++ command channel)
+//
+// Commands are delivered by calling the native port handler captured by the
+// mock Dart_NewNativePort_DL, exactly as the Dart VM would.
+
+#include <gtest/gtest.h>
+#include <windows.h>
+#include <vector>
+
+// Include dart_api_dl.h which redirects to our mock in test builds
+// This must come BEFORE dart_port_manager.h
+#include "dart_api_dl.h"
+
+#include "dart_command_port.h"
+#include "dart_port_manager.h"
+
+namespace {
+
+// Reply decoded from a [request_id, result] list.
+struct Reply {
+  Dart_Port_DL port;
+  int64_t request_id;
+  bool result;
+};
+
+// Owns the Dart_CObjects that make up one command list.
+class CommandMessage {
+ public:
+  CommandMessage(int64_t command, int64_t request_id, Dart_Port_DL reply_port) {
+    AddInt(command);
+    AddInt(request_id);
+    AddSendPort(reply_port);
+  }
+
+  CommandMessage& AddInt(int64_t value) {
+    Dart_CObject object;
+    object.type = Dart_CObject_kInt64;
+    object.value.as_int64 = value;
+    objects_.push_back(object);
+    return *this;
+  }
+
+  CommandMessage& AddSendPort(Dart_Port_DL port) {
+    Dart_CObject object;
+    object.type = Dart_CObject_kSendPort;
+    object.value.as_send_port.id = port;
+    object.value.as_send_port.origin_id = ILLEGAL_PORT;
+    objects_.push_back(object);
+    return *this;
+  }
+
+  Dart_CObject* Build() {
+    pointers_.clear();
+    for (Dart_CObject& object : objects_) {
+      pointers_.push_back(&object);
+    }
+    message_.type = Dart_CObject_kArray;
+    message_.value.as_array.length = static_cast<intptr_t>(pointers_.size());
+    message_.value.as_array.values = pointers_.data();
+    return &message_;
+  }
+
+ private:
+  std::vector<Dart_CObject> objects_;
+  std::vector<Dart_CObject*> pointers_;
+  Dart_CObject message_;
+};
+
+}  // namespace
+
+class DartCommandPortTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    mock_dart_api::Reset();
+    replies_.clear();
+    mock_dart_api::SetPostCObjectCallback(
+        [this](Dart_Port_DL port, Dart_CObject* object) {
+          if (object->type == Dart_CObject_kArray &&
+              object->value.as_array.length == 2) {
+            Dart_CObject** values = object->value.as_array.values;
+            replies_.push_back(
+                {port, values[0]->value.as_int64, values[1]->value.as_bool});
+          }
+          return true;
+        });
+    command_port_ = std::make_unique<DartCommandPort>(port_manager_);
+    ASSERT_TRUE(command_port_->Open());
+  }
+
+  void TearDown() override {
+    command_port_.reset();
+    mock_dart_api::Reset();
+  }
+
+  // Delivers a message the way the Dart VM does: via the native handler,
+  // addressed to our port.
+  void Deliver(Dart_CObject* message) {
+    auto handler = mock_dart_api::GetMockState().native_handler;
+    ASSERT_NE(nullptr, handler);
+    handler(command_port_->port(), message);
+  }
+
+  static constexpr Dart_Port_DL kReplyPort = 777;
+
+  DartPortManager port_manager_;
+  std::unique_ptr<DartCommandPort> command_port_;
+  std::vector<Reply> replies_;
+};
+
+//==============================================================================
+// Test Suite 1: Port Lifecycle
+//==============================================================================
+
+TEST_F(DartCommandPortTest, Open_CreatesNativePort) {
+  EXPECT_NE(ILLEGAL_PORT, command_port_->port());
+  EXPECT_NE(nullptr, mock_dart_api::GetMockState().native_handler);
+}
+
+TEST_F(DartCommandPortTest, Open_Idempotent) {
+  Dart_Port_DL port = command_port_->port();
+  EXPECT_TRUE(command_port_->Open());
+  EXPECT_EQ(port, command_port_->port());
+}
+
+TEST_F(DartCommandPortTest, Close_ClosesNativePort) {
+  Dart_Port_DL port = command_port_->port();
+  command_port_->Close();
+  EXPECT_EQ(ILLEGAL_PORT, command_port_->port());
+  const auto& closed = mock_dart_api::GetMockState().closed_native_ports;
+  ASSERT_EQ(1u, closed.size());
+  EXPECT_EQ(port, closed[0]);
+}
+
+//==============================================================================
+// Test Suite 2: Command Dispatch and Replies
+//==============================================================================
+
+TEST_F(DartCommandPortTest, RegisterCommand_RegistersPortAndReplies) {
+  CommandMessage message(kDartCommandRegisterPort, 1, kReplyPort);
+  message.AddSendPort(4242).AddInt(kDartPortTopicAll).AddInt(0).AddInt(0);
+  Deliver(message.Build());
+
+  ASSERT_EQ(1u, replies_.size());
+  EXPECT_EQ(kReplyPort, replies_[0].port);
+  EXPECT_EQ(1, replies_[0].request_id);
+  EXPECT_TRUE(replies_[0].result);
+  EXPECT_TRUE(port_manager_.UnregisterPort(4242));
+}
+
+TEST_F(DartCommandPortTest, UnregisterCommand_RepliesWithResult) {
+  port_manager_.RegisterPort(5151, -1);
+
+  CommandMessage first(kDartCommandUnregisterPort, 7, kReplyPort);
+  first.AddSendPort(5151);
+  Deliver(first.Build());
+  CommandMessage second(kDartCommandUnregisterPort, 8, kReplyPort);
+  second.AddSendPort(5151);
+  Deliver(second.Build());
+
+  ASSERT_EQ(2u, replies_.size());
+  EXPECT_TRUE(replies_[0].result);
+  EXPECT_FALSE(replies_[1].result);  // Already removed
+}
+
+TEST_F(DartCommandPortTest, PipelinedCommands_RepliesInOrder) {
+  for (int64_t id = 1; id <= 5; id++) {
+    CommandMessage message(kDartCommandUnregisterPort, id, kReplyPort);
+    message.AddSendPort(100 + id);
+    Deliver(message.Build());
+  }
+  ASSERT_EQ(5u, replies_.size());
+  for (size_t i = 0; i < replies_.size(); i++) {
+    EXPECT_EQ(static_cast<int64_t>(i + 1), replies_[i].request_id);
+  }
+}
+
+TEST_F(DartCommandPortTest, ClosedPort_MessageNotDispatched) {
+  auto handler = mock_dart_api::GetMockState().native_handler;
+  ASSERT_NE(nullptr, handler);
+  Dart_Port_DL port = command_port_->port();
+  command_port_->Close();
+
+  CommandMessage message(kDartCommandUnregisterPort, 9, kReplyPort);
+  message.AddSendPort(6161);
+  handler(port, message.Build());
+  EXPECT_TRUE(replies_.empty());
+}
+
+TEST_F(DartCommandPortTest, UnknownCommand_RepliesFalse) {
+  CommandMessage message(99, 3, kReplyPort);
+  EXPECT_FALSE(command_port_->Dispatch(message.Build()));
+  ASSERT_EQ(1u, replies_.size());
+  EXPECT_FALSE(replies_[0].result);
+}
+
+TEST_F(DartCommandPortTest, MissingArguments_RepliesFalse) {
+  CommandMessage message(kDartCommandRegisterPort, 4, kReplyPort);
+  EXPECT_FALSE(command_port_->Dispatch(message.Build()));
+  ASSERT_EQ(1u, replies_.size());
+  EXPECT_FALSE(replies_[0].result);
+}
+
+TEST_F(DartCommandPortTest, MalformedHeader_NoReply) {
+  Dart_CObject not_a_list;
+  not_a_list.type = Dart_CObject_kInt64;
+  not_a_list.value.as_int64 = 1;
+  EXPECT_FALSE(command_port_->Dispatch(&not_a_list));
+  EXPECT_TRUE(replies_.empty());
+}
+
+//==============================================================================
+// Test Suite 3: FFI Export
+//==============================================================================
+
+TEST_F(DartCommandPortTest, OpenDartCommandChannel_PostsSendPort) {
+  mock_dart_api::SetPostCObjectCallback(nullptr);
+  EXPECT_TRUE(OpenDartCommandChannel(kReplyPort));
+  const auto& calls = mock_dart_api::GetPostCalls();
+  ASSERT_EQ(1u, calls.size());
+  EXPECT_EQ(kReplyPort, calls[0].port);
+  EXPECT_EQ(Dart_CObject_kSendPort, calls[0].type);
+  GetGlobalDartCommandPort().Close();
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -211,6 +211,211 @@ TEST_F(DartPortManagerTest, NotifyWindowCountChanged_PostFails_ContinuesWithOthe
   mock_dart_api::SetPostShouldFail(false);
 }
 
+//==============================================================================
+// Test Suite 7: Topic Subscriptions and Native Filters
+//==============================================================================
+
+TEST_F(DartPortManagerTest, Notify_TopicNotSubscribed_NotPosted) {
+  Dart_Port_DL port = CreateTestPort();
+  DartPortSubscription subscription;
+  subscription.topic_mask = 1u << 5;  // Some other topic
+  manager_->RegisterPort(port, -1, subscription);
+  mock_dart_api::Reset();
+  manager_->NotifyWindowCountChanged(3);
+  EXPECT_EQ(0u, GetPostCallCount());
+}
+
+TEST_F(DartPortManagerTest, Notify_CrossesThreshold_OnlyCrossingsPosted) {
+  Dart_Port_DL port = CreateTestPort();
+  DartPortSubscription subscription;
+  subscription.filter_flags = kDartPortFilterCrossesThreshold;
+  subscription.threshold = 3;
+  manager_->RegisterPort(port, 1, subscription);
+  mock_dart_api::Reset();
+  for (LONG count : {2, 3, 4, 3, 2, 1}) {
+    manager_->NotifyWindowCountChanged(count);
+  }
+  // 2→3 crosses upwards, 3→2 crosses downwards; everything else is dropped
+  auto values = GetPostedValues();
+  ASSERT_EQ(2u, values.size());
+  EXPECT_EQ(3, values[0]);
+  EXPECT_EQ(2, values[1]);
+}
+
+TEST_F(DartPortManagerTest, Notify_CrossesThreshold_PerTopicPreviousValue) {
+  Dart_Port_DL port = CreateTestPort();
+  DartPortSubscription subscription;
+  subscription.filter_flags = kDartPortFilterCrossesThreshold;
+  subscription.threshold = 3;
+  manager_->RegisterPort(port, 1, subscription);
+  mock_dart_api::Reset();
+  const uint32_t kOtherTopic = 1u << 4;
+  manager_->Notify(kOtherTopic, 10);  // First value of its topic: no crossing
+  manager_->Notify(kDartPortTopicWindowCount, 2);  // 1→2, not 10→2
+  manager_->Notify(kOtherTopic, 2);                // 10→2 crosses
+  manager_->Notify(kDartPortTopicWindowCount, 4);  // 2→4 crosses
+  auto values = GetPostedValues();
+  ASSERT_EQ(2u, values.size());
+  EXPECT_EQ(2, values[0]);
+  EXPECT_EQ(4, values[1]);
+}
+
+TEST_F(DartPortManagerTest, Notify_OtherProcessesFilter_DropsOwnChanges) {
+  Dart_Port_DL port = CreateTestPort();
+  DartPortSubscription subscription;
+  subscription.filter_flags = kDartPortFilterOtherProcesses;
+  manager_->RegisterPort(port, -1, subscription);
+  mock_dart_api::Reset();
+  manager_->NotifyWindowCountChanged(2, GetCurrentProcessId());
+  manager_->NotifyWindowCountChanged(3, GetCurrentProcessId() + 1);
+  auto values = GetPostedValues();
+  ASSERT_EQ(1u, values.size());
+  EXPECT_EQ(3, values[0]);
+}
+
+TEST_F(DartPortManagerTest, Notify_Predicate_EvaluatedBeforePosting) {
+  Dart_Port_DL filtered = CreateTestPort();
+  Dart_Port_DL unfiltered = CreateTestPort();
+  DartPortSubscription subscription;
+  subscription.predicate = [](const DartPortUpdate& update) {
+    return update.value % 2 == 0;
+  };
+  manager_->RegisterPort(filtered, -1, subscription);
+  manager_->RegisterPort(unfiltered, -1);
+  mock_dart_api::Reset();
+  manager_->NotifyWindowCountChanged(1);
+  manager_->NotifyWindowCountChanged(2);
+  auto ports = GetPostedPorts();
+  EXPECT_EQ(1, std::count(ports.begin(), ports.end(), filtered));
+  EXPECT_EQ(2, std::count(ports.begin(), ports.end(), unfiltered));
+}
+
+TEST_F(DartPortManagerTest, RegisterPort_Twice_ReplacesSubscription) {
+  Dart_Port_DL port = CreateTestPort();
+  manager_->RegisterPort(port, -1);
+  DartPortSubscription subscription;
+  subscription.topic_mask = 0;
+  manager_->RegisterPort(port, -1, subscription);
+  mock_dart_api::Reset();
+  manager_->NotifyWindowCountChanged(4);
+  EXPECT_EQ(0u, GetPostCallCount());
+}
+
+TEST_F(DartPortManagerTest, RegisterWindowCountPortFiltered_FFI_AppliesFilters) {
+  SetCurrentWindowCount(1);
+  Dart_Port_DL port = CreateTestPort();
+  EXPECT_TRUE(RegisterWindowCountPortFiltered(
+      port, kDartPortTopicWindowCount, kDartPortFilterCrossesThreshold, 5));
+  mock_dart_api::Reset();
+  manager_->NotifyWindowCountChanged(2);
+  manager_->NotifyWindowCountChanged(5);
+  auto values = GetPostedValues();
+  ASSERT_EQ(1u, values.size());
+  EXPECT_EQ(5, values[0]);
+}
+
+//==============================================================================
+// Test Suite 8: Listener (NativeCallable) Delivery Mode
+//==============================================================================
+
+namespace {
+std::vector<int64_t> g_listener_values;
+void RecordingListener(int64_t value) { g_listener_values.push_back(value); }
+}  // namespace
+
+TEST_F(DartPortManagerTest, RegisterListener_DeliversInitialCountDirectly) {
+  g_listener_values.clear();
+  auto subscriber = DartSubscriber::ForListener(RecordingListener);
+  EXPECT_TRUE(manager_->Register(subscriber, 4, DartPortSubscription()));
+  EXPECT_EQ(0u, GetPostCallCount());  // No port message
+  ASSERT_EQ(1u, g_listener_values.size());
+  EXPECT_EQ(4, g_listener_values[0]);
+  EXPECT_TRUE(manager_->Unregister(subscriber));
+}
+
+TEST_F(DartPortManagerTest, Notify_MixedModes_BothDelivered) {
+  g_listener_values.clear();
+  Dart_Port_DL port = CreateTestPort();
+  auto listener = DartSubscriber::ForListener(RecordingListener);
+  manager_->RegisterPort(port, -1);
+  manager_->Register(listener, -1, DartPortSubscription());
+  mock_dart_api::Reset();
+  manager_->NotifyWindowCountChanged(6);
+  EXPECT_EQ(1u, GetPostCallCount());
+  ASSERT_EQ(1u, g_listener_values.size());
+  EXPECT_EQ(6, g_listener_values[0]);
+  manager_->Unregister(listener);
+}
+
+TEST_F(DartPortManagerTest, Listener_FiltersApply) {
+  g_listener_values.clear();
+  DartPortSubscription subscription;
+  subscription.filter_flags = kDartPortFilterCrossesThreshold;
+  subscription.threshold = 2;
+  auto listener = DartSubscriber::ForListener(RecordingListener);
+  manager_->Register(listener, 1, subscription);
+  g_listener_values.clear();
+  manager_->NotifyWindowCountChanged(1);
+  manager_->NotifyWindowCountChanged(2);
+  ASSERT_EQ(1u, g_listener_values.size());
+  EXPECT_EQ(2, g_listener_values[0]);
+  manager_->Unregister(listener);
+}
+
+TEST_F(DartPortManagerTest, UnregisterWindowCountListener_FFI_StopsDelivery) {
+  g_listener_values.clear();
+  ASSERT_TRUE(RegisterWindowCountListener(RecordingListener, kDartPortTopicAll,
+                                          kDartPortFilterNone, 0));
+  EXPECT_TRUE(UnregisterWindowCountListener(RecordingListener));
+  g_listener_values.clear();
+  manager_->NotifyWindowCountChanged(9);
+  EXPECT_TRUE(g_listener_values.empty());
+  EXPECT_FALSE(UnregisterWindowCountListener(RecordingListener));
+}
+
+TEST_F(DartPortManagerTest, RegisterWindowCountListener_FFI_NullRejected) {
+  EXPECT_FALSE(RegisterWindowCountListener(nullptr, kDartPortTopicAll,
+                                           kDartPortFilterNone, 0));
+}
+
+//==============================================================================
+// Test Suite 9: Trace ID Delivery
+//==============================================================================
+
+TEST_F(DartPortManagerTest, Notify_TraceIdFlag_PacksTraceIdAboveValue) {
+  Dart_Port_DL traced = CreateTestPort();
+  Dart_Port_DL plain = CreateTestPort();
+  DartPortSubscription subscription;
+  subscription.filter_flags = kDartPortTraceId;
+  manager_->RegisterPort(traced, -1, subscription);
+  manager_->RegisterPort(plain, -1);
+  mock_dart_api::Reset();
+  manager_->NotifyWindowCountChanged(3, 0, 42);
+
+  const auto& calls = mock_dart_api::GetPostCalls();
+  ASSERT_EQ(2u, calls.size());
+  for (const auto& call : calls) {
+    if (call.port == traced) {
+      EXPECT_EQ((int64_t{42} << 32) | 3, call.value_as_int64);
+    } else {
+      EXPECT_EQ(3, call.value_as_int64);  // Unchanged for untraced ports
+    }
+  }
+}
+
+TEST_F(DartPortManagerTest, Listener_TraceIdFlag_PacksTraceIdAboveValue) {
+  g_listener_values.clear();
+  DartPortSubscription subscription;
+  subscription.filter_flags = kDartPortTraceId;
+  auto listener = DartSubscriber::ForListener(RecordingListener);
+  manager_->Register(listener, 2, subscription);  // Initial count: ID 0
+  manager_->NotifyWindowCountChanged(5, 0, 7);
+  ASSERT_EQ(2u, g_listener_values.size());
+  EXPECT_EQ(2, g_listener_values[0]);
+  EXPECT_EQ((int64_t{7} << 32) | 5, g_listener_values[1]);
+  manager_->Unregister(listener);
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -0,0 +1,257 @@
+// ipc_callback_executor_test.cpp
+//
+// Google Test unit tests for IpcCallbackExecutor and IpcCallbackQueue, which
+// run listener callbacks off the waiting thread.
+//
+// Slow callbacks are stood in for by tasks that block on a gate event the
+// test opens once it has looked at the queue.
+
+#include <gtest/gtest.h>
+#include <windows.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "ipc_callback_executor.h"
+#include "ipc_metrics.h"
+#include "ipc_test_namespace.h"
+
+namespace {
+
+template <typename T>
+bool WaitFor(const std::atomic<T>& value, T expected) {
+  for (int i = 0; i < 200 && value.load() != expected; i++) {
+    Sleep(5);
+  }
+  return value.load() == expected;
+}
+
+int64_t Counter(ipc_metrics::Counter counter) {
+  ipc_metrics::MetricsSnapshot snapshot{};
+  ipc_metrics::GetRegistry().Snapshot(&snapshot);
+  return snapshot.counters[counter];
+}
+
+}  // namespace
+
+class IpcCallbackExecutorTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    gate_ = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+    ASSERT_NE(nullptr, gate_);
+  }
+
+  void TearDown() override {
+    if (gate_ != nullptr) {
+      SetEvent(gate_);  // Never leave a worker blocked
+      CloseHandle(gate_);
+    }
+  }
+
+  // Task that signals it started, then blocks until the gate opens.
+  IpcCallbackTask BlockedTask(std::atomic<bool>* started) {
+    HANDLE gate = gate_;
+    return [gate, started] {
+      *started = true;
+      WaitForSingleObject(gate, 5000);
+    };
+  }
+
+  HANDLE gate_ = nullptr;
+};
+
+//==============================================================================
+// Test Suite 1: Inline and Queued Execution
+//==============================================================================
+
+TEST_F(IpcCallbackExecutorTest, Inline_RunsOnCallingThread) {
+  IpcCallbackQueue queue(nullptr);
+  EXPECT_TRUE(queue.is_inline());
+
+  std::thread::id ran_on;
+  EXPECT_EQ(IpcCallbackQueue::kRanInline,
+            queue.Submit([&ran_on] { ran_on = std::this_thread::get_id(); }));
+  EXPECT_EQ(std::this_thread::get_id(), ran_on);
+}
+
+TEST_F(IpcCallbackExecutorTest, Submit_ReturnsWhileTaskRuns) {
+  IpcCallbackQueue queue(std::make_shared<IpcCallbackExecutor>(1));
+  std::atomic<bool> started{false};
+
+  EXPECT_EQ(IpcCallbackQueue::kQueued, queue.Submit(BlockedTask(&started)));
+  ASSERT_TRUE(WaitFor(started, true));  // Running on the worker
+
+  std::atomic<int> calls{0};
+  EXPECT_EQ(IpcCallbackQueue::kQueued, queue.Submit([&calls] { calls++; }));
+  EXPECT_EQ(1u, queue.GetPendingCount());
+  SetEvent(gate_);
+  EXPECT_TRUE(WaitFor(calls, 1));
+}
+
+TEST_F(IpcCallbackExecutorTest, Queue_RunsTasksOneAtATimeInOrder) {
+  // Two workers, yet one queue's tasks never overlap
+  IpcCallbackQueue queue(std::make_shared<IpcCallbackExecutor>(2), 64);
+  std::atomic<int> running{0};
+  std::atomic<int> overlaps{0};
+  std::mutex order_mutex;
+  std::vector<int> order;
+
+  for (int i = 0; i < 20; i++) {
+    queue.Submit([&, i] {
+      if (running.fetch_add(1) != 0) {
+        overlaps++;
+      }
+      Sleep(1);
+      {
+        std::lock_guard<std::mutex> lock(order_mutex);
+        order.push_back(i);
+      }
+      running--;
+    });
+  }
+  for (int i = 0; i < 200 && queue.GetPendingCount() > 0; i++) {
+    Sleep(5);
+  }
+  queue.Close();  // Waits for the last one
+
+  EXPECT_EQ(0, overlaps.load());
+  ASSERT_EQ(20u, order.size());
+  for (int i = 0; i < 20; i++) {
+    EXPECT_EQ(i, order[i]);
+  }
+}
+
+//==============================================================================
+// Test Suite 2: Backpressure
+//==============================================================================
+
+TEST_F(IpcCallbackExecutorTest, FullQueue_ReplacesNewestTask) {
+  IpcCallbackQueue queue(std::make_shared<IpcCallbackExecutor>(1), 2);
+  std::atomic<bool> started{false};
+  queue.Submit(BlockedTask(&started));
+  ASSERT_TRUE(WaitFor(started, true));
+  int64_t queued_before = Counter(ipc_metrics::kMetricCallbacksQueued);
+  int64_t collapsed_before = Counter(ipc_metrics::kMetricCallbacksCollapsed);
+
+  std::mutex ran_mutex;
+  std::vector<int> ran;
+  auto task = [&](int value) {
+    return [&, value] {
+      std::lock_guard<std::mutex> lock(ran_mutex);
+      ran.push_back(value);
+    };
+  };
+  EXPECT_EQ(IpcCallbackQueue::kQueued, queue.Submit(task(1)));
+  EXPECT_EQ(IpcCallbackQueue::kQueued, queue.Submit(task(2)));
+  EXPECT_EQ(IpcCallbackQueue::kCollapsed, queue.Submit(task(3)));
+  EXPECT_EQ(IpcCallbackQueue::kCollapsed, queue.Submit(task(4)));
+  EXPECT_EQ(2u, queue.GetPendingCount());  // Bounded however far behind
+  EXPECT_EQ(queued_before + 2, Counter(ipc_metrics::kMetricCallbacksQueued));
+  EXPECT_EQ(collapsed_before + 2,
+            Counter(ipc_metrics::kMetricCallbacksCollapsed));
+
+  SetEvent(gate_);
+  for (int i = 0; i < 200 && queue.GetPendingCount() > 0; i++) {
+    Sleep(5);
+  }
+  queue.Close();
+  EXPECT_EQ((std::vector<int>{1, 4}), ran);  // The oldest and the latest
+}
+
+TEST_F(IpcCallbackExecutorTest, SharedPool_BusyQueueDoesNotStallOthers) {
+  std::shared_ptr<IpcCallbackExecutor> pool = IpcCallbackExecutor::Acquire();
+  EXPECT_EQ(pool.get(), IpcCallbackExecutor::Acquire().get());
+  ASSERT_GE(pool->thread_count(), 2u);
+
+  IpcCallbackQueue slow(pool);
+  IpcCallbackQueue fast(pool);
+  std::atomic<bool> started{false};
+  slow.Submit(BlockedTask(&started));
+  ASSERT_TRUE(WaitFor(started, true));
+
+  std::atomic<int> calls{0};
+  for (int i = 0; i < 3; i++) {
+    fast.Submit([&calls] { calls++; });
+  }
+  EXPECT_TRUE(WaitFor(calls, 3));
+  SetEvent(gate_);
+}
+
+//==============================================================================
+// Test Suite 3: Shutdown and Errors
+//==============================================================================
+
+TEST_F(IpcCallbackExecutorTest, Close_WaitsForRunningTaskAndDropsQueued) {
+  IpcCallbackQueue queue(std::make_shared<IpcCallbackExecutor>(1));
+  std::atomic<bool> started{false};
+  std::atomic<bool> finished{false};
+  HANDLE gate = gate_;
+  queue.Submit([gate, &started, &finished] {
+    started = true;
+    WaitForSingleObject(gate, 5000);
+    Sleep(20);
+    finished = true;
+  });
+  ASSERT_TRUE(WaitFor(started, true));
+  std::atomic<int> dropped_calls{0};
+  queue.Submit([&dropped_calls] { dropped_calls++; });
+
+  // Close() drops the queued task at once, then waits for the gate
+  std::thread closer([&queue] { queue.Close(); });
+  Sleep(20);
+  EXPECT_FALSE(finished.load());
+  SetEvent(gate_);
+  closer.join();
+  EXPECT_TRUE(finished.load());
+  EXPECT_EQ(0u, queue.GetPendingCount());
+
+  EXPECT_EQ(IpcCallbackQueue::kClosed, queue.Submit([] {}));
+  Sleep(20);
+  EXPECT_EQ(0, dropped_calls.load());
+}
+
+TEST_F(IpcCallbackExecutorTest, Close_FromOwnTask_DoesNotWaitForItself) {
+  auto executor = std::make_shared<IpcCallbackExecutor>(1);
+  IpcCallbackQueue queue(executor);
+  std::atomic<bool> started{false};
+  std::atomic<bool> closed{false};
+  HANDLE gate = gate_;
+  queue.Submit([gate, &queue, &started, &closed] {
+    started = true;
+    WaitForSingleObject(gate, 5000);
+    queue.Close();
+    closed = true;
+  });
+  ASSERT_TRUE(WaitFor(started, true));
+  std::atomic<int> dropped_calls{0};
+  queue.Submit([&dropped_calls] { dropped_calls++; });
+
+  SetEvent(gate_);
+  ASSERT_TRUE(WaitFor(closed, true));
+  EXPECT_EQ(IpcCallbackQueue::kClosed, queue.Submit([] {}));
+
+  // The worker let go of the queue and serves others
+  IpcCallbackQueue other(executor);
+  std::atomic<int> other_calls{0};
+  other.Submit([&other_calls] { other_calls++; });
+  EXPECT_TRUE(WaitFor(other_calls, 1));
+  EXPECT_EQ(0, dropped_calls.load());
+}
+
+TEST_F(IpcCallbackExecutorTest, ThrowingTask_WorkerKeepsRunning) {
+  IpcCallbackQueue queue(std::make_shared<IpcCallbackExecutor>(1));
+  std::atomic<int> calls{0};
+  queue.Submit([] { throw std::runtime_error("Test exception"); });
+  queue.Submit([&calls] { calls++; });
+  EXPECT_TRUE(WaitFor(calls, 1));
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  UseIpcTestNamespaces("IpcCallbackExecutorTest");
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,177 @@
+// ipc_capture_test.cpp
+//
+// Google Test unit tests for IPC traffic capture files (ipc_capture)
+//
+// Writers drain their own flight recorder rings, so the tests never see
+// events recorded by other tests through the global recorder.
+
+#include <gtest/gtest.h>
+#include <windows.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "ipc_capture.h"
+#include "ipc_flight_recorder.h"
+
+namespace {
+
+std::string RingName(const char* test) {
+  return std::string("Local\\IpcCaptureTest.") + test + "." +
+         std::to_string(GetCurrentProcessId());
+}
+
+std::string TempFile(const char* name) {
+  char temp_path[MAX_PATH];
+  DWORD length = GetTempPathA(MAX_PATH, temp_path);
+  return std::string(temp_path, length) + name;
+}
+
+}  // namespace
+
+//==============================================================================
+// Test Suite 1: Capturing
+//==============================================================================
+
+TEST(IpcCaptureTest, Capture_RoundTripsEvents) {
+  ipc_flight::FlightRecorder recorder(RingName("RoundTrip"), 64);
+  ASSERT_TRUE(recorder.Open());
+  std::string path = TempFile("ipc_capture_test_round_trip.bin");
+
+  ipc_capture::CaptureWriter writer(&recorder);
+  ASSERT_TRUE(writer.Open(path));
+  recorder.Record(ipc_flight::kFlightIncrement, 2, 1, 7);
+  recorder.Record(ipc_flight::kFlightDartPost, 2, 0x1234, 7);
+  EXPECT_EQ(2u, writer.Poll());
+  ASSERT_TRUE(writer.Close());
+
+  ipc_capture::CaptureFileHeader header;
+  std::vector<ipc_capture::CaptureRecord> records;
+  ASSERT_TRUE(ipc_capture::ReadCaptureFile(path, &header, &records));
+  std::remove(path.c_str());
+
+  EXPECT_GT(header.frequency, 0);
+  ASSERT_EQ(2u, records.size());
+  EXPECT_EQ(ipc_flight::kFlightIncrement, records[0].kind);
+  EXPECT_EQ(2, records[0].value);
+  EXPECT_EQ(1, records[0].detail);
+  EXPECT_EQ(7u, records[0].trace_id);
+  EXPECT_EQ(GetCurrentProcessId(), records[0].process_id);
+  EXPECT_GE(records[0].ticks, header.start_ticks);
+  EXPECT_EQ(ipc_flight::kFlightDartPost, records[1].kind);
+  EXPECT_EQ(0x1234, records[1].detail);
+}
+
+TEST(IpcCaptureTest, Open_SkipsEventsRecordedBefore) {
+  ipc_flight::FlightRecorder recorder(RingName("Before"), 64);
+  ASSERT_TRUE(recorder.Open());
+  recorder.Record(ipc_flight::kFlightListenerStart);
+  std::string path = TempFile("ipc_capture_test_before.bin");
+
+  ipc_capture::CaptureWriter writer(&recorder);
+  ASSERT_TRUE(writer.Open(path));
+  recorder.Record(ipc_flight::kFlightListenerStop);
+  ASSERT_TRUE(writer.Close());  // Close polls the last events
+
+  ipc_capture::CaptureFileHeader header;
+  std::vector<ipc_capture::CaptureRecord> records;
+  ASSERT_TRUE(ipc_capture::ReadCaptureFile(path, &header, &records));
+  std::remove(path.c_str());
+  ASSERT_EQ(1u, records.size());
+  EXPECT_EQ(ipc_flight::kFlightListenerStop, records[0].kind);
+  EXPECT_EQ(1u, writer.GetRecordCount());
+}
+
+TEST(IpcCaptureTest, Poll_AfterRingWrapped_CountsLostEvents) {
+  ipc_flight::FlightRecorder recorder(RingName("Lost"), 8);
+  ASSERT_TRUE(recorder.Open());
+  std::string path = TempFile("ipc_capture_test_lost.bin");
+
+  ipc_capture::CaptureWriter writer(&recorder);
+  ASSERT_TRUE(writer.Open(path));
+  for (int64_t i = 0; i < 10; i++) {
+    recorder.Record(ipc_flight::kFlightIncrement, i);
+  }
+  EXPECT_EQ(8u, writer.Poll());
+  ASSERT_TRUE(writer.Close());
+  std::remove(path.c_str());
+
+  EXPECT_EQ(8u, writer.GetRecordCount());
+  EXPECT_EQ(2u, writer.GetLostCount());
+}
+
+//==============================================================================
+// Test Suite 2: Reading Capture Files
+//==============================================================================
+
+TEST(IpcCaptureTest, ReadCaptureFile_Missing_Fails) {
+  ipc_capture::CaptureFileHeader header;
+  std::vector<ipc_capture::CaptureRecord> records;
+  EXPECT_FALSE(ipc_capture::ReadCaptureFile(
+      TempFile("ipc_capture_test_missing.bin"), &header, &records));
+}
+
+TEST(IpcCaptureTest, ReadCaptureFile_NotACapture_Fails) {
+  std::string path = TempFile("ipc_capture_test_garbage.bin");
+  FILE* file = std::fopen(path.c_str(), "wb");
+  ASSERT_NE(nullptr, file);
+  std::fputs("this is not a capture file, just some text", file);
+  std::fclose(file);
+
+  ipc_capture::CaptureFileHeader header;
+  std::vector<ipc_capture::CaptureRecord> records;
+  EXPECT_FALSE(ipc_capture::ReadCaptureFile(path, &header, &records));
+  std::remove(path.c_str());
+}
+
+TEST(IpcCaptureTest, ReadCaptureFile_PartialLastRecord_IsIgnored) {
+  ipc_flight::FlightRecorder recorder(RingName("Partial"), 64);
+  ASSERT_TRUE(recorder.Open());
+  std::string path = TempFile("ipc_capture_test_partial.bin");
+  {
+    ipc_capture::CaptureWriter writer(&recorder);
+    ASSERT_TRUE(writer.Open(path));
+    recorder.Record(ipc_flight::kFlightSubscriberAdd, 1, 42);
+    ASSERT_TRUE(writer.Close());
+  }
+  // A capture killed mid-write leaves part of a record behind.
+  FILE* file = std::fopen(path.c_str(), "ab");
+  ASSERT_NE(nullptr, file);
+  std::fwrite("partial", 1, 7, file);
+  std::fclose(file);
+
+  ipc_capture::CaptureFileHeader header;
+  std::vector<ipc_capture::CaptureRecord> records;
+  ASSERT_TRUE(ipc_capture::ReadCaptureFile(path, &header, &records));
+  std::remove(path.c_str());
+  ASSERT_EQ(1u, records.size());
+  EXPECT_EQ(42, records[0].detail);
+}
+
+//==============================================================================
+// Test Suite 3: Background Capture
+//==============================================================================
+
+TEST(IpcCaptureTest, StopCapture_NotRunning_ReturnsFalse) {
+  EXPECT_FALSE(ipc_capture::StopCapture());
+}
+
+TEST(IpcCaptureTest, StartCapture_Twice_SecondFails) {
+  std::string path = TempFile("ipc_capture_test_session.bin");
+  ASSERT_TRUE(ipc_capture::StartCapture(path));
+  EXPECT_FALSE(ipc_capture::StartCapture(path));
+
+  ipc_flight::Record(ipc_flight::kFlightListenerWake);
+  uint64_t records = 0;
+  uint64_t lost = 0;
+  EXPECT_TRUE(ipc_capture::StopCapture(&records, &lost));
+  std::remove(path.c_str());
+  EXPECT_GE(records, 1u);
+  EXPECT_EQ(0u, lost);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,150 @@
+// ipc_delivery_policy_test.cpp
+//
+// Google Test unit tests for the notification delivery policies: parsing
+// and the scheduling decisions of IpcDeliveryScheduler, with time passed in.
+
+#include <gtest/gtest.h>
+#include <windows.h>
+
+#include "ipc_delivery_policy.h"
+
+namespace {
+
+// One tick per microsecond keeps the expected deadlines readable.
+constexpr int64_t kTicksPerSecond = 1000000;
+
+}  // namespace
+
+//==============================================================================
+// Test Suite 1: Parsing
+//==============================================================================
+
+TEST(IpcDeliveryPolicyTest, Parse_ValidPolicies) {
+  IpcDeliveryPolicy policy;
+  ASSERT_TRUE(ParseDeliveryPolicy("coalesce:500", &policy));
+  EXPECT_EQ(IpcDeliveryPolicy::Coalesce(500), policy);
+  ASSERT_TRUE(ParseDeliveryPolicy("debounce:20000", &policy));
+  EXPECT_EQ(IpcDeliveryPolicy::Debounce(20000), policy);
+  ASSERT_TRUE(ParseDeliveryPolicy("frame:120", &policy));
+  EXPECT_EQ(IpcDeliveryMode::kFrameAligned, policy.mode);
+  EXPECT_EQ(8333u, policy.period_us);
+  ASSERT_TRUE(ParseDeliveryPolicy("immediate", &policy));
+  EXPECT_EQ(IpcDeliveryPolicy::Immediate(), policy);
+}
+
+TEST(IpcDeliveryPolicyTest, Parse_RejectsInvalid) {
+  IpcDeliveryPolicy policy = IpcDeliveryPolicy::Coalesce(7);
+  EXPECT_FALSE(ParseDeliveryPolicy("", &policy));
+  EXPECT_FALSE(ParseDeliveryPolicy("coalesce", &policy));
+  EXPECT_FALSE(ParseDeliveryPolicy("coalesce:0", &policy));
+  EXPECT_FALSE(ParseDeliveryPolicy("coalesce:-5", &policy));
+  EXPECT_FALSE(ParseDeliveryPolicy("debounce:1000001", &policy));
+  EXPECT_FALSE(ParseDeliveryPolicy("frame:5000", &policy));
+  EXPECT_FALSE(ParseDeliveryPolicy("throttle:100", &policy));
+  EXPECT_EQ(IpcDeliveryPolicy::Coalesce(7), policy);  // Untouched
+}
+
+TEST(IpcDeliveryPolicyTest, Format_RoundTrips) {
+  const char* texts[] = {"immediate", "coalesce:500", "debounce:2000",
+                         "frame:60"};
+  for (const char* text : texts) {
+    IpcDeliveryPolicy policy;
+    ASSERT_TRUE(ParseDeliveryPolicy(text, &policy)) << text;
+    EXPECT_EQ(text, FormatDeliveryPolicy(policy));
+  }
+}
+
+TEST(IpcDeliveryPolicyTest, Environment_InvalidValueIsImmediate) {
+  SetEnvironmentVariableA(kDeliveryPolicyEnvironmentVariable, "frame:60");
+  EXPECT_EQ(IpcDeliveryPolicy::FrameAligned(60),
+            GetEnvironmentDeliveryPolicy());
+
+  SetEnvironmentVariableA(kDeliveryPolicyEnvironmentVariable, "bogus");
+  EXPECT_EQ(IpcDeliveryPolicy::Immediate(), GetEnvironmentDeliveryPolicy());
+  SetEnvironmentVariableA(kDeliveryPolicyEnvironmentVariable, nullptr);
+}
+
+//==============================================================================
+// Test Suite 2: Scheduling
+//==============================================================================
+
+TEST(IpcDeliveryPolicyTest, Immediate_DeliversEveryChange) {
+  IpcDeliveryScheduler scheduler(IpcDeliveryPolicy::Immediate(),
+                                 kTicksPerSecond);
+  for (int64_t now = 100; now < 120; now++) {
+    EXPECT_EQ(IpcDeliveryScheduler::kDeliverNow, scheduler.OnChange(now));
+  }
+  EXPECT_EQ(0, scheduler.deadline());
+}
+
+TEST(IpcDeliveryPolicyTest, Coalesce_OneDeliveryPerWindow) {
+  IpcDeliveryScheduler scheduler(IpcDeliveryPolicy::Coalesce(500),
+                                 kTicksPerSecond);
+  EXPECT_EQ(IpcDeliveryScheduler::kScheduled, scheduler.OnChange(1000));
+  EXPECT_EQ(1500, scheduler.deadline());
+  EXPECT_EQ(IpcDeliveryScheduler::kMerged, scheduler.OnChange(1200));
+  EXPECT_EQ(IpcDeliveryScheduler::kMerged, scheduler.OnChange(1499));
+  EXPECT_EQ(1500, scheduler.deadline());  // Later changes do not delay it
+
+  EXPECT_TRUE(scheduler.OnDeadline(1500));
+  EXPECT_EQ(0, scheduler.deadline());
+  EXPECT_EQ(IpcDeliveryScheduler::kScheduled, scheduler.OnChange(1600));
+  EXPECT_EQ(2100, scheduler.deadline());
+}
+
+TEST(IpcDeliveryPolicyTest, Debounce_LeadingAndTrailingEdges) {
+  IpcDeliveryScheduler scheduler(IpcDeliveryPolicy::Debounce(1000),
+                                 kTicksPerSecond);
+  EXPECT_EQ(IpcDeliveryScheduler::kDeliverNow, scheduler.OnChange(5000));
+  EXPECT_EQ(0, scheduler.deadline());  // Nothing held yet
+
+  EXPECT_EQ(IpcDeliveryScheduler::kScheduled, scheduler.OnChange(5300));
+  EXPECT_EQ(6300, scheduler.deadline());
+  EXPECT_EQ(IpcDeliveryScheduler::kMerged, scheduler.OnChange(5900));
+  EXPECT_EQ(6900, scheduler.deadline());  // Quiet period starts over
+
+  EXPECT_FALSE(scheduler.OnDeadline(6300));  // Timer armed before the merge
+  EXPECT_TRUE(scheduler.OnDeadline(6900));   // Trailing edge
+
+  // Quiet again: the next change is a leading edge
+  EXPECT_EQ(IpcDeliveryScheduler::kDeliverNow, scheduler.OnChange(8000));
+}
+
+TEST(IpcDeliveryPolicyTest, FrameAligned_DeliversOnNextTick) {
+  IpcDeliveryScheduler scheduler(IpcDeliveryPolicy::FrameAligned(100),
+                                 kTicksPerSecond);  // 10000 us frames
+  EXPECT_EQ(IpcDeliveryScheduler::kScheduled, scheduler.OnChange(123456));
+  EXPECT_EQ(130000, scheduler.deadline());
+  EXPECT_FALSE(scheduler.OnDeadline(129999));
+  EXPECT_TRUE(scheduler.OnDeadline(130001));
+
+  // A change exactly on a tick waits for the next one
+  EXPECT_EQ(IpcDeliveryScheduler::kScheduled, scheduler.OnChange(140000));
+  EXPECT_EQ(150000, scheduler.deadline());
+}
+
+TEST(IpcDeliveryPolicyTest, FrameAligned_BurstIsOneDeliveryPerFrame) {
+  IpcDeliveryScheduler scheduler(IpcDeliveryPolicy::FrameAligned(60),
+                                 kTicksPerSecond);
+  int deliveries = 0;
+  int merged = 0;
+  // 20 windows opening 1 ms apart span two frame ticks
+  for (int64_t now = 1000000; now < 1020000; now += 1000) {
+    if (scheduler.deadline() != 0 && scheduler.OnDeadline(now)) {
+      deliveries++;
+    }
+    if (scheduler.OnChange(now) == IpcDeliveryScheduler::kMerged) {
+      merged++;
+    }
+  }
+  if (scheduler.OnDeadline(scheduler.deadline())) {
+    deliveries++;
+  }
+  EXPECT_LE(deliveries, 3);
+  EXPECT_EQ(20, deliveries + merged);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
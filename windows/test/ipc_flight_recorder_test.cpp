@@ -0,0 +1,288 @@
+// ipc_flight_recorder_test.cpp
+//
+// Google Test unit tests for the cross-process IPC flight recorder
+// (ipc_flight)
+//
+// Recorder tests use their own ring names so they never see events recorded
+// by other tests through the global recorder.
+
+#include <gtest/gtest.h>
+#include <windows.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ipc_flight_recorder.h"
+
+namespace {
+
+std::string RingName(const char* test) {
+  return std::string("Local\\IpcFlightRecorderTest.") + test + "." +
+         std::to_string(GetCurrentProcessId());
+}
+
+std::string ReadFile(const std::string& path) {
+  FILE* file = std::fopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    return std::string();
+  }
+  std::string text;
+  char buf[512];
+  size_t read;
+  while ((read = std::fread(buf, 1, sizeof(buf), file)) > 0) {
+    text.append(buf, read);
+  }
+  std::fclose(file);
+  return text;
+}
+
+}  // namespace
+
+//==============================================================================
+// Test Suite 1: Recording
+//==============================================================================
+
+TEST(IpcFlightRecorderTest, Record_CollectReturnsEventsInOrder) {
+  ipc_flight::FlightRecorder recorder(RingName("Order"), 64);
+  ASSERT_TRUE(recorder.Open());
+
+  recorder.Record(ipc_flight::kFlightIncrement, 3, 1, 17);
+  recorder.Record(ipc_flight::kFlightDartPost, 3, 0x1234, 17);
+
+  std::vector<ipc_flight::FlightEvent> events = recorder.Collect();
+  ASSERT_EQ(2u, events.size());
+  EXPECT_EQ(ipc_flight::kFlightIncrement, events[0].kind);
+  EXPECT_EQ(3, events[0].value);
+  EXPECT_EQ(1, events[0].detail);
+  EXPECT_EQ(17u, events[0].trace_id);
+  EXPECT_EQ(GetCurrentProcessId(), events[0].process_id);
+  EXPECT_EQ(GetCurrentThreadId(), events[0].thread_id);
+  EXPECT_GT(events[0].ticks, 0);
+  EXPECT_EQ(ipc_flight::kFlightDartPost, events[1].kind);
+  EXPECT_EQ(0x1234, events[1].detail);
+  EXPECT_LE(events[0].ticks, events[1].ticks);
+}
+
+TEST(IpcFlightRecorderTest, Record_WithoutOpen_DoesNothing) {
+  ipc_flight::FlightRecorder recorder(RingName("Closed"), 64);
+  recorder.Record(ipc_flight::kFlightListenerWake);
+  EXPECT_TRUE(recorder.Collect().empty());
+}
+
+TEST(IpcFlightRecorderTest, Record_RingFull_KeepsNewestEvents) {
+  ipc_flight::FlightRecorder recorder(RingName("Wrap"), 8);
+  ASSERT_TRUE(recorder.Open());
+
+  for (int64_t i = 1; i <= 20; i++) {
+    recorder.Record(ipc_flight::kFlightIncrement, i);
+  }
+
+  std::vector<ipc_flight::FlightEvent> events = recorder.Collect();
+  ASSERT_EQ(8u, events.size());
+  EXPECT_EQ(13, events.front().value);
+  EXPECT_EQ(20, events.back().value);
+  EXPECT_EQ(0, recorder.GetDroppedCount());
+}
+
+//==============================================================================
+// Test Suite 2: Surviving the Writer
+//==============================================================================
+
+TEST(IpcFlightRecorderTest, TwoRecordersSameRing_ShareEvents) {
+  ipc_flight::FlightRecorder first(RingName("Shared"), 64);
+  ipc_flight::FlightRecorder second(RingName("Shared"), 64);
+  ASSERT_TRUE(first.Open());
+  ASSERT_TRUE(second.Open());
+
+  first.Record(ipc_flight::kFlightSubscriberAdd, 1, 42);
+  second.Record(ipc_flight::kFlightSubscriberRemove, 0, 42);
+
+  EXPECT_EQ(2u, first.Collect().size());
+  EXPECT_EQ(2u, second.Collect().size());
+}
+
+TEST(IpcFlightRecorderTest, WriterGone_EventsStayReadable) {
+  // A window that hangs or crashes stops writing; its history stays in the
+  // mapping for as long as any other process holds it.
+  ipc_flight::FlightRecorder survivor(RingName("Survive"), 64);
+  ASSERT_TRUE(survivor.Open());
+  {
+    auto writer = std::make_unique<ipc_flight::FlightRecorder>(
+        RingName("Survive"), 64);
+    ASSERT_TRUE(writer->Open());
+    writer->Record(ipc_flight::kFlightDecrement, 0, -1, 9);
+  }
+
+  std::vector<ipc_flight::FlightEvent> events = survivor.Collect();
+  ASSERT_EQ(1u, events.size());
+  EXPECT_EQ(ipc_flight::kFlightDecrement, events[0].kind);
+  EXPECT_EQ(9u, events[0].trace_id);
+}
+
+TEST(IpcFlightRecorderTest, WriterDiedMidRecord_SlotTakenOverNextLap) {
+  const uint32_t kCapacity = 8;
+  ipc_flight::FlightRecorder recorder(RingName("DeadWriter"), kCapacity);
+  ASSERT_TRUE(recorder.Open());
+
+  // A writer claims event 0 and dies before publishing it.
+  HANDLE mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE,
+                                    RingName("DeadWriter").c_str());
+  ASSERT_NE(nullptr, mapping);
+  auto* header = static_cast<ipc_flight::FlightRingHeader*>(
+      MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+  ASSERT_NE(nullptr, header);
+  auto* slots = reinterpret_cast<ipc_flight::FlightSlot*>(header + 1);
+  InterlockedIncrement(&header->write_index);
+  InterlockedExchange(&slots[0].sequence, 1);  // Odd, lap of event 0
+
+  // Events 1..8; event 8 lands on the dead writer's slot.
+  for (int64_t i = 1; i <= kCapacity; i++) {
+    recorder.Record(ipc_flight::kFlightIncrement, i);
+  }
+  EXPECT_EQ(0, recorder.GetDroppedCount());
+  std::vector<ipc_flight::FlightEvent> events = recorder.Collect();
+  ASSERT_EQ(kCapacity, events.size());
+  EXPECT_EQ(static_cast<int64_t>(kCapacity), events.back().value);
+
+  // Event 16 finds the slot published by a lap it is ahead of.
+  for (int64_t i = kCapacity + 1; i <= 2 * kCapacity; i++) {
+    recorder.Record(ipc_flight::kFlightIncrement, i);
+  }
+  EXPECT_EQ(0, recorder.GetDroppedCount());
+
+  UnmapViewOfFile(header);
+  CloseHandle(mapping);
+}
+
+TEST(IpcFlightRecorderTest, OpenReadOnly_NoRing_Fails) {
+  ipc_flight::FlightRecorder inspector(RingName("Missing"));
+  EXPECT_FALSE(inspector.OpenReadOnly());
+}
+
+TEST(IpcFlightRecorderTest, OpenReadOnly_SeesEventsWithoutRecording) {
+  ipc_flight::FlightRecorder writer(RingName("ReadOnly"), 16);
+  ASSERT_TRUE(writer.Open());
+  writer.Record(ipc_flight::kFlightListenerStart);
+
+  // Capacity comes from the ring, not the constructor.
+  ipc_flight::FlightRecorder inspector(RingName("ReadOnly"), 4096);
+  ASSERT_TRUE(inspector.OpenReadOnly());
+  inspector.Record(ipc_flight::kFlightListenerStop);
+
+  std::vector<ipc_flight::FlightEvent> events = inspector.Collect();
+  ASSERT_EQ(1u, events.size());
+  EXPECT_EQ(ipc_flight::kFlightListenerStart, events[0].kind);
+}
+
+//==============================================================================
+// Test Suite 3: Dumps
+//==============================================================================
+
+TEST(IpcFlightRecorderTest, FormatEvents_OneLinePerEventEndingAtZero) {
+  std::vector<ipc_flight::FlightEvent> events(2);
+  events[0] = {0, ipc_flight::kFlightIncrement, 100, 1, 1000, 2, 1, 5};
+  events[1] = {1, ipc_flight::kFlightDartPostFailed, 200, 2, 2000, 2, 77, 5};
+
+  std::string text = ipc_flight::FlightRecorder::FormatEvents(events);
+
+  EXPECT_NE(std::string::npos, text.find("count.increment"));
+  EXPECT_NE(std::string::npos, text.find("dart.post_failed"));
+  EXPECT_NE(std::string::npos, text.find("0.000000"));  // Newest event
+  EXPECT_NE(std::string::npos, text.find(" -"));        // Earlier event
+  EXPECT_EQ(3, std::count(text.begin(), text.end(), '\n'));  // Heading too
+}
+
+TEST(IpcFlightRecorderTest, DumpToFile_WritesEvents) {
+  ipc_flight::FlightRecorder recorder(RingName("Dump"), 64);
+  ASSERT_TRUE(recorder.Open());
+  recorder.Record(ipc_flight::kFlightSubscriberAdd, 1, 42);
+
+  char temp_path[MAX_PATH];
+  DWORD length = GetTempPathA(MAX_PATH, temp_path);
+  ASSERT_GT(length, 0u);
+  std::string path =
+      std::string(temp_path, length) + "ipc_flight_recorder_test.txt";
+
+  ASSERT_TRUE(recorder.DumpToFile(path));
+  std::string text = ReadFile(path);
+  std::remove(path.c_str());
+  EXPECT_NE(std::string::npos, text.find("1 events, 0 dropped"));
+  EXPECT_NE(std::string::npos, text.find("subscriber.add"));
+}
+
+//==============================================================================
+// Test Suite 4: Incremental Reads
+//==============================================================================
+
+TEST(IpcFlightRecorderTest, CollectFrom_WriteIndex_SeesOnlyNewEvents) {
+  ipc_flight::FlightRecorder recorder(RingName("FromNow"), 64);
+  ASSERT_TRUE(recorder.Open());
+  recorder.Record(ipc_flight::kFlightIncrement, 1);
+
+  uint32_t next = recorder.GetWriteIndex();
+  recorder.Record(ipc_flight::kFlightDecrement, 0);
+
+  std::vector<ipc_flight::FlightEvent> events;
+  EXPECT_EQ(0u, recorder.CollectFrom(&next, &events));
+  ASSERT_EQ(1u, events.size());
+  EXPECT_EQ(ipc_flight::kFlightDecrement, events[0].kind);
+  EXPECT_EQ(recorder.GetWriteIndex(), next);
+}
+
+TEST(IpcFlightRecorderTest, CollectFrom_Repeated_ReturnsEachEventOnce) {
+  ipc_flight::FlightRecorder recorder(RingName("Repeat"), 64);
+  ASSERT_TRUE(recorder.Open());
+  uint32_t next = recorder.GetWriteIndex();
+  std::vector<ipc_flight::FlightEvent> events;
+
+  recorder.Record(ipc_flight::kFlightIncrement, 1);
+  recorder.Record(ipc_flight::kFlightIncrement, 2);
+  recorder.CollectFrom(&next, &events);
+  recorder.CollectFrom(&next, &events);  // Nothing new
+  recorder.Record(ipc_flight::kFlightIncrement, 3);
+  recorder.CollectFrom(&next, &events);
+
+  ASSERT_EQ(3u, events.size());
+  for (size_t i = 0; i < events.size(); i++) {
+    EXPECT_EQ(static_cast<int64_t>(i + 1), events[i].value);
+  }
+}
+
+TEST(IpcFlightRecorderTest, CollectFrom_ReaderLapped_CountsLostEvents) {
+  ipc_flight::FlightRecorder recorder(RingName("Lapped"), 8);
+  ASSERT_TRUE(recorder.Open());
+  uint32_t next = recorder.GetWriteIndex();
+
+  for (int64_t i = 1; i <= 20; i++) {
+    recorder.Record(ipc_flight::kFlightIncrement, i);
+  }
+
+  std::vector<ipc_flight::FlightEvent> events;
+  EXPECT_EQ(12u, recorder.CollectFrom(&next, &events));
+  ASSERT_EQ(8u, events.size());
+  EXPECT_EQ(13, events.front().value);
+  EXPECT_EQ(20, events.back().value);
+}
+
+TEST(IpcFlightRecorderTest, CollectFrom_ReadOnlyInspector_SeesWriterEvents) {
+  ipc_flight::FlightRecorder writer(RingName("FromReadOnly"), 16);
+  ASSERT_TRUE(writer.Open());
+  ipc_flight::FlightRecorder inspector(RingName("FromReadOnly"));
+  ASSERT_TRUE(inspector.OpenReadOnly());
+  uint32_t next = inspector.GetWriteIndex();
+
+  writer.Record(ipc_flight::kFlightSubscriberAdd, 1, 42);
+
+  std::vector<ipc_flight::FlightEvent> events;
+  inspector.CollectFrom(&next, &events);
+  ASSERT_EQ(1u, events.size());
+  EXPECT_EQ(42, events[0].detail);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,321 @@
+// ipc_log_test.cpp
+//
+// Google Test unit tests for the asynchronous IPC logger (ipc_log)
+//
+// Each test uses its own Logger with a unique shared ring name and an
+// in-memory sink, so tests never touch the real merged log file.
+
+// Compile DEBUG out of this translation unit to test level filtering.
+#define IPC_LOG_MIN_LEVEL IPC_LOG_LEVEL_INFO
+
+#include <gtest/gtest.h>
+#include <windows.h>
+
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ipc_log.h"
+
+namespace {
+
+// Collects lines written by the drainer.
+class LineCollector {
+ public:
+  ipc_log::LineSink Sink() {
+    return [this](const char* text, size_t length) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      lines_.emplace_back(text, length);
+    };
+  }
+
+  std::vector<std::string> Lines() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lines_;
+  }
+
+  bool Contains(const std::string& needle) {
+    for (const std::string& line : Lines()) {
+      if (line.find(needle) != std::string::npos) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<std::string> lines_;
+};
+
+ipc_log::LoggerOptions TestOptions(const char* ring, LineCollector* lines) {
+  ipc_log::LoggerOptions options;
+  options.ring_name = std::string("Local\\IpcLogTest.") + ring + "." +
+                      std::to_string(GetCurrentProcessId());
+  options.sink = lines->Sink();
+  options.echo_to_console = false;
+  options.flush_interval_ms = 5;
+  return options;
+}
+
+// Waits until the logger's writer thread has been elected drainer.
+bool WaitForDrainer(ipc_log::Logger& logger) {
+  for (int i = 0; i < 200 && !logger.IsDrainer(); i++) {
+    Sleep(5);
+  }
+  return logger.IsDrainer();
+}
+
+// Formats a single Log() call the way the writer thread would.
+template <typename... Args>
+std::string FormatCall(const char* format, const Args&... args) {
+  LineCollector lines;
+  ipc_log::Logger logger(TestOptions("Format", &lines));
+  logger.Log(ipc_log::kInfo, format, args...);
+  EXPECT_TRUE(WaitForDrainer(logger));
+  logger.Flush();
+  std::vector<std::string> result = lines.Lines();
+  if (result.size() != 1) {
+    return "<" + std::to_string(result.size()) + " lines>";
+  }
+  // Strip "timestamp [pid:tid] LEVEL " and the trailing newline.
+  std::string line = result[0];
+  size_t start = line.find("INFO  ");
+  return line.substr(start + 6, line.size() - start - 7);
+}
+
+}  // namespace
+
+//==============================================================================
+// Test Suite 1: Deferred Formatting
+//==============================================================================
+
+TEST(IpcLogTest, Format_SubstitutesPlaceholdersInOrder) {
+  EXPECT_EQ("count 3 of 5", FormatCall("count {} of {}", 3, 5u));
+}
+
+TEST(IpcLogTest, Format_SupportsCommonArgumentTypes) {
+  EXPECT_EQ("-7 true 1.5 name",
+            FormatCall("{} {} {} {}", -7L, true, 1.5, "name"));
+  EXPECT_EQ("text", FormatCall("{}", std::string("text")));
+}
+
+TEST(IpcLogTest, Format_HexPlaceholder) {
+  EXPECT_EQ("magic 0xDEADBEEF", FormatCall("magic {:x}", 0xDEADBEEFu));
+}
+
+TEST(IpcLogTest, Format_StringIsCopiedAtCallTime) {
+  char buffer[16] = "before";
+  LineCollector lines;
+  ipc_log::Logger logger(TestOptions("Copy", &lines));
+  logger.Log(ipc_log::kInfo, "value {}", buffer);
+  std::strcpy(buffer, "after");  // Caller's buffer changes before flush
+  ASSERT_TRUE(WaitForDrainer(logger));
+  logger.Flush();
+  EXPECT_TRUE(lines.Contains("value before"));
+}
+
+TEST(IpcLogTest, Format_MissingArgumentLeavesPlaceholder) {
+  EXPECT_EQ("a 1 b {}", FormatCall("a {} b {}", 1));
+}
+
+TEST(IpcLogTest, Format_LongStringIsTruncated) {
+  std::string long_text(500, 'x');
+  std::string formatted = FormatCall("{}", long_text);
+  EXPECT_LT(formatted.size(), ipc_log::kStringBytes);
+  EXPECT_EQ(std::string::npos, formatted.find_first_not_of('x'));
+}
+
+//==============================================================================
+// Test Suite 2: Levels
+//==============================================================================
+
+TEST(IpcLogTest, DebugBelowMinLevel_ArgumentsNotEvaluated) {
+  int evaluations = 0;
+  auto count = [&]() { return ++evaluations; };
+  IPC_LOG_DEBUG("compiled out {}", count());
+  EXPECT_EQ(0, evaluations);
+
+  IPC_LOG_INFO("compiled in {}", count());
+  EXPECT_EQ(1, evaluations);
+}
+
+TEST(IpcLogTest, Line_ContainsProcessThreadAndLevel) {
+  LineCollector lines;
+  ipc_log::Logger logger(TestOptions("Header", &lines));
+  logger.Log(ipc_log::kError, "boom");
+  ASSERT_TRUE(WaitForDrainer(logger));
+  logger.Flush();
+
+  std::string expected = "[" + std::to_string(GetCurrentProcessId()) + ":" +
+                         std::to_string(GetCurrentThreadId()) + "] ERROR boom";
+  EXPECT_TRUE(lines.Contains(expected));
+}
+
+//==============================================================================
+// Test Suite 3: Per-Thread Rings
+//==============================================================================
+
+TEST(IpcLogTest, ManyThreads_AllRecordsDelivered) {
+  LineCollector lines;
+  ipc_log::Logger logger(TestOptions("Threads", &lines));
+  constexpr int kThreads = 4;
+  constexpr int kPerThread = 100;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&logger, t]() {
+      for (int i = 0; i < kPerThread; i++) {
+        logger.Log(ipc_log::kInfo, "thread {} message {}", t, i);
+        if (i % 32 == 31) {
+          Sleep(1);  // Let the writer keep up with the 256-record rings
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_TRUE(WaitForDrainer(logger));
+  logger.Flush();
+
+  EXPECT_EQ(0u, logger.GetDroppedCount());
+  EXPECT_EQ(static_cast<size_t>(kThreads * kPerThread), lines.Lines().size());
+}
+
+TEST(IpcLogTest, FullThreadRing_DropsInsteadOfBlocking) {
+  LineCollector lines;
+  ipc_log::LoggerOptions options = TestOptions("Drop", &lines);
+  options.flush_interval_ms = 60000;  // Writer effectively idle
+  ipc_log::Logger logger(options);
+
+  logger.Log(ipc_log::kInfo, "start writer");
+  ASSERT_TRUE(WaitForDrainer(logger));
+  for (uint32_t i = 0; i < ipc_log::ThreadRing::kCapacity + 10; i++) {
+    logger.Log(ipc_log::kInfo, "fill {}", i);
+  }
+  EXPECT_GE(logger.GetDroppedCount(), 1u);
+  logger.Flush();
+  EXPECT_LE(lines.Lines().size(), ipc_log::ThreadRing::kCapacity + 1);
+}
+
+//==============================================================================
+// Test Suite 4: Shared Ring (Merged Output)
+//==============================================================================
+
+TEST(IpcLogTest, TwoLoggersSameRing_MergedByOneDrainer) {
+  // Two loggers on one ring stand in for two window processes.
+  LineCollector drainer_lines;
+  LineCollector other_lines;
+  ipc_log::Logger drainer(TestOptions("Merge", &drainer_lines));
+  ipc_log::Logger other(TestOptions("Merge", &other_lines));
+
+  drainer.Log(ipc_log::kInfo, "from first");
+  ASSERT_TRUE(WaitForDrainer(drainer));
+  other.Log(ipc_log::kInfo, "from second");
+  Sleep(50);
+  EXPECT_FALSE(other.IsDrainer());
+
+  other.Flush();
+  drainer.Flush();
+
+  EXPECT_TRUE(drainer_lines.Contains("from first"));
+  EXPECT_TRUE(drainer_lines.Contains("from second"));
+  EXPECT_TRUE(other_lines.Lines().empty());
+}
+
+TEST(IpcLogTest, SlowProducers_NotSkippedOnAnEarlierSlotsTimeout) {
+  LineCollector lines;
+  ipc_log::LoggerOptions options = TestOptions("Slow", &lines);
+  ipc_log::Logger logger(options);
+  logger.Log(ipc_log::kInfo, "start");
+  ASSERT_TRUE(WaitForDrainer(logger));
+
+  // Stand in for producers in another process that reserve a slot and take
+  // a while to fill it.
+  HANDLE mapping =
+      OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, options.ring_name.c_str());
+  ASSERT_NE(nullptr, mapping);
+  auto* ring = static_cast<ipc_log::SharedLogRingHeader*>(
+      MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+  ASSERT_NE(nullptr, ring);
+  auto* slots = reinterpret_cast<ipc_log::SharedLogSlot*>(ring + 1);
+  auto reserve = [ring] {
+    return static_cast<DWORD>(InterlockedIncrement(&ring->write_index) - 1);
+  };
+  auto publish = [ring, slots](DWORD pos, const char* text) {
+    ipc_log::SharedLogSlot* slot = &slots[pos & (ring->capacity - 1)];
+    slot->length = static_cast<WORD>(std::strlen(text));
+    std::memcpy(slot->text, text, slot->length);
+    InterlockedExchange(&slot->sequence, static_cast<LONG>(pos + 1));
+  };
+
+  // Each slot is unfinished for less than the stuck-slot timeout, but the
+  // two together exceed it.
+  DWORD first = reserve();
+  Sleep(700);
+  publish(first, "slow first\n");
+  DWORD second = reserve();
+  Sleep(500);
+  publish(second, "slow second\n");
+  logger.Flush();
+
+  EXPECT_TRUE(lines.Contains("slow first"));
+  EXPECT_TRUE(lines.Contains("slow second"));
+
+  UnmapViewOfFile(ring);
+  CloseHandle(mapping);
+}
+
+TEST(IpcLogTest, StalledProducer_SkippedSlotNotOverwritten) {
+  LineCollector lines;
+  ipc_log::LoggerOptions options = TestOptions("Stalled", &lines);
+  ipc_log::Logger logger(options);
+  logger.Log(ipc_log::kInfo, "start");
+  ASSERT_TRUE(WaitForDrainer(logger));
+
+  HANDLE mapping =
+      OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, options.ring_name.c_str());
+  ASSERT_NE(nullptr, mapping);
+  auto* ring = static_cast<ipc_log::SharedLogRingHeader*>(
+      MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+  ASSERT_NE(nullptr, ring);
+  auto* slots = reinterpret_cast<ipc_log::SharedLogSlot*>(ring + 1);
+
+  // A producer in another process reserves a slot, then is suspended for
+  // longer than the drainer waits.
+  DWORD stalled =
+      static_cast<DWORD>(InterlockedIncrement(&ring->write_index) - 1);
+  logger.Flush();
+  Sleep(1100);
+  logger.Flush();
+  ipc_log::SharedLogSlot* slot = &slots[stalled & (ring->capacity - 1)];
+  ASSERT_EQ(static_cast<LONG>(stalled + ring->capacity), slot->sequence);
+
+  // Another lap reuses the slot; the resumed producer must not touch it.
+  for (DWORD i = 0; i < ring->capacity; i++) {
+    logger.Log(ipc_log::kInfo, "lap {}", i);
+    if (i % 64 == 63) {
+      logger.Flush();
+    }
+  }
+  logger.Flush();
+  EXPECT_FALSE(ipc_log::WriteSharedSlot(slot, stalled, "stale\n", 6));
+
+  // The ring still moves: every producer can push.
+  logger.Log(ipc_log::kInfo, "after resume");
+  logger.Flush();
+  EXPECT_TRUE(lines.Contains("after resume"));
+  EXPECT_TRUE(lines.Contains("lap 1023"));
+  EXPECT_FALSE(lines.Contains("stale"));
+
+  UnmapViewOfFile(ring);
+  CloseHandle(mapping);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
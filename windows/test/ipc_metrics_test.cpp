@@ -0,0 +1,338 @@
+// ipc_metrics_test.cpp
+//
+// Google Test unit tests for the cross-process metrics registry
+// (ipc_metrics)
+//
+// Each test uses its own region name so it never sees metrics recorded by
+// other tests through the global registry. Two registries on one region
+// stand in for two window processes.
+
+#include <gtest/gtest.h>
+#include <windows.h>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ipc_log.h"
+#include "ipc_metrics.h"
+
+namespace {
+
+std::string RegionName(const char* test) {
+  return std::string("Local\\IpcMetricsTest.") + test + "." +
+         std::to_string(GetCurrentProcessId());
+}
+
+ipc_metrics::MetricsSnapshot TakeSnapshot(
+    const ipc_metrics::MetricsRegistry& registry) {
+  ipc_metrics::MetricsSnapshot snapshot{};
+  EXPECT_TRUE(registry.Snapshot(&snapshot));
+  return snapshot;
+}
+
+}  // namespace
+
+//==============================================================================
+// Test Suite 1: Recording and Aggregation
+//==============================================================================
+
+TEST(IpcMetricsTest, Increment_VisibleInSnapshot) {
+  ipc_metrics::MetricsRegistry registry(RegionName("Increment"), 4);
+  ASSERT_TRUE(registry.Open());
+
+  registry.Increment(ipc_metrics::kMetricDartPosts);
+  registry.Increment(ipc_metrics::kMetricDartPosts, 4);
+
+  ipc_metrics::MetricsSnapshot snapshot = TakeSnapshot(registry);
+  EXPECT_EQ(1, snapshot.process_count);
+  EXPECT_EQ(5, snapshot.counters[ipc_metrics::kMetricDartPosts]);
+  EXPECT_EQ(0, snapshot.counters[ipc_metrics::kMetricDartPostFailures]);
+}
+
+TEST(IpcMetricsTest, Record_WithoutOpen_DoesNothing) {
+  ipc_metrics::MetricsRegistry registry(RegionName("Closed"), 4);
+  registry.Increment(ipc_metrics::kMetricDartPosts);
+  registry.RecordValue(ipc_metrics::kMetricWakeLatency, 100);
+
+  ipc_metrics::MetricsSnapshot snapshot{};
+  EXPECT_FALSE(registry.HasSlot());
+  EXPECT_FALSE(registry.Snapshot(&snapshot));
+}
+
+TEST(IpcMetricsTest, TwoRegistries_AggregatedAtReadTime) {
+  ipc_metrics::MetricsRegistry first(RegionName("Aggregate"), 4);
+  ipc_metrics::MetricsRegistry second(RegionName("Aggregate"), 4);
+  ASSERT_TRUE(first.Open());
+  ASSERT_TRUE(second.Open());
+
+  first.Increment(ipc_metrics::kMetricNotificationsSent, 2);
+  second.Increment(ipc_metrics::kMetricNotificationsSent, 3);
+  first.SetGauge(ipc_metrics::kMetricDartSubscribers, 2);
+  second.AddGauge(ipc_metrics::kMetricDartSubscribers, 1);
+
+  ipc_metrics::MetricsSnapshot snapshot = TakeSnapshot(first);
+  EXPECT_EQ(2, snapshot.process_count);
+  EXPECT_EQ(5, snapshot.counters[ipc_metrics::kMetricNotificationsSent]);
+  EXPECT_EQ(3, snapshot.gauges[ipc_metrics::kMetricDartSubscribers]);
+}
+
+TEST(IpcMetricsTest, Release_FoldsCountersKeepsTotals) {
+  ipc_metrics::MetricsRegistry staying(RegionName("Release"), 4);
+  ASSERT_TRUE(staying.Open());
+  {
+    ipc_metrics::MetricsRegistry leaving(RegionName("Release"), 4);
+    ASSERT_TRUE(leaving.Open());
+    leaving.Increment(ipc_metrics::kMetricCoalescedEvents, 7);
+    leaving.SetGauge(ipc_metrics::kMetricListenersRunning, 1);
+    leaving.RecordValue(ipc_metrics::kMetricCallbackDuration, 1000);
+  }  // Destructor releases the slot
+
+  ipc_metrics::MetricsSnapshot snapshot = TakeSnapshot(staying);
+  EXPECT_EQ(1, snapshot.process_count);
+  EXPECT_EQ(7, snapshot.counters[ipc_metrics::kMetricCoalescedEvents]);
+  EXPECT_EQ(0, snapshot.gauges[ipc_metrics::kMetricListenersRunning]);
+  EXPECT_EQ(1, snapshot.histograms[ipc_metrics::kMetricCallbackDuration].count);
+}
+
+TEST(IpcMetricsTest, Open_AllSlotsTaken_FailsButCanStillRead) {
+  // Two slots: the retired slot plus one claimable slot.
+  ipc_metrics::MetricsRegistry owner(RegionName("Full"), 2);
+  ipc_metrics::MetricsRegistry late(RegionName("Full"), 2);
+  ASSERT_TRUE(owner.Open());
+  owner.Increment(ipc_metrics::kMetricDartFiltered);
+
+  EXPECT_FALSE(late.Open());
+  EXPECT_FALSE(late.HasSlot());
+  late.Increment(ipc_metrics::kMetricDartFiltered);  // Ignored
+  EXPECT_EQ(1, TakeSnapshot(late).counters[ipc_metrics::kMetricDartFiltered]);
+}
+
+TEST(IpcMetricsTest, Open_SlotCountMismatch_Fails) {
+  ipc_metrics::MetricsRegistry creator(RegionName("Mismatch"), 4);
+  ipc_metrics::MetricsRegistry other(RegionName("Mismatch"), 8);
+  ASSERT_TRUE(creator.Open());
+  EXPECT_FALSE(other.Open());
+}
+
+//==============================================================================
+// Test Suite 2: Histograms
+//==============================================================================
+
+TEST(IpcMetricsTest, BucketIndex_SmallValuesExact) {
+  for (int64_t value = 0; value < 16; value++) {
+    uint32_t index = ipc_metrics::MetricsRegistry::BucketIndex(value);
+    EXPECT_EQ(value, ipc_metrics::MetricsRegistry::BucketUpperBound(index));
+  }
+}
+
+TEST(IpcMetricsTest, BucketIndex_RelativeErrorWithinEighth) {
+  for (int64_t value = 16; value < (int64_t{1} << 40); value = value * 3 + 1) {
+    int64_t bound = ipc_metrics::MetricsRegistry::BucketUpperBound(
+        ipc_metrics::MetricsRegistry::BucketIndex(value));
+    EXPECT_GE(bound, value);
+    EXPECT_LE(bound - value, value / 8) << "value " << value;
+  }
+}
+
+TEST(IpcMetricsTest, BucketIndex_HugeValuesClampToLastBucket) {
+  EXPECT_EQ(ipc_metrics::kHistogramBuckets - 1,
+            ipc_metrics::MetricsRegistry::BucketIndex(INT64_MAX));
+  EXPECT_EQ(0u, ipc_metrics::MetricsRegistry::BucketIndex(-5));
+}
+
+TEST(IpcMetricsTest, Histogram_PercentilesAcrossRegistries) {
+  ipc_metrics::MetricsRegistry first(RegionName("Percentile"), 4);
+  ipc_metrics::MetricsRegistry second(RegionName("Percentile"), 4);
+  ASSERT_TRUE(first.Open());
+  ASSERT_TRUE(second.Open());
+
+  // 1..1000 split across two "processes".
+  for (int64_t value = 1; value <= 1000; value++) {
+    (value % 2 ? first : second)
+        .RecordValue(ipc_metrics::kMetricWakeLatency, value);
+  }
+
+  const ipc_metrics::HistogramSummary& summary =
+      TakeSnapshot(first).histograms[ipc_metrics::kMetricWakeLatency];
+  EXPECT_EQ(1000, summary.count);
+  EXPECT_EQ(500500, summary.sum);
+  EXPECT_EQ(1000, summary.max);
+  EXPECT_GE(summary.p50, 500);
+  EXPECT_LE(summary.p50, 500 + 500 / 8);
+  EXPECT_GE(summary.p99, 990);
+  EXPECT_LE(summary.p99, 1000);  // Capped at max
+}
+
+TEST(IpcMetricsTest, SnapshotBuckets_DifferenceCoversOnlyNewValues) {
+  ipc_metrics::MetricsRegistry registry(RegionName("Buckets"), 4);
+  ASSERT_TRUE(registry.Open());
+
+  // Earlier slow values dominate the cumulative percentiles...
+  for (int i = 0; i < 1000; i++) {
+    registry.RecordValue(ipc_metrics::kMetricWakeLatency, 1000000);
+  }
+  std::vector<int64_t> before;
+  ASSERT_TRUE(
+      registry.SnapshotBuckets(ipc_metrics::kMetricWakeLatency, &before));
+  ASSERT_EQ(ipc_metrics::kHistogramBuckets, before.size());
+
+  // ...but not those of the values recorded since.
+  for (int i = 0; i < 100; i++) {
+    registry.RecordValue(ipc_metrics::kMetricWakeLatency, 100);
+  }
+  std::vector<int64_t> after;
+  ASSERT_TRUE(
+      registry.SnapshotBuckets(ipc_metrics::kMetricWakeLatency, &after));
+  for (size_t b = 0; b < after.size(); b++) {
+    after[b] -= before[b];
+  }
+  int64_t p50 = ipc_metrics::MetricsRegistry::BucketPercentile(after, 0.50);
+  EXPECT_GE(p50, 100);
+  EXPECT_LE(p50, 100 + 100 / 8);
+  EXPECT_EQ(0, ipc_metrics::MetricsRegistry::BucketPercentile(
+                   std::vector<int64_t>(ipc_metrics::kHistogramBuckets), 0.5));
+}
+
+//==============================================================================
+// Test Suite 3: Notification Metrics
+//==============================================================================
+
+TEST(IpcMetricsTest, ListenerWake_CountsCoalescedNotifications) {
+  ipc_metrics::MetricsRegistry writer(RegionName("Coalesce"), 4);
+  ipc_metrics::MetricsRegistry listener(RegionName("Coalesce"), 4);
+  ASSERT_TRUE(writer.Open());
+  ASSERT_TRUE(listener.Open());
+  int64_t last_seen = listener.GetNotifySequence();
+
+  // Three notifications, one wakeup: two were coalesced.
+  writer.RecordNotifySent();
+  writer.RecordNotifySent();
+  writer.RecordNotifySent();
+  LARGE_INTEGER now;
+  QueryPerformanceCounter(&now);
+  listener.RecordListenerWake(now.QuadPart, &last_seen);
+
+  // Wakeup with nothing new (e.g. a late SetEvent): nothing coalesced.
+  listener.RecordListenerWake(now.QuadPart, &last_seen);
+
+  ipc_metrics::MetricsSnapshot snapshot = TakeSnapshot(writer);
+  EXPECT_EQ(3, snapshot.notify_sequence);
+  EXPECT_EQ(3, snapshot.counters[ipc_metrics::kMetricNotificationsSent]);
+  EXPECT_EQ(2, snapshot.counters[ipc_metrics::kMetricNotificationsReceived]);
+  EXPECT_EQ(2, snapshot.counters[ipc_metrics::kMetricCoalescedEvents]);
+  EXPECT_EQ(2, snapshot.histograms[ipc_metrics::kMetricWakeLatency].count);
+}
+
+TEST(IpcMetricsTest, Rate_PerSecondBetweenSnapshots) {
+  ipc_metrics::MetricsSnapshot earlier{};
+  ipc_metrics::MetricsSnapshot later{};
+  earlier.ticks_per_second = later.ticks_per_second = 1000;
+  earlier.timestamp_ticks = 1000;
+  later.timestamp_ticks = 3000;  // Two seconds later
+  earlier.counters[ipc_metrics::kMetricNotificationsReceived] = 10;
+  later.counters[ipc_metrics::kMetricNotificationsReceived] = 50;
+
+  EXPECT_DOUBLE_EQ(20.0, ipc_metrics::MetricsSnapshot::Rate(
+                             earlier, later,
+                             ipc_metrics::kMetricNotificationsReceived));
+  EXPECT_DOUBLE_EQ(0.0, ipc_metrics::MetricsSnapshot::Rate(
+                            later, later,
+                            ipc_metrics::kMetricNotificationsReceived));
+}
+
+TEST(IpcMetricsTest, FormatMetrics_ListsEveryMetric) {
+  ipc_metrics::MetricsSnapshot snapshot{};
+  snapshot.process_count = 2;
+  snapshot.counters[ipc_metrics::kMetricDartPosts] = 42;
+
+  std::string text = ipc_metrics::FormatMetrics(snapshot);
+  EXPECT_NE(std::string::npos, text.find("(2 processes)"));
+  EXPECT_NE(std::string::npos, text.find("dart.posts"));
+  EXPECT_NE(std::string::npos, text.find("42"));
+  EXPECT_NE(std::string::npos, text.find("dart.subscribers"));
+  EXPECT_NE(std::string::npos, text.find("wake_latency_ns"));
+  EXPECT_NE(std::string::npos, text.find("count=0 p50=0"));
+}
+
+TEST(IpcMetricsTest, LogMetrics_EveryMetricReachesTheLog) {
+  std::mutex mutex;
+  std::string logged;
+  ipc_log::LoggerOptions options;
+  options.ring_name = "Local\\IpcMetricsTest.Log." +
+                      std::to_string(GetCurrentProcessId());
+  options.sink = [&](const char* text, size_t length) {
+    std::lock_guard<std::mutex> lock(mutex);
+    logged.append(text, length);
+  };
+  options.echo_to_console = false;
+  options.flush_interval_ms = 5;
+  ipc_log::Logger logger(options);
+
+  ipc_metrics::MetricsSnapshot snapshot{};
+  snapshot.process_count = 2;
+  snapshot.counters[ipc_metrics::kMetricDartPosts] = 42;
+  ipc_metrics::LogMetrics(snapshot, &logger);
+  for (int i = 0; i < 200 && !logger.IsDrainer(); i++) {
+    Sleep(5);
+  }
+  logger.Flush();
+
+  std::lock_guard<std::mutex> lock(mutex);
+  EXPECT_NE(std::string::npos, logged.find("(2 processes)"));
+  EXPECT_NE(std::string::npos, logged.find("dart.posts 42"));
+  for (uint32_t c = 0; c < ipc_metrics::kCounterCount; c++) {
+    EXPECT_NE(std::string::npos,
+              logged.find(ipc_metrics::CounterName(
+                  static_cast<ipc_metrics::Counter>(c))));
+  }
+  for (uint32_t g = 0; g < ipc_metrics::kGaugeCount; g++) {
+    EXPECT_NE(std::string::npos, logged.find(ipc_metrics::GaugeName(
+                                     static_cast<ipc_metrics::Gauge>(g))));
+  }
+  for (uint32_t h = 0; h < ipc_metrics::kHistogramCount; h++) {
+    EXPECT_NE(std::string::npos,
+              logged.find(ipc_metrics::HistogramName(
+                  static_cast<ipc_metrics::Histogram>(h))));
+  }
+}
+
+//==============================================================================
+// Test Suite 4: Read-Only Inspection
+//==============================================================================
+
+TEST(IpcMetricsTest, OpenReadOnly_NoRegion_Fails) {
+  ipc_metrics::MetricsRegistry inspector(RegionName("Missing"));
+  EXPECT_FALSE(inspector.OpenReadOnly());
+}
+
+TEST(IpcMetricsTest, OpenReadOnly_ListsSlotsWithoutClaimingOne) {
+  ipc_metrics::MetricsRegistry window(RegionName("Inspect"), 4);
+  ASSERT_TRUE(window.Open());
+  window.Increment(ipc_metrics::kMetricDartPosts, 3);
+  window.SetGauge(ipc_metrics::kMetricDartSubscribers, 2);
+
+  // Default slot count differs; the inspector adopts the region's.
+  ipc_metrics::MetricsRegistry inspector(RegionName("Inspect"));
+  ASSERT_TRUE(inspector.OpenReadOnly());
+  EXPECT_FALSE(inspector.HasSlot());
+  inspector.RecordNotifySent();  // Ignored: never writes
+
+  ipc_metrics::MetricsSnapshot snapshot = TakeSnapshot(inspector);
+  EXPECT_EQ(1, snapshot.process_count);
+  EXPECT_EQ(0, snapshot.notify_sequence);
+  EXPECT_EQ(3, snapshot.counters[ipc_metrics::kMetricDartPosts]);
+
+  std::vector<ipc_metrics::MetricsSlotInfo> slots = inspector.ListSlots();
+  ASSERT_EQ(1u, slots.size());
+  EXPECT_EQ(GetCurrentProcessId(), slots[0].process_id);
+  EXPECT_TRUE(slots[0].live);
+  EXPECT_EQ(3, slots[0].counters[ipc_metrics::kMetricDartPosts]);
+  EXPECT_EQ(2, slots[0].gauges[ipc_metrics::kMetricDartSubscribers]);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,157 @@
+// ipc_namespace_test.cpp
+//
+// Google Test unit tests for IPC instance namespaces: name validation and
+// qualification, the process default, and isolation of managers and
+// listeners in different namespaces.
+
+#include <gtest/gtest.h>
+#include <windows.h>
+
+#include <atomic>
+#include <string>
+
+#include "ipc_namespace.h"
+#include "shared_buffer_pool.h"
+#include "shared_memory_manager.h"
+#include "window_count_listener.h"
+
+class IpcNamespaceTest : public ::testing::Test {
+ protected:
+  void SetUp() override { saved_default_ = ipc_namespace::GetDefault(); }
+  void TearDown() override { ipc_namespace::SetDefault(saved_default_); }
+
+  std::string saved_default_;
+};
+
+//==============================================================================
+// Test Suite 1: Names
+//==============================================================================
+
+TEST_F(IpcNamespaceTest, Qualify_EmptyNamespace_KeepsOriginalName) {
+  EXPECT_EQ(kSharedMemoryName, ipc_namespace::Qualify(kSharedMemoryName, ""));
+}
+
+TEST_F(IpcNamespaceTest, Qualify_AppendsNamespace) {
+  EXPECT_EQ(std::string(kSharedMemoryName) + ".profile2",
+            ipc_namespace::Qualify(kSharedMemoryName, "profile2"));
+}
+
+TEST_F(IpcNamespaceTest, IsValid_RejectsSeparatorsAndLongNames) {
+  EXPECT_TRUE(ipc_namespace::IsValid(""));
+  EXPECT_TRUE(ipc_namespace::IsValid("Test.1234.7_a-b"));
+  EXPECT_FALSE(ipc_namespace::IsValid("a\\b"));
+  EXPECT_FALSE(ipc_namespace::IsValid("a b"));
+  EXPECT_FALSE(ipc_namespace::IsValid(
+      std::string(ipc_namespace::kMaxLength + 1, 'x')));
+}
+
+TEST_F(IpcNamespaceTest, MakeUnique_NeverRepeats) {
+  std::string first = ipc_namespace::MakeUnique("Test");
+  std::string second = ipc_namespace::MakeUnique("Test");
+  EXPECT_NE(first, second);
+  EXPECT_TRUE(ipc_namespace::IsValid(first));
+  EXPECT_EQ(0u, first.find("Test." + std::to_string(GetCurrentProcessId())));
+}
+
+//==============================================================================
+// Test Suite 2: Process Default
+//==============================================================================
+
+TEST_F(IpcNamespaceTest, SetDefault_AppliesToNewObjects) {
+  ASSERT_TRUE(ipc_namespace::SetDefault("DefaultTest"));
+  SharedMemoryManager manager;
+  WindowCountListener listener;
+
+  EXPECT_EQ(ipc_namespace::Qualify(kSharedMemoryName, "DefaultTest"),
+            manager.shared_memory_name());
+  EXPECT_EQ(ipc_namespace::Qualify(kWindowCountEventName, "DefaultTest"),
+            listener.event_name());
+  EXPECT_EQ(manager.event_name(), listener.event_name());
+}
+
+TEST_F(IpcNamespaceTest, SetDefault_Invalid_KeepsPrevious) {
+  ASSERT_TRUE(ipc_namespace::SetDefault("Before"));
+  EXPECT_FALSE(ipc_namespace::SetDefault("not\\valid"));
+  EXPECT_EQ("Before", ipc_namespace::GetDefault());
+}
+
+TEST_F(IpcNamespaceTest, SetDefault_ExportedToChildProcesses) {
+  ASSERT_TRUE(ipc_namespace::SetDefault("Inherited"));
+  char value[ipc_namespace::kMaxLength + 1] = {};
+  ASSERT_GT(GetEnvironmentVariableA(ipc_namespace::kEnvironmentVariable,
+                                    value, sizeof(value)),
+            0u);
+  EXPECT_STREQ("Inherited", value);
+}
+
+//==============================================================================
+// Test Suite 3: Isolation
+//==============================================================================
+
+TEST_F(IpcNamespaceTest, Managers_InDifferentNamespaces_HaveSeparateCounts) {
+  SharedMemoryManager a(ipc_namespace::MakeUnique("IsolationA"));
+  SharedMemoryManager b(ipc_namespace::MakeUnique("IsolationB"));
+  ASSERT_TRUE(a.Initialize());
+  ASSERT_TRUE(b.Initialize());
+
+  // Fresh namespaces start from zero
+  EXPECT_EQ(0, a.GetWindowCount());
+  EXPECT_EQ(1, a.IncrementWindowCount());
+  EXPECT_EQ(2, a.IncrementWindowCount());
+  EXPECT_EQ(0, b.GetWindowCount());
+  EXPECT_EQ(1, b.IncrementWindowCount());
+}
+
+TEST_F(IpcNamespaceTest, Managers_InSameNamespace_ShareCount) {
+  std::string name = ipc_namespace::MakeUnique("Shared");
+  SharedMemoryManager a(name);
+  SharedMemoryManager b(name);
+  ASSERT_TRUE(a.Initialize());
+  ASSERT_TRUE(b.Initialize());
+
+  a.IncrementWindowCount();
+  EXPECT_EQ(1, b.GetWindowCount());
+}
+
+TEST_F(IpcNamespaceTest, Listener_IgnoresChangesInOtherNamespace) {
+  std::string mine = ipc_namespace::MakeUnique("Mine");
+  std::string other = ipc_namespace::MakeUnique("Other");
+  SharedMemoryManager my_manager(mine);
+  SharedMemoryManager other_manager(other);
+  ASSERT_TRUE(my_manager.Initialize());
+  ASSERT_TRUE(other_manager.Initialize());
+
+  std::atomic<int> wakeups{0};
+  WindowCountListener listener(mine);
+  listener.SetCallback([&wakeups](LONG) { wakeups++; });
+  ASSERT_TRUE(listener.Start());
+
+  other_manager.IncrementWindowCount();
+  Sleep(100);
+  EXPECT_EQ(0, wakeups.load());
+
+  my_manager.IncrementWindowCount();
+  for (int i = 0; i < 100 && wakeups == 0; i++) {
+    Sleep(10);
+  }
+  EXPECT_EQ(1, wakeups.load());
+  listener.Stop();
+}
+
+TEST_F(IpcNamespaceTest, BufferPools_InDifferentNamespaces_DoNotShareSlots) {
+  SharedBufferPool a(ipc_namespace::MakeUnique("PoolA"));
+  SharedBufferPool b(ipc_namespace::MakeUnique("PoolB"));
+  ASSERT_TRUE(a.Initialize());
+  ASSERT_TRUE(b.Initialize());
+  DWORD free_in_b = b.GetFreeSlotCount();
+
+  SharedBufferHandle handle = a.Acquire();
+  ASSERT_NE(kInvalidSharedBuffer, handle);
+  EXPECT_EQ(free_in_b, b.GetFreeSlotCount());
+  a.Release(handle);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
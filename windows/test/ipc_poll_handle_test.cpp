@@ -0,0 +1,148 @@
+// ipc_poll_handle_test.cpp
+//
+// Google Test unit tests for IpcPollHandle, the waitable window count
+// notification for native event loops.
+
+#include <gtest/gtest.h>
+#include <windows.h>
+
+#include <memory>
+
+// Include dart_api_dl.h which redirects to our mock in test builds
+#include "dart_api_dl.h"
+
+#include "ipc_poll_handle.h"
+#include "ipc_runtime.h"
+#include "ipc_test_namespace.h"
+#include "shared_memory_manager.h"
+
+class IpcPollHandleTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    mock_dart_api::Reset();
+    mock_dart_api::SetRecordCalls(false);
+    ASSERT_TRUE(writer_.Initialize());
+  }
+
+  void TearDown() override { mock_dart_api::Reset(); }
+
+  // Another window of the same namespace
+  SharedMemoryManager writer_;
+};
+
+//==============================================================================
+// Test Suite 1: Readiness
+//==============================================================================
+
+TEST_F(IpcPollHandleTest, Open_ReadyForInitialDrain) {
+  std::unique_ptr<IpcPollHandle> poll = IpcPollHandle::Open();
+  ASSERT_NE(nullptr, poll);
+  ASSERT_NE(nullptr, poll->handle());
+
+  EXPECT_EQ(WAIT_OBJECT_0, WaitForSingleObject(poll->handle(), 0));
+  SharedMemorySnapshot snapshot{};
+  EXPECT_TRUE(poll->Drain(&snapshot));
+  EXPECT_EQ(0, snapshot.window_count);
+}
+
+TEST_F(IpcPollHandleTest, Change_SignalsHandle) {
+  std::unique_ptr<IpcPollHandle> poll = IpcPollHandle::Open();
+  ASSERT_NE(nullptr, poll);
+  SharedMemorySnapshot snapshot{};
+  ASSERT_TRUE(poll->Drain(&snapshot));
+  EXPECT_EQ(WAIT_TIMEOUT, WaitForSingleObject(poll->handle(), 0));
+
+  writer_.IncrementWindowCount();
+  ASSERT_EQ(WAIT_OBJECT_0, WaitForSingleObject(poll->handle(), 1000));
+  ASSERT_TRUE(poll->Drain(&snapshot));
+  EXPECT_EQ(1, snapshot.window_count);
+  EXPECT_EQ(GetCurrentProcessId(), snapshot.last_writer_pid);
+}
+
+TEST_F(IpcPollHandleTest, Drain_ResetsHandleWithoutWaiting) {
+  std::unique_ptr<IpcPollHandle> poll = IpcPollHandle::Open();
+  ASSERT_NE(nullptr, poll);
+  SharedMemorySnapshot snapshot{};
+  ASSERT_TRUE(poll->Drain(&snapshot));  // Never waited on the handle
+
+  EXPECT_EQ(WAIT_TIMEOUT, WaitForSingleObject(poll->handle(), 0));
+}
+
+//==============================================================================
+// Test Suite 2: Drain
+//==============================================================================
+
+TEST_F(IpcPollHandleTest, Drain_WithoutChange_ReturnsFalse) {
+  std::unique_ptr<IpcPollHandle> poll = IpcPollHandle::Open();
+  ASSERT_NE(nullptr, poll);
+  SharedMemorySnapshot snapshot{};
+  ASSERT_TRUE(poll->Drain(&snapshot));
+
+  snapshot.window_count = -1;
+  EXPECT_FALSE(poll->Drain(&snapshot));
+  EXPECT_EQ(-1, snapshot.window_count);  // Untouched
+}
+
+TEST_F(IpcPollHandleTest, Drain_CollapsesChangesToLatest) {
+  std::unique_ptr<IpcPollHandle> poll = IpcPollHandle::Open();
+  ASSERT_NE(nullptr, poll);
+  SharedMemorySnapshot snapshot{};
+  ASSERT_TRUE(poll->Drain(&snapshot));
+
+  writer_.IncrementWindowCount();
+  writer_.IncrementWindowCount();
+  writer_.IncrementWindowCount();
+  ASSERT_TRUE(poll->Drain(&snapshot));  // Before any wakeup
+  EXPECT_EQ(3, snapshot.window_count);
+  EXPECT_FALSE(poll->Drain(&snapshot));
+}
+
+//==============================================================================
+// Test Suite 3: External Loops
+//==============================================================================
+
+TEST_F(IpcPollHandleTest, TwoHandles_BothSignaledInOneWait) {
+  std::unique_ptr<IpcPollHandle> first = IpcPollHandle::Open();
+  std::unique_ptr<IpcPollHandle> second = IpcPollHandle::Open();
+  ASSERT_NE(nullptr, first);
+  ASSERT_NE(nullptr, second);
+  SharedMemorySnapshot snapshot{};
+  first->Drain(&snapshot);
+  second->Drain(&snapshot);
+
+  writer_.IncrementWindowCount();
+  HANDLE handles[] = {first->handle(), second->handle()};
+  ASSERT_EQ(WAIT_OBJECT_0,
+            WaitForMultipleObjects(2, handles, TRUE, 1000));  // Both
+  EXPECT_TRUE(first->Drain(&snapshot));
+  EXPECT_TRUE(second->Drain(&snapshot));
+}
+
+TEST_F(IpcPollHandleTest, Handle_KeepsRuntimeAliveUntilClosed) {
+  std::unique_ptr<IpcPollHandle> poll = IpcPollHandle::Open();
+  ASSERT_NE(nullptr, poll);
+  EXPECT_EQ(1, IpcRuntime::GetLiveCount());
+  EXPECT_EQ(1u, IpcRuntime::Acquire()->GetSubscriberCount());
+
+  poll.reset();
+  EXPECT_EQ(0, IpcRuntime::GetLiveCount());
+}
+
+TEST_F(IpcPollHandleTest, CExports_RoundTrip) {
+  IpcPollHandle* poll = OpenIpcPollHandle();
+  ASSERT_NE(nullptr, poll);
+  EXPECT_EQ(poll->handle(), GetIpcPollHandleEvent(poll));
+
+  SharedMemorySnapshot snapshot{};
+  EXPECT_TRUE(DrainIpcPollHandle(poll, &snapshot));
+  EXPECT_FALSE(DrainIpcPollHandle(poll, nullptr));
+  EXPECT_FALSE(DrainIpcPollHandle(nullptr, &snapshot));
+  CloseIpcPollHandle(poll);
+  CloseIpcPollHandle(nullptr);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  UseIpcTestNamespaces("IpcPollHandleTest");
+  return RUN_ALL_TESTS();
+}
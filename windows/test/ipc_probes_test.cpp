@@ -0,0 +1,100 @@
+// ipc_probes_test.cpp
+//
+// Google Test unit tests for the IPC static tracepoints (ipc_probes)
+//
+// No tracing session is attached while the tests run, so these check that
+// registration is safe to repeat and that every probe compiles against the
+// argument types of its call site and fires as a no-op. Event payloads are
+// verified with a live session; see README.md "IpcProbes Tests".
+
+#include <gtest/gtest.h>
+#include <windows.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ipc_probes.h"
+
+namespace {
+
+// Fires every probe with the types used at the instrumented call sites.
+void FireAllProbes() {
+  LONG delta = 1;
+  LONG new_count = 2;
+  DWORD trace_id = 3;
+  DWORD wait_result = WAIT_OBJECT_0;
+  int64_t duration_ticks = 42;
+  int64_t port = 0x1234;
+  uint32_t topic = 1;
+  bool posted = true;
+  size_t subscriber_count = 1;
+
+  IPC_PROBE_COUNT_CHANGE(delta, new_count, trace_id);
+  IPC_PROBE_LISTENER_SLEEP();
+  IPC_PROBE_LISTENER_WAKE(wait_result);
+  IPC_PROBE_CALLBACK_START();
+  IPC_PROBE_CALLBACK_DONE(duration_ticks);
+  IPC_PROBE_DART_POST(port, topic, new_count, trace_id, posted);
+  IPC_PROBE_SUBSCRIBER_ADD(port, subscriber_count);
+  IPC_PROBE_SUBSCRIBER_REMOVE(port, subscriber_count);
+}
+
+}  // namespace
+
+// ============================================================================
+// Test Suite 1: Registration
+// ============================================================================
+
+TEST(IpcProbesTest, Register_IsIdempotent) {
+  EXPECT_TRUE(ipc_probes::Register());
+  EXPECT_TRUE(ipc_probes::Register());
+  ipc_probes::Unregister();
+}
+
+TEST(IpcProbesTest, Unregister_WithoutRegister_IsSafe) {
+  ipc_probes::Unregister();
+  ipc_probes::Unregister();
+}
+
+TEST(IpcProbesTest, Register_AfterUnregister_Succeeds) {
+  ASSERT_TRUE(ipc_probes::Register());
+  ipc_probes::Unregister();
+  EXPECT_TRUE(ipc_probes::Register());
+  ipc_probes::Unregister();
+}
+
+// ============================================================================
+// Test Suite 2: Probes Without a Session
+// ============================================================================
+
+TEST(IpcProbesTest, Probes_BeforeRegister_AreNoOps) {
+  FireAllProbes();
+}
+
+TEST(IpcProbesTest, Probes_WhileRegistered_AreNoOps) {
+  ASSERT_TRUE(ipc_probes::Register());
+  FireAllProbes();
+  ipc_probes::Unregister();
+}
+
+TEST(IpcProbesTest, Probes_AfterUnregister_AreNoOps) {
+  ASSERT_TRUE(ipc_probes::Register());
+  ipc_probes::Unregister();
+  FireAllProbes();
+}
+
+TEST(IpcProbesTest, Probes_EvaluateArgumentsAtMostOnce) {
+  // ETW skips argument evaluation without a session, USDT evaluates once,
+  // and IPC_PROBES_DISABLED never evaluates.
+  ASSERT_TRUE(ipc_probes::Register());
+  int evaluations = 0;
+  auto value = [&evaluations]() {
+    evaluations++;
+    return 7;
+  };
+
+  IPC_PROBE_COUNT_CHANGE(value(), 0, 0);
+
+  EXPECT_LE(evaluations, 1);
+  ipc_probes::Unregister();
+}
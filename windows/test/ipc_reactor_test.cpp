@@ -0,0 +1,307 @@
+// ipc_reactor_test.cpp
+//
+// Google Test unit tests for IpcReactor: handle and timer dispatch, posted
+// tasks, removal guarantees, and the IPC sources that share one reactor.
+
+#include <gtest/gtest.h>
+#include <windows.h>
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+// Include dart_api_dl.h which redirects to our mock in test builds
+#include "dart_api_dl.h"
+
+#include "ipc_reactor.h"
+#include "ipc_test_namespace.h"
+#include "shared_buffer_pool.h"
+#include "shared_memory_manager.h"
+#include "window_count_listener.h"
+
+namespace {
+
+// Polls until |value| reaches |expected| or a second has passed.
+bool WaitFor(const std::atomic<int>& value, int expected) {
+  for (int i = 0; i < 100 && value.load() < expected; i++) {
+    Sleep(10);
+  }
+  return value.load() >= expected;
+}
+
+}  // namespace
+
+class IpcReactorTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    for (HANDLE& event : events_) {
+      event = CreateEventA(nullptr, FALSE, FALSE, nullptr);  // Auto-reset
+      ASSERT_NE(nullptr, event);
+    }
+  }
+
+  void TearDown() override {
+    reactor_.Stop();
+    for (HANDLE event : events_) {
+      CloseHandle(event);
+    }
+  }
+
+  IpcReactor reactor_;
+  HANDLE events_[3] = {};
+};
+
+//==============================================================================
+// Test Suite 1: Handles
+//==============================================================================
+
+TEST_F(IpcReactorTest, SignaledHandle_RunsItsHandler) {
+  std::atomic<int> first{0};
+  std::atomic<int> second{0};
+  reactor_.AddHandle(events_[0], [&first] { first++; });
+  reactor_.AddHandle(events_[1], [&second] { second++; });
+  ASSERT_TRUE(reactor_.Start());
+
+  SetEvent(events_[1]);
+  ASSERT_TRUE(WaitFor(second, 1));
+  EXPECT_EQ(0, first.load());
+
+  SetEvent(events_[0]);
+  ASSERT_TRUE(WaitFor(first, 1));
+  EXPECT_EQ(1, second.load());
+}
+
+TEST_F(IpcReactorTest, HandlesSignaledTogether_AllServed) {
+  std::atomic<int> calls{0};
+  ASSERT_TRUE(reactor_.Start());
+  // The first handler holds the reactor while the others are signaled
+  reactor_.AddHandle(events_[0], [&] {
+    SetEvent(events_[1]);
+    SetEvent(events_[2]);
+    calls++;
+  });
+  reactor_.AddHandle(events_[1], [&calls] { calls++; });
+  reactor_.AddHandle(events_[2], [&calls] { calls++; });
+
+  SetEvent(events_[0]);
+  ASSERT_TRUE(WaitFor(calls, 3));
+  Sleep(20);
+  EXPECT_EQ(3, calls.load());
+}
+
+TEST_F(IpcReactorTest, AddHandle_WaitSetFull_ReturnsInvalid) {
+  std::vector<IpcReactor::HandlerId> ids;
+  for (DWORD i = 0; i < IpcReactor::kMaxHandles; i++) {
+    ids.push_back(reactor_.AddHandle(events_[0], [] {}));
+    ASSERT_NE(IpcReactor::kInvalidHandler, ids.back());
+  }
+  EXPECT_EQ(IpcReactor::kInvalidHandler,
+            reactor_.AddHandle(events_[1], [] {}));
+
+  reactor_.Remove(ids.front());
+  EXPECT_NE(IpcReactor::kInvalidHandler,
+            reactor_.AddHandle(events_[1], [] {}));
+}
+
+TEST_F(IpcReactorTest, Remove_WaitsForRunningHandler) {
+  std::atomic<int> entered{0};
+  std::atomic<bool> running{false};
+  IpcReactor::HandlerId id = reactor_.AddHandle(events_[0], [&] {
+    running = true;
+    entered++;
+    Sleep(50);
+    running = false;
+  });
+  ASSERT_TRUE(reactor_.Start());
+
+  SetEvent(events_[0]);
+  ASSERT_TRUE(WaitFor(entered, 1));
+  reactor_.Remove(id);
+  EXPECT_FALSE(running.load());
+  EXPECT_EQ(0u, reactor_.GetHandleCount());
+
+  SetEvent(events_[0]);
+  Sleep(50);
+  EXPECT_EQ(1, entered.load());
+}
+
+TEST_F(IpcReactorTest, Remove_FromOwnHandler_TakesEffect) {
+  std::atomic<int> calls{0};
+  IpcReactor::HandlerId id = IpcReactor::kInvalidHandler;
+  id = reactor_.AddHandle(events_[0], [&] {
+    calls++;
+    reactor_.Remove(id);
+  });
+  ASSERT_TRUE(reactor_.Start());
+
+  SetEvent(events_[0]);
+  ASSERT_TRUE(WaitFor(calls, 1));
+  SetEvent(events_[0]);
+  Sleep(50);
+  EXPECT_EQ(1, calls.load());
+  EXPECT_EQ(0u, reactor_.GetHandleCount());
+}
+
+TEST_F(IpcReactorTest, HandlerException_ReactorKeepsRunning) {
+  std::atomic<int> calls{0};
+  reactor_.AddHandle(events_[0], [&calls] {
+    calls++;
+    throw std::runtime_error("handler failure");
+  });
+  ASSERT_TRUE(reactor_.Start());
+
+  SetEvent(events_[0]);
+  ASSERT_TRUE(WaitFor(calls, 1));
+  SetEvent(events_[0]);
+  ASSERT_TRUE(WaitFor(calls, 2));
+  EXPECT_TRUE(reactor_.IsRunning());
+}
+
+//==============================================================================
+// Test Suite 2: Timers and Posted Tasks
+//==============================================================================
+
+TEST_F(IpcReactorTest, Timer_FiresRepeatedlyUntilRemoved) {
+  std::atomic<int> ticks{0};
+  ASSERT_TRUE(reactor_.Start());
+  IpcReactor::HandlerId id = reactor_.AddTimer(10, [&ticks] { ticks++; });
+  EXPECT_EQ(1u, reactor_.GetTimerCount());
+
+  ASSERT_TRUE(WaitFor(ticks, 3));
+  reactor_.Remove(id);
+  int after_remove = ticks.load();
+  Sleep(50);
+  EXPECT_EQ(after_remove, ticks.load());
+}
+
+TEST_F(IpcReactorTest, Post_RunsOnReactorThread) {
+  std::atomic<int> ran{0};
+  std::atomic<bool> on_reactor{false};
+  EXPECT_FALSE(reactor_.Post([] {}));  // Not started
+
+  ASSERT_TRUE(reactor_.Start());
+  EXPECT_FALSE(reactor_.IsReactorThread());
+  ASSERT_TRUE(reactor_.Post([&] {
+    on_reactor = reactor_.IsReactorThread();
+    ran++;
+  }));
+  ASSERT_TRUE(WaitFor(ran, 1));
+  EXPECT_TRUE(on_reactor.load());
+}
+
+//==============================================================================
+// Test Suite 3: Shared Reactor
+//==============================================================================
+
+TEST_F(IpcReactorTest, Acquire_SharedUntilLastRelease) {
+  std::shared_ptr<IpcReactor> first = IpcReactor::Acquire();
+  std::shared_ptr<IpcReactor> second = IpcReactor::Acquire();
+  ASSERT_NE(nullptr, first);
+  EXPECT_EQ(first.get(), second.get());
+  EXPECT_TRUE(first->IsRunning());
+
+  std::weak_ptr<IpcReactor> weak = first;
+  first.reset();
+  EXPECT_FALSE(weak.expired());
+  second.reset();
+  EXPECT_TRUE(weak.expired());
+
+  std::shared_ptr<IpcReactor> third = IpcReactor::Acquire();
+  ASSERT_NE(nullptr, third);
+  EXPECT_TRUE(third->IsRunning());
+}
+
+TEST_F(IpcReactorTest, ListenerAndBufferPool_ShareOneThread) {
+  std::shared_ptr<IpcReactor> reactor = IpcReactor::Acquire();
+  ASSERT_NE(nullptr, reactor);
+  SharedMemoryManager manager;
+  ASSERT_TRUE(manager.Initialize());
+
+  std::atomic<int> wakeups{0};
+  std::atomic<DWORD> listener_thread{0};
+  WindowCountListener listener;
+  listener.SetCallback([&](LONG) {
+    listener_thread = GetCurrentThreadId();
+    wakeups++;
+  });
+  ASSERT_TRUE(listener.Start(reactor.get()));
+
+  std::atomic<int> received{0};
+  std::atomic<DWORD> receiver_thread{0};
+  SharedBufferPool pool;
+  ASSERT_TRUE(pool.StartReceiving([&](SharedBufferHandle handle, uint8_t*,
+                                      DWORD, DWORD) {
+    receiver_thread = GetCurrentThreadId();
+    received++;
+    pool.Release(handle);
+  }));
+
+  manager.IncrementWindowCount();
+  SharedBufferHandle handle = pool.Acquire();
+  ASSERT_NE(kInvalidSharedBuffer, handle);
+  ASSERT_TRUE(pool.Publish(handle, 4, GetCurrentProcessId()));
+
+  ASSERT_TRUE(WaitFor(wakeups, 1));
+  ASSERT_TRUE(WaitFor(received, 1));
+  EXPECT_EQ(listener_thread.load(), receiver_thread.load());
+  EXPECT_EQ(2u, reactor->GetHandleCount());
+
+  pool.StopReceiving();
+  listener.Stop();
+  EXPECT_EQ(0u, reactor->GetHandleCount());
+}
+
+TEST_F(IpcReactorTest, ListenerResetDelay_DoesNotHoldReactorThread) {
+  std::shared_ptr<IpcReactor> reactor = IpcReactor::Acquire();
+  ASSERT_NE(nullptr, reactor);
+  SharedMemoryManager manager;
+  ASSERT_TRUE(manager.Initialize());
+  std::atomic<int> wakeups{0};
+  WindowCountListener listener;
+  listener.SetCallback([&](LONG) { wakeups++; });
+  ASSERT_TRUE(listener.Start(reactor.get()));
+
+  // Another source signaled while the listener's event is in its 10 ms
+  // grace period must not wait for the grace period to end.
+  std::atomic<int> served{0};
+  std::atomic<LONGLONG> served_at{0};
+  IpcReactor::HandlerId id = reactor->AddHandle(events_[0], [&] {
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    served_at = now.QuadPart;
+    served++;
+  });
+  LARGE_INTEGER frequency;
+  QueryPerformanceFrequency(&frequency);
+
+  double fastest_ms = 1e9;
+  for (int i = 0; i < 5; i++) {
+    if (i % 2 == 0) {
+      manager.IncrementWindowCount();
+    } else {
+      manager.DecrementWindowCount();
+    }
+    Sleep(2);  // Listener handler has run; its event is still signaled
+    LARGE_INTEGER signaled;
+    QueryPerformanceCounter(&signaled);
+    SetEvent(events_[0]);
+    ASSERT_TRUE(WaitFor(served, i + 1));
+    ASSERT_TRUE(WaitFor(wakeups, i + 1));
+    double ms = static_cast<double>(served_at.load() - signaled.QuadPart) *
+                1000.0 / static_cast<double>(frequency.QuadPart);
+    fastest_ms = ms < fastest_ms ? ms : fastest_ms;
+  }
+  EXPECT_LT(fastest_ms, 5.0);
+
+  reactor->Remove(id);
+  listener.Stop();
+  EXPECT_EQ(0u, reactor->GetHandleCount());
+  EXPECT_EQ(0u, reactor->GetTimerCount());
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  UseIpcTestNamespaces("IpcReactorTest");
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,436 @@
+// ipc_replay.cpp
+//
+// Captures the IPC traffic of running windows to a file and replays it
+// offline.
+//
+// Capture drains the shared flight recorder ring into a compact binary file
+// (ipc_capture.h) until Ctrl+C or --seconds elapse. Like shmem_top it maps
+// the ring read-only, so capturing cannot disturb the windows. Windows can
+// also capture themselves through the StartIpcCapture/StopIpcCapture FFI
+// exports (lib/ipc_capture.dart).
+//
+// Replay re-drives a capture against SharedMemoryManager,
+// WindowCountListener and DartPortManager inside this process. Every
+// recorded window process becomes one replay window with its own manager,
+// listener and port manager, wired like FlutterWindow; Dart posts go to the
+// mock Dart API. Count changes, listener starts and stops and subscriber
+// changes are re-issued in recorded order, at the recorded pace or, with
+// --fast, as fast as possible. Listeners and subscribers that already
+// existed when the capture started are recreated up front.
+//
+// Wakeups and Dart posts are consequences rather than inputs. The report
+// compares how many the capture saw with how many the replay produced, and
+// prints the replay's metrics (wake latency, callback and post durations).
+//
+// Replay drives the real segment, so close the app first; with no window
+// running the printed metrics are the replay's own.
+//
+// Usage:
+//   ipc_replay --capture <file>               Capture until Ctrl+C
+//   ipc_replay --capture <file> --seconds 30  Capture for 30 seconds
+//   ipc_replay <file>                         Replay at the recorded pace
+//   ipc_replay <file> --fast                  Replay as fast as possible
+
+#include <windows.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "dart_api_dl.h"
+#include "dart_port_manager.h"
+#include "ipc_capture.h"
+#include "ipc_flight_recorder.h"
+#include "ipc_log.h"
+#include "ipc_metrics.h"
+#include "shared_memory_manager.h"
+#include "window_count_listener.h"
+
+namespace {
+
+using ipc_capture::CaptureRecord;
+
+// How often capture mode drains the ring and reports progress.
+constexpr DWORD kCapturePollMs = 10;
+constexpr DWORD kCaptureStatusMs = 1000;
+// How long replay waits for the last wakeups and posts to finish.
+constexpr DWORD kSettleMs = 100;
+
+HANDLE g_stop_event = nullptr;
+
+BOOL WINAPI OnConsoleControl(DWORD) {
+  SetEvent(g_stop_event);  // Finish the capture file cleanly
+  return TRUE;
+}
+
+int64_t Now() {
+  LARGE_INTEGER now;
+  QueryPerformanceCounter(&now);
+  return now.QuadPart;
+}
+
+int64_t Frequency() {
+  LARGE_INTEGER frequency;
+  QueryPerformanceFrequency(&frequency);
+  return frequency.QuadPart;
+}
+
+int Capture(const char* path, DWORD seconds) {
+  g_stop_event = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+  SetConsoleCtrlHandler(OnConsoleControl, TRUE);
+
+  ipc_flight::FlightRecorder recorder;
+  if (!recorder.OpenReadOnly()) {
+    std::fprintf(stderr, "No flight recorder: no window is running\n");
+    return 1;
+  }
+  ipc_capture::CaptureWriter writer(&recorder);
+  if (!writer.Open(path)) {
+    std::fprintf(stderr, "Failed to create %s\n", path);
+    return 1;
+  }
+
+  std::printf("Capturing to %s (%s)\n", path,
+              seconds > 0 ? "until the time is up" : "Ctrl+C to stop");
+  ULONGLONG begin = GetTickCount64();
+  ULONGLONG last_status = begin;
+  while (WaitForSingleObject(g_stop_event, kCapturePollMs) == WAIT_TIMEOUT) {
+    writer.Poll();
+    ULONGLONG now = GetTickCount64();
+    if (seconds > 0 && now - begin >= seconds * 1000ull) {
+      break;
+    }
+    if (now - last_status >= kCaptureStatusMs) {
+      last_status = now;
+      std::printf("\r%llu events, %llu lost",
+                  static_cast<unsigned long long>(writer.GetRecordCount()),
+                  static_cast<unsigned long long>(writer.GetLostCount()));
+      std::fflush(stdout);
+    }
+  }
+
+  if (!writer.Close()) {
+    std::fprintf(stderr, "\nFailed to write %s\n", path);
+    return 1;
+  }
+  std::printf("\rCaptured %llu events, %llu lost\n",
+              static_cast<unsigned long long>(writer.GetRecordCount()),
+              static_cast<unsigned long long>(writer.GetLostCount()));
+  return 0;
+}
+
+// ============================================================================
+// Replay
+// ============================================================================
+
+// One recorded window process, wired like FlutterWindow.
+class ReplayWindow {
+ public:
+  ReplayWindow() {
+    manager_.Initialize();
+    listener_.SetCallback([this](LONG) {
+      SharedMemorySnapshot snapshot{};
+      if (!manager_.ReadSnapshot(&snapshot)) {
+        snapshot.window_count = manager_.GetWindowCount();
+      }
+      ports_.NotifyWindowCountChanged(snapshot.window_count,
+                                      snapshot.last_writer_pid,
+                                      snapshot.trace_id);
+    });
+  }
+
+  // The listener thread uses the other members; stop it first.
+  ~ReplayWindow() { listener_.Stop(); }
+
+  ReplayWindow(const ReplayWindow&) = delete;
+  ReplayWindow& operator=(const ReplayWindow&) = delete;
+
+  void Apply(const CaptureRecord& record) {
+    switch (record.kind) {
+      case ipc_flight::kFlightIncrement:
+        manager_.IncrementWindowCount();
+        break;
+      case ipc_flight::kFlightDecrement:
+        manager_.DecrementWindowCount();
+        break;
+      case ipc_flight::kFlightListenerStart:
+        listener_.Start();
+        break;
+      case ipc_flight::kFlightListenerStop:
+        listener_.Stop();
+        break;
+      case ipc_flight::kFlightSubscriberAdd:
+        ports_.RegisterPort(record.detail);
+        break;
+      case ipc_flight::kFlightSubscriberRemove:
+        ports_.UnregisterPort(record.detail);
+        break;
+      default:
+        break;  // Wakeups and posts follow from the events above
+    }
+  }
+
+  void StartListener() { listener_.Start(); }
+  void RegisterPort(Dart_Port_DL port) { ports_.RegisterPort(port); }
+
+ private:
+  SharedMemoryManager manager_;
+  WindowCountListener listener_;
+  DartPortManager ports_;
+};
+
+// State a window had before the capture started, inferred from what it
+// did during the capture.
+struct ImplicitState {
+  bool listener_running = false;
+  std::set<int64_t> ports;
+};
+
+std::map<DWORD, ImplicitState> InferImplicitState(
+    const std::vector<CaptureRecord>& records) {
+  std::map<DWORD, ImplicitState> state;
+  std::map<DWORD, bool> listener_seen;
+  std::map<DWORD, std::set<int64_t>> ports_seen;
+  for (const CaptureRecord& record : records) {
+    DWORD pid = record.process_id;
+    switch (record.kind) {
+      case ipc_flight::kFlightListenerStart:
+      case ipc_flight::kFlightListenerStop:
+        if (!listener_seen[pid] &&
+            record.kind == ipc_flight::kFlightListenerStop) {
+          state[pid].listener_running = true;
+        }
+        listener_seen[pid] = true;
+        break;
+      case ipc_flight::kFlightListenerWake:
+        if (!listener_seen[pid]) {
+          state[pid].listener_running = true;
+          listener_seen[pid] = true;
+        }
+        break;
+      case ipc_flight::kFlightSubscriberAdd:
+        ports_seen[pid].insert(record.detail);
+        break;
+      case ipc_flight::kFlightDartPost:
+      case ipc_flight::kFlightDartPostFailed:
+      case ipc_flight::kFlightSubscriberRemove:
+        if (ports_seen[pid].insert(record.detail).second) {
+          state[pid].ports.insert(record.detail);
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  return state;
+}
+
+// Recorded or replayed event totals.
+struct Totals {
+  int64_t changes = 0;
+  int64_t wakeups = 0;
+  int64_t posts = 0;
+  int64_t post_failures = 0;
+};
+
+Totals CountRecorded(const std::vector<CaptureRecord>& records) {
+  Totals totals;
+  for (const CaptureRecord& record : records) {
+    switch (record.kind) {
+      case ipc_flight::kFlightIncrement:
+      case ipc_flight::kFlightDecrement:
+        totals.changes++;
+        break;
+      case ipc_flight::kFlightListenerWake:
+        totals.wakeups++;
+        break;
+      case ipc_flight::kFlightDartPost:
+        totals.posts++;
+        break;
+      case ipc_flight::kFlightDartPostFailed:
+        totals.post_failures++;
+        break;
+      default:
+        break;
+    }
+  }
+  return totals;
+}
+
+Totals Difference(const ipc_metrics::MetricsSnapshot& before,
+                  const ipc_metrics::MetricsSnapshot& after) {
+  auto delta = [&](ipc_metrics::Counter counter) {
+    return after.counters[counter] - before.counters[counter];
+  };
+  Totals totals;
+  totals.changes = delta(ipc_metrics::kMetricNotificationsSent);
+  totals.wakeups = delta(ipc_metrics::kMetricNotificationsReceived);
+  totals.posts = delta(ipc_metrics::kMetricDartPosts);
+  totals.post_failures = delta(ipc_metrics::kMetricDartPostFailures);
+  return totals;
+}
+
+// Sleeps until shortly before |due|, then spins so events keep their
+// recorded spacing below the timer resolution.
+void WaitUntil(int64_t due, int64_t frequency) {
+  int64_t remaining_ms = (due - Now()) * 1000 / frequency;
+  if (remaining_ms > 2) {
+    Sleep(static_cast<DWORD>(remaining_ms - 2));
+  }
+  while (Now() < due) {
+    YieldProcessor();
+  }
+}
+
+int Replay(const char* path, bool fast) {
+  ipc_capture::CaptureFileHeader header;
+  std::vector<CaptureRecord> records;
+  if (!ipc_capture::ReadCaptureFile(path, &header, &records)) {
+    std::fprintf(stderr, "%s is not a capture file\n", path);
+    return 1;
+  }
+  if (records.empty()) {
+    std::printf("%s holds no events\n", path);
+    return 0;
+  }
+  // Write order can differ slightly from time order across processes.
+  std::stable_sort(records.begin(), records.end(),
+                   [](const CaptureRecord& a, const CaptureRecord& b) {
+                     return a.ticks < b.ticks;
+                   });
+
+  // Posts go to the mock; keep it from recording every call.
+  mock_dart_api::SetRecordCalls(false);
+  Dart_InitializeApiDL(nullptr);
+
+  std::map<DWORD, std::unique_ptr<ReplayWindow>> windows;
+  for (const auto& entry : InferImplicitState(records)) {
+    auto window = std::make_unique<ReplayWindow>();
+    if (entry.second.listener_running) {
+      window->StartListener();
+    }
+    for (int64_t port : entry.second.ports) {
+      window->RegisterPort(port);
+    }
+    windows[entry.first] = std::move(window);
+  }
+  for (const CaptureRecord& record : records) {
+    if (windows.find(record.process_id) == windows.end()) {
+      windows[record.process_id] = std::make_unique<ReplayWindow>();
+    }
+  }
+
+  ipc_metrics::MetricsSnapshot before = {};
+  ipc_metrics::GetRegistry().Snapshot(&before);
+
+  int64_t frequency = Frequency();
+  double scale =
+      static_cast<double>(frequency) / static_cast<double>(header.frequency);
+  int64_t first_ticks = records.front().ticks;
+  int64_t begin = Now();
+  int64_t max_lag = 0;
+  for (const CaptureRecord& record : records) {
+    if (!fast) {
+      int64_t due = begin + static_cast<int64_t>(
+                                static_cast<double>(record.ticks -
+                                                    first_ticks) *
+                                scale);
+      WaitUntil(due, frequency);
+      max_lag = std::max(max_lag, Now() - due);
+    }
+    windows[record.process_id]->Apply(record);
+  }
+  double seconds =
+      static_cast<double>(Now() - begin) / static_cast<double>(frequency);
+  Sleep(kSettleMs);
+
+  ipc_metrics::MetricsSnapshot after = {};
+  ipc_metrics::GetRegistry().Snapshot(&after);
+  size_t window_count = windows.size();
+  windows.clear();
+
+  double recorded_seconds =
+      static_cast<double>(records.back().ticks - first_ticks) /
+      static_cast<double>(header.frequency);
+  Totals recorded = CountRecorded(records);
+  Totals replayed = Difference(before, after);
+  std::printf("Replayed %zu events from %zu windows in %.3f s "
+              "(recorded %.3f s, %s)\n",
+              records.size(), window_count, seconds, recorded_seconds,
+              fast ? "as fast as possible" : "recorded pace");
+  if (fast) {
+    std::printf("%.0f events per second\n",
+                seconds > 0 ? static_cast<double>(records.size()) / seconds
+                            : 0.0);
+  } else {
+    std::printf("Max lag behind the recording: %.3f ms\n",
+                static_cast<double>(max_lag) * 1000.0 /
+                    static_cast<double>(frequency));
+  }
+  std::printf("\n%-20s %10s %10s\n", "", "RECORDED", "REPLAYED");
+  std::printf("%-20s %10lld %10lld\n", "count changes",
+              static_cast<long long>(recorded.changes),
+              static_cast<long long>(replayed.changes));
+  std::printf("%-20s %10lld %10lld\n", "listener wakeups",
+              static_cast<long long>(recorded.wakeups),
+              static_cast<long long>(replayed.wakeups));
+  std::printf("%-20s %10lld %10lld\n", "dart posts",
+              static_cast<long long>(recorded.posts),
+              static_cast<long long>(replayed.posts));
+  std::printf("%-20s %10lld %10lld\n\n", "dart post failures",
+              static_cast<long long>(recorded.post_failures),
+              static_cast<long long>(replayed.post_failures));
+  std::fputs(ipc_metrics::FormatMetrics(after).c_str(), stdout);
+  return 0;
+}
+
+void PrintUsage() {
+  std::fprintf(stderr,
+               "Usage: ipc_replay --capture <file> [--seconds <n>]\n"
+               "       ipc_replay <file> [--fast]\n"
+               "  --capture <file>  Capture the running windows to a file\n"
+               "  --seconds <n>     Stop capturing after n seconds\n"
+               "  --fast            Replay as fast as possible\n");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const char* capture_path = nullptr;
+  const char* replay_path = nullptr;
+  DWORD seconds = 0;
+  bool fast = false;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+      capture_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      seconds = static_cast<DWORD>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (std::strcmp(argv[i], "--fast") == 0) {
+      fast = true;
+    } else if (argv[i][0] != '-' && replay_path == nullptr) {
+      replay_path = argv[i];
+    } else {
+      PrintUsage();
+      return 2;
+    }
+  }
+  if ((capture_path == nullptr) == (replay_path == nullptr)) {
+    PrintUsage();
+    return 2;
+  }
+
+  if (capture_path != nullptr) {
+    // No logging: like shmem_top, capturing must not add traffic.
+    return Capture(capture_path, seconds);
+  }
+  int result = Replay(replay_path, fast);
+  ipc_metrics::Shutdown();
+  ipc_log::Shutdown();
+  return result;
+}
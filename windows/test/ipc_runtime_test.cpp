@@ -0,0 +1,261 @@
+// ipc_runtime_test.cpp
+//
+// Google Test unit tests for IpcRuntime, the per-process shared memory
+// manager and listener shared by all windows of a process.
+
+#include <gtest/gtest.h>
+#include <windows.h>
+
+#include <atomic>
+#include <memory>
+
+// Include dart_api_dl.h which redirects to our mock in test builds
+#include "dart_api_dl.h"
+
+#include "dart_port_manager.h"
+#include "ipc_metrics.h"
+#include "ipc_namespace.h"
+#include "ipc_runtime.h"
+#include "ipc_test_namespace.h"
+#include "shared_buffer_pool.h"
+
+namespace {
+
+constexpr Dart_Port_DL kTestPort = 4400;
+
+// Polls until |value| reaches |expected| or a second has passed.
+bool WaitFor(const std::atomic<int>& value, int expected) {
+  for (int i = 0; i < 100 && value.load() < expected; i++) {
+    Sleep(10);
+  }
+  return value.load() >= expected;
+}
+
+}  // namespace
+
+class IpcRuntimeTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    mock_dart_api::Reset();
+    // The listener thread posts; call recording is not thread-safe.
+    mock_dart_api::SetRecordCalls(false);
+  }
+
+  void TearDown() override { mock_dart_api::Reset(); }
+};
+
+//==============================================================================
+// Test Suite 1: Reference Counting
+//==============================================================================
+
+TEST_F(IpcRuntimeTest, Acquire_ReturnsSameRuntimeWhileHeld) {
+  std::shared_ptr<IpcRuntime> first = IpcRuntime::Acquire();
+  std::shared_ptr<IpcRuntime> second = IpcRuntime::Acquire();
+
+  EXPECT_EQ(first.get(), second.get());
+  EXPECT_EQ(1, IpcRuntime::GetLiveCount());
+  ASSERT_NE(nullptr, first->shared_memory_manager());
+  EXPECT_TRUE(first->IsListening());
+}
+
+TEST_F(IpcRuntimeTest, LastRelease_StopsRuntime) {
+  std::shared_ptr<IpcRuntime> first = IpcRuntime::Acquire();
+  std::shared_ptr<IpcRuntime> second = IpcRuntime::Acquire();
+
+  first.reset();
+  EXPECT_EQ(1, IpcRuntime::GetLiveCount());
+  EXPECT_TRUE(second->IsListening());
+
+  second.reset();
+  EXPECT_EQ(0, IpcRuntime::GetLiveCount());
+
+  // The next user starts a fresh runtime
+  std::shared_ptr<IpcRuntime> third = IpcRuntime::Acquire();
+  EXPECT_EQ(1, IpcRuntime::GetLiveCount());
+  EXPECT_TRUE(third->IsListening());
+}
+
+TEST_F(IpcRuntimeTest, Acquire_DifferentNamespaces_DifferentRuntimes) {
+  std::shared_ptr<IpcRuntime> a =
+      IpcRuntime::Acquire(ipc_namespace::MakeUnique("RuntimeA"));
+  std::shared_ptr<IpcRuntime> b =
+      IpcRuntime::Acquire(ipc_namespace::MakeUnique("RuntimeB"));
+
+  EXPECT_NE(a.get(), b.get());
+  EXPECT_EQ(2, IpcRuntime::GetLiveCount());
+  EXPECT_NE(a->shared_memory_manager()->shared_memory_name(),
+            b->shared_memory_manager()->shared_memory_name());
+}
+
+TEST_F(IpcRuntimeTest, OtherNamespaceRuntime_LeavesProcessGlobalsAlone) {
+  std::shared_ptr<IpcRuntime> runtime = IpcRuntime::Acquire();
+  ASSERT_NE(nullptr, runtime->shared_memory_manager());
+  SharedBufferPool& pool = GetGlobalSharedBufferPool();
+  ASSERT_TRUE(pool.StartReceiving(
+      [](SharedBufferHandle, uint8_t*, DWORD, DWORD) {}));
+
+  // A second namespace comes and goes, e.g. a short-lived poll handle
+  IpcRuntime::Acquire(ipc_namespace::MakeUnique("RuntimeOther")).reset();
+
+  EXPECT_TRUE(pool.IsReceiving());
+  EXPECT_EQ(runtime->shared_memory_manager()->GetReadOnlyView(),
+            GetSharedMemoryView());
+
+  // The default namespace's runtime owns both
+  runtime.reset();
+  EXPECT_FALSE(pool.IsReceiving());
+  EXPECT_EQ(nullptr, GetSharedMemoryView());
+}
+
+//==============================================================================
+// Test Suite 2: Fan-Out
+//==============================================================================
+
+TEST_F(IpcRuntimeTest, Subscribers_EachCalledOncePerChange) {
+  std::shared_ptr<IpcRuntime> runtime = IpcRuntime::Acquire();
+  std::atomic<int> first_calls{0};
+  std::atomic<int> second_calls{0};
+  std::atomic<LONG> seen_count{-1};
+  runtime->Subscribe([&](const SharedMemorySnapshot& snapshot) {
+    first_calls++;
+    seen_count = snapshot.window_count;
+  });
+  runtime->Subscribe(
+      [&](const SharedMemorySnapshot& /* snapshot */) { second_calls++; });
+  EXPECT_EQ(2u, runtime->GetSubscriberCount());
+
+  runtime->shared_memory_manager()->IncrementWindowCount();
+  ASSERT_TRUE(WaitFor(first_calls, 1));
+  ASSERT_TRUE(WaitFor(second_calls, 1));
+  EXPECT_EQ(1, seen_count.load());
+
+  runtime->shared_memory_manager()->DecrementWindowCount();
+  ASSERT_TRUE(WaitFor(first_calls, 2));
+  EXPECT_EQ(2, second_calls.load());
+}
+
+TEST_F(IpcRuntimeTest, Unsubscribe_StopsCalls) {
+  std::shared_ptr<IpcRuntime> runtime = IpcRuntime::Acquire();
+  std::atomic<int> calls{0};
+  std::atomic<int> witness{0};
+  IpcRuntime::SubscriptionId id = runtime->Subscribe(
+      [&](const SharedMemorySnapshot& /* snapshot */) { calls++; });
+  runtime->Subscribe(
+      [&](const SharedMemorySnapshot& /* snapshot */) { witness++; });
+
+  runtime->Unsubscribe(id);
+  EXPECT_EQ(1u, runtime->GetSubscriberCount());
+
+  runtime->shared_memory_manager()->IncrementWindowCount();
+  ASSERT_TRUE(WaitFor(witness, 1));
+  EXPECT_EQ(0, calls.load());
+  runtime->shared_memory_manager()->DecrementWindowCount();
+}
+
+TEST_F(IpcRuntimeTest, ManyUsers_OnePostPerChange) {
+  std::atomic<int> posts{0};
+  mock_dart_api::SetPostCObjectCallback(
+      [&posts](Dart_Port_DL port, Dart_CObject* /* message */) {
+        if (port == kTestPort) {
+          posts++;
+        }
+        return true;
+      });
+  ASSERT_TRUE(GetGlobalDartPortManager().RegisterPort(kTestPort));
+
+  // Four windows' worth of references, one listener
+  std::shared_ptr<IpcRuntime> users[4];
+  for (auto& user : users) {
+    user = IpcRuntime::Acquire();
+  }
+  std::atomic<int> wakeups{0};
+  users[0]->Subscribe(
+      [&](const SharedMemorySnapshot& /* snapshot */) { wakeups++; });
+
+  users[0]->shared_memory_manager()->IncrementWindowCount();
+  ASSERT_TRUE(WaitFor(wakeups, 1));
+  Sleep(50);  // A second listener would have posted by now
+  EXPECT_EQ(1, posts.load());
+
+  users[0]->shared_memory_manager()->DecrementWindowCount();
+  ASSERT_TRUE(WaitFor(wakeups, 2));
+  GetGlobalDartPortManager().UnregisterPort(kTestPort);
+}
+
+//==============================================================================
+// Test Suite 3: Delivery Policies
+//==============================================================================
+
+namespace {
+
+int64_t Counter(ipc_metrics::Counter counter) {
+  ipc_metrics::MetricsSnapshot snapshot{};
+  ipc_metrics::GetRegistry().Snapshot(&snapshot);
+  return snapshot.counters[counter];
+}
+
+}  // namespace
+
+TEST_F(IpcRuntimeTest, FrameAligned_BurstDeliveredOncePerFrame) {
+  std::shared_ptr<IpcRuntime> runtime = IpcRuntime::Acquire();
+  ASSERT_TRUE(runtime->SetDeliveryPolicy(IpcDeliveryPolicy::FrameAligned(10)));
+  std::atomic<int> deliveries{0};
+  std::atomic<LONG> seen_count{-1};
+  runtime->Subscribe([&](const SharedMemorySnapshot& snapshot) {
+    deliveries++;
+    seen_count = snapshot.window_count;
+  });
+  int64_t merged_before = Counter(ipc_metrics::kMetricFrameMerged);
+
+  // 20 windows in a burst, with the listener waking for most of them
+  for (int i = 0; i < 20; i++) {
+    runtime->shared_memory_manager()->IncrementWindowCount();
+    Sleep(12);
+  }
+  for (int i = 0; i < 100 && seen_count.load() != 20; i++) {
+    Sleep(10);
+  }
+  EXPECT_EQ(20, seen_count.load());  // The last delivery has the latest state
+  EXPECT_LE(deliveries.load(), 5);   // 100 ms frames over ~250 ms
+  EXPECT_GT(Counter(ipc_metrics::kMetricFrameMerged), merged_before);
+}
+
+TEST_F(IpcRuntimeTest, SetDeliveryPolicy_HeldDeliveryIsFlushed) {
+  std::shared_ptr<IpcRuntime> runtime = IpcRuntime::Acquire();
+  std::atomic<int> deliveries{0};
+  runtime->Subscribe(
+      [&](const SharedMemorySnapshot& /* snapshot */) { deliveries++; });
+  ASSERT_TRUE(runtime->SetDeliveryPolicy(IpcDeliveryPolicy::Coalesce(900000)));
+
+  runtime->shared_memory_manager()->IncrementWindowCount();
+  Sleep(100);
+  EXPECT_EQ(0, deliveries.load());  // Held for most of a second
+
+  ASSERT_TRUE(runtime->SetDeliveryPolicy(IpcDeliveryPolicy::Immediate()));
+  ASSERT_TRUE(WaitFor(deliveries, 1));
+  EXPECT_EQ(IpcDeliveryPolicy::Immediate(), runtime->GetDeliveryPolicy());
+}
+
+TEST_F(IpcRuntimeTest, DefaultPolicy_AppliesToLiveAndNewRuntimes) {
+  std::shared_ptr<IpcRuntime> live = IpcRuntime::Acquire();
+  ASSERT_TRUE(SetIpcDeliveryPolicy(
+      static_cast<int32_t>(IpcDeliveryMode::kDebounce), 5000));
+  EXPECT_EQ(IpcDeliveryPolicy::Debounce(5000), live->GetDeliveryPolicy());
+
+  std::shared_ptr<IpcRuntime> fresh =
+      IpcRuntime::Acquire(ipc_namespace::MakeUnique("RuntimePolicy"));
+  EXPECT_EQ(IpcDeliveryPolicy::Debounce(5000), fresh->GetDeliveryPolicy());
+
+  EXPECT_FALSE(SetIpcDeliveryPolicy(42, 1));
+  EXPECT_FALSE(SetIpcDeliveryPolicy(
+      static_cast<int32_t>(IpcDeliveryMode::kFrameAligned), 0));
+  ASSERT_TRUE(SetIpcDeliveryPolicy(
+      static_cast<int32_t>(IpcDeliveryMode::kImmediate), 0));
+  EXPECT_EQ(IpcDeliveryPolicy::Immediate(), live->GetDeliveryPolicy());
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  UseIpcTestNamespaces("IpcRuntimeTest");
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,865 @@
+// ipc_stress.cpp
+//
+// Multi-process stress and scaling harness for the shared memory IPC.
+//
+// cross_process_test.cpp simulates windows with several SharedMemoryManager
+// objects inside one process. This tool starts real child processes
+// instead, so wakeups cross address spaces, the counter's cache line moves
+// between processes and every window opens its own kernel handles, the way
+// real windows do.
+//
+// For each process count the harness starts N children that run a scripted
+// workload at a fixed rate, then reports how throughput and latency scale:
+//   - change latency: one IncrementWindowCount/DecrementWindowCount call
+//   - delivery latency: a change until a listener callback in any child
+//     starts (includes the listener's 10 ms reset delay)
+// and checks correctness:
+//   - every count a child observes stays within the bounds the script allows
+//   - the count is back at its starting value once all children are done
+//   - one final change after the run reaches the listener of every child
+//   - every child starts, finishes and exits cleanly
+//
+// Children are this executable started with --child <name> <index>. They
+// read the run configuration from the "<name>.Results" mapping and record
+// into their own slot of it, with ipc_metrics histogram buckets, so results
+// survive children that crash.
+//
+// The children use the real segment and the full production path including
+// logging, so close the app first.
+//
+// Usage:
+//   ipc_stress                             Sweep 2 to 1000 processes
+//   ipc_stress --processes 2,16,128        Process counts to run
+//   ipc_stress --rate 50                   Script steps per second per child
+//   ipc_stress --duration 2000             Workload length in milliseconds
+//   ipc_stress --script open,notify,close  Steps each child repeats
+//   ipc_stress --json <file>               Also write the results as JSON
+//   ipc_stress --spin                      Spin-then-block child listeners
+//
+// Script steps: "open" starts a window (opens a new SharedMemoryManager and
+// increments), "close" ends the newest one (decrements and closes it),
+// "notify" increments and decrements on a long-lived manager.
+//
+// With --spin the child listeners use WindowCountListener::EnableSpinWait,
+// and each row is followed by the spin hits and the cores the spinning
+// kept busy (from the fleet metrics), to weigh latency against CPU burn.
+//
+// The exit code is 1 if any run found a correctness error.
+
+#include <windows.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ipc_log.h"
+#include "ipc_metrics.h"
+#include "shared_memory_manager.h"
+#include "window_count_listener.h"
+
+namespace {
+
+using ipc_metrics::kHistogramBuckets;
+using ipc_metrics::MetricsRegistry;
+
+constexpr char kChildFlag[] = "--child";
+constexpr DWORD kStressMagic = 0x53525453;  // 'STRS'
+
+constexpr int kDefaultProcessCounts[] = {2,  4,   8,   16,  32,
+                                         64, 128, 256, 512, 1000};
+constexpr int kDefaultRate = 50;
+constexpr int kDefaultDurationMs = 2000;
+constexpr char kDefaultScript[] = "open,notify,close";
+constexpr int kMaxScriptSteps = 32;
+
+// How long the parent waits for each child to report ready.
+constexpr DWORD kChildReadyTimeoutMs = 30000;
+// Grace period beyond the duration for children to finish their script.
+constexpr DWORD kChildDoneGraceMs = 60000;
+// How long the final change may take to reach every listener.
+constexpr DWORD kFinalWakeTimeoutMs = 2000;
+// How long a child may take to exit once told to stop.
+constexpr DWORD kChildExitTimeoutMs = 10000;
+
+enum Step : uint8_t {
+  kStepOpen = 1,
+  kStepClose,
+  kStepNotify,
+};
+
+enum ChildState : LONG {
+  kChildStarting = 0,
+  kChildReady,
+  kChildDone,
+};
+
+// Run configuration, written by the parent before it starts any child.
+struct StressHeader {
+  DWORD magic;
+  LONG processes;
+  LONG rate;
+  LONG duration_ms;
+  volatile LONG baseline;  // Count before the run, set before Start
+  LONG max_count;          // Highest count the script allows above baseline
+  LONG step_count;
+  LONG spin_wait;          // Children listen with EnableSpinWait()
+  uint8_t steps[kMaxScriptSteps];
+  // QPC right before the newest change, for delivery latency.
+  alignas(64) volatile LONG64 last_change_ticks;
+};
+
+// Results of one child. Written only by that child (main thread for
+// changes, listener thread for deliveries); read by the parent after the
+// child is done.
+struct alignas(64) StressSlot {
+  volatile LONG state;
+  DWORD process_id;
+  volatile LONG last_seen_count;  // Count read by the latest callback
+  LONG reserved;
+  volatile LONG64 steps;
+  volatile LONG64 changes;
+  volatile LONG64 change_errors;  // Initialize failed or a change returned -1
+  volatile LONG64 range_errors;   // Count outside the allowed bounds
+  volatile LONG64 snapshot_failures;
+  volatile LONG64 wakeups;
+  volatile LONG64 change_max;  // Nanoseconds
+  volatile LONG64 delivery_max;
+  volatile LONG change_buckets[kHistogramBuckets];
+  volatile LONG delivery_buckets[kHistogramBuckets];
+};
+
+int64_t Now() {
+  LARGE_INTEGER now;
+  QueryPerformanceCounter(&now);
+  return now.QuadPart;
+}
+
+int64_t Frequency() {
+  static const int64_t frequency = [] {
+    LARGE_INTEGER value;
+    QueryPerformanceFrequency(&value);
+    return value.QuadPart;
+  }();
+  return frequency;
+}
+
+int64_t TicksToNs(int64_t ticks) {
+  return static_cast<int64_t>(static_cast<double>(ticks) * 1e9 /
+                              static_cast<double>(Frequency()));
+}
+
+void RecordNs(volatile LONG* buckets, volatile LONG64* max, int64_t ns) {
+  InterlockedIncrement(&buckets[MetricsRegistry::BucketIndex(ns)]);
+  LONG64 current = ReadAcquire64(max);
+  while (ns > current) {
+    LONG64 seen = InterlockedCompareExchange64(max, ns, current);
+    if (seen == current) {
+      break;
+    }
+    current = seen;
+  }
+}
+
+std::string ResultsName(const std::string& name) {
+  return name + ".Results";
+}
+
+size_t ResultsSize(int processes) {
+  return sizeof(StressHeader) + processes * sizeof(StressSlot);
+}
+
+// Parses "open,notify,close" into steps. Rejects unknown steps and scripts
+// that close more windows than they opened or leave any open.
+bool ParseScript(const char* text, StressHeader* header) {
+  std::string script(text);
+  int depth = 0;
+  int max_depth = 0;
+  bool notifies = false;
+  header->step_count = 0;
+  size_t begin = 0;
+  while (begin <= script.size()) {
+    size_t end = script.find(',', begin);
+    if (end == std::string::npos) {
+      end = script.size();
+    }
+    std::string step = script.substr(begin, end - begin);
+    if (header->step_count == kMaxScriptSteps) {
+      return false;
+    }
+    if (step == "open") {
+      header->steps[header->step_count++] = kStepOpen;
+      depth++;
+      max_depth = depth > max_depth ? depth : max_depth;
+    } else if (step == "close") {
+      header->steps[header->step_count++] = kStepClose;
+      if (--depth < 0) {
+        return false;
+      }
+    } else if (step == "notify") {
+      header->steps[header->step_count++] = kStepNotify;
+      notifies = true;
+    } else {
+      return false;
+    }
+    begin = end + 1;
+  }
+  // A notify raises the count by one on top of the open windows.
+  header->max_count = max_depth + (notifies ? 1 : 0);
+  return depth == 0 && header->max_count > 0;
+}
+
+// ============================================================================
+// Child
+// ============================================================================
+
+class StressChild {
+ public:
+  StressChild(StressHeader* header, StressSlot* slot)
+      : header_(header), slot_(slot) {}
+
+  bool Initialize() { return manager_.Initialize(); }
+
+  const SharedMemoryData* view() { return manager_.GetReadOnlyView(); }
+
+  void OnChange() {
+    int64_t now = Now();
+    InterlockedIncrement64(&slot_->wakeups);
+    int64_t sent = ReadAcquire64(&header_->last_change_ticks);
+    if (sent != 0 && sent <= now) {
+      RecordNs(slot_->delivery_buckets, &slot_->delivery_max,
+               TicksToNs(now - sent));
+    }
+
+    SharedMemorySnapshot snapshot;
+    if (!manager_.ReadSnapshot(&snapshot)) {
+      InterlockedIncrement64(&slot_->snapshot_failures);
+      return;
+    }
+    CheckRange(snapshot.window_count, 0, 0);
+    InterlockedExchange(&slot_->last_seen_count, snapshot.window_count);
+  }
+
+  // Repeats the script until the duration is over, finishing the last
+  // round so every window it opened is closed again.
+  void Run() {
+    int64_t period = Frequency() / header_->rate;
+    int64_t begin = Now();
+    int64_t end = begin + header_->duration_ms * Frequency() / 1000;
+    int64_t due = begin;
+    while (Now() < end) {
+      for (LONG i = 0; i < header_->step_count; i++) {
+        WaitUntil(due);
+        due += period;
+        RunStep(static_cast<Step>(header_->steps[i]));
+        InterlockedIncrement64(&slot_->steps);
+      }
+    }
+  }
+
+ private:
+  void RunStep(Step step) {
+    switch (step) {
+      case kStepOpen: {
+        auto window = std::make_unique<SharedMemoryManager>();
+        if (window->Initialize()) {
+          Change(window.get(), 1);
+        } else {
+          InterlockedIncrement64(&slot_->change_errors);
+          window.reset();  // Its close step is skipped too
+        }
+        windows_.push_back(std::move(window));
+        break;
+      }
+      case kStepClose:
+        if (windows_.back()) {
+          Change(windows_.back().get(), -1);
+        }
+        windows_.pop_back();
+        break;
+      case kStepNotify:
+        Change(&manager_, 1);
+        Change(&manager_, -1);
+        break;
+    }
+  }
+
+  void Change(SharedMemoryManager* manager, LONG delta) {
+    int64_t start = Now();
+    InterlockedExchange64(&header_->last_change_ticks, start);
+    LONG count = delta > 0 ? manager->IncrementWindowCount()
+                           : manager->DecrementWindowCount();
+    RecordNs(slot_->change_buckets, &slot_->change_max,
+             TicksToNs(Now() - start));
+    InterlockedIncrement64(&slot_->changes);
+    if (count < 0) {
+      InterlockedIncrement64(&slot_->change_errors);
+      return;
+    }
+    // This child's own change is part of the count it returns.
+    CheckRange(count, delta > 0 ? 1 : 0, delta > 0 ? 0 : 1);
+  }
+
+  void CheckRange(LONG count, LONG low_margin, LONG high_margin) {
+    LONG baseline = ReadAcquire(&header_->baseline);
+    LONG high = baseline + header_->processes * header_->max_count;
+    if (count < baseline + low_margin || count > high - high_margin) {
+      InterlockedIncrement64(&slot_->range_errors);
+    }
+  }
+
+  static void WaitUntil(int64_t due) {
+    // Sleep only: spinning would distort runs with more children than
+    // cores. Steps stay on schedule on average because |due| is absolute.
+    int64_t remaining_ms = (due - Now()) * 1000 / Frequency();
+    if (remaining_ms > 0) {
+      Sleep(static_cast<DWORD>(remaining_ms));
+    }
+  }
+
+  StressHeader* header_;
+  StressSlot* slot_;
+  SharedMemoryManager manager_;  // Long-lived, for notify steps
+  std::vector<std::unique_ptr<SharedMemoryManager>> windows_;
+};
+
+int RunChild(int argc, char* argv[]) {
+  if (argc < 4) {
+    return 2;
+  }
+  std::string name = argv[2];
+  int index = std::atoi(argv[3]);
+
+  HANDLE mapping =
+      OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, ResultsName(name).c_str());
+  HANDLE ready =
+      OpenSemaphoreA(SEMAPHORE_MODIFY_STATE, FALSE, (name + ".Ready").c_str());
+  HANDLE done =
+      OpenSemaphoreA(SEMAPHORE_MODIFY_STATE, FALSE, (name + ".Done").c_str());
+  HANDLE start = OpenEventA(SYNCHRONIZE, FALSE, (name + ".Start").c_str());
+  HANDLE stop = OpenEventA(SYNCHRONIZE, FALSE, (name + ".Stop").c_str());
+  if (mapping == nullptr || ready == nullptr || done == nullptr ||
+      start == nullptr || stop == nullptr) {
+    return 1;  // The parent times out waiting for this child
+  }
+  auto* header = static_cast<StressHeader*>(
+      MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+  if (header == nullptr || header->magic != kStressMagic || index < 0 ||
+      index >= header->processes) {
+    return 1;
+  }
+  StressSlot* slot = reinterpret_cast<StressSlot*>(header + 1) + index;
+  slot->process_id = GetCurrentProcessId();
+  slot->last_seen_count = -1;
+
+  int exit_code = 0;
+  {
+    StressChild child(header, slot);
+    WindowCountListener listener;
+    listener.SetCallback([&child](LONG) { child.OnChange(); });
+    bool ok = child.Initialize();
+    if (ok && header->spin_wait) {
+      listener.EnableSpinWait(child.view());
+    }
+    ok = ok && listener.Start();
+    InterlockedExchange(&slot->state, kChildReady);
+    ReleaseSemaphore(ready, 1, nullptr);  // Even on failure: never hang
+
+    HANDLE go[] = {start, stop};
+    if (!ok) {
+      exit_code = 1;
+    } else if (WaitForMultipleObjects(2, go, FALSE, INFINITE) ==
+               WAIT_OBJECT_0) {
+      child.Run();
+      InterlockedExchange(&slot->state, kChildDone);
+      ReleaseSemaphore(done, 1, nullptr);
+      // Keep listening for the parent's final change.
+      WaitForSingleObject(stop, INFINITE);
+    }
+    listener.Stop();
+  }
+
+  UnmapViewOfFile(header);
+  CloseHandle(mapping);
+  CloseHandle(ready);
+  CloseHandle(done);
+  CloseHandle(start);
+  CloseHandle(stop);
+  ipc_metrics::Shutdown();
+  ipc_log::Shutdown();
+  return exit_code;
+}
+
+// ============================================================================
+// Parent
+// ============================================================================
+
+struct Options {
+  std::vector<int> process_counts;
+  int rate = kDefaultRate;
+  int duration_ms = kDefaultDurationMs;
+  const char* script = kDefaultScript;
+  const char* json_path = nullptr;
+  bool spin = false;
+};
+
+// Aggregate of one run.
+struct RunResult {
+  int processes = 0;
+  int started = 0;  // Children that reported ready
+  double seconds = 0;
+  int64_t steps = 0;
+  int64_t changes = 0;
+  int64_t wakeups = 0;
+  int64_t change_errors = 0;
+  int64_t range_errors = 0;
+  int64_t snapshot_failures = 0;
+  int lost_final_wakeups = 0;
+  int failed_children = 0;  // Did not finish or exited with an error
+  bool balanced = false;    // Count back at the baseline after the run
+  int64_t change_max = 0;
+  int64_t delivery_max = 0;
+  int64_t spin_hits = 0;      // Fleet metrics over the run
+  double spin_cores = 0;      // Cores kept busy spinning, on average
+  std::vector<int64_t> change_buckets =
+      std::vector<int64_t>(kHistogramBuckets);
+  std::vector<int64_t> delivery_buckets =
+      std::vector<int64_t>(kHistogramBuckets);
+
+  bool Ok() const {
+    return started == processes && change_errors == 0 && range_errors == 0 &&
+           snapshot_failures == 0 && lost_final_wakeups == 0 &&
+           failed_children == 0 && balanced;
+  }
+};
+
+// Nearest-rank percentile of bucketed nanoseconds, capped at max.
+int64_t Percentile(const std::vector<int64_t>& buckets, int64_t max,
+                   double q) {
+  int64_t count = 0;
+  for (int64_t bucket : buckets) {
+    count += bucket;
+  }
+  if (count == 0) {
+    return 0;
+  }
+  int64_t rank = static_cast<int64_t>(q * static_cast<double>(count));
+  if (rank >= count) {
+    rank = count - 1;
+  }
+  int64_t seen = 0;
+  for (uint32_t b = 0; b < kHistogramBuckets; b++) {
+    seen += buckets[b];
+    if (seen > rank) {
+      int64_t bound = MetricsRegistry::BucketUpperBound(b);
+      return bound < max ? bound : max;
+    }
+  }
+  return max;
+}
+
+double Micros(int64_t ns) {
+  return static_cast<double>(ns) / 1000.0;
+}
+
+// Children die with the job if the harness exits or crashes mid-run.
+HANDLE CreateKillOnCloseJob() {
+  HANDLE job = CreateJobObjectA(nullptr, nullptr);
+  if (job == nullptr) {
+    return nullptr;
+  }
+  JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits = {};
+  limits.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+  SetInformationJobObject(job, JobObjectExtendedLimitInformation, &limits,
+                          sizeof(limits));
+  return job;
+}
+
+// Starts one child suspended, adds it to the job, then lets it run.
+HANDLE SpawnChild(const char* module_path, const std::string& name, int index,
+                  HANDLE job) {
+  std::string command = std::string("\"") + module_path + "\" " + kChildFlag +
+                        " " + name + " " + std::to_string(index);
+  STARTUPINFOA startup = {};
+  startup.cb = sizeof(startup);
+  PROCESS_INFORMATION info = {};
+  // No console output: a thousand children logging would swamp the table.
+  if (!CreateProcessA(nullptr, &command[0], nullptr, nullptr, FALSE,
+                      CREATE_SUSPENDED | CREATE_NO_WINDOW, nullptr, nullptr,
+                      &startup, &info)) {
+    return nullptr;
+  }
+  if (job != nullptr) {
+    AssignProcessToJobObject(job, info.hProcess);
+  }
+  ResumeThread(info.hThread);
+  CloseHandle(info.hThread);
+  return info.hProcess;
+}
+
+void Aggregate(const StressSlot* slots, RunResult* result) {
+  for (int i = 0; i < result->processes; i++) {
+    const StressSlot& slot = slots[i];
+    result->steps += slot.steps;
+    result->changes += slot.changes;
+    result->wakeups += slot.wakeups;
+    result->change_errors += slot.change_errors;
+    result->range_errors += slot.range_errors;
+    result->snapshot_failures += slot.snapshot_failures;
+    if (slot.change_max > result->change_max) {
+      result->change_max = slot.change_max;
+    }
+    if (slot.delivery_max > result->delivery_max) {
+      result->delivery_max = slot.delivery_max;
+    }
+    for (uint32_t b = 0; b < kHistogramBuckets; b++) {
+      result->change_buckets[b] += slot.change_buckets[b];
+      result->delivery_buckets[b] += slot.delivery_buckets[b];
+    }
+  }
+}
+
+// Counts listeners that have not yet seen |count|.
+int CountBehind(const StressSlot* slots, int processes, LONG count) {
+  int behind = 0;
+  for (int i = 0; i < processes; i++) {
+    if (ReadAcquire(&slots[i].last_seen_count) != count) {
+      behind++;
+    }
+  }
+  return behind;
+}
+
+bool RunOnce(const Options& options, const StressHeader& config,
+             const char* module_path, SharedMemoryManager* manager,
+             int processes, RunResult* result) {
+  result->processes = processes;
+  std::string name = "Local\\IpcStress." +
+                     std::to_string(GetCurrentProcessId()) + "." +
+                     std::to_string(processes);
+
+  size_t size = ResultsSize(processes);
+  HANDLE mapping = CreateFileMappingA(
+      INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+      static_cast<DWORD>(static_cast<uint64_t>(size) >> 32),
+      static_cast<DWORD>(size), ResultsName(name).c_str());
+  if (mapping == nullptr) {
+    std::fprintf(stderr, "CreateFileMappingA failed: %lu\n",
+                 static_cast<unsigned long>(GetLastError()));
+    return false;
+  }
+  auto* header = static_cast<StressHeader*>(
+      MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size));
+  if (header == nullptr) {
+    std::fprintf(stderr, "MapViewOfFile failed: %lu\n",
+                 static_cast<unsigned long>(GetLastError()));
+    CloseHandle(mapping);
+    return false;
+  }
+  StressSlot* slots = reinterpret_cast<StressSlot*>(header + 1);
+  *header = config;
+  header->processes = processes;
+  header->magic = kStressMagic;
+
+  HANDLE ready =
+      CreateSemaphoreA(nullptr, 0, processes, (name + ".Ready").c_str());
+  HANDLE done =
+      CreateSemaphoreA(nullptr, 0, processes, (name + ".Done").c_str());
+  HANDLE start = CreateEventA(nullptr, TRUE, FALSE, (name + ".Start").c_str());
+  HANDLE stop = CreateEventA(nullptr, TRUE, FALSE, (name + ".Stop").c_str());
+  HANDLE job = CreateKillOnCloseJob();
+
+  std::vector<HANDLE> children;
+  for (int i = 0; i < processes; i++) {
+    HANDLE child = SpawnChild(module_path, name, i, job);
+    if (child == nullptr) {
+      std::fprintf(stderr, "CreateProcessA failed for child %d: %lu\n", i,
+                   static_cast<unsigned long>(GetLastError()));
+      break;
+    }
+    children.push_back(child);
+  }
+  for (size_t i = 0; i < children.size(); i++) {
+    if (WaitForSingleObject(ready, kChildReadyTimeoutMs) != WAIT_OBJECT_0) {
+      break;
+    }
+    result->started++;
+  }
+
+  ipc_metrics::MetricsSnapshot metrics_before = {};
+  ipc_metrics::GetRegistry().Snapshot(&metrics_before);
+  if (result->started == processes) {
+    LONG baseline = manager->GetWindowCount();
+    InterlockedExchange(&header->baseline, baseline);
+
+    int64_t begin = Now();
+    SetEvent(start);
+    DWORD deadline_ms = static_cast<DWORD>(options.duration_ms) +
+                        kChildDoneGraceMs;
+    for (int i = 0; i < processes; i++) {
+      if (WaitForSingleObject(done, deadline_ms) != WAIT_OBJECT_0) {
+        break;  // Stragglers are counted as failed below
+      }
+    }
+    result->seconds = static_cast<double>(Now() - begin) /
+                      static_cast<double>(Frequency());
+    result->balanced = manager->GetWindowCount() == baseline;
+
+    // One last change while every child is idle must reach them all.
+    InterlockedExchange64(&header->last_change_ticks, Now());
+    LONG final_count = manager->IncrementWindowCount();
+    DWORD waited_ms = 0;
+    while (CountBehind(slots, processes, final_count) > 0 &&
+           waited_ms < kFinalWakeTimeoutMs) {
+      Sleep(10);
+      waited_ms += 10;
+    }
+    result->lost_final_wakeups = CountBehind(slots, processes, final_count);
+    manager->DecrementWindowCount();
+  }
+
+  // Children that never saw Start leave through Stop as well.
+  SetEvent(stop);
+  for (size_t i = 0; i < children.size(); i++) {
+    DWORD exit_code = 1;
+    bool exited =
+        WaitForSingleObject(children[i], kChildExitTimeoutMs) ==
+            WAIT_OBJECT_0 &&
+        GetExitCodeProcess(children[i], &exit_code) && exit_code == 0;
+    if (result->started == processes &&
+        (!exited || ReadAcquire(&slots[i].state) != kChildDone)) {
+      result->failed_children++;
+    }
+    CloseHandle(children[i]);
+  }
+  Aggregate(slots, result);
+
+  // Children fold their counters into the retired slot as they exit
+  ipc_metrics::MetricsSnapshot metrics_after = {};
+  if (ipc_metrics::GetRegistry().Snapshot(&metrics_after)) {
+    result->spin_hits =
+        metrics_after.counters[ipc_metrics::kMetricSpinHits] -
+        metrics_before.counters[ipc_metrics::kMetricSpinHits];
+    result->spin_cores =
+        ipc_metrics::MetricsSnapshot::Rate(
+            metrics_before, metrics_after,
+            ipc_metrics::kMetricSpinNanoseconds) /
+        1e9;
+  }
+
+  if (job != nullptr) {
+    CloseHandle(job);  // Kills any child that did not exit
+  }
+  CloseHandle(stop);
+  CloseHandle(start);
+  CloseHandle(done);
+  CloseHandle(ready);
+  UnmapViewOfFile(header);
+  CloseHandle(mapping);
+  return true;
+}
+
+void PrintHeading() {
+  std::printf("%6s %8s %11s %9s %9s %9s %9s %9s %9s %9s %6s %6s  %s\n",
+              "PROCS", "STARTED", "CHANGES/S", "CHG_P50", "CHG_P99",
+              "CHG_MAX", "DLV_P50", "DLV_P99", "DLV_MAX", "WAKEUPS", "LOST",
+              "ERRORS", "RESULT");
+  std::printf("%6s %8s %11s %9s %9s %9s %9s %9s %9s %9s %6s %6s\n", "", "",
+              "", "(us)", "(us)", "(us)", "(us)", "(us)", "(us)", "", "", "");
+}
+
+void PrintRow(const RunResult& r) {
+  double rate = r.seconds > 0 ? static_cast<double>(r.changes) / r.seconds : 0;
+  int64_t errors = r.change_errors + r.range_errors + r.snapshot_failures +
+                   r.failed_children + (r.balanced ? 0 : 1);
+  std::printf(
+      "%6d %8d %11.0f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9lld %6d %6lld  "
+      "%s\n",
+      r.processes, r.started, rate,
+      Micros(Percentile(r.change_buckets, r.change_max, 0.50)),
+      Micros(Percentile(r.change_buckets, r.change_max, 0.99)),
+      Micros(r.change_max),
+      Micros(Percentile(r.delivery_buckets, r.delivery_max, 0.50)),
+      Micros(Percentile(r.delivery_buckets, r.delivery_max, 0.99)),
+      Micros(r.delivery_max), static_cast<long long>(r.wakeups),
+      r.lost_final_wakeups, static_cast<long long>(errors),
+      r.Ok() ? "ok" : "FAIL");
+  std::fflush(stdout);
+}
+
+void PrintSpinRow(const RunResult& r) {
+  std::printf("%6s spin hits %lld, %.2f cores spinning\n", "",
+              static_cast<long long>(r.spin_hits), r.spin_cores);
+  std::fflush(stdout);
+}
+
+bool WriteJson(const char* path, const Options& options,
+               const std::vector<RunResult>& results) {
+  FILE* file = std::fopen(path, "w");
+  if (file == nullptr) {
+    return false;
+  }
+  std::fprintf(file,
+               "{\n  \"rate\": %d,\n  \"duration_ms\": %d,\n"
+               "  \"script\": \"%s\",\n  \"spin\": %s,\n  \"runs\": [\n",
+               options.rate, options.duration_ms, options.script,
+               options.spin ? "true" : "false");
+  for (size_t i = 0; i < results.size(); i++) {
+    const RunResult& r = results[i];
+    std::fprintf(
+        file,
+        "    {\"processes\": %d, \"started\": %d, \"seconds\": %.3f, "
+        "\"steps\": %lld, \"changes\": %lld, \"wakeups\": %lld, "
+        "\"change_ns\": {\"p50\": %lld, \"p99\": %lld, \"p999\": %lld, "
+        "\"max\": %lld}, "
+        "\"delivery_ns\": {\"p50\": %lld, \"p99\": %lld, \"p999\": %lld, "
+        "\"max\": %lld}, "
+        "\"change_errors\": %lld, \"range_errors\": %lld, "
+        "\"snapshot_failures\": %lld, \"lost_final_wakeups\": %d, "
+        "\"failed_children\": %d, \"balanced\": %s, "
+        "\"spin_hits\": %lld, \"spin_cores\": %.3f, \"ok\": %s}%s\n",
+        r.processes, r.started, r.seconds, static_cast<long long>(r.steps),
+        static_cast<long long>(r.changes), static_cast<long long>(r.wakeups),
+        static_cast<long long>(
+            Percentile(r.change_buckets, r.change_max, 0.50)),
+        static_cast<long long>(
+            Percentile(r.change_buckets, r.change_max, 0.99)),
+        static_cast<long long>(
+            Percentile(r.change_buckets, r.change_max, 0.999)),
+        static_cast<long long>(r.change_max),
+        static_cast<long long>(
+            Percentile(r.delivery_buckets, r.delivery_max, 0.50)),
+        static_cast<long long>(
+            Percentile(r.delivery_buckets, r.delivery_max, 0.99)),
+        static_cast<long long>(
+            Percentile(r.delivery_buckets, r.delivery_max, 0.999)),
+        static_cast<long long>(r.delivery_max),
+        static_cast<long long>(r.change_errors),
+        static_cast<long long>(r.range_errors),
+        static_cast<long long>(r.snapshot_failures), r.lost_final_wakeups,
+        r.failed_children, r.balanced ? "true" : "false",
+        static_cast<long long>(r.spin_hits), r.spin_cores,
+        r.Ok() ? "true" : "false", i + 1 < results.size() ? "," : "");
+  }
+  std::fputs("  ]\n}\n", file);
+  return std::fclose(file) == 0;
+}
+
+bool ParseProcessCounts(const char* text, std::vector<int>* counts) {
+  counts->clear();
+  const char* cursor = text;
+  while (*cursor != '\0') {
+    char* end = nullptr;
+    long value = std::strtol(cursor, &end, 10);
+    if (end == cursor || value < 1 || (*end != ',' && *end != '\0')) {
+      return false;
+    }
+    counts->push_back(static_cast<int>(value));
+    cursor = *end == ',' ? end + 1 : end;
+  }
+  return !counts->empty();
+}
+
+void PrintUsage() {
+  std::fprintf(
+      stderr,
+      "Usage: ipc_stress [--processes <n,n,...>] [--rate <steps/s>]\n"
+      "                  [--duration <ms>] [--script <steps>] "
+      "[--json <file>]\n"
+      "                  [--spin]\n"
+      "  --processes <list>  Process counts to run (default 2 to 1000)\n"
+      "  --rate <n>          Script steps per second per child (default %d)\n"
+      "  --duration <ms>     Workload length (default %d)\n"
+      "  --script <steps>    Comma-separated open, close and notify steps\n"
+      "                      (default %s)\n"
+      "  --json <file>       Also write the results as JSON\n"
+      "  --spin              Children spin before blocking\n",
+      kDefaultRate, kDefaultDurationMs, kDefaultScript);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc > 1 && std::strcmp(argv[1], kChildFlag) == 0) {
+    return RunChild(argc, argv);
+  }
+
+  Options options;
+  options.process_counts.assign(std::begin(kDefaultProcessCounts),
+                                std::end(kDefaultProcessCounts));
+  for (int i = 1; i < argc; i++) {
+    bool has_value = i + 1 < argc;
+    if (std::strcmp(argv[i], "--processes") == 0 && has_value) {
+      if (!ParseProcessCounts(argv[++i], &options.process_counts)) {
+        PrintUsage();
+        return 2;
+      }
+    } else if (std::strcmp(argv[i], "--rate") == 0 && has_value) {
+      options.rate = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--duration") == 0 && has_value) {
+      options.duration_ms = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--script") == 0 && has_value) {
+      options.script = argv[++i];
+    } else if (std::strcmp(argv[i], "--json") == 0 && has_value) {
+      options.json_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--spin") == 0) {
+      options.spin = true;
+    } else {
+      PrintUsage();
+      return 2;
+    }
+  }
+
+  StressHeader config = {};
+  config.rate = options.rate;
+  config.duration_ms = options.duration_ms;
+  config.spin_wait = options.spin ? 1 : 0;
+  if (options.rate < 1 || options.duration_ms < 1 ||
+      !ParseScript(options.script, &config)) {
+    PrintUsage();
+    return 2;
+  }
+
+  char module_path[MAX_PATH];
+  if (GetModuleFileNameA(nullptr, module_path, MAX_PATH) == 0) {
+    std::fprintf(stderr, "GetModuleFileNameA failed: %lu\n",
+                 static_cast<unsigned long>(GetLastError()));
+    return 1;
+  }
+  SharedMemoryManager manager;
+  if (!manager.Initialize()) {
+    std::fprintf(stderr, "Failed to open the shared memory segment\n");
+    return 1;
+  }
+
+  std::printf("ipc_stress  script %s  rate %d/s  duration %d ms%s\n\n",
+              options.script, options.rate, options.duration_ms,
+              options.spin ? "  spin wait" : "");
+  PrintHeading();
+  std::vector<RunResult> results;
+  bool ok = true;
+  for (int processes : options.process_counts) {
+    RunResult result;
+    if (!RunOnce(options, config, module_path, &manager, processes, &result)) {
+      return 1;
+    }
+    PrintRow(result);
+    if (options.spin) {
+      PrintSpinRow(result);
+    }
+    ok = ok && result.Ok();
+    results.push_back(std::move(result));
+  }
+
+  if (options.json_path != nullptr &&
+      !WriteJson(options.json_path, options, results)) {
+    std::fprintf(stderr, "Failed to write %s\n", options.json_path);
+    return 1;
+  }
+  ipc_metrics::Shutdown();
+  ipc_log::Shutdown();
+  return ok ? 0 : 1;
+}
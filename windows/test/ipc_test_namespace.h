@@ -0,0 +1,41 @@
+// ipc_test_namespace.h
+//
+// Runs every test in its own IPC namespace (see runner/ipc_namespace.h), so
+// test binaries can run in parallel (ctest -j) and next to the app without
+// sharing the counter segment, the change event or the buffer pool.
+//
+// Each test starts with a fresh segment, but tests that run child processes
+// or open objects by name must still use the namespaced names, e.g.
+// SharedMemoryManager::shared_memory_name().
+//
+// Register in main() before RUN_ALL_TESTS():
+//   UseIpcTestNamespaces("SharedMemoryManagerTest");
+
+#ifndef TEST_IPC_TEST_NAMESPACE_H_
+#define TEST_IPC_TEST_NAMESPACE_H_
+
+#include <gtest/gtest.h>
+
+#include "ipc_namespace.h"
+
+// Switches the process default namespace to a unique one as each test
+// starts, before its fixture is constructed.
+class IpcTestNamespaceListener : public ::testing::EmptyTestEventListener {
+ public:
+  explicit IpcTestNamespaceListener(const char* prefix) : prefix_(prefix) {}
+
+  void OnTestStart(const ::testing::TestInfo& /* test_info */) override {
+    ipc_namespace::SetDefault(ipc_namespace::MakeUnique(prefix_));
+  }
+
+ private:
+  const char* prefix_;
+};
+
+// Installs the listener; gtest takes ownership.
+inline void UseIpcTestNamespaces(const char* prefix) {
+  ::testing::UnitTest::GetInstance()->listeners().Append(
+      new IpcTestNamespaceListener(prefix));
+}
+
+#endif  // TEST_IPC_TEST_NAMESPACE_H_
@@ -0,0 +1,506 @@
+// ipc_topic_bench.cpp
+//
+// Wakeup cost of broadcast versus topic-targeted notifications.
+//
+// Starts N child processes, each a window that cares about one of T topics
+// (child i watches topic i % T), and publishes every topic in turn through
+// IpcTopicBoard. It runs twice:
+//   - broadcast: every child registers interest in all T topics, so every
+//     publish wakes every child, as the one shared change event does
+//   - targeted: every child registers interest in its own topic only, so a
+//     publish wakes the N / T children watching it
+// and reports, per mode, the processes the publishes woke, the wakeups per
+// publish and the CPU time the children spent (user and kernel, from
+// GetProcessTimes over the publishing phase).
+//
+// Each publish waits until every child watching the topic has seen it, so
+// publishes never collapse into one wakeup and the counts are exact.
+//
+// Children are this executable started with --child <name> <index>. They
+// run in a private IPC namespace, so the benchmark can run next to the app.
+//
+// Usage:
+//   ipc_topic_bench                    100 processes, 10 topics
+//   ipc_topic_bench --processes 200    Child processes
+//   ipc_topic_bench --topics 20        Topics the children are spread over
+//   ipc_topic_bench --publishes 5000   Publishes per mode
+//   ipc_topic_bench --json <file>      Also write the results as JSON
+//
+// The exit code is 1 if a child failed or a publish did not reach every
+// child watching its topic.
+
+#include <windows.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ipc_log.h"
+#include "ipc_metrics.h"
+#include "ipc_namespace.h"
+#include "ipc_topic_board.h"
+
+namespace {
+
+constexpr char kChildFlag[] = "--child";
+constexpr DWORD kBenchMagic = 0x48434E42;  // 'BNCH'
+
+constexpr int kDefaultProcesses = 100;
+constexpr int kDefaultTopics = 10;
+constexpr int kDefaultPublishes = 1000;
+
+// How long the parent waits for each child to report ready.
+constexpr DWORD kChildReadyTimeoutMs = 30000;
+// How long one publish may take to reach every child watching the topic.
+constexpr DWORD kDeliveryTimeoutMs = 2000;
+// How long a child may take to exit once told to stop.
+constexpr DWORD kChildExitTimeoutMs = 10000;
+
+enum Mode : LONG {
+  kModeBroadcast = 0,
+  kModeTargeted = 1,
+};
+
+const char* ModeName(Mode mode) {
+  return mode == kModeBroadcast ? "broadcast" : "targeted";
+}
+
+// Run configuration, written by the parent before it starts any child.
+struct BenchHeader {
+  DWORD magic;
+  LONG processes;
+  LONG topics;
+  LONG mode;
+};
+
+// Results of one child, written only by that child's reactor thread.
+struct alignas(64) BenchSlot {
+  volatile LONG ready;
+  volatile LONG64 wakeups;  // Callbacks, one per woken publish
+  volatile LONG64 useful;   // Callbacks for the child's own topic
+};
+
+std::string ResultsName(const std::string& name) {
+  return name + ".Results";
+}
+
+size_t ResultsSize(int processes) {
+  return sizeof(BenchHeader) + processes * sizeof(BenchSlot);
+}
+
+int64_t FiletimeTo100ns(const FILETIME& time) {
+  return (static_cast<int64_t>(time.dwHighDateTime) << 32) |
+         time.dwLowDateTime;
+}
+
+// User plus kernel time of a process, in 100 ns units.
+int64_t ProcessCpuTime(HANDLE process) {
+  FILETIME creation, exit, kernel, user;
+  if (!GetProcessTimes(process, &creation, &exit, &kernel, &user)) {
+    return 0;
+  }
+  return FiletimeTo100ns(kernel) + FiletimeTo100ns(user);
+}
+
+// ============================================================================
+// Child
+// ============================================================================
+
+int RunChild(int argc, char* argv[]) {
+  if (argc < 4) {
+    return 2;
+  }
+  std::string name = argv[2];
+  int index = std::atoi(argv[3]);
+
+  HANDLE mapping =
+      OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, ResultsName(name).c_str());
+  HANDLE ready =
+      OpenSemaphoreA(SEMAPHORE_MODIFY_STATE, FALSE, (name + ".Ready").c_str());
+  HANDLE seen =
+      OpenSemaphoreA(SEMAPHORE_MODIFY_STATE, FALSE, (name + ".Seen").c_str());
+  HANDLE stop = OpenEventA(SYNCHRONIZE, FALSE, (name + ".Stop").c_str());
+  if (mapping == nullptr || ready == nullptr || seen == nullptr ||
+      stop == nullptr) {
+    return 1;  // The parent times out waiting for this child
+  }
+  auto* header = static_cast<BenchHeader*>(
+      MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+  if (header == nullptr || header->magic != kBenchMagic || index < 0 ||
+      index >= header->processes) {
+    return 1;
+  }
+  BenchSlot* slot = reinterpret_cast<BenchSlot*>(header + 1) + index;
+  uint32_t own_topic = static_cast<uint32_t>(index % header->topics);
+  uint32_t mask = IpcTopicBit(own_topic);
+  if (header->mode == kModeBroadcast) {
+    mask = header->topics == static_cast<LONG>(kMaxIpcTopics)
+               ? 0xFFFFFFFFu
+               : (1u << header->topics) - 1;
+  }
+
+  int exit_code = 0;
+  {
+    std::shared_ptr<IpcTopicBoard> board = IpcTopicBoard::Acquire();
+    IpcTopicBoard::SubscriptionId id = IpcTopicBoard::kInvalidSubscription;
+    if (board) {
+      id = board->Subscribe(mask, [slot, seen, own_topic](uint32_t topic,
+                                                          LONG) {
+        InterlockedIncrement64(&slot->wakeups);
+        if (topic == own_topic) {
+          InterlockedIncrement64(&slot->useful);
+          ReleaseSemaphore(seen, 1, nullptr);
+        }
+      });
+    }
+    bool ok = id != IpcTopicBoard::kInvalidSubscription;
+    InterlockedExchange(&slot->ready, ok ? 1 : 0);
+    ReleaseSemaphore(ready, 1, nullptr);  // Even on failure: never hang
+
+    if (ok) {
+      WaitForSingleObject(stop, INFINITE);
+      board->Unsubscribe(id);
+    } else {
+      exit_code = 1;
+    }
+  }
+
+  UnmapViewOfFile(header);
+  CloseHandle(mapping);
+  CloseHandle(ready);
+  CloseHandle(seen);
+  CloseHandle(stop);
+  ipc_metrics::Shutdown();
+  ipc_log::Shutdown();
+  return exit_code;
+}
+
+// ============================================================================
+// Parent
+// ============================================================================
+
+struct Options {
+  int processes = kDefaultProcesses;
+  int topics = kDefaultTopics;
+  int publishes = kDefaultPublishes;
+  const char* json_path = nullptr;
+};
+
+struct ModeResult {
+  Mode mode = kModeBroadcast;
+  int started = 0;          // Children that subscribed
+  int lost = 0;             // Publishes not seen by every watcher in time
+  int failed_children = 0;  // Did not exit cleanly
+  double seconds = 0;
+  int64_t signaled = 0;     // Processes signaled (topics.wakeups)
+  int64_t wakeups = 0;      // Child callbacks
+  int64_t useful = 0;       // Callbacks for the child's own topic
+  int64_t cpu_100ns = 0;    // Children's CPU time while publishing
+
+  bool Ok(const Options& options) const {
+    return started == options.processes && lost == 0 &&
+           failed_children == 0;
+  }
+};
+
+// Children die with the job if the benchmark exits or crashes mid-run.
+HANDLE CreateKillOnCloseJob() {
+  HANDLE job = CreateJobObjectA(nullptr, nullptr);
+  if (job == nullptr) {
+    return nullptr;
+  }
+  JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits = {};
+  limits.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+  SetInformationJobObject(job, JobObjectExtendedLimitInformation, &limits,
+                          sizeof(limits));
+  return job;
+}
+
+// Starts one child suspended, adds it to the job, then lets it run.
+HANDLE SpawnChild(const char* module_path, const std::string& name, int index,
+                  HANDLE job) {
+  std::string command = std::string("\"") + module_path + "\" " + kChildFlag +
+                        " " + name + " " + std::to_string(index);
+  STARTUPINFOA startup = {};
+  startup.cb = sizeof(startup);
+  PROCESS_INFORMATION info = {};
+  if (!CreateProcessA(nullptr, &command[0], nullptr, nullptr, FALSE,
+                      CREATE_SUSPENDED | CREATE_NO_WINDOW, nullptr, nullptr,
+                      &startup, &info)) {
+    return nullptr;
+  }
+  if (job != nullptr) {
+    AssignProcessToJobObject(job, info.hProcess);
+  }
+  ResumeThread(info.hThread);
+  CloseHandle(info.hThread);
+  return info.hProcess;
+}
+
+int64_t TopicWakeups() {
+  ipc_metrics::MetricsSnapshot snapshot = {};
+  ipc_metrics::GetRegistry().Snapshot(&snapshot);
+  return snapshot.counters[ipc_metrics::kMetricTopicWakeups];
+}
+
+bool RunMode(const Options& options, const char* module_path,
+             IpcTopicBoard* board, Mode mode, ModeResult* result) {
+  result->mode = mode;
+  std::string name = "Local\\IpcTopicBench." +
+                     std::to_string(GetCurrentProcessId()) + "." +
+                     ModeName(mode);
+
+  size_t size = ResultsSize(options.processes);
+  HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr,
+                                      PAGE_READWRITE, 0,
+                                      static_cast<DWORD>(size),
+                                      ResultsName(name).c_str());
+  if (mapping == nullptr) {
+    std::fprintf(stderr, "CreateFileMappingA failed: %lu\n",
+                 static_cast<unsigned long>(GetLastError()));
+    return false;
+  }
+  auto* header = static_cast<BenchHeader*>(
+      MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size));
+  if (header == nullptr) {
+    std::fprintf(stderr, "MapViewOfFile failed: %lu\n",
+                 static_cast<unsigned long>(GetLastError()));
+    CloseHandle(mapping);
+    return false;
+  }
+  BenchSlot* slots = reinterpret_cast<BenchSlot*>(header + 1);
+  header->processes = options.processes;
+  header->topics = options.topics;
+  header->mode = mode;
+  header->magic = kBenchMagic;
+
+  HANDLE ready = CreateSemaphoreA(nullptr, 0, options.processes,
+                                  (name + ".Ready").c_str());
+  HANDLE seen = CreateSemaphoreA(nullptr, 0, options.processes,
+                                 (name + ".Seen").c_str());
+  HANDLE stop = CreateEventA(nullptr, TRUE, FALSE, (name + ".Stop").c_str());
+  HANDLE job = CreateKillOnCloseJob();
+
+  std::vector<HANDLE> children;
+  for (int i = 0; i < options.processes; i++) {
+    HANDLE child = SpawnChild(module_path, name, i, job);
+    if (child == nullptr) {
+      std::fprintf(stderr, "CreateProcessA failed for child %d: %lu\n", i,
+                   static_cast<unsigned long>(GetLastError()));
+      break;
+    }
+    children.push_back(child);
+  }
+  for (size_t i = 0; i < children.size(); i++) {
+    if (WaitForSingleObject(ready, kChildReadyTimeoutMs) != WAIT_OBJECT_0) {
+      break;
+    }
+  }
+  for (size_t i = 0; i < children.size(); i++) {
+    result->started += ReadAcquire(&slots[i].ready) ? 1 : 0;
+  }
+
+  if (result->started == options.processes) {
+    // Children watching each topic: the releases one publish must collect.
+    std::vector<int> watchers(options.topics, 0);
+    for (int i = 0; i < options.processes; i++) {
+      watchers[i % options.topics]++;
+    }
+
+    int64_t cpu_before = 0;
+    for (HANDLE child : children) {
+      cpu_before += ProcessCpuTime(child);
+    }
+    int64_t signaled_before = TopicWakeups();
+    LARGE_INTEGER frequency, begin, end;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&begin);
+
+    for (int p = 0; p < options.publishes; p++) {
+      uint32_t topic = static_cast<uint32_t>(p % options.topics);
+      board->Publish(topic);
+      for (int w = 0; w < watchers[topic]; w++) {
+        if (WaitForSingleObject(seen, kDeliveryTimeoutMs) != WAIT_OBJECT_0) {
+          result->lost++;
+          break;
+        }
+      }
+    }
+
+    QueryPerformanceCounter(&end);
+    result->seconds = static_cast<double>(end.QuadPart - begin.QuadPart) /
+                      static_cast<double>(frequency.QuadPart);
+    result->signaled = TopicWakeups() - signaled_before;
+    for (HANDLE child : children) {
+      result->cpu_100ns += ProcessCpuTime(child);
+    }
+    result->cpu_100ns -= cpu_before;
+  }
+
+  SetEvent(stop);
+  for (size_t i = 0; i < children.size(); i++) {
+    DWORD exit_code = 1;
+    bool exited =
+        WaitForSingleObject(children[i], kChildExitTimeoutMs) ==
+            WAIT_OBJECT_0 &&
+        GetExitCodeProcess(children[i], &exit_code) && exit_code == 0;
+    if (!exited) {
+      result->failed_children++;
+    }
+    CloseHandle(children[i]);
+  }
+  for (int i = 0; i < options.processes; i++) {
+    result->wakeups += slots[i].wakeups;
+    result->useful += slots[i].useful;
+  }
+
+  if (job != nullptr) {
+    CloseHandle(job);  // Kills any child that did not exit
+  }
+  CloseHandle(stop);
+  CloseHandle(seen);
+  CloseHandle(ready);
+  UnmapViewOfFile(header);
+  CloseHandle(mapping);
+  return true;
+}
+
+double PerPublish(const Options& options, double value) {
+  return options.publishes > 0 ? value / options.publishes : 0;
+}
+
+void PrintHeading() {
+  std::printf("%-10s %8s %9s %10s %10s %10s %11s %11s  %s\n", "MODE",
+              "STARTED", "SIGNALED", "WAKEUPS", "WAKE/PUB", "CPU_MS",
+              "CPU_US/PUB", "WALL_MS", "RESULT");
+}
+
+void PrintRow(const Options& options, const ModeResult& r) {
+  double cpu_ms = static_cast<double>(r.cpu_100ns) / 1e4;
+  std::printf("%-10s %8d %9lld %10lld %10.1f %10.1f %11.1f %11.1f  %s\n",
+              ModeName(r.mode), r.started, static_cast<long long>(r.signaled),
+              static_cast<long long>(r.wakeups),
+              PerPublish(options, static_cast<double>(r.wakeups)), cpu_ms,
+              PerPublish(options, cpu_ms * 1000.0), r.seconds * 1000.0,
+              r.Ok(options) ? "ok" : "FAIL");
+  std::fflush(stdout);
+}
+
+bool WriteJson(const char* path, const Options& options,
+               const std::vector<ModeResult>& results) {
+  FILE* file = std::fopen(path, "w");
+  if (file == nullptr) {
+    return false;
+  }
+  std::fprintf(file,
+               "{\n  \"processes\": %d,\n  \"topics\": %d,\n"
+               "  \"publishes\": %d,\n  \"modes\": [\n",
+               options.processes, options.topics, options.publishes);
+  for (size_t i = 0; i < results.size(); i++) {
+    const ModeResult& r = results[i];
+    std::fprintf(
+        file,
+        "    {\"mode\": \"%s\", \"started\": %d, \"seconds\": %.3f, "
+        "\"signaled\": %lld, \"wakeups\": %lld, \"useful\": %lld, "
+        "\"cpu_ns\": %lld, \"lost\": %d, \"failed_children\": %d, "
+        "\"ok\": %s}%s\n",
+        ModeName(r.mode), r.started, r.seconds,
+        static_cast<long long>(r.signaled), static_cast<long long>(r.wakeups),
+        static_cast<long long>(r.useful),
+        static_cast<long long>(r.cpu_100ns * 100), r.lost, r.failed_children,
+        r.Ok(options) ? "true" : "false", i + 1 < results.size() ? "," : "");
+  }
+  std::fputs("  ]\n}\n", file);
+  return std::fclose(file) == 0;
+}
+
+void PrintUsage() {
+  std::fprintf(
+      stderr,
+      "Usage: ipc_topic_bench [--processes <n>] [--topics <n>]\n"
+      "                       [--publishes <n>] [--json <file>]\n"
+      "  --processes <n>  Child processes (default %d, at most %lu)\n"
+      "  --topics <n>     Topics the children watch (default %d, at most "
+      "%u)\n"
+      "  --publishes <n>  Publishes per mode (default %d)\n"
+      "  --json <file>    Also write the results as JSON\n",
+      kDefaultProcesses,
+      static_cast<unsigned long>(kMaxIpcTopicProcesses - 1), kDefaultTopics,
+      kMaxIpcTopics, kDefaultPublishes);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc > 1 && std::strcmp(argv[1], kChildFlag) == 0) {
+    return RunChild(argc, argv);
+  }
+
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    bool has_value = i + 1 < argc;
+    if (std::strcmp(argv[i], "--processes") == 0 && has_value) {
+      options.processes = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--topics") == 0 && has_value) {
+      options.topics = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--publishes") == 0 && has_value) {
+      options.publishes = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--json") == 0 && has_value) {
+      options.json_path = argv[++i];
+    } else {
+      PrintUsage();
+      return 2;
+    }
+  }
+  // One slot stays free for this process
+  if (options.processes < 1 ||
+      options.processes >= static_cast<int>(kMaxIpcTopicProcesses) ||
+      options.topics < 1 || options.topics > static_cast<int>(kMaxIpcTopics) ||
+      options.topics > options.processes || options.publishes < 1) {
+    PrintUsage();
+    return 2;
+  }
+
+  char module_path[MAX_PATH];
+  if (GetModuleFileNameA(nullptr, module_path, MAX_PATH) == 0) {
+    std::fprintf(stderr, "GetModuleFileNameA failed: %lu\n",
+                 static_cast<unsigned long>(GetLastError()));
+    return 1;
+  }
+  // Private instance; children inherit it through the environment.
+  ipc_namespace::SetDefault(ipc_namespace::MakeUnique("IpcTopicBench"));
+  std::shared_ptr<IpcTopicBoard> board = IpcTopicBoard::Acquire();
+  if (!board) {
+    std::fprintf(stderr, "Failed to open the topic board\n");
+    return 1;
+  }
+
+  std::printf("ipc_topic_bench  %d processes  %d topics  %d publishes\n\n",
+              options.processes, options.topics, options.publishes);
+  PrintHeading();
+  std::vector<ModeResult> results;
+  bool ok = true;
+  for (Mode mode : {kModeBroadcast, kModeTargeted}) {
+    ModeResult result;
+    if (!RunMode(options, module_path, board.get(), mode, &result)) {
+      return 1;
+    }
+    PrintRow(options, result);
+    ok = ok && result.Ok(options);
+    results.push_back(result);
+  }
+
+  if (options.json_path != nullptr &&
+      !WriteJson(options.json_path, options, results)) {
+    std::fprintf(stderr, "Failed to write %s\n", options.json_path);
+    return 1;
+  }
+  board.reset();
+  ipc_metrics::Shutdown();
+  ipc_log::Shutdown();
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,291 @@
+// ipc_topic_board_test.cpp
+//
+// Google Test unit tests for IpcTopicBoard, the topic-aware wakeup board.
+//
+// Other window processes are stood in for by slots planted in the board
+// section with process IDs no process has: a publish marks their pending
+// topics exactly as for a live process, and their wake event simply does
+// not exist.
+
+#include <gtest/gtest.h>
+#include <windows.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "ipc_metrics.h"
+#include "ipc_namespace.h"
+#include "ipc_test_namespace.h"
+#include "ipc_topic_board.h"
+
+namespace {
+
+constexpr LONG kExitedProcess = 0x7FFFFFF0;
+
+template <typename T>
+bool WaitFor(const std::atomic<T>& value, T expected) {
+  for (int i = 0; i < 200 && value.load() != expected; i++) {
+    Sleep(5);
+  }
+  return value.load() == expected;
+}
+
+int64_t Counter(ipc_metrics::Counter counter) {
+  ipc_metrics::MetricsSnapshot snapshot{};
+  ipc_metrics::GetRegistry().Snapshot(&snapshot);
+  return snapshot.counters[counter];
+}
+
+}  // namespace
+
+class IpcTopicBoardTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    board_ = IpcTopicBoard::Acquire();
+    ASSERT_NE(nullptr, board_);
+    // A second mapping of the same section, as another process sees it
+    mapping_ = OpenFileMappingA(
+        FILE_MAP_ALL_ACCESS, FALSE,
+        ipc_namespace::Qualify(kIpcTopicBoardName).c_str());
+    ASSERT_NE(nullptr, mapping_);
+    header_ = static_cast<IpcTopicBoardHeader*>(
+        MapViewOfFile(mapping_, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+    ASSERT_NE(nullptr, header_);
+  }
+
+  void TearDown() override {
+    board_.reset();
+    if (header_ != nullptr) {
+      UnmapViewOfFile(header_);
+    }
+    if (mapping_ != nullptr) {
+      CloseHandle(mapping_);
+    }
+  }
+
+  // Claims a free slot for a process that is not running.
+  IpcTopicSlot* PlantProcess(LONG pid, uint32_t interest) {
+    for (DWORD i = 0; i < kMaxIpcTopicProcesses; i++) {
+      if (InterlockedCompareExchange(&header_->slots[i].pid, pid, 0) == 0) {
+        header_->slots[i].interest = static_cast<LONG>(interest);
+        return &header_->slots[i];
+      }
+    }
+    return nullptr;
+  }
+
+  std::shared_ptr<IpcTopicBoard> board_;
+  HANDLE mapping_ = nullptr;
+  IpcTopicBoardHeader* header_ = nullptr;
+};
+
+//==============================================================================
+// Test Suite 1: Publishing
+//==============================================================================
+
+TEST_F(IpcTopicBoardTest, Publish_BumpsTopicSequence) {
+  EXPECT_EQ(1, board_->Publish(3));
+  EXPECT_EQ(2, board_->Publish(3));
+  EXPECT_EQ(2, board_->GetSequence(3));
+  EXPECT_EQ(0, board_->GetSequence(4));
+  EXPECT_EQ(2, header_->sequences[3]);  // Visible to every process
+
+  EXPECT_EQ(-1, board_->Publish(kMaxIpcTopics));
+}
+
+TEST_F(IpcTopicBoardTest, Publish_WakesOnlyInterestedProcesses) {
+  IpcTopicSlot* one = PlantProcess(kExitedProcess, IpcTopicBit(1));
+  IpcTopicSlot* two = PlantProcess(kExitedProcess - 1, IpcTopicBit(2));
+  ASSERT_NE(nullptr, one);
+  ASSERT_NE(nullptr, two);
+  int64_t wakeups_before = Counter(ipc_metrics::kMetricTopicWakeups);
+
+  board_->Publish(1);
+  EXPECT_EQ(static_cast<LONG>(IpcTopicBit(1)), one->pending);
+  EXPECT_EQ(0, two->pending);
+  EXPECT_EQ(wakeups_before + 1, Counter(ipc_metrics::kMetricTopicWakeups));
+
+  board_->Publish(5);  // Nobody listens
+  EXPECT_EQ(static_cast<LONG>(IpcTopicBit(1)), one->pending);
+  EXPECT_EQ(0, two->pending);
+  EXPECT_EQ(wakeups_before + 1, Counter(ipc_metrics::kMetricTopicWakeups));
+}
+
+TEST_F(IpcTopicBoardTest, Publish_PendingProcessNotSignaledAgain) {
+  IpcTopicSlot* slot =
+      PlantProcess(kExitedProcess, IpcTopicBit(1) | IpcTopicBit(2));
+  ASSERT_NE(nullptr, slot);
+  int64_t wakeups_before = Counter(ipc_metrics::kMetricTopicWakeups);
+
+  board_->Publish(1);
+  board_->Publish(1);
+  board_->Publish(2);
+  EXPECT_EQ(static_cast<LONG>(IpcTopicBit(1) | IpcTopicBit(2)),
+            slot->pending);
+  EXPECT_EQ(wakeups_before + 1, Counter(ipc_metrics::kMetricTopicWakeups));
+}
+
+//==============================================================================
+// Test Suite 2: Subscriptions
+//==============================================================================
+
+TEST_F(IpcTopicBoardTest, Subscribe_CalledForItsTopicsOnly) {
+  std::atomic<int> calls{0};
+  std::atomic<LONG> last_sequence{0};
+  IpcTopicBoard::SubscriptionId id =
+      board_->Subscribe(IpcTopicBit(4), [&](uint32_t topic, LONG sequence) {
+        EXPECT_EQ(4u, topic);
+        last_sequence = sequence;
+        calls++;
+      });
+  ASSERT_NE(IpcTopicBoard::kInvalidSubscription, id);
+
+  board_->Publish(6);
+  board_->Publish(4);
+  ASSERT_TRUE(WaitFor(calls, 1));
+  EXPECT_EQ(1, last_sequence.load());
+  Sleep(50);
+  EXPECT_EQ(1, calls.load());
+  board_->Unsubscribe(id);
+}
+
+TEST_F(IpcTopicBoardTest, Interest_IsUnionOfSubscriptions) {
+  auto first = board_->Subscribe(IpcTopicBit(1), [](uint32_t, LONG) {});
+  auto second = board_->Subscribe(IpcTopicBit(1) | IpcTopicBit(7),
+                                  [](uint32_t, LONG) {});
+  EXPECT_EQ(IpcTopicBit(1) | IpcTopicBit(7), board_->GetInterest());
+
+  board_->Unsubscribe(second);
+  EXPECT_EQ(IpcTopicBit(1), board_->GetInterest());
+
+  // Every user in the process shares the board and its slot
+  std::shared_ptr<IpcTopicBoard> other = IpcTopicBoard::Acquire();
+  EXPECT_EQ(board_.get(), other.get());
+  board_->Unsubscribe(first);
+  EXPECT_EQ(0u, board_->GetInterest());
+  EXPECT_EQ(IpcTopicBoard::kInvalidSubscription,
+            board_->Subscribe(0, [](uint32_t, LONG) {}));
+}
+
+TEST_F(IpcTopicBoardTest, Unsubscribe_StopsWakingProcess) {
+  std::atomic<int> calls{0};
+  auto id = board_->Subscribe(IpcTopicBit(2),
+                              [&](uint32_t, LONG) { calls++; });
+  board_->Publish(2);
+  ASSERT_TRUE(WaitFor(calls, 1));
+  board_->Unsubscribe(id);
+  int64_t wakeups_before = Counter(ipc_metrics::kMetricTopicWakeups);
+
+  board_->Publish(2);
+  Sleep(50);
+  EXPECT_EQ(1, calls.load());
+  EXPECT_EQ(wakeups_before, Counter(ipc_metrics::kMetricTopicWakeups));
+}
+
+TEST_F(IpcTopicBoardTest, Subscribe_FullTable_ReclaimsSlotOfExitedProcess) {
+  for (DWORD i = 0; i < kMaxIpcTopicProcesses; i++) {
+    ASSERT_NE(nullptr, PlantProcess(kExitedProcess - static_cast<LONG>(i),
+                                    IpcTopicBit(3)));
+  }
+  std::atomic<int> calls{0};
+  auto id = board_->Subscribe(IpcTopicBit(5),
+                              [&](uint32_t, LONG) { calls++; });
+  ASSERT_NE(IpcTopicBoard::kInvalidSubscription, id);
+
+  // The reclaimed slot lost the exited owner's interest
+  EXPECT_EQ(IpcTopicBit(5), board_->GetInterest());
+  board_->Publish(5);
+  EXPECT_TRUE(WaitFor(calls, 1));
+  board_->Unsubscribe(id);
+}
+
+TEST_F(IpcTopicBoardTest, Subscriber_MayUnsubscribeItselfAndOthers) {
+  std::atomic<int> first_calls{0};
+  std::atomic<int> second_calls{0};
+  IpcTopicBoard::SubscriptionId first = IpcTopicBoard::kInvalidSubscription;
+  IpcTopicBoard::SubscriptionId second = IpcTopicBoard::kInvalidSubscription;
+  // Subscribers run in order; the first removes both before the second
+  first = board_->Subscribe(IpcTopicBit(8), [&](uint32_t, LONG) {
+    board_->Unsubscribe(second);
+    board_->Unsubscribe(first);
+    first_calls++;
+  });
+  second = board_->Subscribe(IpcTopicBit(8),
+                             [&](uint32_t, LONG) { second_calls++; });
+  ASSERT_NE(IpcTopicBoard::kInvalidSubscription, second);
+
+  board_->Publish(8);
+  ASSERT_TRUE(WaitFor(first_calls, 1));
+  board_->Publish(8);
+  Sleep(50);
+  EXPECT_EQ(1, first_calls.load());
+  EXPECT_EQ(0, second_calls.load());
+  EXPECT_EQ(0u, board_->GetInterest());
+}
+
+//==============================================================================
+// Test Suite 3: Opening
+//==============================================================================
+
+TEST(IpcTopicBoardOpenTest, Acquire_WaitsForCreatorToInitialize) {
+  // A creator that has mapped the section but not yet written the header
+  std::string ipc_namespace = ipc_namespace::GetDefault() + ".Opening";
+  HANDLE mapping = CreateFileMappingA(
+      INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0,
+      sizeof(IpcTopicBoardHeader),
+      ipc_namespace::Qualify(kIpcTopicBoardName, ipc_namespace).c_str());
+  ASSERT_NE(nullptr, mapping);
+  auto* header = static_cast<IpcTopicBoardHeader*>(
+      MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+  ASSERT_NE(nullptr, header);
+
+  std::thread creator([header] {
+    Sleep(20);
+    header->layout_version = kIpcTopicBoardLayoutVersion;
+    header->topic_count = kMaxIpcTopics;
+    header->slot_count = kMaxIpcTopicProcesses;
+    MemoryBarrier();
+    header->magic = 0x43504F54;  // 'TOPC'
+  });
+  std::shared_ptr<IpcTopicBoard> board = IpcTopicBoard::Acquire(ipc_namespace);
+  creator.join();
+  EXPECT_NE(nullptr, board);
+
+  board.reset();
+  UnmapViewOfFile(header);
+  CloseHandle(mapping);
+}
+
+TEST(IpcTopicBoardOpenTest, Acquire_LayoutMismatch_FailsAndCanRetry) {
+  std::string ipc_namespace = ipc_namespace::GetDefault() + ".Mismatch";
+  HANDLE mapping = CreateFileMappingA(
+      INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0,
+      sizeof(IpcTopicBoardHeader),
+      ipc_namespace::Qualify(kIpcTopicBoardName, ipc_namespace).c_str());
+  ASSERT_NE(nullptr, mapping);
+  auto* header = static_cast<IpcTopicBoardHeader*>(
+      MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+  ASSERT_NE(nullptr, header);
+  header->layout_version = kIpcTopicBoardLayoutVersion + 1;
+  header->topic_count = kMaxIpcTopics;
+  header->slot_count = kMaxIpcTopicProcesses;
+  header->magic = 0x43504F54;  // 'TOPC'
+
+  // The failed board is torn down without deadlocking on the registry
+  EXPECT_EQ(nullptr, IpcTopicBoard::Acquire(ipc_namespace));
+  EXPECT_EQ(nullptr, IpcTopicBoard::Acquire(ipc_namespace));
+
+  header->layout_version = kIpcTopicBoardLayoutVersion;
+  EXPECT_NE(nullptr, IpcTopicBoard::Acquire(ipc_namespace));
+
+  UnmapViewOfFile(header);
+  CloseHandle(mapping);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  UseIpcTestNamespaces("IpcTopicBoardTest");
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,219 @@
+// ipc_trace_test.cpp
+//
+// Google Test unit tests for the cross-process latency trace (ipc_trace)
+//
+// Recorder tests use their own ring names so they never see stages recorded
+// by other tests through the global recorder.
+
+#include <gtest/gtest.h>
+#include <windows.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "ipc_trace.h"
+
+namespace {
+
+std::string RingName(const char* test) {
+  return std::string("Local\\IpcTraceTest.") + test + "." +
+         std::to_string(GetCurrentProcessId());
+}
+
+size_t CountOf(const std::string& text, const std::string& needle) {
+  size_t count = 0;
+  for (size_t pos = text.find(needle); pos != std::string::npos;
+       pos = text.find(needle, pos + 1)) {
+    count++;
+  }
+  return count;
+}
+
+ipc_trace::TraceEvent MakeEvent(uint32_t trace_id, ipc_trace::Stage stage,
+                                DWORD pid, int64_t start, uint32_t duration) {
+  ipc_trace::TraceEvent event;
+  event.trace_id = trace_id;
+  event.stage = stage;
+  event.process_id = pid;
+  event.thread_id = 1;
+  event.start_ticks = start;
+  event.duration_ticks = duration;
+  return event;
+}
+
+}  // namespace
+
+//==============================================================================
+// Test Suite 1: Recording
+//==============================================================================
+
+TEST(IpcTraceTest, Record_CollectReturnsEventInOrder) {
+  ipc_trace::TraceRecorder recorder(RingName("Order"), 64);
+  ASSERT_TRUE(recorder.Open());
+
+  recorder.Record(ipc_trace::kStageEventSignal, 5, 200, 260);
+  recorder.Record(ipc_trace::kStageCounterWrite, 5, 100, 150);
+
+  std::vector<ipc_trace::TraceEvent> events = recorder.Collect();
+  ASSERT_EQ(2u, events.size());
+  EXPECT_EQ(ipc_trace::kStageCounterWrite, events[0].stage);
+  EXPECT_EQ(100, events[0].start_ticks);
+  EXPECT_EQ(50u, events[0].duration_ticks);
+  EXPECT_EQ(5u, events[0].trace_id);
+  EXPECT_EQ(GetCurrentProcessId(), events[0].process_id);
+  EXPECT_EQ(GetCurrentThreadId(), events[0].thread_id);
+  EXPECT_EQ(ipc_trace::kStageEventSignal, events[1].stage);
+}
+
+TEST(IpcTraceTest, Record_WithoutOpen_DoesNothing) {
+  ipc_trace::TraceRecorder recorder(RingName("Closed"), 64);
+  recorder.Record(ipc_trace::kStageCallback, 1, 0, 1);
+  EXPECT_TRUE(recorder.Collect().empty());
+}
+
+TEST(IpcTraceTest, Record_RingFull_KeepsNewestEvents) {
+  ipc_trace::TraceRecorder recorder(RingName("Wrap"), 8);
+  ASSERT_TRUE(recorder.Open());
+
+  for (uint32_t i = 1; i <= 20; i++) {
+    recorder.Record(ipc_trace::kStageDartPost, i, i, i);
+  }
+
+  std::vector<ipc_trace::TraceEvent> events = recorder.Collect();
+  ASSERT_EQ(8u, events.size());
+  EXPECT_EQ(13u, events.front().trace_id);
+  EXPECT_EQ(20u, events.back().trace_id);
+  EXPECT_EQ(0, recorder.GetDroppedCount());
+}
+
+TEST(IpcTraceTest, WriterDiedMidRecord_SlotTakenOverNextLap) {
+  const uint32_t kCapacity = 8;
+  ipc_trace::TraceRecorder recorder(RingName("DeadWriter"), kCapacity);
+  ASSERT_TRUE(recorder.Open());
+
+  // A writer claims span 0 and dies before publishing it.
+  HANDLE mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE,
+                                    RingName("DeadWriter").c_str());
+  ASSERT_NE(nullptr, mapping);
+  auto* header = static_cast<ipc_trace::TraceRingHeader*>(
+      MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+  ASSERT_NE(nullptr, header);
+  auto* slots = reinterpret_cast<ipc_trace::TraceSlot*>(header + 1);
+  InterlockedIncrement(&header->write_index);
+  InterlockedExchange(&slots[0].sequence, 1);  // Odd, lap of span 0
+
+  // Spans 1..8; span 8 lands on the dead writer's slot.
+  for (uint32_t i = 1; i <= kCapacity; i++) {
+    recorder.Record(ipc_trace::kStageDartPost, i, i, i);
+  }
+  EXPECT_EQ(0, recorder.GetDroppedCount());
+  std::vector<ipc_trace::TraceEvent> events = recorder.Collect();
+  ASSERT_EQ(kCapacity, events.size());
+  EXPECT_EQ(kCapacity, events.back().trace_id);
+
+  // A late store from the dead writer's lap is not reported as span 8.
+  slots[0].lap = 0;
+  EXPECT_EQ(kCapacity - 1, recorder.Collect().size());
+
+  UnmapViewOfFile(header);
+  CloseHandle(mapping);
+}
+
+TEST(IpcTraceTest, TwoRecordersSameRing_ShareEvents) {
+  // Two recorders on one ring stand in for two window processes.
+  ipc_trace::TraceRecorder writer(RingName("Shared"), 64);
+  ipc_trace::TraceRecorder reader(RingName("Shared"), 64);
+  ASSERT_TRUE(writer.Open());
+  ASSERT_TRUE(reader.Open());
+
+  writer.Record(ipc_trace::kStageCounterWrite, 9, 10, 20);
+  reader.Record(ipc_trace::kStageCallback, 9, 30, 40);
+
+  EXPECT_EQ(2u, reader.Collect().size());
+  EXPECT_EQ(2u, writer.Collect().size());
+}
+
+TEST(IpcTraceTest, Deferred_CompletedWithLaterTraceId) {
+  // Deferred stages go to the global recorder; filter by a unique ID.
+  const uint32_t trace_id = 0xF00D0000u + GetCurrentProcessId() % 0xFFFF;
+  ipc_trace::BeginDeferred(ipc_trace::kStageListenerWake);
+  Sleep(1);
+  ipc_trace::EndDeferred(trace_id);
+  ipc_trace::EndDeferred(trace_id);  // Nothing pending: ignored
+
+  size_t found = 0;
+  for (const auto& event : ipc_trace::GetRecorder().Collect()) {
+    if (event.trace_id == trace_id) {
+      EXPECT_EQ(ipc_trace::kStageListenerWake, event.stage);
+      EXPECT_GT(event.duration_ticks, 0u);
+      found++;
+    }
+  }
+  EXPECT_EQ(1u, found);
+}
+
+//==============================================================================
+// Test Suite 2: Chrome JSON Export
+//==============================================================================
+
+TEST(IpcTraceTest, ToChromeJson_EmitsSlicesAndProcessNames) {
+  std::vector<ipc_trace::TraceEvent> events = {
+      MakeEvent(3, ipc_trace::kStageCounterWrite, 100, 1000, 10),
+      MakeEvent(3, ipc_trace::kStageDartPost, 200, 2000, 20),
+  };
+  std::string json = ipc_trace::TraceRecorder::ToChromeJson(events);
+
+  EXPECT_EQ(0u, json.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["));
+  EXPECT_EQ(2u, CountOf(json, "\"ph\":\"X\""));
+  EXPECT_EQ(2u, CountOf(json, "\"name\":\"process_name\""));
+  EXPECT_NE(std::string::npos, json.find("\"name\":\"counter.write\""));
+  EXPECT_NE(std::string::npos, json.find("\"name\":\"dart.post\""));
+  EXPECT_NE(std::string::npos, json.find("\"pid\":200"));
+  EXPECT_EQ(2u, CountOf(json, "\"trace_id\":3"));
+  EXPECT_NE(std::string::npos, json.find("\"ts\":0.000"));  // Rebased
+}
+
+TEST(IpcTraceTest, ToChromeJson_FlowJoinsStagesOfOneTrace) {
+  std::vector<ipc_trace::TraceEvent> events = {
+      MakeEvent(7, ipc_trace::kStageCounterWrite, 100, 1000, 10),
+      MakeEvent(7, ipc_trace::kStageCallback, 200, 2000, 10),
+      MakeEvent(7, ipc_trace::kStageDartReceive, 200, 3000, 0),
+      MakeEvent(8, ipc_trace::kStageCounterWrite, 100, 4000, 10),  // Alone
+      MakeEvent(0, ipc_trace::kStageDartPost, 100, 5000, 10),  // Untraced
+  };
+  std::string json = ipc_trace::TraceRecorder::ToChromeJson(events);
+
+  EXPECT_EQ(1u, CountOf(json, "\"ph\":\"s\""));
+  EXPECT_EQ(1u, CountOf(json, "\"ph\":\"t\""));
+  EXPECT_EQ(1u, CountOf(json, "\"ph\":\"f\""));
+  EXPECT_EQ(3u, CountOf(json, "\"id\":7"));
+  EXPECT_EQ(0u, CountOf(json, "\"id\":8"));
+  EXPECT_EQ(0u, CountOf(json, "\"id\":0"));
+}
+
+TEST(IpcTraceTest, ExportChromeTrace_WritesFile) {
+  ipc_trace::TraceRecorder recorder(RingName("Export"), 64);
+  ASSERT_TRUE(recorder.Open());
+  recorder.Record(ipc_trace::kStageEventSignal, 1, 0, 5);
+
+  char temp_path[MAX_PATH];
+  DWORD length = GetTempPathA(MAX_PATH, temp_path);
+  ASSERT_GT(length, 0u);
+  std::string path = std::string(temp_path, length) + "ipc_trace_test.json";
+
+  ASSERT_TRUE(recorder.ExportChromeTrace(path));
+  FILE* file = std::fopen(path.c_str(), "rb");
+  ASSERT_NE(nullptr, file);
+  char buf[512] = {};
+  size_t read = std::fread(buf, 1, sizeof(buf) - 1, file);
+  std::fclose(file);
+  std::remove(path.c_str());
+  EXPECT_NE(std::string::npos,
+            std::string(buf, read).find("\"name\":\"event.signal\""));
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
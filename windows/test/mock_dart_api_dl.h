@@ -21,6 +21,9 @@
 /// In real Dart, this is int64_t representing a SendPort's native handle.
 typedef int64_t Dart_Port_DL;
 
+/// Invalid port ID (matches ILLEGAL_PORT in dart_api.h).
+#define ILLEGAL_PORT ((Dart_Port_DL)0)
+
 /// Enum for Dart_CObject types.
 /// Only including types we actually use in tests.
 typedef enum {
@@ -40,6 +43,16 @@ typedef enum {
   Dart_CObject_kNumberOfTypes = 13,
 } Dart_CObject_Type;
 
+/// Element type of typed data (subset of Dart_TypedData_Type).
+typedef enum {
+  Dart_TypedData_kByteData = 0,
+  Dart_TypedData_kInt8,
+  Dart_TypedData_kUint8,
+} Dart_TypedData_Type;
+
+/// Finalizer invoked when an external typed data object is collected.
+typedef void (*Dart_HandleFinalizer)(void* isolate_callback_data, void* peer);
+
 /// C representation of a Dart object for FFI.
 /// Simplified version that only includes fields we use.
 struct Dart_CObject {
@@ -58,9 +71,25 @@ struct Dart_CObject {
       intptr_t length;
       struct Dart_CObject** values;
     } as_array;
+    struct {
+      Dart_TypedData_Type type;
+      intptr_t length;
+      const uint8_t* values;
+    } as_typed_data;
+    struct {
+      Dart_TypedData_Type type;
+      intptr_t length;
+      uint8_t* data;
+      void* peer;
+      Dart_HandleFinalizer callback;
+    } as_external_typed_data;
   } value;
 };
 
+/// Handler for messages posted to a native port.
+typedef void (*Dart_NativeMessageHandler_DL)(Dart_Port_DL dest_port_id,
+                                             Dart_CObject* message);
+
 // ============================================================================
 // Mock Function Implementation
 // ============================================================================
@@ -84,6 +113,10 @@ struct MockState {
   PostCObjectCallback custom_callback = nullptr;
   std::vector<PostCObjectCall> post_calls;
   bool post_should_fail = false;
+  bool record_calls = true;
+  Dart_NativeMessageHandler_DL native_handler = nullptr;
+  Dart_Port_DL next_native_port = 9000;
+  std::vector<Dart_Port_DL> closed_native_ports;
 };
 
 /// Get global mock state (singleton pattern).
@@ -99,6 +132,9 @@ inline void Reset() {
   state.custom_callback = nullptr;
   state.post_calls.clear();
   state.post_should_fail = false;
+  state.record_calls = true;
+  state.native_handler = nullptr;
+  state.closed_native_ports.clear();
 }
 
 /// Set custom callback for PostCObject.
@@ -111,6 +147,11 @@ inline void SetPostShouldFail(bool should_fail) {
   GetMockState().post_should_fail = should_fail;
 }
 
+/// Disable call recording (e.g. in benchmarks, to avoid unbounded growth).
+inline void SetRecordCalls(bool record_calls) {
+  GetMockState().record_calls = record_calls;
+}
+
 /// Get recorded PostCObject calls.
 inline const std::vector<PostCObjectCall>& GetPostCalls() {
   return GetMockState().post_calls;
@@ -138,13 +179,15 @@ inline bool Dart_PostCObject_DL(Dart_Port_DL port, Dart_CObject* object) {
   auto& state = mock_dart_api::GetMockState();
 
   // Record the call for verification
-  mock_dart_api::PostCObjectCall call;
-  call.port = port;
-  call.type = object->type;
-  call.value_as_int64 = (object->type == Dart_CObject_kInt64)
-                            ? object->value.as_int64
-                            : 0;
-  state.post_calls.push_back(call);
+  if (state.record_calls) {
+    mock_dart_api::PostCObjectCall call;
+    call.port = port;
+    call.type = object->type;
+    call.value_as_int64 = (object->type == Dart_CObject_kInt64)
+                              ? object->value.as_int64
+                              : 0;
+    state.post_calls.push_back(call);
+  }
 
   // Check if we should simulate failure
   if (state.post_should_fail) {
@@ -159,4 +202,24 @@ inline bool Dart_PostCObject_DL(Dart_Port_DL port, Dart_CObject* object) {
   return true;  // Success by default
 }
 
+/// Mock implementation of Dart_NewNativePort_DL.
+/// In real Dart, this creates a port whose messages run |handler| on a VM
+/// thread. Our mock stores the handler so tests can invoke it directly.
+inline Dart_Port_DL Dart_NewNativePort_DL(const char* name,
+                                          Dart_NativeMessageHandler_DL handler,
+                                          bool handle_concurrently) {
+  (void)name;
+  (void)handle_concurrently;
+  auto& state = mock_dart_api::GetMockState();
+  state.native_handler = handler;
+  return state.next_native_port++;
+}
+
+/// Mock implementation of Dart_CloseNativePort_DL.
+/// Records the closed port for verification.
+inline bool Dart_CloseNativePort_DL(Dart_Port_DL native_port_id) {
+  mock_dart_api::GetMockState().closed_native_ports.push_back(native_port_id);
+  return true;
+}
+
 #endif  // TEST_MOCK_DART_API_DL_H_
@@ -0,0 +1,342 @@
+// shared_buffer_pool_test.cpp
+//
+// Google Test unit tests for SharedBufferPool (zero-copy payload transfer)
+//
+// All pools in one test process map the same named section, so every test
+// returns the slots it takes. Cross-process delivery is exercised by
+// targeting the current process ID explicitly.
+
+#include <gtest/gtest.h>
+#include <windows.h>
+
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+// Include dart_api_dl.h which redirects to our mock in test builds
+#include "dart_api_dl.h"
+
+#include "ipc_namespace.h"
+#include "ipc_test_namespace.h"
+#include "shared_buffer_pool.h"
+
+class SharedBufferPoolTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    mock_dart_api::Reset();
+    ASSERT_TRUE(pool_.Initialize());
+  }
+
+  void TearDown() override {
+    UnmapHeader();
+    pool_.StopReceiving();
+    mock_dart_api::Reset();
+  }
+
+  DWORD self() const { return GetCurrentProcessId(); }
+
+  // Maps the pool header directly, as another process would see it.
+  SharedBufferPoolHeader* MapHeader() {
+    mapping_ = OpenFileMappingA(
+        FILE_MAP_ALL_ACCESS, FALSE,
+        ipc_namespace::Qualify("Local\\FlutterMultiWindowBufferPool").c_str());
+    if (mapping_ == nullptr) {
+      return nullptr;
+    }
+    header_view_ = MapViewOfFile(mapping_, FILE_MAP_ALL_ACCESS, 0, 0,
+                                 sizeof(SharedBufferPoolHeader));
+    return static_cast<SharedBufferPoolHeader*>(header_view_);
+  }
+
+  void UnmapHeader() {
+    if (header_view_ != nullptr) {
+      UnmapViewOfFile(header_view_);
+      header_view_ = nullptr;
+    }
+    if (mapping_ != nullptr) {
+      CloseHandle(mapping_);
+      mapping_ = nullptr;
+    }
+  }
+
+  // Acquires every slot of the pool.
+  std::vector<SharedBufferHandle> AcquireAll() {
+    std::vector<SharedBufferHandle> handles;
+    for (DWORD i = 0; i < kSharedBufferSlotCount; i++) {
+      SharedBufferHandle handle = pool_.Acquire();
+      if (handle != kInvalidSharedBuffer) {
+        handles.push_back(handle);
+      }
+    }
+    return handles;
+  }
+
+  // No process has this ID.
+  static constexpr DWORD kExitedProcess = 0x7FFFFFF0;
+
+  SharedBufferPool pool_;
+  HANDLE mapping_ = nullptr;
+  void* header_view_ = nullptr;
+};
+
+//==============================================================================
+// Test Suite 1: Slot Lifecycle
+//==============================================================================
+
+TEST_F(SharedBufferPoolTest, Initialize_Idempotent) {
+  EXPECT_TRUE(pool_.Initialize());
+  EXPECT_EQ(kSharedBufferSlotCount, pool_.GetFreeSlotCount());
+}
+
+TEST_F(SharedBufferPoolTest, Acquire_ReturnsWritableSlot) {
+  SharedBufferHandle handle = pool_.Acquire();
+  ASSERT_NE(kInvalidSharedBuffer, handle);
+  EXPECT_EQ(kSharedBufferSlotCount - 1, pool_.GetFreeSlotCount());
+
+  uint8_t* data = pool_.GetData(handle);
+  ASSERT_NE(nullptr, data);
+  data[0] = 0x11;
+  data[kSharedBufferSlotSize - 1] = 0x22;  // Whole slot is mapped
+
+  EXPECT_TRUE(pool_.Release(handle));
+  EXPECT_EQ(kSharedBufferSlotCount, pool_.GetFreeSlotCount());
+}
+
+TEST_F(SharedBufferPoolTest, Acquire_WhenExhausted_ReturnsInvalid) {
+  std::vector<SharedBufferHandle> handles;
+  for (DWORD i = 0; i < kSharedBufferSlotCount; i++) {
+    handles.push_back(pool_.Acquire());
+    ASSERT_NE(kInvalidSharedBuffer, handles.back());
+  }
+  EXPECT_EQ(kInvalidSharedBuffer, pool_.Acquire());
+
+  for (SharedBufferHandle handle : handles) {
+    EXPECT_TRUE(pool_.Release(handle));
+  }
+}
+
+TEST_F(SharedBufferPoolTest, Release_StaleHandle_Ignored) {
+  SharedBufferHandle first = pool_.Acquire();
+  ASSERT_TRUE(pool_.Release(first));
+
+  // Reacquire until the same slot comes back with a new generation.
+  SharedBufferHandle second = pool_.Acquire();
+  ASSERT_NE(first, second);
+
+  EXPECT_FALSE(pool_.Release(first));  // e.g. a late finalizer
+  EXPECT_EQ(nullptr, pool_.GetData(first));
+  EXPECT_NE(nullptr, pool_.GetData(second));
+  EXPECT_TRUE(pool_.Release(second));
+}
+
+TEST_F(SharedBufferPoolTest, Publish_TooLarge_Rejected) {
+  SharedBufferHandle handle = pool_.Acquire();
+  EXPECT_FALSE(pool_.Publish(handle, kSharedBufferSlotSize + 1, self()));
+  EXPECT_TRUE(pool_.Release(handle));
+}
+
+//==============================================================================
+// Test Suite 2: Publish and Claim
+//==============================================================================
+
+TEST_F(SharedBufferPoolTest, Claim_TargetedBuffer_SharesMemory) {
+  SharedBufferPool receiver;
+  ASSERT_TRUE(receiver.Initialize());
+
+  SharedBufferHandle handle = pool_.Acquire();
+  uint8_t* sent = pool_.GetData(handle);
+  std::memcpy(sent, "payload", 7);
+  ASSERT_TRUE(pool_.Publish(handle, 7, self()));
+
+  DWORD length = 0;
+  DWORD sender = 0;
+  SharedBufferHandle claimed = receiver.Claim(&length, &sender);
+  ASSERT_EQ(handle, claimed);
+  EXPECT_EQ(7u, length);
+  EXPECT_EQ(self(), sender);
+  EXPECT_EQ(0, std::memcmp(receiver.GetData(claimed), "payload", 7));
+
+  EXPECT_TRUE(receiver.Release(claimed));
+}
+
+TEST_F(SharedBufferPoolTest, Claim_EachBufferOnce) {
+  SharedBufferHandle handle = pool_.Acquire();
+  ASSERT_TRUE(pool_.Publish(handle, 1, self()));
+
+  SharedBufferHandle first = pool_.Claim(nullptr, nullptr);
+  EXPECT_EQ(handle, first);
+  EXPECT_EQ(kInvalidSharedBuffer, pool_.Claim(nullptr, nullptr));
+  EXPECT_TRUE(pool_.Release(first));
+}
+
+TEST_F(SharedBufferPoolTest, Receiver_WakesOnPublish) {
+  std::atomic<int> received{0};
+  ASSERT_TRUE(pool_.StartReceiving(
+      [&](SharedBufferHandle handle, uint8_t* data, DWORD length, DWORD) {
+        if (length == 3 && data[0] == 'a') {
+          received++;
+        }
+        pool_.Release(handle);
+      }));
+
+  SharedBufferHandle handle = pool_.Acquire();
+  std::memcpy(pool_.GetData(handle), "abc", 3);
+  ASSERT_TRUE(pool_.Publish(handle, 3, self()));
+
+  for (int i = 0; i < 100 && received == 0; i++) {
+    Sleep(10);
+  }
+  EXPECT_EQ(1, received.load());
+  pool_.StopReceiving();
+}
+
+//==============================================================================
+// Test Suite 3: Dart Delivery (ExternalTypedData)
+//==============================================================================
+
+TEST_F(SharedBufferPoolTest, PostToPort_SendsExternalTypedDataWithoutCopy) {
+  SharedBufferPool& pool = GetGlobalSharedBufferPool();
+  ASSERT_TRUE(pool.Initialize());
+
+  SharedBufferHandle handle = pool.Acquire();
+  uint8_t* data = pool.GetData(handle);
+  ASSERT_TRUE(pool.Publish(handle, 16, self()));
+  SharedBufferHandle claimed = pool.Claim(nullptr, nullptr);
+  ASSERT_EQ(handle, claimed);
+
+  Dart_CObject captured_data;
+  int64_t captured_handle = 0;
+  mock_dart_api::SetPostCObjectCallback(
+      [&](Dart_Port_DL, Dart_CObject* message) {
+        EXPECT_EQ(Dart_CObject_kArray, message->type);
+        EXPECT_EQ(3, message->value.as_array.length);
+        captured_handle = message->value.as_array.values[0]->value.as_int64;
+        captured_data = *message->value.as_array.values[2];
+        return true;
+      });
+
+  ASSERT_TRUE(PostSharedBufferToPort(1234, claimed, data, 16, self()));
+  EXPECT_EQ(claimed, captured_handle);
+  EXPECT_EQ(Dart_CObject_kExternalTypedData, captured_data.type);
+  EXPECT_EQ(Dart_TypedData_kUint8,
+            captured_data.value.as_external_typed_data.type);
+  EXPECT_EQ(16, captured_data.value.as_external_typed_data.length);
+  EXPECT_EQ(data, captured_data.value.as_external_typed_data.data);
+
+  // Slot stays held until Dart collects the list and the finalizer runs.
+  DWORD free_before = pool.GetFreeSlotCount();
+  captured_data.value.as_external_typed_data.callback(
+      nullptr, captured_data.value.as_external_typed_data.peer);
+  EXPECT_EQ(free_before + 1, pool.GetFreeSlotCount());
+}
+
+TEST_F(SharedBufferPoolTest, PostToPort_Failure_ReleasesSlot) {
+  SharedBufferPool& pool = GetGlobalSharedBufferPool();
+  ASSERT_TRUE(pool.Initialize());
+
+  SharedBufferHandle handle = pool.Acquire();
+  ASSERT_TRUE(pool.Publish(handle, 1, self()));
+  SharedBufferHandle claimed = pool.Claim(nullptr, nullptr);
+  DWORD free_before = pool.GetFreeSlotCount();
+
+  mock_dart_api::SetPostShouldFail(true);
+  EXPECT_FALSE(
+      PostSharedBufferToPort(1234, claimed, pool.GetData(claimed), 1, self()));
+  EXPECT_EQ(free_before + 1, pool.GetFreeSlotCount());
+}
+
+TEST_F(SharedBufferPoolTest, CloseExport_StopsPostingToThePort) {
+  std::atomic<int> posts{0};
+  mock_dart_api::SetPostCObjectCallback([&](Dart_Port_DL, Dart_CObject*) {
+    posts++;
+    return true;
+  });
+  ASSERT_TRUE(OpenSharedBufferPool(1234));
+  SharedBufferPool& pool = GetGlobalSharedBufferPool();
+  EXPECT_TRUE(pool.IsReceiving());
+
+  CloseSharedBufferPool();
+  EXPECT_FALSE(pool.IsReceiving());
+
+  // A buffer addressed to this window now waits in the pool
+  SharedBufferHandle handle = AcquireSharedBuffer();
+  ASSERT_NE(kInvalidSharedBuffer, handle);
+  ASSERT_TRUE(PublishSharedBuffer(handle, 1, self()));
+  Sleep(50);
+  EXPECT_EQ(0, posts.load());
+  SharedBufferHandle claimed = pool.Claim(nullptr, nullptr);
+  EXPECT_EQ(handle, claimed);
+  pool.Release(claimed);
+}
+
+//==============================================================================
+// Test Suite 4: Crash Recovery
+//==============================================================================
+
+TEST_F(SharedBufferPoolTest, Acquire_Exhausted_ReclaimsSlotsOfExitedProcess) {
+  // A buffer published to a process that is gone can never be claimed and
+  // must be recovered once the pool runs out.
+  std::vector<SharedBufferHandle> handles = AcquireAll();
+  ASSERT_EQ(kSharedBufferSlotCount, handles.size());
+  ASSERT_TRUE(pool_.Publish(handles[0], 1, kExitedProcess));
+  EXPECT_EQ(kInvalidSharedBuffer, pool_.Claim(nullptr, nullptr));
+
+  SharedBufferHandle recovered = pool_.Acquire();
+  EXPECT_NE(kInvalidSharedBuffer, recovered);
+  EXPECT_FALSE(pool_.Release(handles[0]));  // Old generation is stale
+
+  EXPECT_TRUE(pool_.Release(recovered));
+  for (size_t i = 1; i < handles.size(); i++) {
+    EXPECT_TRUE(pool_.Release(handles[i]));
+  }
+}
+
+TEST_F(SharedBufferPoolTest, Reclaim_UntargetedOfExitedSender_Freed) {
+  SharedBufferPoolHeader* header = MapHeader();
+  ASSERT_NE(nullptr, header);
+  std::vector<SharedBufferHandle> handles = AcquireAll();
+  ASSERT_EQ(kSharedBufferSlotCount, handles.size());
+
+  // Published to any other process by a sender that has since exited,
+  // with no receiver left to take it.
+  SharedBufferSlot& slot =
+      header->slots[static_cast<DWORD>(handles[0] & 0xFFFFFFFF)];
+  slot.sender_pid = static_cast<LONG>(kExitedProcess);
+  ASSERT_TRUE(pool_.Publish(handles[0], 1, 0));
+
+  SharedBufferHandle recovered = pool_.Acquire();
+  EXPECT_NE(kInvalidSharedBuffer, recovered);
+  EXPECT_TRUE(pool_.Release(recovered));
+  for (size_t i = 1; i < handles.size(); i++) {
+    EXPECT_TRUE(pool_.Release(handles[i]));
+  }
+}
+
+TEST_F(SharedBufferPoolTest, Reclaim_ClaimedSlotOfExitedSender_StaysHeld) {
+  SharedBufferPoolHeader* header = MapHeader();
+  ASSERT_NE(nullptr, header);
+  std::vector<SharedBufferHandle> handles = AcquireAll();
+  ASSERT_EQ(kSharedBufferSlotCount, handles.size());
+
+  // The sender exits right after publishing; the slot now belongs to the
+  // receiver that claimed it, not to the sender.
+  SharedBufferSlot& slot =
+      header->slots[static_cast<DWORD>(handles[0] & 0xFFFFFFFF)];
+  ASSERT_TRUE(pool_.Publish(handles[0], 1, self()));
+  slot.sender_pid = static_cast<LONG>(kExitedProcess);
+  SharedBufferHandle claimed = pool_.Claim(nullptr, nullptr);
+  ASSERT_EQ(handles[0], claimed);
+
+  EXPECT_EQ(kInvalidSharedBuffer, pool_.Acquire());  // Nothing to reclaim
+  EXPECT_NE(nullptr, pool_.GetData(claimed));
+  EXPECT_TRUE(pool_.Release(claimed));
+  for (size_t i = 1; i < handles.size(); i++) {
+    EXPECT_TRUE(pool_.Release(handles[i]));
+  }
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  UseIpcTestNamespaces("SharedBufferPoolTest");
+  return RUN_ALL_TESTS();
+}
@@ -6,9 +6,14 @@
 // across multiple instances, which is the root cause of our multi-window issue.
 
 #include <gtest/gtest.h>
+#include "ipc_namespace.h"
+#include "ipc_test_namespace.h"
 #include "shared_memory_manager.h"
 #include <windows.h>
+#include <atomic>
 #include <memory>
+#include <string>
+#include <thread>
 
 class SharedMemoryManagerTest : public ::testing::Test {
 protected:
@@ -309,7 +314,279 @@ TEST_F(SharedMemoryManagerTest, MaxInstances_AllShareMemory) {
   }
 }
 
+//==============================================================================
+// Test Suite 7: Change Source Tracking
+//==============================================================================
+
+TEST_F(SharedMemoryManagerTest, LastWriterProcessId_BeforeChange_IsZero) {
+  SharedMemoryManager manager;
+  manager.Initialize();
+  EXPECT_EQ(0u, manager.GetLastWriterProcessId());
+}
+
+TEST_F(SharedMemoryManagerTest, LastWriterProcessId_AfterChange_IsCurrentProcess) {
+  SharedMemoryManager writer;
+  SharedMemoryManager reader;
+  writer.Initialize();
+  reader.Initialize();
+
+  writer.IncrementWindowCount();
+
+  EXPECT_EQ(GetCurrentProcessId(), reader.GetLastWriterProcessId());
+}
+
+//==============================================================================
+// Test Suite 8: Zero-Copy View and Seqlock Snapshots
+//==============================================================================
+
+TEST_F(SharedMemoryManagerTest, Initialize_WritesLayoutHeader) {
+  SharedMemoryManager manager;
+  ASSERT_TRUE(manager.Initialize());
+
+  const SharedMemoryData* view = manager.GetReadOnlyView();
+  ASSERT_NE(nullptr, view);
+  EXPECT_EQ(kSharedMemoryMagic, view->magic);
+  EXPECT_EQ(kSharedMemoryLayoutVersion, view->layout_version);
+  EXPECT_EQ(sizeof(SharedMemoryData), view->data_size);
+}
+
+TEST_F(SharedMemoryManagerTest, ReadOnlyView_SeesWritesFromOtherInstance) {
+  SharedMemoryManager writer;
+  SharedMemoryManager reader;
+  ASSERT_TRUE(writer.Initialize());
+  ASSERT_TRUE(reader.Initialize());
+
+  const SharedMemoryData* view = reader.GetReadOnlyView();
+  ASSERT_NE(nullptr, view);
+  EXPECT_EQ(view, reader.GetReadOnlyView());  // Mapped once
+
+  writer.IncrementWindowCount();
+  writer.IncrementWindowCount();
+  EXPECT_EQ(2, view->window_count);
+}
+
+TEST_F(SharedMemoryManagerTest, ReadOnlyView_BeforeInit_ReturnsNull) {
+  SharedMemoryManager manager;
+  EXPECT_EQ(nullptr, manager.GetReadOnlyView());
+}
+
+TEST_F(SharedMemoryManagerTest, Sequence_AdvancesByTwoPerChange) {
+  SharedMemoryManager manager;
+  ASSERT_TRUE(manager.Initialize());
+
+  SharedMemorySnapshot before;
+  ASSERT_TRUE(manager.ReadSnapshot(&before));
+  EXPECT_EQ(0, before.sequence % 2);
+
+  manager.IncrementWindowCount();
+  manager.DecrementWindowCount();
+
+  SharedMemorySnapshot after;
+  ASSERT_TRUE(manager.ReadSnapshot(&after));
+  EXPECT_EQ(before.sequence + 4, after.sequence);
+}
+
+TEST_F(SharedMemoryManagerTest, ReadSnapshot_MatchesIndividualFields) {
+  SharedMemoryManager manager;
+  ASSERT_TRUE(manager.Initialize());
+  manager.IncrementWindowCount();
+
+  SharedMemorySnapshot snapshot;
+  ASSERT_TRUE(manager.ReadSnapshot(&snapshot));
+  EXPECT_EQ(1, snapshot.window_count);
+  EXPECT_EQ(GetCurrentProcessId(), snapshot.last_writer_pid);
+}
+
+TEST_F(SharedMemoryManagerTest, ReadSnapshot_BeforeInit_ReturnsFalse) {
+  SharedMemoryManager manager;
+  SharedMemorySnapshot snapshot;
+  EXPECT_FALSE(manager.ReadSnapshot(&snapshot));
+}
+
+TEST_F(SharedMemoryManagerTest, ReadSnapshot_ConcurrentWriters_NeverTorn) {
+  SharedMemoryManager writer;
+  SharedMemoryManager reader;
+  ASSERT_TRUE(writer.Initialize());
+  ASSERT_TRUE(reader.Initialize());
+
+  // Writer toggles between 1 and 0, so any snapshot outside that range
+  // (or an odd sequence) means the seqlock let a torn read through.
+  // The writer yields between updates like a real window would; a writer
+  // that never pauses can starve a seqlock reader indefinitely.
+  std::atomic<bool> done{false};
+  std::thread thread([&]() {
+    for (int i = 0; i < 2000; i++) {
+      writer.IncrementWindowCount();
+      writer.DecrementWindowCount();
+      std::this_thread::yield();
+    }
+    done = true;
+  });
+
+  int reads = 0;
+  while (!done) {
+    SharedMemorySnapshot snapshot;
+    if (!reader.ReadSnapshot(&snapshot)) {
+      ADD_FAILURE() << "ReadSnapshot retries exhausted";
+      break;  // Still join the writer below
+    }
+    EXPECT_EQ(0, snapshot.sequence % 2);
+    EXPECT_GE(snapshot.window_count, 0);
+    EXPECT_LE(snapshot.window_count, 1);
+    reads++;
+  }
+  thread.join();
+  EXPECT_GT(reads, 0);
+}
+
+TEST_F(SharedMemoryManagerTest, FfiExports_ReportCompiledLayout) {
+  EXPECT_EQ(kSharedMemoryLayoutVersion, GetSharedMemoryLayoutVersion());
+  EXPECT_EQ(sizeof(SharedMemoryData), GetSharedMemoryDataSize());
+
+  SetGlobalSharedMemoryManager(nullptr);
+  EXPECT_EQ(nullptr, GetSharedMemoryView());
+
+  SharedMemoryManager manager;
+  ASSERT_TRUE(manager.Initialize());
+  SetGlobalSharedMemoryManager(&manager);
+  EXPECT_EQ(manager.GetReadOnlyView(), GetSharedMemoryView());
+
+  SharedMemorySnapshot snapshot;
+  EXPECT_TRUE(ReadSharedMemorySnapshot(&snapshot));
+  SetGlobalSharedMemoryManager(nullptr);
+}
+
+//==============================================================================
+// Test Suite 9: Trace IDs
+//==============================================================================
+
+TEST_F(SharedMemoryManagerTest, CountChange_AssignsNewTraceIdVisibleToReaders) {
+  SharedMemoryManager writer;
+  SharedMemoryManager reader;
+  ASSERT_TRUE(writer.Initialize());
+  ASSERT_TRUE(reader.Initialize());
+
+  writer.IncrementWindowCount();
+  SharedMemorySnapshot first;
+  ASSERT_TRUE(reader.ReadSnapshot(&first));
+  EXPECT_NE(0u, first.trace_id);
+
+  writer.DecrementWindowCount();
+  SharedMemorySnapshot second;
+  ASSERT_TRUE(reader.ReadSnapshot(&second));
+  EXPECT_EQ(first.trace_id + 1, second.trace_id);
+}
+
+//==============================================================================
+// Test Suite 10: Read-Only Inspection
+//==============================================================================
+
+TEST_F(SharedMemoryManagerTest, ReadSnapshotFrom_ReadOnlyMapping_MatchesManager) {
+  SharedMemoryManager manager;
+  ASSERT_TRUE(manager.Initialize());
+  manager.IncrementWindowCount();
+
+  // What shmem_top does: open the existing section read-only, no manager.
+  HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE,
+                                    manager.shared_memory_name().c_str());
+  ASSERT_NE(nullptr, mapping);
+  const SharedMemoryData* view = static_cast<const SharedMemoryData*>(
+      MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, sizeof(SharedMemoryData)));
+  ASSERT_NE(nullptr, view);
+
+  SharedMemorySnapshot expected;
+  SharedMemorySnapshot actual;
+  ASSERT_TRUE(manager.ReadSnapshot(&expected));
+  ASSERT_TRUE(SharedMemoryManager::ReadSnapshotFrom(view, &actual));
+  EXPECT_EQ(expected.window_count, actual.window_count);
+  EXPECT_EQ(expected.sequence, actual.sequence);
+  EXPECT_EQ(expected.trace_id, actual.trace_id);
+  EXPECT_FALSE(SharedMemoryManager::ReadSnapshotFrom(nullptr, &actual));
+
+  UnmapViewOfFile(view);
+  CloseHandle(mapping);
+  manager.DecrementWindowCount();
+}
+
+TEST_F(SharedMemoryManagerTest, DeadWriter_SequenceTakenOverAfterStall) {
+  SharedMemoryManager manager;
+  ASSERT_TRUE(manager.Initialize());
+
+  // A writer that died between BeginWrite() and EndWrite() leaves the
+  // sequence odd; the next writer must not wait on it forever.
+  HANDLE mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE,
+                                    manager.shared_memory_name().c_str());
+  ASSERT_NE(nullptr, mapping);
+  SharedMemoryData* data = static_cast<SharedMemoryData*>(MapViewOfFile(
+      mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SharedMemoryData)));
+  ASSERT_NE(nullptr, data);
+  InterlockedIncrement(&data->sequence);
+
+  ULONGLONG start = GetTickCount64();
+  EXPECT_EQ(1, manager.IncrementWindowCount());
+  EXPECT_GE(GetTickCount64() - start, 90u);  // Waited for the stall first
+
+  SharedMemorySnapshot snapshot;
+  ASSERT_TRUE(manager.ReadSnapshot(&snapshot));
+  EXPECT_EQ(0, snapshot.sequence % 2);
+  EXPECT_EQ(1, snapshot.window_count);
+  EXPECT_EQ(0, manager.DecrementWindowCount());  // No further stall
+
+  UnmapViewOfFile(data);
+  CloseHandle(mapping);
+}
+
+TEST_F(SharedMemoryManagerTest, Initialize_LayoutMismatch_Fails) {
+  // A creator built with another layout, as another app version would be
+  std::string ipc_namespace = ipc_namespace::GetDefault() + ".Mismatch";
+  SharedMemoryManager probe(ipc_namespace);
+  HANDLE mapping = CreateFileMappingA(
+      INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0,
+      sizeof(SharedMemoryData), probe.shared_memory_name().c_str());
+  ASSERT_NE(nullptr, mapping);
+  SharedMemoryData* data = static_cast<SharedMemoryData*>(MapViewOfFile(
+      mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SharedMemoryData)));
+  ASSERT_NE(nullptr, data);
+  data->layout_version = kSharedMemoryLayoutVersion + 1;
+  data->magic = kSharedMemoryMagic;
+
+  SharedMemoryManager manager(ipc_namespace);
+  EXPECT_FALSE(manager.Initialize());
+  EXPECT_EQ(-1, manager.IncrementWindowCount());
+
+  UnmapViewOfFile(data);
+  CloseHandle(mapping);
+}
+
+TEST_F(SharedMemoryManagerTest, Initialize_WaitsForCreatorToInitialize) {
+  std::string ipc_namespace = ipc_namespace::GetDefault() + ".Opening";
+  SharedMemoryManager probe(ipc_namespace);
+  HANDLE mapping = CreateFileMappingA(
+      INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0,
+      sizeof(SharedMemoryData), probe.shared_memory_name().c_str());
+  ASSERT_NE(nullptr, mapping);
+  SharedMemoryData* data = static_cast<SharedMemoryData*>(MapViewOfFile(
+      mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SharedMemoryData)));
+  ASSERT_NE(nullptr, data);
+
+  std::thread creator([data] {
+    Sleep(20);
+    data->layout_version = kSharedMemoryLayoutVersion;
+    data->data_size = sizeof(SharedMemoryData);
+    MemoryBarrier();
+    data->magic = kSharedMemoryMagic;
+  });
+  SharedMemoryManager manager(ipc_namespace);
+  EXPECT_TRUE(manager.Initialize());
+  creator.join();
+
+  manager.IncrementWindowCount();
+  UnmapViewOfFile(data);
+  CloseHandle(mapping);
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
+  UseIpcTestNamespaces("SharedMemoryManagerTest");
   return RUN_ALL_TESTS();
 }
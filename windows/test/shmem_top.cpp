@@ -0,0 +1,363 @@
+// shmem_top.cpp
+//
+// Live, read-only inspector for the multi-window shared memory ("shmem-top").
+//
+// Shows the window count, seqlock sequence, listeners waiting on the change
+// event, one row per window process and the fleet metrics, refreshed in
+// place. Useful for watching a misbehaving set of windows without attaching
+// a debugger to any of them.
+//
+// The counter segment, the metrics region and the flight recorder ring are
+// opened with FILE_MAP_READ only. The inspector never creates them, never
+// counts itself as a window, never signals the change event, never claims a metrics slot and
+// never logs through ipc_log, so running it cannot perturb the windows it
+// is watching.
+//
+// Usage:
+//   shmem_top                 Refreshing view (Ctrl+C to quit)
+//   shmem_top --interval 250  Refresh period in milliseconds (default 500)
+//   shmem_top --json          One-shot JSON dump on stdout, then exit
+//   shmem_top --flight <file> Dump the IPC flight recorder, then exit
+//   shmem_top --namespace <n> Watch the instance in IPC namespace n
+//                             (default FLUTTER_IPC_NAMESPACE, else the app)
+//
+// With --json or --flight the exit code is 1 if there is nothing to read.
+
+#include <windows.h>
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "ipc_flight_recorder.h"
+#include "ipc_metrics.h"
+#include "ipc_namespace.h"
+#include "shared_memory_manager.h"
+
+namespace {
+
+constexpr DWORD kDefaultIntervalMs = 500;
+
+// Read-only view of the counter segment.
+class SegmentView {
+ public:
+  SegmentView() : mapping_(nullptr), data_(nullptr) {}
+  ~SegmentView() { Close(); }
+
+  SegmentView(const SegmentView&) = delete;
+  SegmentView& operator=(const SegmentView&) = delete;
+
+  // Opens the segment if a window has created it. Returns false if there
+  // is none yet or its layout does not match this build.
+  bool Open() {
+    if (data_ != nullptr) {
+      return true;
+    }
+    std::string name = ipc_namespace::Qualify(kSharedMemoryName);
+    mapping_ = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+    if (mapping_ == nullptr) {
+      return false;
+    }
+    data_ = static_cast<const SharedMemoryData*>(MapViewOfFile(
+        mapping_, FILE_MAP_READ, 0, 0, sizeof(SharedMemoryData)));
+    if (data_ == nullptr || data_->magic != kSharedMemoryMagic ||
+        data_->layout_version != kSharedMemoryLayoutVersion ||
+        data_->data_size != sizeof(SharedMemoryData)) {
+      Close();
+      return false;
+    }
+    return true;
+  }
+
+  bool ReadSnapshot(SharedMemorySnapshot* snapshot) const {
+    return SharedMemoryManager::ReadSnapshotFrom(data_, snapshot);
+  }
+
+ private:
+  void Close() {
+    if (data_) {
+      UnmapViewOfFile(data_);
+      data_ = nullptr;
+    }
+    if (mapping_) {
+      CloseHandle(mapping_);
+      mapping_ = nullptr;
+    }
+  }
+
+  HANDLE mapping_;
+  const SharedMemoryData* data_;
+};
+
+// Everything shown in one frame or dump.
+struct Frame {
+  bool has_segment = false;
+  SharedMemorySnapshot segment = {};
+  bool has_metrics = false;
+  ipc_metrics::MetricsSnapshot metrics = {};
+  std::vector<ipc_metrics::MetricsSlotInfo> windows;
+};
+
+void Capture(SegmentView* segment, ipc_metrics::MetricsRegistry* metrics,
+             Frame* frame) {
+  // Windows may start after the inspector; keep trying to attach.
+  frame->has_segment =
+      segment->Open() && segment->ReadSnapshot(&frame->segment);
+  frame->has_metrics =
+      metrics->OpenReadOnly() && metrics->Snapshot(&frame->metrics);
+  if (frame->has_metrics) {
+    frame->windows = metrics->ListSlots();
+  }
+}
+
+void AppendF(std::string* out, const char* format, ...) {
+  char line[512];
+  va_list args;
+  va_start(args, format);
+  int length = std::vsnprintf(line, sizeof(line), format, args);
+  va_end(args);
+  if (length > 0) {
+    out->append(line, static_cast<size_t>(length) < sizeof(line)
+                          ? static_cast<size_t>(length)
+                          : sizeof(line) - 1);
+  }
+}
+
+std::string RenderText(const Frame& frame, const Frame* previous,
+                       DWORD interval_ms) {
+  using ipc_metrics::MetricsSnapshot;
+  std::string out;
+  AppendF(&out, "shmem-top  %s  (every %lu ms, Ctrl+C to quit)\n\n",
+          ipc_namespace::Qualify(kSharedMemoryName).c_str(),
+          static_cast<unsigned long>(interval_ms));
+
+  if (!frame.has_segment) {
+    out += "Waiting for a window to create the shared memory segment...\n";
+    return out;
+  }
+  AppendF(&out,
+          "Windows  %-6ld  sequence %-8ld  last writer %-8lu  trace %lu\n",
+          static_cast<long>(frame.segment.window_count),
+          static_cast<long>(frame.segment.sequence),
+          static_cast<unsigned long>(frame.segment.last_writer_pid),
+          static_cast<unsigned long>(frame.segment.trace_id));
+
+  if (!frame.has_metrics) {
+    out += "\nMetrics region not available\n";
+    return out;
+  }
+  const MetricsSnapshot& metrics = frame.metrics;
+  AppendF(&out, "Waiters  %-6lld  notifications %lld\n\n",
+          static_cast<long long>(
+              metrics.gauges[ipc_metrics::kMetricListenersRunning]),
+          static_cast<long long>(metrics.notify_sequence));
+
+  AppendF(&out, "  %-5s %-8s %-5s %10s %10s %10s %8s %8s %6s\n", "SLOT",
+          "PID", "STATE", "SENT", "RECEIVED", "COALESCED", "POSTS", "FAILED",
+          "SUBS");
+  for (const ipc_metrics::MetricsSlotInfo& window : frame.windows) {
+    AppendF(&out, "  %-5u %-8lu %-5s %10lld %10lld %10lld %8lld %8lld %6lld\n",
+            window.index, static_cast<unsigned long>(window.process_id),
+            window.live ? "live" : "dead",
+            static_cast<long long>(
+                window.counters[ipc_metrics::kMetricNotificationsSent]),
+            static_cast<long long>(
+                window.counters[ipc_metrics::kMetricNotificationsReceived]),
+            static_cast<long long>(
+                window.counters[ipc_metrics::kMetricCoalescedEvents]),
+            static_cast<long long>(
+                window.counters[ipc_metrics::kMetricDartPosts]),
+            static_cast<long long>(
+                window.counters[ipc_metrics::kMetricDartPostFailures]),
+            static_cast<long long>(
+                window.gauges[ipc_metrics::kMetricDartSubscribers]));
+  }
+
+  out += "\n";
+  out += ipc_metrics::FormatMetrics(metrics);
+  if (previous != nullptr && previous->has_metrics) {
+    AppendF(&out, "  rates: sent %.1f/s  received %.1f/s  posts %.1f/s\n",
+            MetricsSnapshot::Rate(previous->metrics, metrics,
+                                  ipc_metrics::kMetricNotificationsSent),
+            MetricsSnapshot::Rate(previous->metrics, metrics,
+                                  ipc_metrics::kMetricNotificationsReceived),
+            MetricsSnapshot::Rate(previous->metrics, metrics,
+                                  ipc_metrics::kMetricDartPosts));
+  }
+  return out;
+}
+
+void AppendJsonCounters(std::string* out, const int64_t* counters) {
+  *out += "{";
+  for (uint32_t c = 0; c < ipc_metrics::kCounterCount; c++) {
+    AppendF(out, "%s\"%s\":%lld", c ? "," : "",
+            ipc_metrics::CounterName(static_cast<ipc_metrics::Counter>(c)),
+            static_cast<long long>(counters[c]));
+  }
+  *out += "}";
+}
+
+void AppendJsonGauges(std::string* out, const int64_t* gauges) {
+  *out += "{";
+  for (uint32_t g = 0; g < ipc_metrics::kGaugeCount; g++) {
+    AppendF(out, "%s\"%s\":%lld", g ? "," : "",
+            ipc_metrics::GaugeName(static_cast<ipc_metrics::Gauge>(g)),
+            static_cast<long long>(gauges[g]));
+  }
+  *out += "}";
+}
+
+std::string RenderJson(const Frame& frame) {
+  std::string out = "{\"segment\":";
+  if (frame.has_segment) {
+    AppendF(&out,
+            "{\"window_count\":%ld,\"sequence\":%ld,\"last_writer_pid\":%lu,"
+            "\"trace_id\":%lu,\"layout_version\":%lu}",
+            static_cast<long>(frame.segment.window_count),
+            static_cast<long>(frame.segment.sequence),
+            static_cast<unsigned long>(frame.segment.last_writer_pid),
+            static_cast<unsigned long>(frame.segment.trace_id),
+            static_cast<unsigned long>(kSharedMemoryLayoutVersion));
+  } else {
+    out += "null";
+  }
+
+  out += ",\"metrics\":";
+  if (frame.has_metrics) {
+    const ipc_metrics::MetricsSnapshot& metrics = frame.metrics;
+    AppendF(&out, "{\"process_count\":%lld,\"notify_sequence\":%lld,",
+            static_cast<long long>(metrics.process_count),
+            static_cast<long long>(metrics.notify_sequence));
+    out += "\"counters\":";
+    AppendJsonCounters(&out, metrics.counters);
+    out += ",\"gauges\":";
+    AppendJsonGauges(&out, metrics.gauges);
+    out += ",\"histograms\":{";
+    for (uint32_t h = 0; h < ipc_metrics::kHistogramCount; h++) {
+      const ipc_metrics::HistogramSummary& summary = metrics.histograms[h];
+      AppendF(&out,
+              "%s\"%s\":{\"count\":%lld,\"sum\":%lld,\"max\":%lld,"
+              "\"p50\":%lld,\"p90\":%lld,\"p99\":%lld,\"p999\":%lld}",
+              h ? "," : "",
+              ipc_metrics::HistogramName(
+                  static_cast<ipc_metrics::Histogram>(h)),
+              static_cast<long long>(summary.count),
+              static_cast<long long>(summary.sum),
+              static_cast<long long>(summary.max),
+              static_cast<long long>(summary.p50),
+              static_cast<long long>(summary.p90),
+              static_cast<long long>(summary.p99),
+              static_cast<long long>(summary.p999));
+    }
+    out += "}}";
+  } else {
+    out += "null";
+  }
+
+  out += ",\"windows\":[";
+  for (size_t i = 0; i < frame.windows.size(); i++) {
+    const ipc_metrics::MetricsSlotInfo& window = frame.windows[i];
+    AppendF(&out, "%s{\"slot\":%u,\"pid\":%lu,\"live\":%s,\"counters\":",
+            i ? "," : "", window.index,
+            static_cast<unsigned long>(window.process_id),
+            window.live ? "true" : "false");
+    AppendJsonCounters(&out, window.counters);
+    out += ",\"gauges\":";
+    AppendJsonGauges(&out, window.gauges);
+    out += "}";
+  }
+  out += "]}\n";
+  return out;
+}
+
+void PrintUsage() {
+  std::fprintf(stderr,
+               "Usage: shmem_top [--interval <ms>] [--json] [--flight <file>]\n"
+               "                 [--namespace <name>]\n"
+               "  --interval <ms>     Refresh period (default %lu)\n"
+               "  --json              Print one JSON snapshot and exit\n"
+               "  --flight <file>     Dump the flight recorder and exit\n"
+               "  --namespace <name>  IPC namespace of the windows to watch\n",
+               static_cast<unsigned long>(kDefaultIntervalMs));
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  bool json = false;
+  const char* flight_path = nullptr;
+  DWORD interval_ms = kDefaultIntervalMs;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--json") == 0) {
+      json = true;
+    } else if (std::strcmp(argv[i], "--flight") == 0 && i + 1 < argc) {
+      flight_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+      interval_ms = static_cast<DWORD>(std::strtoul(argv[++i], nullptr, 10));
+      if (interval_ms == 0) {
+        interval_ms = kDefaultIntervalMs;
+      }
+    } else if (std::strcmp(argv[i], "--namespace") == 0 && i + 1 < argc &&
+               ipc_namespace::SetDefault(argv[i + 1])) {
+      i++;
+    } else {
+      PrintUsage();
+      return 2;
+    }
+  }
+
+  if (flight_path != nullptr) {
+    // Read-only like everything else here: the events of windows that
+    // crashed are still in the ring as long as any window is open.
+    ipc_flight::FlightRecorder flight(
+        ipc_namespace::Qualify(ipc_flight::FlightRecorder::kDefaultRingName));
+    if (!flight.OpenReadOnly()) {
+      std::fprintf(stderr, "No flight recorder: no window is running\n");
+      return 1;
+    }
+    if (!flight.DumpToFile(flight_path)) {
+      std::fprintf(stderr, "Failed to write %s\n", flight_path);
+      return 1;
+    }
+    std::printf("Wrote %zu events to %s\n", flight.Collect().size(),
+                flight_path);
+    return 0;
+  }
+
+  SegmentView segment;
+  ipc_metrics::MetricsRegistry metrics(
+      ipc_namespace::Qualify(ipc_metrics::MetricsRegistry::kDefaultRegionName));
+
+  if (json) {
+    Frame frame;
+    Capture(&segment, &metrics, &frame);
+    std::fputs(RenderJson(frame).c_str(), stdout);
+    return frame.has_segment ? 0 : 1;
+  }
+
+  // Redraw in place with VT sequences instead of scrolling.
+  HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+  DWORD mode = 0;
+  if (GetConsoleMode(console, &mode)) {
+    SetConsoleMode(console, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+  }
+
+  Frame previous;
+  bool has_previous = false;
+  for (;;) {
+    Frame frame;
+    Capture(&segment, &metrics, &frame);
+    std::string text =
+        RenderText(frame, has_previous ? &previous : nullptr, interval_ms);
+    std::fputs("\x1b[H\x1b[2J", stdout);
+    std::fputs(text.c_str(), stdout);
+    std::fflush(stdout);
+
+    previous = frame;
+    has_previous = true;
+    Sleep(interval_ms);
+  }
+}
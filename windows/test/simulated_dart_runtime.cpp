@@ -0,0 +1,333 @@
+// simulated_dart_runtime.cpp
+//
+// Implementation of the simulated Dart VM.
+
+#include "simulated_dart_runtime.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace simulated_dart {
+
+namespace {
+// First port ID handed out. Real ports are random 64-bit values; these
+// only need to stay clear of the IDs tests register by hand.
+constexpr Dart_Port_DL kFirstPort = 0x5D000000;
+
+// Spins instead of sleeping: processing and GC pauses are CPU work on the
+// isolate thread, and sleeps are far too coarse for microsecond costs.
+void BusyWait(std::chrono::microseconds duration) {
+  if (duration.count() <= 0) {
+    return;
+  }
+  auto until = std::chrono::steady_clock::now() + duration;
+  while (std::chrono::steady_clock::now() < until) {
+    std::this_thread::yield();
+  }
+}
+}  // anonymous namespace
+
+SimulatedDartRuntime::SimulatedDartRuntime()
+    : next_port_(kFirstPort), next_sequence_(0), installed_(false) {}
+
+SimulatedDartRuntime::~SimulatedDartRuntime() {
+  Uninstall();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& isolate : isolates_) {
+      isolate->stopping = true;
+      isolate->wake.notify_one();
+    }
+  }
+  for (auto& isolate : isolates_) {
+    isolate->thread.join();
+  }
+
+  // Everything still alive is collected when the VM shuts down.
+  std::vector<Finalizer> remaining;
+  for (auto& isolate : isolates_) {
+    remaining.insert(remaining.end(), isolate->garbage.begin(),
+                     isolate->garbage.end());
+  }
+  for (auto& entry : ports_) {
+    for (const Message& message : entry.second->queue) {
+      remaining.insert(remaining.end(), message.finalizers.begin(),
+                       message.finalizers.end());
+    }
+  }
+  RunFinalizers(remaining);
+}
+
+void SimulatedDartRuntime::Install() {
+  mock_dart_api::SetPostCObjectCallback(
+      [this](Dart_Port_DL port, Dart_CObject* object) {
+        return Post(port, object);
+      });
+  installed_ = true;
+}
+
+void SimulatedDartRuntime::Uninstall() {
+  if (installed_) {
+    mock_dart_api::SetPostCObjectCallback(nullptr);
+    installed_ = false;
+  }
+}
+
+int SimulatedDartRuntime::CreateIsolate(const IsolateConfig& config) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto isolate = std::make_unique<Isolate>();
+  isolate->config = config;
+  Isolate* started = isolate.get();
+  isolates_.push_back(std::move(isolate));
+  // The loop blocks on mutex_ until this call returns.
+  started->thread = std::thread([this, started] { RunEventLoop(started); });
+  return static_cast<int>(isolates_.size() - 1);
+}
+
+Dart_Port_DL SimulatedDartRuntime::NewPort(int isolate,
+                                           MessageHandler handler) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (isolate < 0 || isolate >= static_cast<int>(isolates_.size())) {
+    return ILLEGAL_PORT;
+  }
+  auto port = std::make_unique<Port>();
+  port->id = next_port_++;
+  port->isolate = isolate;
+  port->open = true;
+  port->handler = std::move(handler);
+  isolates_[isolate]->ports.push_back(port.get());
+  Dart_Port_DL id = port->id;
+  ports_[id] = std::move(port);
+  return id;
+}
+
+bool SimulatedDartRuntime::ClosePort(Dart_Port_DL port_id) {
+  std::vector<Finalizer> dropped;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = ports_.find(port_id);
+    if (it == ports_.end() || !it->second->open) {
+      return false;
+    }
+    Port* port = it->second.get();
+    port->open = false;
+    port->stats.dropped += port->queue.size();
+    for (const Message& message : port->queue) {
+      dropped.insert(dropped.end(), message.finalizers.begin(),
+                     message.finalizers.end());
+    }
+    port->queue.clear();
+    port->stats.queue_depth = 0;
+    isolates_[port->isolate]->stats.finalizers_run += dropped.size();
+  }
+  // A message deleted unread frees its external data right away.
+  RunFinalizers(dropped);
+  idle_.notify_all();
+  return true;
+}
+
+bool SimulatedDartRuntime::Post(Dart_Port_DL port_id,
+                                const Dart_CObject* object) {
+  // Copy outside the lock, on the posting thread, as the VM serializes.
+  Message message;
+  if (object == nullptr ||
+      !CopyObject(object, &message.value, &message.finalizers)) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = ports_.find(port_id);
+  if (it == ports_.end() || !it->second->open) {
+    return false;  // The caller keeps ownership of external data
+  }
+  Port* port = it->second.get();
+  message.sequence = next_sequence_++;
+  message.posted = std::chrono::steady_clock::now();
+  port->queue.push_back(std::move(message));
+  port->stats.posted++;
+  port->stats.queue_depth = port->queue.size();
+  port->stats.max_queue_depth =
+      std::max(port->stats.max_queue_depth, port->stats.queue_depth);
+  isolates_[port->isolate]->wake.notify_one();
+  return true;
+}
+
+bool SimulatedDartRuntime::WaitForIdle(std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return idle_.wait_for(lock, timeout, [this] {
+    for (const auto& isolate : isolates_) {
+      if (isolate->busy) {
+        return false;
+      }
+    }
+    for (const auto& entry : ports_) {
+      if (!entry.second->queue.empty()) {
+        return false;
+      }
+    }
+    return true;
+  });
+}
+
+PortStats SimulatedDartRuntime::GetPortStats(Dart_Port_DL port) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = ports_.find(port);
+  return it == ports_.end() ? PortStats() : it->second->stats;
+}
+
+IsolateStats SimulatedDartRuntime::GetIsolateStats(int isolate) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (isolate < 0 || isolate >= static_cast<int>(isolates_.size())) {
+    return IsolateStats();
+  }
+  return isolates_[isolate]->stats;
+}
+
+bool SimulatedDartRuntime::CopyObject(const Dart_CObject* object,
+                                      DartValue* copy,
+                                      std::vector<Finalizer>* finalizers) {
+  copy->type = object->type;
+  switch (object->type) {
+    case Dart_CObject_kNull:
+      return true;
+    case Dart_CObject_kBool:
+      copy->as_bool = object->value.as_bool;
+      return true;
+    case Dart_CObject_kInt32:
+      copy->type = Dart_CObject_kInt64;
+      copy->as_int64 = object->value.as_int32;
+      return true;
+    case Dart_CObject_kInt64:
+      copy->as_int64 = object->value.as_int64;
+      return true;
+    case Dart_CObject_kDouble:
+      copy->as_double = object->value.as_double;
+      return true;
+    case Dart_CObject_kString:
+      if (object->value.as_string == nullptr) {
+        return false;
+      }
+      copy->as_string = object->value.as_string;
+      return true;
+    case Dart_CObject_kSendPort:
+      copy->as_int64 = object->value.as_send_port.id;
+      return true;
+    case Dart_CObject_kArray: {
+      intptr_t length = object->value.as_array.length;
+      if (length < 0 ||
+          (length > 0 && object->value.as_array.values == nullptr)) {
+        return false;
+      }
+      copy->elements.resize(static_cast<size_t>(length));
+      for (intptr_t i = 0; i < length; i++) {
+        const Dart_CObject* element = object->value.as_array.values[i];
+        if (element == nullptr ||
+            !CopyObject(element, &copy->elements[i], finalizers)) {
+          return false;
+        }
+      }
+      return true;
+    }
+    case Dart_CObject_kTypedData: {
+      intptr_t length = object->value.as_typed_data.length;
+      const uint8_t* values = object->value.as_typed_data.values;
+      if (length < 0 || (length > 0 && values == nullptr)) {
+        return false;
+      }
+      copy->typed_data_type = object->value.as_typed_data.type;
+      copy->bytes.assign(values, values + length);
+      return true;
+    }
+    case Dart_CObject_kExternalTypedData: {
+      const auto& external = object->value.as_external_typed_data;
+      if (external.length < 0 ||
+          (external.length > 0 && external.data == nullptr)) {
+        return false;
+      }
+      copy->typed_data_type = external.type;
+      copy->external_data = external.data;
+      copy->external_length = external.length;
+      if (external.callback != nullptr) {
+        finalizers->push_back(Finalizer{external.callback, external.peer});
+      }
+      return true;
+    }
+    default:
+      return false;  // Capabilities, native pointers, unsupported
+  }
+}
+
+void SimulatedDartRuntime::RunEventLoop(Isolate* isolate) {
+  const IsolateConfig& config = isolate->config;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    Port* port = nullptr;
+    isolate->wake.wait(lock, [&] {
+      port = NextReadyPort(*isolate);
+      return isolate->stopping || port != nullptr;
+    });
+    if (isolate->stopping) {
+      return;
+    }
+
+    Message message = std::move(port->queue.front());
+    port->queue.pop_front();
+    port->stats.queue_depth = port->queue.size();
+    auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - message.posted);
+    port->stats.total_latency += latency;
+    port->stats.max_latency = std::max(port->stats.max_latency, latency);
+    isolate->busy = true;
+    lock.unlock();
+
+    // Ports are never freed before the runtime, so the handler stays
+    // valid even if the port is closed meanwhile.
+    port->handler(port->id, message.value);
+    BusyWait(config.message_cost);
+
+    lock.lock();
+    port->stats.handled++;
+    isolate->stats.handled++;
+    // The message becomes garbage once its handler returns.
+    isolate->garbage.insert(isolate->garbage.end(),
+                            message.finalizers.begin(),
+                            message.finalizers.end());
+    if (config.gc_interval != 0 &&
+        ++isolate->handled_since_gc >= config.gc_interval) {
+      isolate->handled_since_gc = 0;
+      std::vector<Finalizer> collected;
+      collected.swap(isolate->garbage);
+      lock.unlock();
+      BusyWait(config.gc_pause);
+      RunFinalizers(collected);
+      lock.lock();
+      isolate->stats.gc_count++;
+      isolate->stats.finalizers_run += collected.size();
+    }
+    isolate->busy = false;
+    idle_.notify_all();
+  }
+}
+
+SimulatedDartRuntime::Port* SimulatedDartRuntime::NextReadyPort(
+    const Isolate& isolate) const {
+  Port* oldest = nullptr;
+  for (Port* port : isolate.ports) {
+    if (port->open && !port->queue.empty() &&
+        (oldest == nullptr ||
+         port->queue.front().sequence < oldest->queue.front().sequence)) {
+      oldest = port;
+    }
+  }
+  return oldest;
+}
+
+void SimulatedDartRuntime::RunFinalizers(
+    const std::vector<Finalizer>& finalizers) {
+  for (const Finalizer& finalizer : finalizers) {
+    finalizer.callback(nullptr, finalizer.peer);
+  }
+}
+
+}  // namespace simulated_dart
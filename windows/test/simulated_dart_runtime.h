@@ -0,0 +1,183 @@
+// simulated_dart_runtime.h
+//
+// Simulated Dart VM for end-to-end native tests and benchmarks.
+//
+// mock_dart_api_dl.h only records Dart_PostCObject_DL calls. Installed as
+// the mock's post callback, this runtime plays the receiving side of a real
+// VM instead:
+//   - Posting deep-copies the Dart_CObject on the posting thread, like the
+//     VM serializing it into a message, so callers may reuse their objects
+//     as soon as the call returns. External typed data is adopted rather
+//     than copied; its finalizer runs when a simulated GC collects it.
+//   - Every port has its own message queue. Posting to an unknown or closed
+//     port, or an object the VM cannot send, fails without taking ownership.
+//   - Every isolate runs an event loop thread that handles the oldest queued
+//     message of any of its ports, one at a time, spending a configurable
+//     processing cost per message and pausing for a GC every N messages.
+//
+// So a slow isolate builds real queue depth and latency, and native-side
+// backpressure can be measured without Flutter. Only standard C++ is used;
+// the runtime has no Windows dependency of its own.
+
+#ifndef TEST_SIMULATED_DART_RUNTIME_H_
+#define TEST_SIMULATED_DART_RUNTIME_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mock_dart_api_dl.h"
+
+namespace simulated_dart {
+
+// A posted object as the receiving isolate sees it. Owns all of its data
+// except external typed data, which points at the adopted native buffer.
+struct DartValue {
+  Dart_CObject_Type type = Dart_CObject_kNull;
+  bool as_bool = false;
+  int64_t as_int64 = 0;  // kInt32 and kInt64 (both a Dart int), kSendPort
+  double as_double = 0.0;
+  std::string as_string;
+  std::vector<DartValue> elements;  // kArray
+  Dart_TypedData_Type typed_data_type = Dart_TypedData_kUint8;
+  std::vector<uint8_t> bytes;            // kTypedData
+  const uint8_t* external_data = nullptr;  // kExternalTypedData
+  intptr_t external_length = 0;
+};
+
+// Finalizer of adopted external typed data.
+struct Finalizer {
+  Dart_HandleFinalizer callback;
+  void* peer;
+};
+
+struct IsolateConfig {
+  // Time the isolate spends on every message after its handler returns
+  // (busy-waited, like Dart code running on the isolate thread).
+  std::chrono::microseconds message_cost{0};
+  // A GC runs after every gc_interval handled messages; 0 disables GC,
+  // and finalizers then only run when the runtime shuts down.
+  uint32_t gc_interval = 0;
+  // How long each GC stops the event loop.
+  std::chrono::microseconds gc_pause{0};
+};
+
+struct PortStats {
+  uint64_t posted = 0;
+  uint64_t handled = 0;
+  uint64_t dropped = 0;  // Still queued when the port was closed
+  size_t queue_depth = 0;
+  size_t max_queue_depth = 0;
+  std::chrono::nanoseconds total_latency{0};  // Post until handler start
+  std::chrono::nanoseconds max_latency{0};
+};
+
+struct IsolateStats {
+  uint64_t handled = 0;
+  uint64_t gc_count = 0;
+  uint64_t finalizers_run = 0;
+};
+
+// Runs on the isolate's event loop thread, like a ReceivePort listener.
+using MessageHandler =
+    std::function<void(Dart_Port_DL port, const DartValue& message)>;
+
+// A set of simulated isolates and their ports. Thread-safe.
+class SimulatedDartRuntime {
+ public:
+  SimulatedDartRuntime();
+
+  // Uninstalls, stops every isolate, drops queued messages and runs all
+  // finalizers still pending.
+  ~SimulatedDartRuntime();
+
+  SimulatedDartRuntime(const SimulatedDartRuntime&) = delete;
+  SimulatedDartRuntime& operator=(const SimulatedDartRuntime&) = delete;
+
+  // Routes the mock's Dart_PostCObject_DL to Post(). Posting from several
+  // threads also needs mock_dart_api::SetRecordCalls(false), since call
+  // recording is not thread-safe.
+  void Install();
+  void Uninstall();
+
+  // Starts an isolate with its own event loop thread. Returns its ID.
+  int CreateIsolate(const IsolateConfig& config = IsolateConfig());
+
+  // Opens a port on an isolate. Returns ILLEGAL_PORT for an unknown one.
+  Dart_Port_DL NewPort(int isolate, MessageHandler handler);
+
+  // Closes a port. Later posts fail; queued messages are dropped and their
+  // external typed data finalized. Returns false if the port is not open.
+  bool ClosePort(Dart_Port_DL port);
+
+  // Dart_PostCObject semantics: copies the object and queues it.
+  bool Post(Dart_Port_DL port, const Dart_CObject* object);
+
+  // Waits until every queue is empty and no handler is running.
+  bool WaitForIdle(std::chrono::milliseconds timeout);
+
+  PortStats GetPortStats(Dart_Port_DL port) const;
+  IsolateStats GetIsolateStats(int isolate) const;
+
+  // Deep-copies an object, collecting the finalizers of external typed
+  // data it adopts. Returns false for types the VM cannot send.
+  static bool CopyObject(const Dart_CObject* object, DartValue* copy,
+                         std::vector<Finalizer>* finalizers);
+
+ private:
+  struct Message {
+    uint64_t sequence;  // Orders messages across the ports of an isolate
+    std::chrono::steady_clock::time_point posted;
+    DartValue value;
+    std::vector<Finalizer> finalizers;
+  };
+
+  struct Port {
+    Dart_Port_DL id;
+    int isolate;
+    bool open;
+    MessageHandler handler;
+    std::deque<Message> queue;
+    PortStats stats;
+  };
+
+  struct Isolate {
+    IsolateConfig config;
+    std::thread thread;
+    std::condition_variable wake;
+    bool stopping = false;
+    bool busy = false;
+    uint32_t handled_since_gc = 0;
+    std::vector<Port*> ports;
+    std::vector<Finalizer> garbage;  // Collected by the next GC
+    IsolateStats stats;
+  };
+
+  void RunEventLoop(Isolate* isolate);
+
+  // Returns the open port of |isolate| with the oldest queued message, or
+  // nullptr. Caller holds mutex_.
+  Port* NextReadyPort(const Isolate& isolate) const;
+
+  static void RunFinalizers(const std::vector<Finalizer>& finalizers);
+
+  mutable std::mutex mutex_;
+  std::condition_variable idle_;
+  std::vector<std::unique_ptr<Isolate>> isolates_;
+  std::map<Dart_Port_DL, std::unique_ptr<Port>> ports_;
+  Dart_Port_DL next_port_;
+  uint64_t next_sequence_;
+  bool installed_;
+};
+
+}  // namespace simulated_dart
+
+#endif  // TEST_SIMULATED_DART_RUNTIME_H_
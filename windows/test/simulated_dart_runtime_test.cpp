@@ -0,0 +1,346 @@
+// simulated_dart_runtime_test.cpp
+//
+// Google Test unit tests for the simulated Dart VM (simulated_dart_runtime.h)
+//
+// The last suite drives production DartPortManager code through the mock
+// Dart API with the runtime installed.
+
+#include <gtest/gtest.h>
+#include <windows.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+// Include dart_api_dl.h which redirects to our mock in test builds
+#include "dart_api_dl.h"
+
+#include "dart_port_manager.h"
+#include "simulated_dart_runtime.h"
+
+using simulated_dart::DartValue;
+using simulated_dart::IsolateConfig;
+using simulated_dart::SimulatedDartRuntime;
+
+namespace {
+
+constexpr std::chrono::milliseconds kIdleTimeout(5000);
+
+Dart_CObject Int64Object(int64_t value) {
+  Dart_CObject object;
+  object.type = Dart_CObject_kInt64;
+  object.value.as_int64 = value;
+  return object;
+}
+
+// Collects messages on the isolate thread for the test thread to check.
+struct Inbox {
+  std::mutex mutex;
+  std::vector<DartValue> messages;
+  std::vector<Dart_Port_DL> ports;
+
+  simulated_dart::MessageHandler Handler() {
+    return [this](Dart_Port_DL port, const DartValue& message) {
+      std::lock_guard<std::mutex> lock(mutex);
+      messages.push_back(message);
+      ports.push_back(port);
+    };
+  }
+};
+
+std::atomic<int> g_finalized{0};
+
+void CountingFinalizer(void* /* isolate_callback_data */, void* peer) {
+  g_finalized.fetch_add(static_cast<int>(reinterpret_cast<intptr_t>(peer)));
+}
+
+Dart_CObject ExternalObject(uint8_t* data, intptr_t length, intptr_t weight) {
+  Dart_CObject object;
+  object.type = Dart_CObject_kExternalTypedData;
+  object.value.as_external_typed_data.type = Dart_TypedData_kUint8;
+  object.value.as_external_typed_data.length = length;
+  object.value.as_external_typed_data.data = data;
+  object.value.as_external_typed_data.peer = reinterpret_cast<void*>(weight);
+  object.value.as_external_typed_data.callback = CountingFinalizer;
+  return object;
+}
+
+}  // namespace
+
+class SimulatedDartRuntimeTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    mock_dart_api::Reset();
+    g_finalized = 0;
+  }
+};
+
+//==============================================================================
+// Test Suite 1: Message Copying
+//==============================================================================
+
+TEST_F(SimulatedDartRuntimeTest, Post_DeepCopiesNestedArray) {
+  SimulatedDartRuntime runtime;
+  Inbox inbox;
+  Dart_Port_DL port = runtime.NewPort(runtime.CreateIsolate(),
+                                      inbox.Handler());
+
+  char text[] = "count";
+  Dart_CObject name;
+  name.type = Dart_CObject_kString;
+  name.value.as_string = text;
+  Dart_CObject count;
+  count.type = Dart_CObject_kInt32;
+  count.value.as_int32 = 3;
+  Dart_CObject* elements[] = {&name, &count};
+  Dart_CObject message;
+  message.type = Dart_CObject_kArray;
+  message.value.as_array.length = 2;
+  message.value.as_array.values = elements;
+  ASSERT_TRUE(runtime.Post(port, &message));
+
+  // The sender may reuse its objects as soon as the post returns.
+  text[0] = 'X';
+  count.value.as_int32 = 99;
+  ASSERT_TRUE(runtime.WaitForIdle(kIdleTimeout));
+
+  ASSERT_EQ(1u, inbox.messages.size());
+  const DartValue& received = inbox.messages[0];
+  EXPECT_EQ(Dart_CObject_kArray, received.type);
+  ASSERT_EQ(2u, received.elements.size());
+  EXPECT_EQ("count", received.elements[0].as_string);
+  EXPECT_EQ(Dart_CObject_kInt64, received.elements[1].type);
+  EXPECT_EQ(3, received.elements[1].as_int64);
+}
+
+TEST_F(SimulatedDartRuntimeTest, Post_TypedData_CopiesBytes) {
+  SimulatedDartRuntime runtime;
+  Inbox inbox;
+  Dart_Port_DL port = runtime.NewPort(runtime.CreateIsolate(),
+                                      inbox.Handler());
+
+  uint8_t bytes[] = {1, 2, 3, 4};
+  Dart_CObject message;
+  message.type = Dart_CObject_kTypedData;
+  message.value.as_typed_data.type = Dart_TypedData_kUint8;
+  message.value.as_typed_data.length = 4;
+  message.value.as_typed_data.values = bytes;
+  ASSERT_TRUE(runtime.Post(port, &message));
+  bytes[0] = 0xFF;
+  ASSERT_TRUE(runtime.WaitForIdle(kIdleTimeout));
+
+  ASSERT_EQ(1u, inbox.messages.size());
+  EXPECT_EQ(std::vector<uint8_t>({1, 2, 3, 4}), inbox.messages[0].bytes);
+}
+
+TEST_F(SimulatedDartRuntimeTest, Post_UnsupportedObject_FailsWithoutAdopting) {
+  SimulatedDartRuntime runtime;
+  Inbox inbox;
+  Dart_Port_DL port = runtime.NewPort(runtime.CreateIsolate(),
+                                      inbox.Handler());
+
+  uint8_t data[8] = {};
+  Dart_CObject external = ExternalObject(data, 8, 1);
+  Dart_CObject pointer;
+  pointer.type = Dart_CObject_kNativePointer;
+  Dart_CObject* elements[] = {&external, &pointer};
+  Dart_CObject message;
+  message.type = Dart_CObject_kArray;
+  message.value.as_array.length = 2;
+  message.value.as_array.values = elements;
+
+  EXPECT_FALSE(runtime.Post(port, &message));
+  ASSERT_TRUE(runtime.WaitForIdle(kIdleTimeout));
+  EXPECT_TRUE(inbox.messages.empty());
+  EXPECT_EQ(0u, runtime.GetPortStats(port).posted);
+  EXPECT_EQ(0, g_finalized.load());  // Ownership stays with the sender
+}
+
+//==============================================================================
+// Test Suite 2: Ports and Queues
+//==============================================================================
+
+TEST_F(SimulatedDartRuntimeTest, Post_UnknownPort_Fails) {
+  SimulatedDartRuntime runtime;
+  runtime.CreateIsolate();
+  Dart_CObject message = Int64Object(1);
+  EXPECT_FALSE(runtime.Post(1234, &message));
+  EXPECT_EQ(ILLEGAL_PORT, runtime.NewPort(7, nullptr));
+}
+
+TEST_F(SimulatedDartRuntimeTest, ClosePort_DropsQueuedAndFailsLaterPosts) {
+  SimulatedDartRuntime runtime;
+  IsolateConfig config;
+  config.message_cost = std::chrono::milliseconds(20);
+  int isolate = runtime.CreateIsolate(config);
+  Inbox inbox;
+  Dart_Port_DL port = runtime.NewPort(isolate, inbox.Handler());
+
+  uint8_t data[4] = {};
+  for (int i = 0; i < 5; i++) {
+    Dart_CObject message = ExternalObject(data, 4, 1);
+    ASSERT_TRUE(runtime.Post(port, &message));
+  }
+  ASSERT_TRUE(runtime.ClosePort(port));
+  EXPECT_FALSE(runtime.ClosePort(port));
+  Dart_CObject late = Int64Object(6);
+  EXPECT_FALSE(runtime.Post(port, &late));
+  ASSERT_TRUE(runtime.WaitForIdle(kIdleTimeout));
+
+  // At most the message already being handled gets through.
+  simulated_dart::PortStats stats = runtime.GetPortStats(port);
+  EXPECT_EQ(5u, stats.posted);
+  EXPECT_EQ(5u, stats.handled + stats.dropped);
+  EXPECT_GE(stats.dropped, 4u);
+  EXPECT_EQ(static_cast<int>(stats.dropped), g_finalized.load());
+}
+
+TEST_F(SimulatedDartRuntimeTest, Messages_HandledInPostOrderAcrossPorts) {
+  SimulatedDartRuntime runtime;
+  int isolate = runtime.CreateIsolate();
+  Inbox inbox;
+  Dart_Port_DL first = runtime.NewPort(isolate, inbox.Handler());
+  Dart_Port_DL second = runtime.NewPort(isolate, inbox.Handler());
+
+  for (int64_t i = 0; i < 100; i++) {
+    Dart_CObject message = Int64Object(i);
+    ASSERT_TRUE(runtime.Post(i % 3 == 0 ? first : second, &message));
+  }
+  ASSERT_TRUE(runtime.WaitForIdle(kIdleTimeout));
+
+  ASSERT_EQ(100u, inbox.messages.size());
+  for (int64_t i = 0; i < 100; i++) {
+    EXPECT_EQ(i, inbox.messages[i].as_int64);
+    EXPECT_EQ(i % 3 == 0 ? first : second, inbox.ports[i]);
+  }
+}
+
+TEST_F(SimulatedDartRuntimeTest, SlowIsolate_BuildsQueueDepthAndLatency) {
+  SimulatedDartRuntime runtime;
+  IsolateConfig config;
+  config.message_cost = std::chrono::milliseconds(2);
+  Inbox inbox;
+  Dart_Port_DL port = runtime.NewPort(runtime.CreateIsolate(config),
+                                      inbox.Handler());
+
+  for (int64_t i = 0; i < 10; i++) {
+    Dart_CObject message = Int64Object(i);
+    ASSERT_TRUE(runtime.Post(port, &message));
+  }
+  ASSERT_TRUE(runtime.WaitForIdle(kIdleTimeout));
+
+  simulated_dart::PortStats stats = runtime.GetPortStats(port);
+  EXPECT_EQ(10u, stats.handled);
+  EXPECT_EQ(0u, stats.queue_depth);
+  EXPECT_GE(stats.max_queue_depth, 5u);
+  // The last message waited behind nine others.
+  EXPECT_GE(stats.max_latency, std::chrono::milliseconds(10));
+}
+
+//==============================================================================
+// Test Suite 3: Garbage Collection
+//==============================================================================
+
+TEST_F(SimulatedDartRuntimeTest, ExternalTypedData_AdoptedAndFinalizedByGc) {
+  SimulatedDartRuntime runtime;
+  IsolateConfig config;
+  config.gc_interval = 4;
+  int isolate = runtime.CreateIsolate(config);
+  Inbox inbox;
+  Dart_Port_DL port = runtime.NewPort(isolate, inbox.Handler());
+
+  uint8_t data[16] = {7};
+  for (int i = 0; i < 6; i++) {
+    Dart_CObject message = ExternalObject(data, 16, 1);
+    ASSERT_TRUE(runtime.Post(port, &message));
+  }
+  ASSERT_TRUE(runtime.WaitForIdle(kIdleTimeout));
+
+  // Not copied: the isolate sees the sender's buffer.
+  EXPECT_EQ(data, inbox.messages[0].external_data);
+  EXPECT_EQ(16, inbox.messages[0].external_length);
+  // One GC after four messages; the last two are still alive.
+  simulated_dart::IsolateStats stats = runtime.GetIsolateStats(isolate);
+  EXPECT_EQ(1u, stats.gc_count);
+  EXPECT_EQ(4u, stats.finalizers_run);
+  EXPECT_EQ(4, g_finalized.load());
+}
+
+TEST_F(SimulatedDartRuntimeTest, Shutdown_RunsPendingFinalizers) {
+  uint8_t data[4] = {};
+  {
+    SimulatedDartRuntime runtime;
+    Dart_Port_DL port = runtime.NewPort(runtime.CreateIsolate(), nullptr);
+    runtime.ClosePort(port);
+    Dart_Port_DL live = runtime.NewPort(
+        runtime.CreateIsolate(), [](Dart_Port_DL, const DartValue&) {});
+    Dart_CObject message = ExternalObject(data, 4, 10);
+    ASSERT_TRUE(runtime.Post(live, &message));
+    ASSERT_TRUE(runtime.WaitForIdle(kIdleTimeout));
+    EXPECT_EQ(0, g_finalized.load());  // GC disabled
+  }
+  EXPECT_EQ(10, g_finalized.load());
+}
+
+TEST_F(SimulatedDartRuntimeTest, GcPause_DelaysLaterMessages) {
+  SimulatedDartRuntime runtime;
+  IsolateConfig config;
+  config.gc_interval = 1;
+  config.gc_pause = std::chrono::milliseconds(20);
+  int isolate = runtime.CreateIsolate(config);
+  Inbox inbox;
+  Dart_Port_DL port = runtime.NewPort(isolate, inbox.Handler());
+
+  Dart_CObject first = Int64Object(1);
+  Dart_CObject second = Int64Object(2);
+  ASSERT_TRUE(runtime.Post(port, &first));
+  ASSERT_TRUE(runtime.Post(port, &second));
+  ASSERT_TRUE(runtime.WaitForIdle(kIdleTimeout));
+
+  EXPECT_EQ(2u, runtime.GetIsolateStats(isolate).gc_count);
+  EXPECT_GE(runtime.GetPortStats(port).max_latency,
+            std::chrono::milliseconds(20));
+}
+
+//==============================================================================
+// Test Suite 4: End-to-End with DartPortManager
+//==============================================================================
+
+TEST_F(SimulatedDartRuntimeTest, DartPortManager_UpdatesArriveInOrder) {
+  SimulatedDartRuntime runtime;
+  runtime.Install();
+  Inbox inbox;
+  Dart_Port_DL port = runtime.NewPort(runtime.CreateIsolate(),
+                                      inbox.Handler());
+
+  DartPortManager manager;
+  ASSERT_TRUE(manager.RegisterPort(port, 0));
+  for (LONG count = 1; count <= 50; count++) {
+    manager.NotifyWindowCountChanged(count);
+  }
+  ASSERT_TRUE(runtime.WaitForIdle(kIdleTimeout));
+
+  ASSERT_EQ(51u, inbox.messages.size());
+  for (LONG count = 0; count <= 50; count++) {
+    EXPECT_EQ(count, inbox.messages[count].as_int64);
+  }
+}
+
+TEST_F(SimulatedDartRuntimeTest, DartPortManager_ClosedIsolatePort_PostFails) {
+  SimulatedDartRuntime runtime;
+  runtime.Install();
+  Dart_Port_DL port = runtime.NewPort(runtime.CreateIsolate(), nullptr);
+  ASSERT_TRUE(runtime.ClosePort(port));
+
+  DartPortManager manager;
+  ASSERT_TRUE(manager.RegisterPort(port));
+  manager.NotifyWindowCountChanged(1);
+  ASSERT_EQ(1u, mock_dart_api::GetPostCalls().size());
+  EXPECT_EQ(0u, runtime.GetPortStats(port).posted);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
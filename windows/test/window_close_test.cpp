@@ -7,6 +7,7 @@
 
 #include <gtest/gtest.h>
 #include <windows.h>
+#include "ipc_test_namespace.h"
 #include "shared_memory_manager.h"
 
 // Note: RequestWindowClose is tested via GetProcAddress (runtime lookup)
@@ -104,7 +105,7 @@ TEST_F(WindowCloseTest, DecrementWindowCount_SignalsEvent) {
   HANDLE event = OpenEventA(
       SYNCHRONIZE,
       FALSE,
-      "Local\\FlutterWindowCountChanged");
+      manager_->event_name().c_str());
   ASSERT_NE(event, nullptr) << "Failed to open event - SharedMemoryManager may not have created it";
 
   // Increment first so we have something to decrement
@@ -166,3 +167,9 @@ TEST_F(WindowCloseTest, Decrement_VisibleInOriginalInstance) {
   // Assert: original manager sees the decrement
   EXPECT_EQ(1, manager_->GetWindowCount());
 }
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  UseIpcTestNamespaces("WindowCloseTest");
+  return RUN_ALL_TESTS();
+}
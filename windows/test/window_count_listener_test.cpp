@@ -5,6 +5,9 @@
 // Tests event-driven notification system that eliminates polling overhead
 
 #include <gtest/gtest.h>
+#include "ipc_metrics.h"
+#include "ipc_test_namespace.h"
+#include "shared_memory_manager.h"
 #include "window_count_listener.h"
 #include <windows.h>
 #include <memory>
@@ -116,7 +119,7 @@ TEST_F(WindowCountListenerTest, Callback_CalledOnEventSignal) {
   listener.Start();
 
   // Manually signal the event (simulating SharedMemoryManager signaling)
-  const char* event_name = "Local\\FlutterWindowCountChanged";
+  const char* event_name = listener.event_name().c_str();
   HANDLE hEvent = OpenEventA(EVENT_MODIFY_STATE, FALSE, event_name);
   ASSERT_NE(nullptr, hEvent) << "Event should exist after listener starts";
 
@@ -140,7 +143,7 @@ TEST_F(WindowCountListenerTest, Event_CreatedOnStart) {
   listener.Start();
 
   // Try to open the event - should succeed if it was created
-  const char* event_name = "Local\\FlutterWindowCountChanged";
+  const char* event_name = listener.event_name().c_str();
   HANDLE hEvent = OpenEventA(EVENT_MODIFY_STATE, FALSE, event_name);
 
   EXPECT_NE(nullptr, hEvent) << "Event should be created by listener";
@@ -170,6 +173,34 @@ TEST_F(WindowCountListenerTest, TwoListeners_ShareSameEvent) {
   SUCCEED();
 }
 
+TEST_F(WindowCountListenerTest, Stop_SharedEventResetByOthers_StopsPromptly) {
+  WindowCountListener listener;
+  ASSERT_TRUE(listener.Start());
+  Sleep(20);  // Let the thread reach its wait
+
+  // Other windows' listeners reset the shared event after every wake; one
+  // that does so right after Stop() must not leave this thread waiting.
+  HANDLE shared = OpenEventA(EVENT_MODIFY_STATE, FALSE,
+                             listener.event_name().c_str());
+  ASSERT_NE(nullptr, shared);
+  std::atomic<bool> done{false};
+  std::thread resetter([&]() {
+    while (!done) {
+      ResetEvent(shared);
+    }
+  });
+
+  auto start = std::chrono::steady_clock::now();
+  listener.Stop();
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start);
+  done = true;
+  resetter.join();
+  CloseHandle(shared);
+
+  EXPECT_LT(elapsed.count(), 1000) << "Stop() waited for the wait timeout";
+}
+
 //==============================================================================
 // Test Suite 4: Thread Safety
 //==============================================================================
@@ -210,7 +241,7 @@ TEST_F(WindowCountListenerTest, EventNotification_LowLatency) {
   listener.SetCallback(TestCallback);
   listener.Start();
 
-  const char* event_name = "Local\\FlutterWindowCountChanged";
+  const char* event_name = listener.event_name().c_str();
   HANDLE hEvent = OpenEventA(EVENT_MODIFY_STATE, FALSE, event_name);
   ASSERT_NE(nullptr, hEvent);
 
@@ -247,7 +278,7 @@ TEST_F(WindowCountListenerTest, MultipleSignals_AllReceived) {
   listener.SetCallback(TestCallback);
   listener.Start();
 
-  const char* event_name = "Local\\FlutterWindowCountChanged";
+  const char* event_name = listener.event_name().c_str();
   HANDLE hEvent = OpenEventA(EVENT_MODIFY_STATE, FALSE, event_name);
   ASSERT_NE(nullptr, hEvent);
 
@@ -279,7 +310,7 @@ TEST_F(WindowCountListenerTest, CallbackException_DoesNotCrash) {
   listener.SetCallback(throwing_callback);
   listener.Start();
 
-  const char* event_name = "Local\\FlutterWindowCountChanged";
+  const char* event_name = listener.event_name().c_str();
   HANDLE hEvent = OpenEventA(EVENT_MODIFY_STATE, FALSE, event_name);
 
   if (hEvent) {
@@ -299,7 +330,7 @@ TEST_F(WindowCountListenerTest, NoCallback_DoesNotCrash) {
   // Don't set callback
   listener.Start();
 
-  const char* event_name = "Local\\FlutterWindowCountChanged";
+  const char* event_name = listener.event_name().c_str();
   HANDLE hEvent = OpenEventA(EVENT_MODIFY_STATE, FALSE, event_name);
 
   if (hEvent) {
@@ -313,7 +344,171 @@ TEST_F(WindowCountListenerTest, NoCallback_DoesNotCrash) {
   SUCCEED();
 }
 
+//==============================================================================
+// Test Suite 8: Spin-Then-Block Waiting
+//==============================================================================
+
+namespace {
+
+int64_t SpinCounter(ipc_metrics::Counter counter) {
+  ipc_metrics::MetricsSnapshot snapshot{};
+  ipc_metrics::GetRegistry().Snapshot(&snapshot);
+  return snapshot.counters[counter];
+}
+
+}  // namespace
+
+TEST_F(WindowCountListenerTest, SpinBudget_NoHistory_Blocks) {
+  AdaptiveSpinBudget budget(1000);
+  EXPECT_EQ(0, budget.GetBudgetTicks());
+
+  budget.OnArrival(5000);  // One change has no gap yet
+  EXPECT_EQ(0, budget.GetBudgetTicks());
+}
+
+TEST_F(WindowCountListenerTest, SpinBudget_CloseChanges_SpinTwiceTheGap) {
+  AdaptiveSpinBudget budget(1000);
+  for (int64_t ticks = 100; ticks <= 1000; ticks += 100) {
+    budget.OnArrival(ticks);
+  }
+  EXPECT_EQ(100, budget.average_gap_ticks());
+  EXPECT_EQ(200, budget.GetBudgetTicks());
+}
+
+TEST_F(WindowCountListenerTest, SpinBudget_CappedAndSparse) {
+  AdaptiveSpinBudget capped(1000);
+  capped.OnArrival(1000);
+  capped.OnArrival(1700);
+  EXPECT_EQ(1000, capped.GetBudgetTicks());  // 2 * 700, capped
+
+  AdaptiveSpinBudget sparse(1000);
+  sparse.OnArrival(1000);
+  sparse.OnArrival(3000);
+  EXPECT_EQ(0, sparse.GetBudgetTicks());  // Gap beyond the cap
+}
+
+TEST_F(WindowCountListenerTest, SpinBudget_AfterIdle_RecoversQuickly) {
+  AdaptiveSpinBudget budget(1000);
+  int64_t ticks = 100;
+  for (int i = 0; i < 20; i++) {
+    budget.OnArrival(ticks += 100);
+  }
+  for (int i = 0; i < 20; i++) {
+    budget.OnArrival(ticks += 1000000000);  // Changes once in a long while
+  }
+  EXPECT_EQ(0, budget.GetBudgetTicks());
+
+  int arrivals = 0;
+  while (budget.GetBudgetTicks() == 0 && arrivals < 100) {
+    budget.OnArrival(ticks += 100);
+    arrivals++;
+  }
+  EXPECT_LE(arrivals, 20);
+}
+
+TEST_F(WindowCountListenerTest, SpinWait_EachChangeDeliveredOnce) {
+  SharedMemoryManager manager;
+  ASSERT_TRUE(manager.Initialize());
+  std::atomic<int> calls{0};
+  std::atomic<LONG> last_count{-1};
+
+  WindowCountListener listener;
+  listener.SetCallback([&](LONG) {
+    calls++;
+    last_count = manager.GetWindowCount();
+  });
+  listener.EnableSpinWait(manager.GetReadOnlyView(), 50000);  // 50ms cap
+  ASSERT_TRUE(listener.Start());
+  int64_t hits_before = SpinCounter(ipc_metrics::kMetricSpinHits);
+
+  const int kChanges = 20;
+  for (int i = 0; i < kChanges; i++) {
+    manager.IncrementWindowCount();
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  for (int i = 0; i < 100 && last_count != kChanges; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  listener.Stop();
+
+  EXPECT_EQ(kChanges, last_count.load());
+  // Event signals of changes a spin delivered are not delivered again
+  EXPECT_LE(calls.load(), kChanges);
+  EXPECT_GT(SpinCounter(ipc_metrics::kMetricSpinHits), hits_before);
+}
+
+TEST_F(WindowCountListenerTest, SpinWait_IdleListener_DoesNotSpin) {
+  SharedMemoryManager manager;
+  ASSERT_TRUE(manager.Initialize());
+  std::atomic<int> calls{0};
+
+  WindowCountListener listener;
+  listener.SetCallback([&calls](LONG) { calls++; });
+  listener.EnableSpinWait(manager.GetReadOnlyView());
+  ASSERT_TRUE(listener.Start());
+  int64_t spin_before = SpinCounter(ipc_metrics::kMetricSpinNanoseconds);
+
+  manager.IncrementWindowCount();  // No gap history: blocks, no budget
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  listener.Stop();
+
+  EXPECT_EQ(1, calls.load());
+  int64_t spun_ns =
+      SpinCounter(ipc_metrics::kMetricSpinNanoseconds) - spin_before;
+  EXPECT_LT(spun_ns, 10000000);  // Far below the 100ms it was idle
+}
+
+//==============================================================================
+// Test Suite 9: Callbacks Off the Waiting Thread
+//==============================================================================
+
+TEST_F(WindowCountListenerTest, CallbackMode_SlowCallback_DoesNotBlockWaiting) {
+  SharedMemoryManager manager;
+  ASSERT_TRUE(manager.Initialize());
+  HANDLE gate = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+  ASSERT_NE(nullptr, gate);
+  std::atomic<int> calls{0};
+  std::atomic<LONG> last_count{-1};
+
+  WindowCountListener listener;
+  listener.SetCallback([&](LONG) {
+    WaitForSingleObject(gate, 5000);  // Slow until the test opens the gate
+    last_count = manager.GetWindowCount();
+    calls++;
+  });
+  listener.SetCallbackMode(WindowCountListener::CallbackMode::kDedicatedWorker,
+                           1);
+  ASSERT_TRUE(listener.Start());
+  int64_t received_before =
+      SpinCounter(ipc_metrics::kMetricNotificationsReceived);
+
+  const int kChanges = 4;
+  for (int i = 0; i < kChanges; i++) {
+    manager.IncrementWindowCount();
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+  }
+  // Every change woke the listener although no callback has finished
+  EXPECT_EQ(0, calls.load());
+  EXPECT_GE(SpinCounter(ipc_metrics::kMetricNotificationsReceived) -
+                received_before,
+            kChanges);
+
+  // The blocked callback, then one for all the changes queued behind it
+  SetEvent(gate);
+  for (int i = 0; i < 100 && calls < 2; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  listener.Stop();
+  CloseHandle(gate);
+
+  EXPECT_EQ(2, calls.load());
+  EXPECT_EQ(kChanges, last_count.load());
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
+  UseIpcTestNamespaces("WindowCountListenerTest");
   return RUN_ALL_TESTS();
 }
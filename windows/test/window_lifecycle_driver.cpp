@@ -0,0 +1,321 @@
+// window_lifecycle_driver.cpp
+//
+// Headless window-lifecycle driver: what opening and closing a window costs
+// apart from Flutter.
+//
+// FlutterWindow runs WindowLifecycle (window_lifecycle.h) inside a real
+// Win32 window with a Flutter engine. This tool runs the same lifecycle
+// against a PlatformWindow with no content, thousands of times, and reports
+// how long each phase takes: acquiring the process's IpcRuntime, increment
+// and initial count, then decrement and releasing the runtime on the way
+// out.
+//
+// Windows of one process share the runtime, so by default a new window is
+// opened before the oldest one is closed and the runtime stays up: this is
+// the cost of one more window in a running process. With --windows K, K
+// windows stay open at once, as with K views in one process. --cold closes
+// each window before opening the next, so every open starts the runtime
+// (segment, listener thread) and every close stops it: the cost of the
+// first window of a process. --ports registers Dart ports (mocked) that the
+// runtime notifies.
+//
+// Uses the real segment and the full production path including logging, so
+// close the app first. Log lines are echoed to the console as usual; the
+// report follows once the logger has been flushed.
+//
+// Usage:
+//   window_lifecycle_driver                Run 5000 open/close cycles
+//   window_lifecycle_driver --cycles 20000 Number of cycles
+//   window_lifecycle_driver --windows 8    Windows open at the same time
+//   window_lifecycle_driver --cold         Start and stop the runtime
+//                                          every cycle
+//   window_lifecycle_driver --ports 4      Dart ports to notify
+//   window_lifecycle_driver --json <file>  Also write the results as JSON
+
+#include <windows.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <vector>
+
+// Include dart_api_dl.h which redirects to our mock in test builds
+#include "dart_api_dl.h"
+
+#include "dart_port_manager.h"
+#include "ipc_log.h"
+#include "ipc_metrics.h"
+#include "shared_memory_manager.h"
+#include "window_lifecycle.h"
+
+namespace {
+
+constexpr int kDefaultCycles = 5000;
+constexpr Dart_Port_DL kFirstPort = 7000;
+
+struct Options {
+  int cycles = kDefaultCycles;
+  int windows = 1;
+  int ports = 0;
+  bool cold = false;
+  const char* json_path = nullptr;
+};
+
+// A window with nothing in it: the IPC steps are all that runs.
+class HeadlessWindow : public PlatformWindow {
+ public:
+  HeadlessWindow() : lifecycle_(this) {}
+
+  WindowLifecycle& lifecycle() { return lifecycle_; }
+
+  // PlatformWindow:
+  bool CreateContent() override { return true; }
+  void DestroyContent() override {}
+
+ private:
+  WindowLifecycle lifecycle_;
+};
+
+// Per-phase samples in QPC ticks, one per open or close.
+struct PhaseSamples {
+  std::vector<int64_t> ticks[kWindowLifecyclePhaseCount];
+  std::vector<int64_t> create_total;
+  std::vector<int64_t> destroy_total;
+};
+
+const char* PhaseName(int phase) {
+  return WindowLifecyclePhaseName(static_cast<WindowLifecyclePhase>(phase));
+}
+
+void RecordCreate(const WindowLifecycle& lifecycle, PhaseSamples* samples) {
+  int64_t total = 0;
+  for (int phase = 0; phase < kPhaseDecrement; phase++) {
+    int64_t ticks =
+        lifecycle.GetPhaseTicks(static_cast<WindowLifecyclePhase>(phase));
+    samples->ticks[phase].push_back(ticks);
+    total += ticks;
+  }
+  samples->create_total.push_back(total);
+}
+
+void RecordDestroy(const WindowLifecycle& lifecycle, PhaseSamples* samples) {
+  int64_t total = 0;
+  for (int phase = kPhaseDecrement; phase < kWindowLifecyclePhaseCount;
+       phase++) {
+    int64_t ticks =
+        lifecycle.GetPhaseTicks(static_cast<WindowLifecyclePhase>(phase));
+    samples->ticks[phase].push_back(ticks);
+    total += ticks;
+  }
+  samples->destroy_total.push_back(total);
+}
+
+struct Summary {
+  double mean_us = 0;
+  double p50_us = 0;
+  double p99_us = 0;
+  double max_us = 0;
+};
+
+Summary Summarize(std::vector<int64_t> ticks, double ticks_per_us) {
+  Summary summary;
+  if (ticks.empty()) {
+    return summary;
+  }
+  std::sort(ticks.begin(), ticks.end());
+  double sum = 0;
+  for (int64_t value : ticks) {
+    sum += static_cast<double>(value);
+  }
+  auto at = [&](double fraction) {
+    size_t index = static_cast<size_t>(fraction * (ticks.size() - 1));
+    return static_cast<double>(ticks[index]) / ticks_per_us;
+  };
+  summary.mean_us = sum / ticks.size() / ticks_per_us;
+  summary.p50_us = at(0.50);
+  summary.p99_us = at(0.99);
+  summary.max_us = static_cast<double>(ticks.back()) / ticks_per_us;
+  return summary;
+}
+
+void PrintRow(const char* name, const Summary& s) {
+  std::printf("%-20s %10.2f %10.2f %10.2f %10.2f\n", name, s.mean_us,
+              s.p50_us, s.p99_us, s.max_us);
+}
+
+void PrintReport(const Options& options, const PhaseSamples& samples,
+                 double ticks_per_us, double seconds) {
+  std::printf(
+      "\nwindow_lifecycle_driver  cycles %d  windows %d  ports %d%s\n\n",
+      options.cycles, options.windows, options.ports,
+      options.cold ? "  cold" : "");
+  std::printf("%-20s %10s %10s %10s %10s\n", "PHASE", "MEAN(us)", "P50(us)",
+              "P99(us)", "MAX(us)");
+  for (int phase = 0; phase < kWindowLifecyclePhaseCount; phase++) {
+    if (phase == kPhaseDecrement) {
+      PrintRow("open total", Summarize(samples.create_total, ticks_per_us));
+      std::printf("\n");
+    }
+    PrintRow(PhaseName(phase), Summarize(samples.ticks[phase], ticks_per_us));
+  }
+  PrintRow("close total", Summarize(samples.destroy_total, ticks_per_us));
+  std::printf("\n%.0f open/close cycles per second\n",
+              seconds > 0 ? options.cycles / seconds : 0);
+}
+
+void WriteSummary(FILE* file, const char* name, const Summary& s,
+                  bool last) {
+  std::fprintf(file,
+               "    \"%s\": {\"mean_us\": %.3f, \"p50_us\": %.3f, "
+               "\"p99_us\": %.3f, \"max_us\": %.3f}%s\n",
+               name, s.mean_us, s.p50_us, s.p99_us, s.max_us,
+               last ? "" : ",");
+}
+
+bool WriteJson(const char* path, const Options& options,
+               const PhaseSamples& samples, double ticks_per_us,
+               double seconds) {
+  FILE* file = std::fopen(path, "w");
+  if (file == nullptr) {
+    return false;
+  }
+  std::fprintf(file,
+               "{\n  \"cycles\": %d,\n  \"windows\": %d,\n  \"ports\": %d,\n"
+               "  \"cold\": %s,\n  \"seconds\": %.3f,\n  \"phases\": {\n",
+               options.cycles, options.windows, options.ports,
+               options.cold ? "true" : "false", seconds);
+  for (int phase = 0; phase < kWindowLifecyclePhaseCount; phase++) {
+    WriteSummary(file, PhaseName(phase),
+                 Summarize(samples.ticks[phase], ticks_per_us), false);
+  }
+  WriteSummary(file, "open_total",
+               Summarize(samples.create_total, ticks_per_us), false);
+  WriteSummary(file, "close_total",
+               Summarize(samples.destroy_total, ticks_per_us), true);
+  std::fputs("  }\n}\n", file);
+  return std::fclose(file) == 0;
+}
+
+void PrintUsage() {
+  std::fprintf(
+      stderr,
+      "Usage: window_lifecycle_driver [--cycles <n>] [--windows <n>]\n"
+      "                               [--cold] [--ports <n>] [--json <file>]\n"
+      "  --cycles <n>    Open/close cycles to run (default %d)\n"
+      "  --windows <n>   Windows open at the same time (default 1)\n"
+      "  --cold          Close before opening; restarts the runtime\n"
+      "  --ports <n>     Dart ports the runtime notifies (default 0)\n"
+      "  --json <file>   Also write the results as JSON\n",
+      kDefaultCycles);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    bool has_value = i + 1 < argc;
+    if (std::strcmp(argv[i], "--cycles") == 0 && has_value) {
+      options.cycles = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--windows") == 0 && has_value) {
+      options.windows = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--ports") == 0 && has_value) {
+      options.ports = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--cold") == 0) {
+      options.cold = true;
+    } else if (std::strcmp(argv[i], "--json") == 0 && has_value) {
+      options.json_path = argv[++i];
+    } else {
+      PrintUsage();
+      return 2;
+    }
+  }
+  if (options.cycles < 1 || options.windows < 1 || options.ports < 0 ||
+      (options.cold && options.windows != 1)) {
+    PrintUsage();
+    return 2;
+  }
+
+  // The lifecycle tolerates a missing segment; the measurements would not.
+  SharedMemoryManager probe;
+  if (!probe.Initialize()) {
+    std::fprintf(stderr, "Failed to open the shared memory segment\n");
+    return 1;
+  }
+
+  // The listener thread posts; call recording is not thread-safe.
+  mock_dart_api::SetRecordCalls(false);
+  for (int i = 0; i < options.ports; i++) {
+    GetGlobalDartPortManager().RegisterPort(kFirstPort + i);
+  }
+
+  LARGE_INTEGER frequency;
+  QueryPerformanceFrequency(&frequency);
+  double ticks_per_us = static_cast<double>(frequency.QuadPart) / 1e6;
+
+  PhaseSamples samples;
+  for (auto& phase : samples.ticks) {
+    phase.reserve(options.cycles);
+  }
+  std::deque<std::unique_ptr<HeadlessWindow>> open;
+  auto open_window = [] {
+    auto window = std::make_unique<HeadlessWindow>();
+    window->lifecycle().OnCreate();  // Headless content cannot fail
+    return window;
+  };
+
+  // Each cycle opens a window before closing the oldest, so K windows are
+  // open between cycles and the runtime never stops.
+  if (!options.cold) {
+    for (int i = 0; i < options.windows; i++) {
+      open.push_back(open_window());
+    }
+  }
+
+  LARGE_INTEGER begin;
+  QueryPerformanceCounter(&begin);
+  for (int cycle = 0; cycle < options.cycles; cycle++) {
+    if (options.cold) {
+      std::unique_ptr<HeadlessWindow> window = open_window();
+      RecordCreate(window->lifecycle(), &samples);
+      window->lifecycle().OnDestroy();
+      RecordDestroy(window->lifecycle(), &samples);
+      continue;
+    }
+    open.push_back(open_window());
+    RecordCreate(open.back()->lifecycle(), &samples);
+
+    std::unique_ptr<HeadlessWindow> oldest = std::move(open.front());
+    open.pop_front();
+    oldest->lifecycle().OnDestroy();
+    RecordDestroy(oldest->lifecycle(), &samples);
+  }
+  LARGE_INTEGER end;
+  QueryPerformanceCounter(&end);
+  double seconds = static_cast<double>(end.QuadPart - begin.QuadPart) /
+                   static_cast<double>(frequency.QuadPart);
+
+  for (auto& window : open) {
+    window->lifecycle().OnDestroy();
+  }
+  open.clear();
+  for (int i = 0; i < options.ports; i++) {
+    GetGlobalDartPortManager().UnregisterPort(kFirstPort + i);
+  }
+
+  // Flush the echoed log lines before printing the report.
+  ipc_metrics::Shutdown();
+  ipc_log::Shutdown();
+
+  PrintReport(options, samples, ticks_per_us, seconds);
+  if (options.json_path != nullptr &&
+      !WriteJson(options.json_path, options, samples, ticks_per_us,
+                 seconds)) {
+    std::fprintf(stderr, "Failed to write %s\n", options.json_path);
+    return 1;
+  }
+  return 0;
+}
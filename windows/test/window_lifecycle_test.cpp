@@ -0,0 +1,210 @@
+// window_lifecycle_test.cpp
+//
+// Google Test unit tests for WindowLifecycle, the IPC half of opening and
+// closing a window, driven through a fake PlatformWindow.
+//
+// Counts are checked relative to the value before each test, since the
+// segment is shared with anything else that has it open.
+
+#include <gtest/gtest.h>
+#include <windows.h>
+
+// Include dart_api_dl.h which redirects to our mock in test builds
+#include "dart_api_dl.h"
+
+#include "dart_port_manager.h"
+#include "ipc_test_namespace.h"
+#include "shared_memory_manager.h"
+#include "window_lifecycle.h"
+
+namespace {
+
+// Records what the lifecycle asked of it, and the window count it saw.
+class FakeWindow : public PlatformWindow {
+ public:
+  explicit FakeWindow(SharedMemoryManager* observer) : observer_(observer) {}
+
+  bool CreateContent() override {
+    create_calls++;
+    count_at_create = observer_->GetWindowCount();
+    return content_ok;
+  }
+
+  void DestroyContent() override {
+    destroy_calls++;
+    count_at_destroy = observer_->GetWindowCount();
+  }
+
+  bool content_ok = true;
+  int create_calls = 0;
+  int destroy_calls = 0;
+  LONG count_at_create = -1;
+  LONG count_at_destroy = -1;
+
+ private:
+  SharedMemoryManager* observer_;
+};
+
+}  // namespace
+
+class WindowLifecycleTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    mock_dart_api::Reset();
+    ASSERT_TRUE(observer_.Initialize());
+    baseline_ = observer_.GetWindowCount();
+  }
+
+  SharedMemoryManager observer_;
+  LONG baseline_ = 0;
+};
+
+//==============================================================================
+// Test Suite 1: Opening a Window
+//==============================================================================
+
+TEST_F(WindowLifecycleTest, OnCreate_CountsWindowBeforeContent) {
+  FakeWindow window(&observer_);
+  WindowLifecycle lifecycle(&window);
+
+  ASSERT_TRUE(lifecycle.OnCreate());
+  EXPECT_EQ(1, window.create_calls);
+  EXPECT_EQ(baseline_ + 1, window.count_at_create);
+  EXPECT_EQ(baseline_ + 1, GetCurrentWindowCount());
+  ASSERT_NE(nullptr, lifecycle.shared_memory_manager());
+
+  lifecycle.OnDestroy();
+}
+
+TEST_F(WindowLifecycleTest, OnCreate_ContentFails_ReturnsFalse) {
+  FakeWindow window(&observer_);
+  window.content_ok = false;
+  WindowLifecycle lifecycle(&window);
+
+  EXPECT_FALSE(lifecycle.OnCreate());
+  // The window still counts until it is destroyed, as with a failed
+  // WM_CREATE.
+  EXPECT_EQ(baseline_ + 1, observer_.GetWindowCount());
+  lifecycle.OnDestroy();
+  EXPECT_EQ(baseline_, observer_.GetWindowCount());
+}
+
+TEST_F(WindowLifecycleTest, Listener_ForwardsOtherWindowsChanges) {
+  FakeWindow window(&observer_);
+  WindowLifecycle lifecycle(&window);
+  ASSERT_TRUE(lifecycle.OnCreate());
+
+  // Another window opening wakes the runtime's listener.
+  observer_.IncrementWindowCount();
+  for (int i = 0; i < 100 && GetCurrentWindowCount() != baseline_ + 2; i++) {
+    Sleep(10);
+  }
+  EXPECT_EQ(baseline_ + 2, GetCurrentWindowCount());
+
+  observer_.DecrementWindowCount();
+  lifecycle.OnDestroy();
+}
+
+TEST_F(WindowLifecycleTest, TwoWindows_ShareOneRuntime) {
+  FakeWindow first_window(&observer_);
+  FakeWindow second_window(&observer_);
+  WindowLifecycle first(&first_window);
+  WindowLifecycle second(&second_window);
+
+  ASSERT_TRUE(first.OnCreate());
+  ASSERT_TRUE(second.OnCreate());
+  EXPECT_EQ(first.runtime(), second.runtime());
+  EXPECT_EQ(first.shared_memory_manager(), second.shared_memory_manager());
+  EXPECT_EQ(1, IpcRuntime::GetLiveCount());
+  EXPECT_EQ(baseline_ + 2, observer_.GetWindowCount());
+
+  // Closing one window leaves the runtime to the other
+  first.OnDestroy();
+  ASSERT_NE(nullptr, second.runtime());
+  EXPECT_TRUE(second.runtime()->IsListening());
+
+  second.OnDestroy();
+  EXPECT_EQ(0, IpcRuntime::GetLiveCount());
+  EXPECT_EQ(baseline_, observer_.GetWindowCount());
+}
+
+//==============================================================================
+// Test Suite 2: Closing a Window
+//==============================================================================
+
+TEST_F(WindowLifecycleTest, OnDestroy_UncountsWindowBeforeContent) {
+  FakeWindow window(&observer_);
+  WindowLifecycle lifecycle(&window);
+  ASSERT_TRUE(lifecycle.OnCreate());
+
+  lifecycle.OnDestroy();
+  EXPECT_EQ(1, window.destroy_calls);
+  EXPECT_EQ(baseline_, window.count_at_destroy);
+  EXPECT_EQ(nullptr, lifecycle.shared_memory_manager());
+}
+
+TEST_F(WindowLifecycleTest, OnDestroy_TwiceOrBeforeCreate_DoesNothing) {
+  FakeWindow window(&observer_);
+  WindowLifecycle lifecycle(&window);
+  lifecycle.OnDestroy();
+  EXPECT_EQ(0, window.destroy_calls);
+
+  ASSERT_TRUE(lifecycle.OnCreate());
+  lifecycle.OnDestroy();
+  lifecycle.OnDestroy();
+  EXPECT_EQ(1, window.destroy_calls);
+  EXPECT_EQ(baseline_, observer_.GetWindowCount());
+}
+
+TEST_F(WindowLifecycleTest, Cycles_ReuseLifecycleAndStayBalanced) {
+  FakeWindow window(&observer_);
+  WindowLifecycle lifecycle(&window);
+  for (int i = 0; i < 20; i++) {
+    ASSERT_TRUE(lifecycle.OnCreate());
+    lifecycle.OnDestroy();
+  }
+  EXPECT_EQ(20, window.create_calls);
+  EXPECT_EQ(20, window.destroy_calls);
+  EXPECT_EQ(baseline_, observer_.GetWindowCount());
+}
+
+//==============================================================================
+// Test Suite 3: Phase Timing
+//==============================================================================
+
+TEST_F(WindowLifecycleTest, PhaseTicks_CoverCreateAndDestroy) {
+  FakeWindow window(&observer_);
+  WindowLifecycle lifecycle(&window);
+  ASSERT_TRUE(lifecycle.OnCreate());
+
+  int64_t create_total = 0;
+  for (int phase = 0; phase < kPhaseDecrement; phase++) {
+    int64_t ticks =
+        lifecycle.GetPhaseTicks(static_cast<WindowLifecyclePhase>(phase));
+    EXPECT_GE(ticks, 0);
+    create_total += ticks;
+  }
+  EXPECT_GT(create_total, 0);
+  // Closing phases have not run yet.
+  EXPECT_EQ(0, lifecycle.GetPhaseTicks(kPhaseRuntimeRelease));
+
+  lifecycle.OnDestroy();
+  // The last window stops the runtime, joining its listener thread.
+  EXPECT_GT(lifecycle.GetPhaseTicks(kPhaseRuntimeRelease), 0);
+}
+
+TEST_F(WindowLifecycleTest, PhaseName_IsDistinctForEveryPhase) {
+  for (int a = 0; a < kWindowLifecyclePhaseCount; a++) {
+    for (int b = a + 1; b < kWindowLifecyclePhaseCount; b++) {
+      EXPECT_STRNE(
+          WindowLifecyclePhaseName(static_cast<WindowLifecyclePhase>(a)),
+          WindowLifecyclePhaseName(static_cast<WindowLifecyclePhase>(b)));
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  UseIpcTestNamespaces("WindowLifecycleTest");
+  return RUN_ALL_TESTS();
+}